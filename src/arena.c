@@ -0,0 +1,129 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define ArenaBlockSize (64 * 1024)
+#define ArenaAlignment 16
+
+#define AlignUp(size) (((size) + ArenaAlignment - 1) & ~(size_t)(ArenaAlignment - 1))
+
+// Keeps the first allocation in a block aligned
+#define BlockHeaderSize AlignUp(sizeof(ArenaBlock))
+
+static void *blockData(ArenaBlock *block) {
+    return (uint8_t*)block + BlockHeaderSize;
+}
+
+static ArenaBlock *newBlock(Arena *arena, size_t size) {
+    size_t blockSize = size > ArenaBlockSize ? size : ArenaBlockSize;
+
+    ArenaBlock *block = arena->spare;
+    if (block != NULL && block->size >= blockSize) {
+        arena->spare = NULL;
+    }
+    else {
+        block = malloc(BlockHeaderSize + blockSize);
+        assert(block != NULL);
+        block->size = blockSize;
+    }
+
+    block->used = 0;
+    block->prev = arena->current;
+    arena->current = block;
+
+    return block;
+}
+
+void *arena_alloc(Arena *arena, size_t size) {
+    size = AlignUp(size);
+
+    ArenaBlock *block = arena->current;
+    if (block == NULL || block->size - block->used < size)
+        block = newBlock(arena, size);
+
+    void *mem = (uint8_t*)blockData(block) + block->used;
+    block->used += size;
+    arena->allocated += size;
+
+    // Rolled back memory gets handed out again, so always clear it
+    memset(mem, 0, size);
+    return mem;
+}
+
+void *arena_copy(Arena *arena, void *data, size_t size) {
+    void *mem = arena_alloc(arena, size);
+    memcpy(mem, data, size);
+    return mem;
+}
+
+ArenaMark arena_mark(Arena *arena) {
+    return (ArenaMark){
+        .block = arena->current,
+        .used = arena->current == NULL ? 0 : arena->current->used,
+        .allocated = arena->allocated,
+    };
+}
+
+void arena_rollback(Arena *arena, ArenaMark mark) {
+    while (arena->current != mark.block) {
+        ArenaBlock *block = arena->current;
+        assert(block != NULL);
+        arena->current = block->prev;
+
+        if (arena->spare == NULL) {
+            arena->spare = block;
+        }
+        else {
+            free(block);
+        }
+    }
+
+    if (arena->current != NULL)
+        arena->current->used = mark.used;
+
+    arena->allocated = mark.allocated;
+}
+
+void arena_release(Arena *arena) {
+    ArenaBlock *block = arena->current;
+    while (block != NULL) {
+        ArenaBlock *prev = block->prev;
+        free(block);
+        block = prev;
+    }
+
+    free(arena->spare);
+
+    arena->current = NULL;
+    arena->spare = NULL;
+    arena->allocated = 0;
+}
+
+void arena_absorb(Arena *arena, Arena *other) {
+    free(other->spare);
+    other->spare = NULL;
+
+    arena->allocated += other->allocated;
+    other->allocated = 0;
+
+    if (other->current == NULL)
+        return;
+
+    if (arena->current == NULL) {
+        arena->current = other->current;
+        other->current = NULL;
+        return;
+    }
+
+    // Slot the other chain in under the current block, so allocation keeps
+    // going where it was
+    ArenaBlock *bottom = other->current;
+    while (bottom->prev != NULL)
+        bottom = bottom->prev;
+
+    bottom->prev = arena->current->prev;
+    arena->current->prev = other->current;
+    other->current = NULL;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Bump allocator. Everything allocated from an arena is freed together by
+// arena_release, and a mark can be rolled back to throw away everything
+// allocated after it.
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *prev;
+    size_t size;
+    size_t used;
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *current;
+    // Last block given back by a rollback, kept so backtracking over a
+    // block boundary doesn't hit malloc every time
+    ArenaBlock *spare;
+    // Bytes handed out and not rolled back
+    size_t allocated;
+} Arena;
+
+typedef struct {
+    ArenaBlock *block;
+    size_t used;
+    size_t allocated;
+} ArenaMark;
+
+// Returns zeroed memory
+void *arena_alloc(Arena *arena, size_t size);
+void *arena_copy(Arena *arena, void *data, size_t size);
+
+ArenaMark arena_mark(Arena *arena);
+void arena_rollback(Arena *arena, ArenaMark mark);
+
+void arena_release(Arena *arena);
+
+// Moves every block of other into arena, leaving other empty. Marks taken
+// before this can't be rolled back to anymore.
+void arena_absorb(Arena *arena, Arena *other);
@@ -1,7 +1,30 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdlib.h>
+#include <assert.h>
+
 #define ArrayAppend(array, length, elem) {\
     length++;\
     array = realloc(array, length * sizeof(elem));\
     array[length - 1] = elem;\
 }
+
+// Makes room for at least needed elements. The capacity doubles, so growing
+// one element at a time stays linear.
+static inline void *growArray(void *array, size_t *capacity, size_t needed,
+    size_t elemSize)
+{
+    if (needed <= *capacity)
+        return array;
+
+    size_t newCapacity = *capacity == 0 ? 64 : *capacity * 2;
+    while (newCapacity < needed)
+        newCapacity *= 2;
+
+    array = realloc(array, newCapacity * elemSize);
+    assert(array != NULL);
+    *capacity = newCapacity;
+
+    return array;
+}
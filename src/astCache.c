@@ -0,0 +1,415 @@
+#include "astCache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "hashMap.h"
+#include "logger.h"
+#include "symbol.h"
+
+#define AstCacheMagic "SAAST\0\0\0"
+#define AstCacheAlignment 8
+
+// Every build of the analyzer writes caches only it will read back
+static uint64_t buildHash(void) {
+    static char buildId[] = __DATE__ " " __TIME__;
+    return hashBytes((uint8_t*)buildId, sizeof(buildId) - 1);
+}
+
+static uint64_t sourceHash(Buffer source) {
+    return hashBytes(source.bytes, source.size);
+}
+
+// Tokens without a file have an empty name, which always passes
+static bool fileHash(char *fileName, uint64_t *outHash) {
+    *outHash = 0;
+    if (*fileName == '\0')
+        return true;
+
+    Buffer buffer = {0};
+    if (!openAndReadFileToBuffer(fileName, &buffer))
+        return false;
+
+    *outHash = sourceHash(buffer);
+    free(buffer.bytes);
+    free(buffer.splices);
+
+    return true;
+}
+
+// Growable byte array the sections are staged in
+typedef struct {
+    size_t size;
+    size_t capacity;
+    uint8_t *bytes;
+} ByteArray;
+
+static size_t byteArray_append(ByteArray *array, void *data, size_t size) {
+    if (array->size + size > array->capacity) {
+        size_t capacity = array->capacity == 0 ? 4096 : array->capacity * 2;
+        while (capacity < array->size + size)
+            capacity *= 2;
+
+        array->bytes = realloc(array->bytes, capacity);
+        assert(array->bytes != NULL);
+        array->capacity = capacity;
+    }
+
+    size_t offset = array->size;
+    memcpy(array->bytes + offset, data, size);
+    array->size += size;
+
+    return offset;
+}
+
+static bool fitsIn32(size_t value) {
+    return value <= UINT32_MAX;
+}
+
+// Converts the tokens into their cached form, with the names and current
+// hashes of the files they came from. Fails if any count doesn't fit in 32
+// bits or a file can't be read.
+static bool cacheTokens(TokenList tokens, ByteArray *outTokens,
+    ByteArray *outText, ByteArray *outFileNames, ByteArray *outFileHashes)
+{
+    // File name -> index + 1
+    HashMap fileNameIds = {0};
+    size_t numFileNames = 0;
+
+    bool success = true;
+    for (size_t i = 0; i < tokens.numTokens && success; i++) {
+        Token *tok = tokens.tokens + i;
+
+        String fileName = astr(tok->fileName == NULL ? "" : tok->fileName);
+
+        void *id = NULL;
+        if (!hashMap_find(&fileNameIds, fileName, &id)) {
+            uint64_t hash = 0;
+            if (!fileHash((char*)fileName.str, &hash)) {
+                success = false;
+                break;
+            }
+
+            byteArray_append(outFileNames, fileName.str, fileName.length + 1);
+            byteArray_append(outFileHashes, &hash, sizeof(hash));
+            id = (void*)(++numFileNames);
+            hashMap_insert(&fileNameIds, fileName, id);
+        }
+
+        CachedToken cached = {
+            .type = tok->type,
+            .fileName = (size_t)id - 1,
+            .line = tok->line,
+            .col = tok->col,
+            .fileIndex = tok->fileIndex,
+        };
+
+        // Tokens with text all keep it in the same place in the union
+        if (tok->ident.str != NULL) {
+            cached.hasText = true;
+            cached.textOffset = outText->size;
+            cached.textLength = tok->ident.length;
+            byteArray_append(outText, tok->ident.str, tok->ident.length);
+        }
+
+        success = fitsIn32(tok->line) && fitsIn32(tok->col) &&
+            fitsIn32(tok->fileIndex) && fitsIn32(outText->size);
+
+        byteArray_append(outTokens, &cached, sizeof(CachedToken));
+    }
+
+    hashMap_cleanup(&fileNameIds);
+    return success;
+}
+
+static bool writeSection(FILE *file, AstCacheSection *section, void *data,
+    size_t elemSize, size_t count)
+{
+    static uint8_t padding[AstCacheAlignment];
+
+    long pos = ftell(file);
+    if (pos < 0)
+        return false;
+
+    size_t paddingSize = (AstCacheAlignment - pos % AstCacheAlignment) %
+        AstCacheAlignment;
+    if (fwrite(padding, 1, paddingSize, file) != paddingSize)
+        return false;
+
+    section->offset = pos + paddingSize;
+    section->count = count;
+
+    size_t size = elemSize * count;
+    return size == 0 || fwrite(data, 1, size, file) == size;
+}
+
+char *astCache_path(char *directory, char *sourceName) {
+    uint64_t hash = hashBytes((uint8_t*)sourceName, strlen(sourceName));
+
+    size_t size = strlen(directory) + sizeof("/0123456789abcdef.ast");
+    char *path = malloc(size);
+    assert(path != NULL);
+
+    snprintf(path, size, "%s/%016llx.ast", directory, (unsigned long long)hash);
+    return path;
+}
+
+bool astCache_write(char *path, Buffer source, TokenList tokens, FlatAst *ast) {
+    ByteArray cachedTokens = {0};
+    ByteArray tokenText = {0};
+    ByteArray fileNames = {0};
+    ByteArray fileHashes = {0};
+
+    if (!cacheTokens(tokens, &cachedTokens, &tokenText, &fileNames,
+        &fileHashes))
+    {
+        logError("AstCache: Couldn't cache %s\n", path);
+        free(cachedTokens.bytes);
+        free(tokenText.bytes);
+        free(fileNames.bytes);
+        free(fileHashes.bytes);
+        return false;
+    }
+
+    AstCacheHeader header = {
+        .version = AstCacheVersion,
+        .nodeSize = sizeof(FlatNode),
+        .tokenSize = sizeof(CachedToken),
+        .numNodeKinds = FlatNode_Count,
+        .sourceHash = sourceHash(source),
+        .buildHash = buildHash(),
+    };
+    memcpy(header.magic, AstCacheMagic, sizeof(header.magic));
+
+    bool success = false;
+
+    FILE *file = fopen(path, "wb");
+    if (file != NULL) {
+        AstCacheSection *sections = header.sections;
+
+        // The header is written again once the sections are placed
+        success = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            writeSection(file, sections + AstCacheSection_Nodes, ast->nodes,
+                sizeof(FlatNode), ast->numNodes) &&
+            writeSection(file, sections + AstCacheSection_Payloads,
+                ast->payloads, sizeof(uint32_t), ast->numPayloads) &&
+            writeSection(file, sections + AstCacheSection_Strings,
+                ast->strings, 1, ast->stringBytes) &&
+            writeSection(file, sections + AstCacheSection_Tokens,
+                cachedTokens.bytes, sizeof(CachedToken), tokens.numTokens) &&
+            writeSection(file, sections + AstCacheSection_TokenText,
+                tokenText.bytes, 1, tokenText.size) &&
+            writeSection(file, sections + AstCacheSection_FileNames,
+                fileNames.bytes, 1, fileNames.size) &&
+            writeSection(file, sections + AstCacheSection_FileHashes,
+                fileHashes.bytes, sizeof(uint64_t),
+                fileHashes.size / sizeof(uint64_t)) &&
+            fseek(file, 0, SEEK_SET) == 0 &&
+            fwrite(&header, sizeof(header), 1, file) == 1;
+
+        success = fclose(file) == 0 && success;
+    }
+
+    if (!success) {
+        logError("AstCache: Couldn't write %s\n", path);
+        remove(path);
+    }
+
+    free(cachedTokens.bytes);
+    free(tokenText.bytes);
+    free(fileNames.bytes);
+    free(fileHashes.bytes);
+
+    return success;
+}
+
+// Pointer to a section if it fits in the mapping, or NULL
+static void *sectionData(AstCache *cache, AstCacheHeader *header,
+    AstCacheSectionType type, size_t elemSize)
+{
+    AstCacheSection section = header->sections[type];
+
+    if (section.offset % AstCacheAlignment != 0 ||
+        section.offset > cache->mappingSize ||
+        section.count > (cache->mappingSize - section.offset) / elemSize)
+    {
+        return NULL;
+    }
+
+    return (uint8_t*)cache->mapping + section.offset;
+}
+
+// Rebuilds the tokens and file names from their cached form
+static bool loadTokens(AstCache *cache, AstCacheHeader *header) {
+    CachedToken *cachedTokens = sectionData(cache, header,
+        AstCacheSection_Tokens, sizeof(CachedToken));
+    char *text = sectionData(cache, header, AstCacheSection_TokenText, 1);
+    char *names = sectionData(cache, header, AstCacheSection_FileNames, 1);
+    if (cachedTokens == NULL || text == NULL || names == NULL)
+        return false;
+
+    size_t textSize = header->sections[AstCacheSection_TokenText].count;
+    size_t namesSize = header->sections[AstCacheSection_FileNames].count;
+
+    // Names point into the mapping, so the last one has to be terminated
+    if (namesSize > 0 && names[namesSize - 1] != '\0')
+        return false;
+
+    for (size_t i = 0; i < namesSize; i++) {
+        if (names[i] == '\0')
+            cache->numFileNames++;
+    }
+
+    cache->fileNames = malloc((cache->numFileNames + 1) * sizeof(char*));
+    assert(cache->fileNames != NULL);
+
+    char *name = names;
+    for (size_t i = 0; i < cache->numFileNames; i++) {
+        cache->fileNames[i] = name;
+        name += strlen(name) + 1;
+    }
+
+    size_t numTokens = header->sections[AstCacheSection_Tokens].count;
+    cache->tokens = (TokenList){
+        .numTokens = numTokens,
+        .tokens = calloc(numTokens + 1, sizeof(Token)),
+    };
+    assert(cache->tokens.tokens != NULL);
+
+    for (size_t i = 0; i < numTokens; i++) {
+        CachedToken cached = cachedTokens[i];
+        if (cached.fileName >= cache->numFileNames ||
+            (size_t)cached.textOffset + cached.textLength > textSize)
+        {
+            return false;
+        }
+
+        Token *tok = cache->tokens.tokens + i;
+        *tok = (Token){
+            .type = cached.type,
+            .line = cached.line,
+            .col = cached.col,
+            .fileName = cache->fileNames[cached.fileName],
+            .fileIndex = cached.fileIndex,
+        };
+
+        if (cached.hasText) {
+            tok->ident = (String){
+                (uint8_t*)text + cached.textOffset,
+                cached.textLength
+            };
+        }
+
+        // Symbol ids only mean something in the process that interned them
+        if (tok->type == Token_Ident)
+            tok->symbol = symbol_intern(tok->ident);
+    }
+
+    return true;
+}
+
+static bool filesUnchanged(AstCache *cache, uint64_t *fileHashes) {
+    for (size_t i = 0; i < cache->numFileNames; i++) {
+        uint64_t hash = 0;
+        if (!fileHash(cache->fileNames[i], &hash) || hash != fileHashes[i])
+            return false;
+    }
+
+    return true;
+}
+
+bool astCache_load(char *path, Buffer source, AstCache *outCache) {
+    *outCache = (AstCache){0};
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat info = {0};
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(AstCacheHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    outCache->mapping = mapping;
+    outCache->mappingSize = info.st_size;
+
+    AstCacheHeader *header = mapping;
+    if (memcmp(header->magic, AstCacheMagic, sizeof(header->magic)) != 0) {
+        logWarn("AstCache: %s isn't an AST cache\n", path);
+        astCache_cleanup(outCache);
+        return false;
+    }
+
+    // An old cache is a normal miss
+    if (header->version != AstCacheVersion ||
+        header->nodeSize != sizeof(FlatNode) ||
+        header->tokenSize != sizeof(CachedToken) ||
+        header->numNodeKinds != FlatNode_Count ||
+        header->buildHash != buildHash() ||
+        header->sourceHash != sourceHash(source))
+    {
+        astCache_cleanup(outCache);
+        return false;
+    }
+
+    FlatAst *ast = &(outCache->ast);
+    ast->nodes = sectionData(outCache, header, AstCacheSection_Nodes,
+        sizeof(FlatNode));
+    ast->payloads = sectionData(outCache, header, AstCacheSection_Payloads,
+        sizeof(uint32_t));
+    ast->strings = sectionData(outCache, header, AstCacheSection_Strings, 1);
+
+    uint64_t *fileHashes = sectionData(outCache, header,
+        AstCacheSection_FileHashes, sizeof(uint64_t));
+
+    bool valid = ast->nodes != NULL && ast->payloads != NULL &&
+        ast->strings != NULL && fileHashes != NULL &&
+        loadTokens(outCache, header) &&
+        header->sections[AstCacheSection_FileHashes].count ==
+            outCache->numFileNames;
+
+    // A header that changed since is a normal miss
+    if (valid && !filesUnchanged(outCache, fileHashes)) {
+        astCache_cleanup(outCache);
+        return false;
+    }
+
+    if (valid) {
+        ast->numNodes = header->sections[AstCacheSection_Nodes].count;
+        ast->numPayloads = header->sections[AstCacheSection_Payloads].count;
+        ast->stringBytes = header->sections[AstCacheSection_Strings].count;
+        ast->tokens = outCache->tokens.tokens;
+
+        valid = flatAst_validate(ast, outCache->tokens.numTokens);
+    }
+
+    if (!valid) {
+        logWarn("AstCache: %s is corrupt\n", path);
+        astCache_cleanup(outCache);
+        return false;
+    }
+
+    return true;
+}
+
+void astCache_cleanup(AstCache *cache) {
+    // The flat AST's arrays are in the mapping, so they aren't freed here
+    if (cache->mapping != NULL)
+        munmap(cache->mapping, cache->mappingSize);
+
+    free(cache->tokens.tokens);
+    free(cache->fileNames);
+
+    *cache = (AstCache){0};
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "buffer.h"
+#include "lexer.h"
+#include "flatAst.h"
+
+// Saves a flat AST with its tokens to a file that can be mapped back in
+// without parsing. Everything in the file is an index or an offset, so the
+// arrays are used straight out of the mapping. Only the tokens are rebuilt,
+// since rules use Tokens with pointers in them.
+//
+// A cache is only loaded if it was written by the same version of the format
+// and the same build of the analyzer, for a source file with the same
+// contents, and every file the tokens came from, like the headers it
+// includes, still has the contents it had then. Anything else counts as a
+// miss and the caller should parse.
+//
+// File layout, all in native byte order, every section 8 byte aligned:
+//   AstCacheHeader
+//   Nodes       FlatNode[]
+//   Payloads    uint32_t[]
+//   Strings     the flat AST's string pool
+//   Tokens      CachedToken[]
+//   TokenText   bytes every CachedToken's text points into
+//   FileNames   NUL terminated names
+//   FileHashes  uint64_t[] hash of each named file's contents, in name order
+
+#define AstCacheVersion 2
+
+typedef enum {
+    AstCacheSection_Nodes,
+    AstCacheSection_Payloads,
+    AstCacheSection_Strings,
+    AstCacheSection_Tokens,
+    AstCacheSection_TokenText,
+    AstCacheSection_FileNames,
+    AstCacheSection_FileHashes,
+    AstCacheSection_Count,
+} AstCacheSectionType;
+
+typedef struct {
+    uint64_t offset;
+    // Elements, or bytes for the text sections
+    uint64_t count;
+} AstCacheSection;
+
+typedef struct {
+    char magic[8];
+    uint32_t version;
+    // Guards against a different layout of the records
+    uint32_t nodeSize;
+    uint32_t tokenSize;
+    uint32_t numNodeKinds;
+    uint64_t sourceHash;
+    uint64_t buildHash;
+    AstCacheSection sections[AstCacheSection_Count];
+} AstCacheHeader;
+
+typedef struct {
+    uint32_t type;
+    // Index into the file names
+    uint32_t fileName;
+    uint32_t line;
+    uint32_t col;
+    uint32_t fileIndex;
+    // Into the token text, if the token has any
+    uint32_t textOffset;
+    uint32_t textLength;
+    uint32_t hasText;
+} CachedToken;
+
+typedef struct {
+    void *mapping;
+    size_t mappingSize;
+
+    FlatAst ast;
+    TokenList tokens;
+    size_t numFileNames;
+    char **fileNames;
+} AstCache;
+
+// The file in directory that sourceName's cache goes in, named after a hash of
+// sourceName. Free it when done.
+char *astCache_path(char *directory, char *sourceName);
+
+bool astCache_write(char *path, Buffer source, TokenList tokens, FlatAst *ast);
+
+// False on a miss. Files that aren't caches or don't pass validation are
+// logged.
+bool astCache_load(char *path, Buffer source, AstCache *outCache);
+void astCache_cleanup(AstCache *cache);
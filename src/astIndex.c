@@ -0,0 +1,84 @@
+#include "astIndex.h"
+
+#include <stdlib.h>
+#include <assert.h>
+
+#include "traversal.h"
+#include "array.h"
+
+#define IndexAppend(index, array, num, capacity, node) {\
+    index->array = growArray(index->array, &(index->capacity),\
+        index->num + 1, sizeof(*index->array));\
+    index->array[index->num++] = node;\
+}
+
+void astIndex_start(AstIndex *index, bool hasStmtExprs) {
+    *index = (AstIndex){
+        .hasBodies = true,
+        .hasStmtExprs = hasStmtExprs,
+    };
+}
+
+bool astIndex_visit(TraversalEvent event, TraversalType type, void *node,
+    void *data)
+{
+    AstIndex *index = data;
+
+    if (event == TraversalEvent_Leave)
+        return true;
+
+    switch (type) {
+    case Traversal_FuncDef:
+        IndexAppend(index, funcDefs, numFuncDefs, funcDefCapacity, node);
+        return true;
+    case Traversal_CompoundStmt:
+        IndexAppend(index, compoundStmts, numCompoundStmts,
+            compoundStmtCapacity, node);
+        return true;
+    case Traversal_Declaration:
+        IndexAppend(index, declarations, numDeclarations,
+            declarationCapacity, node);
+        return index->hasStmtExprs;
+    // The statements everything else is found under
+    case Traversal_TranslationUnit:
+    case Traversal_ExternalDecl:
+    case Traversal_BlockItemList:
+    case Traversal_BlockItem:
+    case Traversal_Statement:
+    case Traversal_LabeledStatement:
+    case Traversal_SelectionStatement:
+    case Traversal_IterationStatement:
+        return true;
+    default:
+        return index->hasStmtExprs;
+    }
+}
+
+void astIndex_build(AstIndex *index, TranslationUnit unit, bool withBodies,
+    bool hasStmtExprs)
+{
+    if (withBodies) {
+        astIndex_start(index, hasStmtExprs);
+        traverseEvents(&unit, false, astIndex_visit, index);
+        return;
+    }
+
+    *index = (AstIndex){
+        .hasStmtExprs = hasStmtExprs,
+    };
+
+    astList_foreach(unit.externalDecls, ExternalDecl, decl) {
+        if (decl->type == ExternalDecl_FuncDef) {
+            IndexAppend(index, funcDefs, numFuncDefs, funcDefCapacity,
+                &(decl->func));
+        }
+    }
+}
+
+void astIndex_cleanup(AstIndex *index) {
+    free(index->funcDefs);
+    free(index->declarations);
+    free(index->compoundStmts);
+
+    *index = (AstIndex){0};
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "parser.h"
+#include "traversal.h"
+
+// Lists of the nodes rules look for the most, in the order a traversal visits
+// them. Rules that only look at these nodes go through the lists instead of
+// traversing the whole tree.
+//
+// The parser builds the index once it has the whole tree, since nodes are
+// copied into their parents by value and only end up where they stay once
+// the parse is done. Only statements are walked to find them. Expressions are
+// only looked inside when the parser saw a statement expression, since that's
+// the only way one of these nodes ends up in an expression.
+typedef struct AstIndex {
+    size_t numFuncDefs;
+    size_t funcDefCapacity;
+    FuncDef **funcDefs;
+
+    size_t numDeclarations;
+    size_t declarationCapacity;
+    Declaration **declarations;
+
+    size_t numCompoundStmts;
+    size_t compoundStmtCapacity;
+    CompoundStmt **compoundStmts;
+
+    // Whether the Declarations and CompoundStmts are listed. They aren't while
+    // function bodies are deferred.
+    bool hasBodies;
+    // Whether the parse of the nodes outside deferred bodies saw a statement
+    // expression
+    bool hasStmtExprs;
+} AstIndex;
+
+// With bodies, every deferred function body has to be parsed already
+void astIndex_build(AstIndex *index, TranslationUnit unit, bool withBodies,
+    bool hasStmtExprs);
+// For listing the nodes, bodies included, in a walk that does other things
+// too. astIndex_visit is the walk's visitor, with the index as its data. It
+// doesn't matter whether the walk builds the legacy levels.
+void astIndex_start(AstIndex *index, bool hasStmtExprs);
+bool astIndex_visit(TraversalEvent event, TraversalType type, void *node,
+    void *data);
+void astIndex_cleanup(AstIndex *index);
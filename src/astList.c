@@ -0,0 +1,79 @@
+#include "astList.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#define ScratchInitialCapacity (16 * 1024)
+
+typedef struct {
+    size_t top;
+    size_t capacity;
+    uint8_t *bytes;
+} ScratchStack;
+
+static _Thread_local ScratchStack g_scratch;
+
+static size_t builderEnd(ListBuilder *builder) {
+    return builder->start + builder->size * builder->elemSize;
+}
+
+ListBuilder listBuilder_init(size_t elemSize) {
+    return (ListBuilder){
+        .elemSize = elemSize,
+        .start = g_scratch.top,
+    };
+}
+
+void listBuilder_append(ListBuilder *builder, void *elem) {
+    size_t end = builderEnd(builder);
+
+    // Anything above the builder belongs to a nested builder that was
+    // abandoned, so it can be overwritten
+    assert(g_scratch.top >= end);
+    g_scratch.top = end;
+
+    if (end + builder->elemSize > g_scratch.capacity) {
+        size_t capacity = g_scratch.capacity == 0 ?
+            ScratchInitialCapacity : g_scratch.capacity * 2;
+        while (capacity < end + builder->elemSize)
+            capacity *= 2;
+
+        g_scratch.bytes = realloc(g_scratch.bytes, capacity);
+        assert(g_scratch.bytes != NULL);
+        g_scratch.capacity = capacity;
+    }
+
+    memcpy(g_scratch.bytes + end, elem, builder->elemSize);
+    g_scratch.top = end + builder->elemSize;
+    builder->size++;
+}
+
+AstList listBuilder_finish(ListBuilder *builder, Arena *arena) {
+    AstList list = { .size = builder->size };
+
+    if (builder->size > 0) {
+        assert(g_scratch.top >= builderEnd(builder));
+        list.items = arena_copy(arena, g_scratch.bytes + builder->start,
+            builder->size * builder->elemSize);
+    }
+
+    g_scratch.top = builder->start;
+    builder->size = 0;
+
+    return list;
+}
+
+void listBuilder_reset(void) {
+    g_scratch.top = 0;
+}
+
+void listBuilder_release(void) {
+    free(g_scratch.bytes);
+    g_scratch = (ScratchStack){0};
+}
+
+size_t listBuilder_scratchBytes(void) {
+    return g_scratch.capacity;
+}
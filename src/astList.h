@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <assert.h>
+
+#include "arena.h"
+
+// Lists in the AST are a single array in the translation unit's arena.
+//
+// An element's children are allocated while the element is being parsed, so a
+// list can't grow in place in the arena. Elements are collected in a
+// ListBuilder instead and copied into the arena in one piece once the list is
+// closed.
+
+typedef struct {
+    size_t size;
+    void *items;
+} AstList;
+
+#define astList_get(list, type, index) ((type*)(list).items + (index))
+
+#define astList_foreach(list, type, name) for (type *name = (type*)(list).items;\
+    name < (type*)(list).items + (list).size; name++)
+
+// Builders stage their elements on a scratch stack shared by every builder on
+// the thread. Nested lists are always closed before the list around them gets
+// its next element, so builders use the stack in order. A builder that's
+// abandoned because its production failed is simply forgotten, and its
+// elements get overwritten by the next builder further out.
+typedef struct {
+    size_t elemSize;
+    size_t start;
+    size_t size;
+} ListBuilder;
+
+ListBuilder listBuilder_init(size_t elemSize);
+void listBuilder_append(ListBuilder *builder, void *elem);
+
+// Copies the elements into the arena and gives the stack space back
+AstList listBuilder_finish(ListBuilder *builder, Arena *arena);
+
+// Throws away everything staged by any builder
+void listBuilder_reset(void);
+
+// Frees the thread's scratch stack, for threads that are done parsing
+void listBuilder_release(void);
+
+// Bytes the thread's scratch stack has grown to
+size_t listBuilder_scratchBytes(void);
+
+#define listBuilder_appendLocal(builder, data) do {\
+    assert(sizeof(data) == (builder)->elemSize);\
+    listBuilder_append(builder, &(data));\
+} while (0)
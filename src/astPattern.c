@@ -0,0 +1,294 @@
+#include "astPattern.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "array.h"
+
+void astPatterns_add(AstPatterns *patterns, const AstPattern *added,
+    size_t numAdded, void *data)
+{
+    patterns->entries = growArray(patterns->entries,
+        &(patterns->entryCapacity), patterns->numEntries + numAdded,
+        sizeof(AstPatternEntry));
+
+    for (size_t i = 0; i < numAdded; i++) {
+        patterns->entries[patterns->numEntries++] = (AstPatternEntry){
+            .pattern = added + i,
+            .data = data,
+        };
+    }
+}
+
+static size_t pattern_numTests(const AstPattern *pattern) {
+    size_t numTests = 0;
+    while (numTests < MaxAstPatternTests &&
+        pattern->tests[numTests].size != 0)
+    {
+        numTests++;
+    }
+
+    return numTests;
+}
+
+static bool test_equals(const AstPatternTest *a, const AstPatternTest *b) {
+    return a->pointer == b->pointer && a->offset == b->offset &&
+        a->size == b->size && a->op == b->op && a->value == b->value;
+}
+
+static uint32_t compile_addStates(AstPatterns *patterns, size_t count) {
+    patterns->states = growArray(patterns->states,
+        &(patterns->stateCapacity), patterns->numStates + count,
+        sizeof(AstPatternState));
+
+    uint32_t first = patterns->numStates;
+    patterns->numStates += count;
+
+    return first;
+}
+
+// Fills in the state for the entries that passed the tests before depth.
+// Entries with no more tests end here, and the rest are split by their next
+// test, in the order the tests first show up.
+static void compile_state(AstPatterns *patterns, uint32_t state,
+    uint32_t *entries, size_t numEntries, size_t depth)
+{
+    patterns->matches = growArray(patterns->matches,
+        &(patterns->matchCapacity), patterns->numMatches + numEntries,
+        sizeof(uint32_t));
+
+    patterns->states[state].firstMatch = patterns->numMatches;
+    size_t numRest = 0;
+    for (size_t i = 0; i < numEntries; i++) {
+        const AstPattern *pattern = patterns->entries[entries[i]].pattern;
+        if (pattern_numTests(pattern) == depth)
+            patterns->matches[patterns->numMatches++] = entries[i];
+        else
+            entries[numRest++] = entries[i];
+    }
+    patterns->states[state].numMatches =
+        patterns->numMatches - patterns->states[state].firstMatch;
+
+    // Group the rest by their next test, keeping each group in order
+    size_t numGroups = 0;
+    size_t *groupEnds = malloc((numRest + 1) * sizeof(size_t));
+    assert(groupEnds != NULL);
+
+    for (size_t start = 0; start < numRest; start = groupEnds[numGroups++]) {
+        const AstPatternTest *test =
+            patterns->entries[entries[start]].pattern->tests + depth;
+
+        size_t end = start + 1;
+        for (size_t i = start + 1; i < numRest; i++) {
+            const AstPatternTest *other =
+                patterns->entries[entries[i]].pattern->tests + depth;
+            if (!test_equals(test, other))
+                continue;
+
+            uint32_t moved = entries[i];
+            memmove(entries + end + 1, entries + end,
+                (i - end) * sizeof(uint32_t));
+            entries[end++] = moved;
+        }
+
+        groupEnds[numGroups] = end;
+    }
+
+    uint32_t firstChild = compile_addStates(patterns, numGroups);
+    patterns->states[state].firstChild = firstChild;
+    patterns->states[state].numChildren = numGroups;
+
+    size_t start = 0;
+    for (size_t i = 0; i < numGroups; i++) {
+        patterns->states[firstChild + i] = (AstPatternState){
+            .test = patterns->entries[entries[start]].pattern->tests[depth],
+        };
+        compile_state(patterns, firstChild + i, entries + start,
+            groupEnds[i] - start, depth + 1);
+        start = groupEnds[i];
+    }
+
+    free(groupEnds);
+}
+
+static bool isLegacyType(TraversalType type) {
+    switch (type) {
+#define LegacyTypeCase(type) case Traversal_ ## type:
+    LegacyBinaryTypes(LegacyTypeCase)
+#undef LegacyTypeCase
+        return true;
+    default:
+        return false;
+    }
+}
+
+void astPatterns_compile(AstPatterns *patterns) {
+    patterns->numStates = 0;
+    patterns->numMatches = 0;
+    patterns->legacyLevels = false;
+    patterns->wanted = 0;
+
+    uint32_t *entries = malloc((patterns->numEntries + 1) * sizeof(uint32_t));
+    assert(entries != NULL);
+
+    for (size_t type = 0; type < Traversal_Count; type++) {
+        size_t numEntries = 0;
+        for (size_t i = 0; i < patterns->numEntries; i++) {
+            if (patterns->entries[i].pattern->type == type)
+                entries[numEntries++] = i;
+        }
+
+        if (numEntries == 0) {
+            patterns->roots[type] = AstPattern_NoState;
+            continue;
+        }
+
+        patterns->legacyLevels = patterns->legacyLevels || isLegacyType(type);
+        patterns->wanted |= traversal_trackedKind(type);
+
+        uint32_t root = compile_addStates(patterns, 1);
+        patterns->states[root] = (AstPatternState){0};
+        patterns->roots[type] = root;
+        compile_state(patterns, root, entries, numEntries, 0);
+    }
+
+    free(entries);
+}
+
+static bool test_passes(const AstPatternTest *test, void *node) {
+    uint8_t *base = node;
+    if (test->pointer != AstPattern_NoPointer) {
+        memcpy(&base, base + test->pointer, sizeof(base));
+        if (base == NULL)
+            return false;
+    }
+
+    uint64_t value = 0;
+    switch (test->size) {
+    case 1: {
+        uint8_t field;
+        memcpy(&field, base + test->offset, 1);
+        value = field;
+        break;
+    }
+    case 2: {
+        uint16_t field;
+        memcpy(&field, base + test->offset, 2);
+        value = field;
+        break;
+    }
+    case 4: {
+        uint32_t field;
+        memcpy(&field, base + test->offset, 4);
+        value = field;
+        break;
+    }
+    case 8:
+        memcpy(&value, base + test->offset, 8);
+        break;
+    default:
+        assert(false);
+    }
+
+    switch (test->op) {
+    case AstPatternOp_Equal:
+        return value == test->value;
+    case AstPatternOp_NotEqual:
+        return value != test->value;
+    case AstPatternOp_Greater:
+        return value > test->value;
+    default:
+        assert(false);
+        return false;
+    }
+}
+
+static void walk_run(AstPatternWalk *walk, uint32_t stateIndex, void *node) {
+    AstPatterns *patterns = walk->patterns;
+    AstPatternState *state = patterns->states + stateIndex;
+
+    if (state->numMatches > 0) {
+        walk->matched = growArray(walk->matched, &(walk->matchedCapacity),
+            walk->numMatched + state->numMatches, sizeof(uint32_t));
+        memcpy(walk->matched + walk->numMatched,
+            patterns->matches + state->firstMatch,
+            state->numMatches * sizeof(uint32_t));
+        walk->numMatched += state->numMatches;
+    }
+
+    for (uint32_t i = 0; i < state->numChildren; i++) {
+        uint32_t child = state->firstChild + i;
+        if (test_passes(&(patterns->states[child].test), node))
+            walk_run(walk, child, node);
+    }
+}
+
+AstPatternWalk astPatterns_startMatch(AstPatterns *patterns,
+    AstPatternMatch onMatch)
+{
+    return (AstPatternWalk){
+        .patterns = patterns,
+        .onMatch = onMatch,
+    };
+}
+
+bool astPatterns_visit(TraversalEvent event, TraversalType type, void *node,
+    void *data)
+{
+    AstPatternWalk *walk = data;
+    AstPatterns *patterns = walk->patterns;
+
+    if (event == TraversalEvent_Leave)
+        return true;
+
+    uint32_t root = patterns->roots[type];
+    if (root != AstPattern_NoState) {
+        walk->numMatched = 0;
+        walk_run(walk, root, node);
+
+        // Back in the order the patterns were added. There's rarely more than
+        // one or two.
+        for (size_t i = 1; i < walk->numMatched; i++) {
+            uint32_t entry = walk->matched[i];
+            size_t j = i;
+            for (; j > 0 && walk->matched[j - 1] > entry; j--)
+                walk->matched[j] = walk->matched[j - 1];
+            walk->matched[j] = entry;
+        }
+
+        for (size_t i = 0; i < walk->numMatched; i++) {
+            AstPatternEntry *entry = patterns->entries + walk->matched[i];
+            walk->onMatch(entry->pattern, node, entry->data);
+        }
+    }
+
+    // Nothing under the node has a type any of the patterns are on
+    NodeKindMask kinds = traversal_nodeKinds(type, node);
+    return patterns->wanted == AllNodeKinds || kinds == AllNodeKinds ||
+        (kinds & patterns->wanted) != 0;
+}
+
+void astPatterns_endMatch(AstPatternWalk *walk) {
+    free(walk->matched);
+    walk->matched = NULL;
+}
+
+void astPatterns_match(AstPatterns *patterns, TranslationUnit *unit,
+    AstPatternMatch onMatch)
+{
+    if (patterns->numStates == 0)
+        return;
+
+    AstPatternWalk walk = astPatterns_startMatch(patterns, onMatch);
+    traverseEvents(unit, patterns->legacyLevels, astPatterns_visit, &walk);
+    astPatterns_endMatch(&walk);
+}
+
+void astPatterns_cleanup(AstPatterns *patterns) {
+    free(patterns->entries);
+    free(patterns->states);
+    free(patterns->matches);
+
+    *patterns = (AstPatterns){0};
+}
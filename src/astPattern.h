@@ -0,0 +1,152 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "parser.h"
+#include "traversal.h"
+
+// Declarative checks on AST nodes. A pattern names a node type and a few tests
+// on the node's fields, for example "an IterationStatement of type While whose
+// whileStmt isn't a compound statement". Patterns are added to a set, which
+// compiles them into a decision tree per node type where patterns that start
+// with the same tests share them. A single walk of the unit then runs every
+// pattern in the set.
+
+typedef enum {
+    AstPatternOp_Equal,
+    AstPatternOp_NotEqual,
+    AstPatternOp_Greater,
+} AstPatternOp;
+
+#define AstPattern_NoPointer SIZE_MAX
+
+typedef struct {
+    // Offset of a pointer in the node to follow before reading the field, or
+    // AstPattern_NoPointer to read the node's own field. A test through a
+    // NULL pointer fails.
+    size_t pointer;
+    size_t offset;
+    // 1, 2, 4 or 8 bytes. Tests end at the first one that's 0.
+    uint8_t size;
+    AstPatternOp op;
+    uint64_t value;
+} AstPatternTest;
+
+#define AstPatternField(type, field, fieldOp, fieldValue) {\
+    .pointer = AstPattern_NoPointer,\
+    .offset = offsetof(type, field),\
+    .size = sizeof(((type*)0)->field),\
+    .op = fieldOp,\
+    .value = (uint64_t)(fieldValue),\
+}
+
+#define AstPatternChildField(type, pointerField, childType, field, fieldOp,\
+    fieldValue)\
+{\
+    .pointer = offsetof(type, pointerField),\
+    .offset = offsetof(childType, field),\
+    .size = sizeof(((childType*)0)->field),\
+    .op = fieldOp,\
+    .value = (uint64_t)(fieldValue),\
+}
+
+// Fields of nodes stored inside the node can be named too, as in list.size
+#define PatternIs(type, field, value)\
+    AstPatternField(type, field, AstPatternOp_Equal, value)
+#define PatternIsNot(type, field, value)\
+    AstPatternField(type, field, AstPatternOp_NotEqual, value)
+#define PatternMoreThan(type, field, value)\
+    AstPatternField(type, field, AstPatternOp_Greater, value)
+
+// Tests a field of the node that one of the node's pointers points to
+#define PatternChildIs(type, pointerField, childType, field, value)\
+    AstPatternChildField(type, pointerField, childType, field,\
+        AstPatternOp_Equal, value)
+#define PatternChildIsNot(type, pointerField, childType, field, value)\
+    AstPatternChildField(type, pointerField, childType, field,\
+        AstPatternOp_NotEqual, value)
+
+#define MaxAstPatternTests 4
+
+typedef struct {
+    TraversalType type;
+    AstPatternTest tests[MaxAstPatternTests];
+
+    // Offset of the Token pointer in the node that a match is reported at,
+    // and what's reported
+    size_t token;
+    char *message;
+} AstPattern;
+
+// Called for every node a pattern matches, with the data the pattern was
+// added with. Patterns that match the same node are called in the order they
+// were added.
+typedef void (*AstPatternMatch)(const AstPattern *pattern, void *node,
+    void *data);
+
+typedef struct {
+    const AstPattern *pattern;
+    void *data;
+} AstPatternEntry;
+
+typedef struct {
+    // A test a node has to pass to get to the state's children and matches.
+    // The root state of each type has no test.
+    AstPatternTest test;
+    uint32_t firstChild;
+    uint32_t numChildren;
+    uint32_t firstMatch;
+    uint32_t numMatches;
+} AstPatternState;
+
+#define AstPattern_NoState UINT32_MAX
+
+typedef struct {
+    size_t numEntries;
+    size_t entryCapacity;
+    AstPatternEntry *entries;
+
+    // Filled in by astPatterns_compile
+    uint32_t roots[Traversal_Count];
+    size_t numStates;
+    size_t stateCapacity;
+    AstPatternState *states;
+    // Indices into entries for the states' matches
+    size_t numMatches;
+    size_t matchCapacity;
+    uint32_t *matches;
+    // Whether any pattern is on the LogicalOrExpr to MultiplicativeExpr levels
+    bool legacyLevels;
+    // Kinds the patterns' types are tracked as. See traversal_trackedKind.
+    NodeKindMask wanted;
+} AstPatterns;
+
+void astPatterns_add(AstPatterns *patterns, const AstPattern *added,
+    size_t numAdded, void *data);
+void astPatterns_compile(AstPatterns *patterns);
+// Walks the unit once and calls onMatch for every match, in the order of the
+// walk
+void astPatterns_match(AstPatterns *patterns, TranslationUnit *unit,
+    AstPatternMatch onMatch);
+
+typedef struct {
+    AstPatterns *patterns;
+    AstPatternMatch onMatch;
+
+    size_t numMatched;
+    size_t matchedCapacity;
+    uint32_t *matched;
+} AstPatternWalk;
+
+// For matching in a walk that does other things too. astPatterns_visit is
+// the walk's visitor, with the AstPatternWalk as its data, and the walk has
+// to build the legacy levels when the patterns' legacyLevels is set. Ending
+// the match frees what it used.
+AstPatternWalk astPatterns_startMatch(AstPatterns *patterns,
+    AstPatternMatch onMatch);
+bool astPatterns_visit(TraversalEvent event, TraversalType type, void *node,
+    void *data);
+void astPatterns_endMatch(AstPatternWalk *walk);
+void astPatterns_cleanup(AstPatterns *patterns);
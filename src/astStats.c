@@ -0,0 +1,575 @@
+#include "astStats.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <assert.h>
+#include <errno.h>
+
+#include "buffer.h"
+#include "lexer.h"
+#include "parser.h"
+#include "traversal.h"
+#include "logger.h"
+#include "flatAst.h"
+#include "astCache.h"
+
+static char *g_typeNames[] = {
+#define AstStatsTypeName(type) #type,
+    AstStatsTypes(AstStatsTypeName)
+#undef AstStatsTypeName
+};
+
+void astStats_recordAllocation(AstStats *stats, AstStatsType type,
+    size_t numNodes, size_t bytes, size_t arenaBytes)
+{
+    assert(type < AstStats_Count);
+
+    stats->types[type].allocations += numNodes;
+    stats->types[type].allocatedBytes += bytes;
+
+    if (arenaBytes > stats->peakArenaBytes)
+        stats->peakArenaBytes = arenaBytes;
+}
+
+void astStats_recordList(AstStats *stats, AstStatsType type, size_t length) {
+    assert(type < AstStats_Count);
+
+    stats->types[type].lists++;
+    stats->types[type].listElems += length;
+}
+
+static AstBacktrackStats *findProduction(AstStats *stats,
+    const char *production)
+{
+    // There are only a few dozen productions
+    for (size_t i = 0; i < stats->numProductions; i++) {
+        if (stats->productions[i].production == production)
+            return stats->productions + i;
+    }
+
+    if (stats->numProductions == stats->productionCapacity) {
+        stats->productionCapacity = stats->productionCapacity == 0 ?
+            32 : stats->productionCapacity * 2;
+        stats->productions = realloc(stats->productions,
+            stats->productionCapacity * sizeof(AstBacktrackStats));
+        assert(stats->productions != NULL);
+    }
+
+    AstBacktrackStats *res = stats->productions + stats->numProductions++;
+    *res = (AstBacktrackStats){ .production = production };
+
+    return res;
+}
+
+void astStats_recordBacktrack(AstStats *stats, const char *production) {
+    stats->numBacktracks++;
+    findProduction(stats, production)->count++;
+}
+
+void astStats_merge(AstStats *stats, AstStats *other) {
+    for (size_t i = 0; i < AstStats_Count; i++) {
+        AstTypeStats *type = stats->types + i;
+        AstTypeStats *otherType = other->types + i;
+
+        type->count += otherType->count;
+        type->unionWaste += otherType->unionWaste;
+        type->allocations += otherType->allocations;
+        type->allocatedBytes += otherType->allocatedBytes;
+        type->lists += otherType->lists;
+        type->listElems += otherType->listElems;
+    }
+
+    stats->numBacktracks += other->numBacktracks;
+    for (size_t i = 0; i < other->numProductions; i++) {
+        AstBacktrackStats backtracks = other->productions[i];
+        findProduction(stats, backtracks.production)->count += backtracks.count;
+    }
+
+    stats->peakArenaBytes += other->peakArenaBytes;
+    stats->memoBytes += other->memoBytes;
+    stats->listScratchBytes += other->listScratchBytes;
+}
+
+void astStats_cleanup(AstStats *stats) {
+    free(stats->productions);
+    *stats = (AstStats){0};
+}
+
+// Union waste
+//
+// A union is as big as its biggest member, so a node whose type picks a
+// smaller member leaves the rest unused. Only a node's own unions are counted.
+// Nodes stored inside a union are counted when the walk gets to them.
+
+// Bytes from the start of one member to the end of another, for the anonymous
+// structs inside unions
+#define MemberSpan(type, first, last) (offsetof(type, last) +\
+    sizeof(((type*)0)->last) - offsetof(type, first))
+
+// Sizes are indexed by the node's type. Types without a member leave theirs 0.
+static size_t unionWaste(size_t active, size_t numMembers, size_t *sizes) {
+    if (active >= numMembers)
+        return 0;
+
+    size_t max = 0;
+    for (size_t i = 0; i < numMembers; i++) {
+        if (sizes[i] > max)
+            max = sizes[i];
+    }
+
+    return max - sizes[active];
+}
+
+#define UnionWaste(active, ...) unionWaste(active,\
+    sizeof((size_t[]){ __VA_ARGS__ }) / sizeof(size_t),\
+    (size_t[]){ __VA_ARGS__ })
+
+static size_t nodeUnionWaste(AstStatsType type, void *data) {
+    switch (type) {
+        case AstStats_Designator: {
+            Designator *node = data;
+            return UnionWaste(node->type,
+                [Designator_Constant] = sizeof(node->constantExpr),
+                [Designator_Ident] = sizeof(node->ident));
+        }
+        case AstStats_PrimaryExpr: {
+            PrimaryExpr *node = data;
+            return UnionWaste(node->type,
+                [PrimaryExpr_Ident] = sizeof(node->ident),
+                [PrimaryExpr_Constant] = sizeof(node->constant),
+                [PrimaryExpr_String] = sizeof(node->string),
+                [PrimaryExpr_Expr] = sizeof(node->expr),
+                [PrimaryExpr_GenericSelection] = sizeof(node->genericSelection));
+        }
+        case AstStats_PostfixOp: {
+            PostfixOp *node = data;
+            return UnionWaste(node->type,
+                [PostfixOp_Index] = sizeof(node->indexExpr),
+                [PostfixOp_Call] = MemberSpan(PostfixOp, callHasEmptyArgs,
+                    callExprs),
+                [PostfixOp_Dot] = sizeof(node->dotIdent),
+                [PostfixOp_Arrow] = sizeof(node->arrowIdent),
+                [PostfixOp_Dec] = 0);
+        }
+        case AstStats_PostfixExpr: {
+            PostfixExpr *node = data;
+            return UnionWaste(node->type,
+                [Postfix_Primary] = sizeof(node->primary),
+                [Postfix_InitializerList] = MemberSpan(PostfixExpr,
+                    initializerListType, initializerList));
+        }
+        case AstStats_UnaryExpr: {
+            UnaryExpr *node = data;
+            return UnionWaste(node->type,
+                [UnaryExpr_UnaryOp] = MemberSpan(UnaryExpr, unaryOpType,
+                    unaryOpCast),
+                [UnaryExpr_Inc] = sizeof(node->incOpExpr),
+                [UnaryExpr_Dec] = sizeof(node->decOpExpr),
+                [UnaryExpr_SizeofExpr] = sizeof(node->sizeofExpr),
+                [UnaryExpr_SizeofType] = sizeof(node->sizeofTypeName),
+                [UnaryExpr_AlignofType] = sizeof(node->alignofTypeName),
+                [UnaryExpr_Base] = sizeof(node->baseExpr));
+        }
+        case AstStats_CastExpr: {
+            CastExpr *node = data;
+            return UnionWaste(node->type,
+                [CastExpr_Unary] = sizeof(node->unary),
+                [CastExpr_Cast] = MemberSpan(CastExpr, castType, castExpr));
+        }
+        case AstStats_BinaryExpr: {
+            // Only the lowest level uses the cast
+            BinaryExpr *node = data;
+            return UnionWaste(node->level == BinaryExpr_Cast ? 0 : 1,
+                sizeof(node->cast), sizeof(node->operands));
+        }
+        case AstStats_InnerExpr: {
+            InnerExpr *node = data;
+            return UnionWaste(node->type,
+                [InnerExpr_Assign] = sizeof(node->assign),
+                [InnerExpr_CompoundStatement] = sizeof(node->compoundStmt));
+        }
+        case AstStats_PostDirectAbstractDeclarator: {
+            PostDirectAbstractDeclarator *node = data;
+            return UnionWaste(node->type,
+                [PostDirectAbstractDeclarator_Bracket] = MemberSpan(
+                    PostDirectAbstractDeclarator, bracketIsEmpty,
+                    bracketAssignExpr),
+                [PostDirectAbstractDeclarator_Paren] = MemberSpan(
+                    PostDirectAbstractDeclarator, parenIsEmpty,
+                    parenParamList));
+        }
+        case AstStats_PostDirectDeclarator: {
+            PostDirectDeclarator *node = data;
+            size_t bracketSize = MemberSpan(PostDirectDeclarator,
+                bracketIsEmpty, bracketAssignExpr);
+            size_t identListSize = MemberSpan(PostDirectDeclarator,
+                parenType, parenIdentList);
+            size_t paramListSize = MemberSpan(PostDirectDeclarator,
+                parenType, parenParamTypeList);
+            size_t parenSize = identListSize > paramListSize ?
+                identListSize : paramListSize;
+
+            size_t waste = UnionWaste(node->type,
+                [PostDirectDeclarator_Paren] = parenSize,
+                [PostDirectDeclarator_Bracket] = bracketSize);
+
+            // Parens have a union of their own
+            if (node->type == PostDirectDeclarator_Paren) {
+                waste += UnionWaste(node->parenType,
+                    [PostDirectDeclaratorParen_Empty] = 0,
+                    [PostDirectDeclaratorParen_IdentList] =
+                        sizeof(node->parenIdentList),
+                    [PostDirectDeclaratorParen_ParamTypelist] =
+                        sizeof(node->parenParamTypeList));
+            }
+
+            return waste;
+        }
+        case AstStats_DirectDeclarator: {
+            DirectDeclarator *node = data;
+            return UnionWaste(node->type,
+                [DirectDeclarator_Ident] = sizeof(node->ident),
+                [DirectDeclarator_ParenDeclarator] = sizeof(node->declarator));
+        }
+        case AstStats_SpecifierQualifier: {
+            SpecifierQualifier *node = data;
+            return UnionWaste(node->type,
+                [SpecifierQualifier_Specifier] = sizeof(node->typeSpecifier),
+                [SpecifierQualifier_Qualifier] = sizeof(node->typeQualifier));
+        }
+        case AstStats_StructDeclaration: {
+            StructDeclaration *node = data;
+            return UnionWaste(node->type,
+                [StructDeclaration_StaticAssert] = sizeof(node->staticAssert),
+                [StructDeclaration_Normal] = MemberSpan(StructDeclaration,
+                    normalSpecifierQualifiers, normalStructDeclaratorList));
+        }
+        case AstStats_TypeSpecifier: {
+            TypeSpecifier *node = data;
+            return UnionWaste(node->type,
+                [TypeSpecifier_AtomicType] = sizeof(node->atomicName),
+                [TypeSpecifier_StructOrUnion] = sizeof(node->structOrUnion),
+                [TypeSpecifier_Enum] = sizeof(node->enumSpecifier),
+                [TypeSpecifier_TypedefName] = sizeof(node->typedefName));
+        }
+        case AstStats_AlignmentSpecifier: {
+            AlignmentSpecifier *node = data;
+            return UnionWaste(node->type,
+                [AlignmentSpecifier_TypeName] = sizeof(node->typeName),
+                [AlignmentSpecifier_Constant] = sizeof(node->constant));
+        }
+        case AstStats_DeclarationSpecifier: {
+            DeclarationSpecifier *node = data;
+            return UnionWaste(node->type,
+                [DeclarationSpecifier_StorageClass] = sizeof(node->storageClass),
+                [DeclarationSpecifier_Type] = sizeof(node->typeSpecifier),
+                [DeclarationSpecifier_TypeQualifier] = sizeof(node->typeQualifier),
+                [DeclarationSpecifier_Func] = sizeof(node->function),
+                [DeclarationSpecifier_Alignment] = sizeof(node->alignment));
+        }
+        case AstStats_Declaration: {
+            Declaration *node = data;
+            return UnionWaste(node->type,
+                [Declaration_StaticAssert] = sizeof(node->staticAssert),
+                [Declaration_Normal] = MemberSpan(Declaration, declSpecifiers,
+                    initDeclaratorList));
+        }
+        case AstStats_LabeledStatement: {
+            LabeledStatement *node = data;
+            return UnionWaste(node->type,
+                [LabeledStatement_Ident] = sizeof(node->ident),
+                [LabeledStatement_Case] = sizeof(node->caseConstExpr),
+                [LabeledStatement_Default] = 0);
+        }
+        case AstStats_SelectionStatement: {
+            SelectionStatement *node = data;
+            return UnionWaste(node->type,
+                [SelectionStatement_If] = MemberSpan(SelectionStatement,
+                    ifToken, ifFalseStmt),
+                [SelectionStatement_Switch] = MemberSpan(SelectionStatement,
+                    switchToken, switchStmt));
+        }
+        case AstStats_IterationStatement: {
+            IterationStatement *node = data;
+            return UnionWaste(node->type,
+                [IterationStatement_While] = MemberSpan(IterationStatement,
+                    whileToken, whileStmt),
+                [IterationStatement_DoWhile] = MemberSpan(IterationStatement,
+                    doToken, doExpr),
+                [IterationStatement_For] = MemberSpan(IterationStatement,
+                    forToken, forStmt));
+        }
+        case AstStats_JumpStatement: {
+            JumpStatement *node = data;
+            return UnionWaste(node->type,
+                [JumpStatement_Goto] = sizeof(node->gotoIdent),
+                [JumpStatement_Return] = MemberSpan(JumpStatement,
+                    returnHasExpr, returnExpr));
+        }
+        case AstStats_Statement: {
+            Statement *node = data;
+            return UnionWaste(node->type,
+                [Statement_Labeled] = sizeof(node->labeled),
+                [Statement_Compound] = sizeof(node->compound),
+                [Statement_Expression] = sizeof(node->expression),
+                [Statement_Selection] = sizeof(node->selection),
+                [Statement_Iteration] = sizeof(node->iteration),
+                [Statement_Jump] = sizeof(node->jump),
+                [Statement_Asm] = sizeof(node->assembly));
+        }
+        case AstStats_BlockItem: {
+            BlockItem *node = data;
+            return UnionWaste(node->type,
+                [BlockItem_Declaration] = sizeof(node->decl),
+                [BlockItem_Statement] = sizeof(node->stmt));
+        }
+        case AstStats_ExternalDecl: {
+            ExternalDecl *node = data;
+            return UnionWaste(node->type,
+                [ExternalDecl_FuncDef] = sizeof(node->func),
+                [ExternalDecl_Decl] = sizeof(node->decl));
+        }
+        default:
+            return 0;
+    }
+}
+
+// Counts every node the traversal gets to, along with its union waste
+#define AstStatsCountFunc(type)\
+static void countNode_ ## type(TraversalFuncTable *table, type *node, void *data) {\
+    AstTypeStats *stats = ((AstStats*)data)->types + AstStats_ ## type;\
+    stats->count++;\
+    stats->unionWaste += nodeUnionWaste(AstStats_ ## type, node);\
+    defaultTraversal_ ## type(table, node, data);\
+}
+AstStatsNodeTypes(AstStatsCountFunc)
+#undef AstStatsCountFunc
+
+static void countNodes(AstStats *stats, TranslationUnit *unit) {
+    TraversalFuncTable table = defaultTraversal();
+#define AstStatsSetCountFunc(type) table.traverse_ ## type = countNode_ ## type;
+    AstStatsNodeTypes(AstStatsSetCountFunc)
+#undef AstStatsSetCountFunc
+
+    traverse(table, *unit, stats);
+}
+
+// The flat AST keeps the same nodes as the tree, so it has a stats type for
+// each of its kinds
+static const AstStatsType g_flatKindTypes[FlatNode_Count] = {
+#define AstStatsFlatKind(type) [FlatNode_ ## type] = AstStats_ ## type,
+    FlatNodeKinds(AstStatsFlatKind)
+#undef AstStatsFlatKind
+};
+
+static void countFlatNodes(AstStats *stats, FlatAst *ast) {
+    for (size_t i = 0; i < ast->numNodes; i++) {
+        stats->types[g_flatKindTypes[ast->nodes[i].kind]].count++;
+    }
+}
+
+// The counts come from the flat AST when there is one, and the union waste
+// from a walk over the tree, which needs the nodes themselves. The walk counts
+// the nodes as well, so a flat AST that's missing nodes or has extra ones is
+// caught.
+static void measureNodes(AstStats *stats, TranslationUnit *unit,
+    FlatAst *flat, char *fileName)
+{
+    AstStats walked = {0};
+    countNodes(&walked, unit);
+
+    for (size_t i = 0; i < AstStats_Count; i++) {
+        stats->types[i].count = walked.types[i].count;
+        stats->types[i].unionWaste = walked.types[i].unionWaste;
+    }
+
+    if (flat == NULL)
+        return;
+
+    for (size_t i = 0; i < AstStats_Count; i++) {
+        stats->types[i].count = 0;
+    }
+    countFlatNodes(stats, flat);
+
+    for (size_t i = 0; i < AstStats_Count; i++) {
+        if (stats->types[i].count != walked.types[i].count) {
+            logError("AstStats: %s: The flat AST has %zu %s nodes, but the "
+                "tree has %zu\n", fileName, stats->types[i].count,
+                g_typeNames[i], walked.types[i].count);
+        }
+    }
+}
+
+static void printJsonString(char *str) {
+    printf("\"");
+
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\')
+            printf("\\");
+
+        printf("%c", *str);
+    }
+
+    printf("\"");
+}
+
+static int compareBacktracks(const void *a, const void *b) {
+    const AstBacktrackStats *left = a;
+    const AstBacktrackStats *right = b;
+
+    if (left->count != right->count)
+        return left->count < right->count ? 1 : -1;
+
+    return strcmp(left->production, right->production);
+}
+
+static void printJsonStats(char *fileName, size_t numTokens, AstStats *stats,
+    size_t arenaBytes)
+{
+    printf("  {\n    \"file\": ");
+    printJsonString(fileName);
+    printf(",\n");
+
+    printf("    \"tokens\": %zu,\n", numTokens);
+    printf("    \"arenaBytes\": %zu,\n", arenaBytes);
+    printf("    \"peakParserBytes\": %zu,\n", stats->peakArenaBytes +
+        stats->memoBytes + stats->listScratchBytes);
+    printf("    \"peakArenaBytes\": %zu,\n", stats->peakArenaBytes);
+    printf("    \"memoBytes\": %zu,\n", stats->memoBytes);
+    printf("    \"listScratchBytes\": %zu,\n", stats->listScratchBytes);
+
+    printf("    \"nodes\": {");
+    bool first = true;
+    for (size_t i = 0; i < AstStats_Count; i++) {
+        AstTypeStats type = stats->types[i];
+        if (type.count == 0 && type.allocations == 0 && type.lists == 0)
+            continue;
+
+        printf(first ? "\n" : ",\n");
+        first = false;
+
+        printf("      \"%s\": { \"count\": %zu, \"allocations\": %zu, "
+            "\"allocatedBytes\": %zu, \"unionWaste\": %zu, \"lists\": %zu, "
+            "\"averageListLength\": %.2f }",
+            g_typeNames[i], type.count, type.allocations,
+            type.allocatedBytes, type.unionWaste, type.lists,
+            type.lists == 0 ? 0.0 : (double)type.listElems / type.lists);
+    }
+    printf(first ? "},\n" : "\n    },\n");
+
+    printf("    \"backtracks\": %zu,\n", stats->numBacktracks);
+
+    qsort(stats->productions, stats->numProductions,
+        sizeof(AstBacktrackStats), compareBacktracks);
+
+    printf("    \"backtracksByProduction\": {");
+    for (size_t i = 0; i < stats->numProductions; i++) {
+        AstBacktrackStats backtracks = stats->productions[i];
+        printf("%s      \"%s\": %zu", i == 0 ? "\n" : ",\n",
+            backtracks.production, backtracks.count);
+    }
+    printf(stats->numProductions == 0 ? "}\n" : "\n    }\n");
+
+    printf("  }");
+}
+
+// Only what the cache can tell, since nothing was parsed
+static void printCachedJsonStats(char *fileName, AstCache *cache) {
+    AstStats stats = {0};
+    countFlatNodes(&stats, &(cache->ast));
+
+    printf("  {\n    \"file\": ");
+    printJsonString(fileName);
+    printf(",\n");
+
+    printf("    \"cached\": true,\n");
+    printf("    \"tokens\": %zu,\n", cache->tokens.numTokens);
+
+    printf("    \"nodes\": {");
+    bool first = true;
+    for (size_t i = 0; i < AstStats_Count; i++) {
+        if (stats.types[i].count == 0)
+            continue;
+
+        printf(first ? "\n" : ",\n");
+        first = false;
+
+        printf("      \"%s\": { \"count\": %zu }", g_typeNames[i],
+            stats.types[i].count);
+    }
+    printf(first ? "}\n" : "\n    }\n");
+
+    printf("  }");
+}
+
+void printAstStats(size_t numFiles, char **fileNames, char *cacheDirectory) {
+    printf("[\n");
+
+    bool first = true;
+    for (size_t i = 0; i < numFiles; i++) {
+        Buffer fileBuff = {0};
+        if (!openAndReadFileToBuffer(fileNames[i], &fileBuff)) {
+            logError("AstStats: Couldn't read source file: %s with error: %s\n",
+                fileNames[i], strerror(errno));
+            continue;
+        }
+
+        char *cachePath = cacheDirectory == NULL ? NULL :
+            astCache_path(cacheDirectory, fileNames[i]);
+
+        AstCache cache = {0};
+        if (cachePath != NULL && astCache_load(cachePath, fileBuff, &cache)) {
+            printf(first ? "" : ",\n");
+            first = false;
+            printCachedJsonStats(fileNames[i], &cache);
+
+            astCache_cleanup(&cache);
+            free(cachePath);
+            free(fileBuff.bytes);
+            continue;
+        }
+
+        LineInfo lineInfo = {0};
+        TokenList tokens = {0};
+        if (!lexFile(fileBuff, fileNames[i], &tokens, &lineInfo)) {
+            free(cachePath);
+            free(fileBuff.bytes);
+            continue;
+        }
+
+        AstStats stats = {0};
+        setAstStats(&stats);
+
+        TranslationUnit unit = {0};
+        if (parseTokens(&tokens, &unit)) {
+            // The unit's arena before the walks parse any deferred bodies
+            size_t arenaBytes = unit.arena.allocated;
+
+            // Only files too big for 32 bit indices don't get one
+            FlatAst flat = {0};
+            bool hasFlat = flatAst_build(&unit, tokens, &flat);
+            measureNodes(&stats, &unit, hasFlat ? &flat : NULL, fileNames[i]);
+
+            printf(first ? "" : ",\n");
+            first = false;
+            printJsonStats(fileNames[i], tokens.numTokens, &stats, arenaBytes);
+
+            if (cachePath != NULL && hasFlat)
+                astCache_write(cachePath, fileBuff, tokens, &flat);
+            else if (cachePath != NULL)
+                logError("AstStats: %s is too big to cache\n", fileNames[i]);
+
+            flatAst_cleanup(&flat);
+            translationUnit_cleanup(unit);
+        }
+
+        setAstStats(NULL);
+        astStats_cleanup(&stats);
+        free(cachePath);
+        free(tokens.tokens);
+        free(fileBuff.bytes);
+    }
+
+    printf(first ? "]\n" : "\n]\n");
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Measures what a translation unit's AST costs. The parser reports every node
+// it copies into its arena, every list it closes and every time it rewinds the
+// tokens to try another alternative. After the parse, the nodes that are left
+// are counted in the flat copy of the tree (see flatAst.h), and a walk over
+// the finished tree adds up the union space they don't use. The walk counts
+// the nodes too, and a flat copy that doesn't agree is logged as an error.
+//
+// Allocations include nodes that were thrown away when their alternative
+// failed, so they're usually more than the nodes in the finished tree.
+
+// Every node type a traversal visits. The LogicalOrExpr through
+// MultiplicativeExpr levels are left out since the parser never builds them.
+#define AstStatsNodeTypes(X)\
+    X(TranslationUnit)\
+    X(ExternalDecl)\
+    X(FuncDef)\
+    X(CompoundStmt)\
+    X(BlockItemList)\
+    X(BlockItem)\
+    X(Statement)\
+    X(AsmStatement)\
+    X(JumpStatement)\
+    X(IterationStatement)\
+    X(ExpressionStatement)\
+    X(SelectionStatement)\
+    X(LabeledStatement)\
+    X(Declaration)\
+    X(InitDeclaratorList)\
+    X(InitDeclarator)\
+    X(DeclarationSpecifierList)\
+    X(DeclarationSpecifier)\
+    X(AlignmentSpecifier)\
+    X(FunctionSpecifier)\
+    X(StorageClassSpecifier)\
+    X(TypeSpecifier)\
+    X(EnumSpecifier)\
+    X(EnumeratorList)\
+    X(Enumerator)\
+    X(StructOrUnionSpecifier)\
+    X(StructDeclaration)\
+    X(StaticAssertDeclaration)\
+    X(StructDeclaratorList)\
+    X(StructDeclarator)\
+    X(TypeName)\
+    X(SpecifierQualifierList)\
+    X(SpecifierQualifier)\
+    X(TypeQualifier)\
+    X(Declarator)\
+    X(DirectDeclarator)\
+    X(PostDirectDeclarator)\
+    X(IdentifierList)\
+    X(AbstractDeclarator)\
+    X(Pointer)\
+    X(DirectAbstractDeclarator)\
+    X(PostDirectAbstractDeclarator)\
+    X(ParameterTypeList)\
+    X(ParameterDeclaration)\
+    X(Expr)\
+    X(InnerExpr)\
+    X(AssignExpr)\
+    X(AssignPrefix)\
+    X(ConditionalExpr)\
+    X(BinaryExpr)\
+    X(CastExpr)\
+    X(UnaryExpr)\
+    X(PostfixExpr)\
+    X(PostfixOp)\
+    X(ArgExprList)\
+    X(PrimaryExpr)\
+    X(ConstantExpr)\
+    X(GenericSelection)\
+    X(GenericAssociation)\
+    X(InitializerList)\
+    X(DesignationAndInitializer)\
+    X(Initializer)\
+    X(Designation)\
+    X(Designator)
+
+// The nodes plus the element types of lists that aren't nodes themselves
+#define AstStatsTypes(X)\
+    AstStatsNodeTypes(X)\
+    X(BinaryOperand)\
+    X(String)
+
+typedef enum {
+#define AstStatsTypeEnum(type) AstStats_ ## type,
+    AstStatsTypes(AstStatsTypeEnum)
+#undef AstStatsTypeEnum
+    AstStats_Count,
+} AstStatsType;
+
+// The AstStatsType of a node, picked from its C type. Only usable where the
+// node types are declared.
+#define AstStatsGenericCase(type) type: AstStats_ ## type,
+#define AstStatsTypeOf(node)\
+    _Generic((node), AstStatsTypes(AstStatsGenericCase) default: AstStats_Count)
+
+typedef struct {
+    // Nodes in the finished tree, including ones stored inside their parents
+    size_t count;
+    // Bytes of unions the nodes in the tree don't use with their type
+    size_t unionWaste;
+
+    // Nodes copied into the arena on their own or as list elements
+    size_t allocations;
+    size_t allocatedBytes;
+
+    // Lists with elements of this type, and their total length
+    size_t lists;
+    size_t listElems;
+} AstTypeStats;
+
+typedef struct {
+    const char *production;
+    size_t count;
+} AstBacktrackStats;
+
+typedef struct {
+    AstTypeStats types[AstStats_Count];
+
+    size_t numBacktracks;
+    size_t numProductions;
+    size_t productionCapacity;
+    AstBacktrackStats *productions;
+
+    // Most bytes the parser's arena, packrat tables and list scratch space
+    // held at once. With more than one thread these are the sums of each
+    // thread's peaks.
+    size_t peakArenaBytes;
+    size_t memoBytes;
+    size_t listScratchBytes;
+} AstStats;
+
+// Each thread records into its own stats, which are merged after the parse
+void astStats_recordAllocation(AstStats *stats, AstStatsType type,
+    size_t numNodes, size_t bytes, size_t arenaBytes);
+void astStats_recordList(AstStats *stats, AstStatsType type, size_t length);
+// Productions are compared by pointer, so pass __func__
+void astStats_recordBacktrack(AstStats *stats, const char *production);
+
+void astStats_merge(AstStats *stats, AstStats *other);
+void astStats_cleanup(AstStats *stats);
+
+// Lexes and parses each file, then prints its stats as a JSON array with an
+// object per file. With a cache directory, each file's flat AST is saved
+// there, and a file whose cache is still valid isn't parsed at all. Its
+// object only has the node counts, taken from the cache, and "cached": true.
+void printAstStats(size_t numFiles, char **fileNames, char *cacheDirectory);
@@ -3,6 +3,28 @@
 #include <stdio.h>
 #include <string.h>
 
+#include "array.h"
+
+static bool g_trigraphs;
+
+static size_t newLineLength(uint8_t *bytes, size_t size, size_t offset);
+
+static char trigraphReplacement(uint8_t c);
+
+static void findTrigraphs(Buffer *buffer);
+
+static int compareSplices(const void *left, const void *right);
+
+static BufferSplice *findSplice(Buffer *buffer, size_t pos);
+
+static void skipSplices(Buffer *buffer);
+
+static size_t logicalChar(Buffer *buffer, size_t pos, char *outChar);
+
+void setTrigraphs(bool enabled) {
+    g_trigraphs = enabled;
+}
+
 bool openAndReadFileToBuffer(char *fileName, Buffer *outBuff) {
     if (outBuff == NULL)
         return false;
@@ -20,29 +42,99 @@ bool openAndReadFileToBuffer(char *fileName, Buffer *outBuff) {
     fread(bytes, size, 1, file);
     fclose(file);
 
+    bytes[size] = '\0';
+
     outBuff->size = size;
     outBuff->bytes = bytes;
 
+    buffer_findSplices(outBuff);
+
     return true;
 }
 
+void buffer_findSplices(Buffer *buffer) {
+    buffer->numSplices = 0;
+    buffer->nextSplice = 0;
+    buffer->splices = NULL;
+
+    uint8_t *bytes = buffer->bytes;
+    size_t size = buffer->size;
+
+    // memchr is vectorized, so a file without backslashes costs one fast
+    // pass and never gets a splice table
+    uint8_t *backslash = memchr(bytes, '\\', size);
+
+    while (backslash != NULL) {
+        size_t offset = backslash - bytes;
+        size_t length = newLineLength(bytes, size, offset + 1);
+
+        if (length > 0) {
+            BufferSplice splice = { .offset = offset, .length = length + 1 };
+            ArrayAppend(buffer->splices, buffer->numSplices, splice);
+        }
+
+        size_t next = offset + 1 + length;
+        backslash = next < size ? memchr(bytes + next, '\\', size - next) : NULL;
+    }
+
+    if (g_trigraphs)
+        findTrigraphs(buffer);
+}
+
 char peek(Buffer *buffer) {
-    return buffer->bytes[buffer->pos];
+    if (buffer->numSplices == 0)
+        return buffer->bytes[buffer->pos];
+
+    skipSplices(buffer);
+
+    char c = '\0';
+    logicalChar(buffer, buffer->pos, &c);
+
+    return c;
 }
 
 char peekAhead(Buffer *buffer, size_t lookahead) {
-    if (buffer->pos + lookahead > buffer->size)
-        return '\0';
+    if (buffer->numSplices == 0) {
+        if (buffer->pos + lookahead > buffer->size)
+            return '\0';
+
+        return buffer->bytes[buffer->pos + lookahead];
+    }
+
+    skipSplices(buffer);
 
-    return buffer->bytes[buffer->pos + lookahead];
+    char c = '\0';
+    size_t pos = buffer->pos;
+
+    for (size_t i = 0; i <= lookahead; i++) {
+        pos = logicalChar(buffer, pos, &c);
+    }
+
+    return c;
 }
 
 bool peekMulti(Buffer *buffer, char *str) {
     if (buffer->size <= strlen(str) + buffer->pos)
         return false;
 
-    for (uint64_t i = 0; i < strlen(str); i++) {
-        if (buffer->bytes[buffer->pos + i] != str[i])
+    if (buffer->numSplices == 0) {
+        for (uint64_t i = 0; i < strlen(str); i++) {
+            if (buffer->bytes[buffer->pos + i] != str[i])
+                return false;
+        }
+
+        return true;
+    }
+
+    skipSplices(buffer);
+
+    size_t pos = buffer->pos;
+
+    for (; *str != '\0'; str++) {
+        char c = '\0';
+        pos = logicalChar(buffer, pos, &c);
+
+        if (c != *str)
             return false;
     }
 
@@ -50,6 +142,30 @@ bool peekMulti(Buffer *buffer, char *str) {
 }
 
 char consume(Buffer *buffer) {
+    if (buffer->numSplices > 0) {
+        skipSplices(buffer);
+
+        char c = '\0';
+        size_t next = logicalChar(buffer, buffer->pos, &c);
+        if (next == buffer->pos)
+            next++;
+
+        size_t length = next - buffer->pos;
+        buffer->pos = next;
+
+        if (c == '\n') {
+            buffer->line++;
+            buffer->col = 0;
+        }
+        else if (c != '\0') {
+            buffer->col += length;
+        }
+
+        skipSplices(buffer);
+
+        return c;
+    }
+
     char c = peek(buffer);
     buffer->pos++;
 
@@ -91,14 +207,211 @@ bool consumeMultiIf(Buffer *buffer, char *str) {
 
 void consumeAndCopyOut(Buffer *buffer, size_t numBytes, char **outStr) {
     char *str = malloc(numBytes + 1);
-    memcpy(str, buffer->bytes + buffer->pos, numBytes);
-    str[numBytes] = '\0';
 
-    consumeMulti(buffer, numBytes);
+    if (buffer->numSplices == 0) {
+        memcpy(str, buffer->bytes + buffer->pos, numBytes);
+        consumeMulti(buffer, numBytes);
+    }
+    else {
+        // Copied a character at a time so splices are left out and trigraphs
+        // are replaced, the same as everything else reads them
+        for (size_t i = 0; i < numBytes; i++) {
+            str[i] = consume(buffer);
+        }
+    }
+
+    str[numBytes] = '\0';
 
     *outStr = str;
 }
 
 uint8_t *buffCurr(Buffer *buffer) {
+    if (buffer->numSplices > 0)
+        skipSplices(buffer);
+
     return buffer->bytes + buffer->pos;
 }
+
+String buffer_spelling(Buffer start, Buffer *buffer) {
+    uint8_t *bytes = buffCurr(&start);
+    String spelling = {
+        .str = bytes,
+        .length = buffCurr(buffer) - bytes,
+    };
+
+    if (buffer->numSplices == 0)
+        return spelling;
+
+    size_t numChars = 0;
+    for (Buffer chars = start; chars.pos < buffer->pos; numChars++) {
+        consume(&chars);
+    }
+
+    if (numChars == spelling.length)
+        return spelling;
+
+    char *copy = NULL;
+    consumeAndCopyOut(&start, numChars, &copy);
+
+    return (String){
+        .str = (uint8_t*)copy,
+        .length = numChars,
+    };
+}
+
+// gcc also splices when there's whitespace between the backslash and the
+// new line, so we do the same
+static size_t newLineLength(uint8_t *bytes, size_t size, size_t offset) {
+    size_t end = offset;
+    while (end < size && (bytes[end] == ' ' || bytes[end] == '\t'))
+        end++;
+
+    if (end < size && bytes[end] == '\n')
+        return end + 1 - offset;
+
+    if (end + 1 < size && bytes[end] == '\r' && bytes[end + 1] == '\n')
+        return end + 2 - offset;
+
+    return 0;
+}
+
+static char trigraphReplacement(uint8_t c) {
+    switch (c) {
+        case '=': return '#';
+        case '(': return '[';
+        case '/': return '\\';
+        case ')': return ']';
+        case '\'': return '^';
+        case '<': return '{';
+        case '!': return '|';
+        case '>': return '}';
+        case '-': return '~';
+        default: return '\0';
+    }
+}
+
+static void findTrigraphs(Buffer *buffer) {
+    uint8_t *bytes = buffer->bytes;
+    size_t size = buffer->size;
+
+    size_t numSplices = buffer->numSplices;
+
+    uint8_t *question = memchr(bytes, '?', size);
+
+    while (question != NULL) {
+        size_t offset = question - bytes;
+        size_t next = offset + 1;
+
+        char replacement = offset + 2 < size && bytes[offset + 1] == '?' ?
+            trigraphReplacement(bytes[offset + 2]) : '\0';
+
+        if (replacement != '\0') {
+            BufferSplice splice = {
+                .offset = offset,
+                .length = 3,
+                .replacement = replacement
+            };
+
+            // A backslash trigraph before a new line splices like a backslash
+            size_t length = replacement == '\\' ?
+                newLineLength(bytes, size, offset + 3) : 0;
+
+            if (length > 0) {
+                splice.length += length;
+                splice.replacement = '\0';
+            }
+
+            ArrayAppend(buffer->splices, buffer->numSplices, splice);
+            next = offset + splice.length;
+        }
+
+        question = next < size ? memchr(bytes + next, '?', size - next) : NULL;
+    }
+
+    if (buffer->numSplices == numSplices)
+        return;
+
+    qsort(buffer->splices, buffer->numSplices, sizeof(BufferSplice),
+        compareSplices);
+
+    // Drop anything overlapping an earlier entry, like a backslash that
+    // follows a backslash trigraph
+    size_t kept = 0;
+    for (size_t i = 0; i < buffer->numSplices; i++) {
+        BufferSplice splice = buffer->splices[i];
+
+        if (kept > 0) {
+            BufferSplice prev = buffer->splices[kept - 1];
+            if (splice.offset < prev.offset + prev.length)
+                continue;
+        }
+
+        buffer->splices[kept++] = splice;
+    }
+
+    buffer->numSplices = kept;
+}
+
+static int compareSplices(const void *left, const void *right) {
+    const BufferSplice *leftSplice = left;
+    const BufferSplice *rightSplice = right;
+
+    if (leftSplice->offset < rightSplice->offset)
+        return -1;
+
+    return leftSplice->offset > rightSplice->offset;
+}
+
+// Uses nextSplice as a cursor, so walking forward through the buffer is
+// amortized constant time
+static BufferSplice *findSplice(Buffer *buffer, size_t pos) {
+    size_t idx = buffer->nextSplice;
+
+    while (idx > 0 && buffer->splices[idx - 1].offset >= pos)
+        idx--;
+
+    while (idx < buffer->numSplices && buffer->splices[idx].offset < pos)
+        idx++;
+
+    buffer->nextSplice = idx;
+
+    if (idx < buffer->numSplices && buffer->splices[idx].offset == pos)
+        return buffer->splices + idx;
+
+    return NULL;
+}
+
+static void skipSplices(Buffer *buffer) {
+    BufferSplice *splice = findSplice(buffer, buffer->pos);
+
+    while (splice != NULL && splice->replacement == '\0') {
+        buffer->pos += splice->length;
+        buffer->line++;
+        buffer->col = 0;
+
+        splice = findSplice(buffer, buffer->pos);
+    }
+}
+
+// Returns the physical position after the logical character at pos
+static size_t logicalChar(Buffer *buffer, size_t pos, char *outChar) {
+    BufferSplice *splice = findSplice(buffer, pos);
+
+    while (splice != NULL && splice->replacement == '\0') {
+        pos += splice->length;
+        splice = findSplice(buffer, pos);
+    }
+
+    if (pos >= buffer->size) {
+        *outChar = '\0';
+        return pos;
+    }
+
+    if (splice != NULL) {
+        *outChar = splice->replacement;
+        return pos + splice->length;
+    }
+
+    *outChar = buffer->bytes[pos];
+    return pos + 1;
+}
@@ -4,15 +4,35 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "astring.h"
+
+// A backslash-newline or trigraph at a physical offset in the buffer.
+// Splices have no replacement and are skipped entirely.
+typedef struct {
+    size_t offset;
+    size_t length;
+    char replacement;
+} BufferSplice;
+
 typedef struct {
     size_t size;
     size_t pos;
     size_t line;
     size_t col;
     uint8_t *bytes;
+
+    // Only buffers that contain splices or trigraphs have a table. Positions
+    // stay physical offsets, so line and col are exact for spliced lines.
+    size_t numSplices;
+    size_t nextSplice;
+    BufferSplice *splices;
 } Buffer;
 
+// Trigraphs are off by default, like gcc without -trigraphs
+void setTrigraphs(bool enabled);
+
 bool openAndReadFileToBuffer(char *fileName, Buffer *outBuff);
+void buffer_findSplices(Buffer *buffer);
 
 char peek(Buffer *buffer);
 char peekAhead(Buffer *buffer, size_t lookahead);
@@ -23,3 +43,9 @@ bool consumeIf(Buffer *buffer, char c);
 bool consumeMultiIf(Buffer *buffer, char *str);
 void consumeAndCopyOut(Buffer *buffer, size_t numBytes, char **outStr);
 uint8_t *buffCurr(Buffer *buffer);
+
+// What was consumed since start, a copy of the buffer from before. It's the
+// buffer's own bytes, unless a splice or trigraph is among them. Then it's a
+// copy of the characters they make up, so a name split over lines is spelled
+// the same as one that isn't.
+String buffer_spelling(Buffer start, Buffer *buffer);
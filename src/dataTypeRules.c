@@ -1,16 +1,22 @@
 #include "dataTypeRules.h"
 
+static void rule_5_2_b_checkShort(Rule *rule, RuleContext *context, Token *tok) {
+    reportRuleViolation(rule->name, tok->fileName, tok->line,
+        "%s", "Type cannot use the keyword short");
+}
+
+static void rule_5_2_b_checkLong(Rule *rule, RuleContext *context, Token *tok) {
+    reportRuleViolation(rule->name, tok->fileName, tok->line,
+        "%s", "Type cannot use the keyword long");
+}
+
+static const TokenSubscription rule_5_2_b_tokens[] = {
+    { Token_short, rule_5_2_b_checkShort },
+    { Token_long, rule_5_2_b_checkLong },
+};
+
 // Cannot use keywords short and long
-void rule_5_2_b(Rule rule, RuleContext context) {
-    for (uint64_t i = 0; i < context.tokens.numTokens; i++) {
-        Token tok = context.tokens.tokens[i];
-        if (tok.type == Token_short) {
-            reportRuleViolation(rule.name, tok.fileName, tok.line,
-                "%s", "Type cannot use the keyword short");
-        }
-        else if (tok.type == Token_long) {
-            reportRuleViolation(rule.name, tok.fileName, tok.line,
-                "%s", "Type cannot use the keyword long");
-        }
-    }
+size_t rule_5_2_b(const TokenSubscription **outSubscriptions) {
+    *outSubscriptions = rule_5_2_b_tokens;
+    return sizeof(rule_5_2_b_tokens) / sizeof(TokenSubscription);
 }
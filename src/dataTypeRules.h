@@ -3,4 +3,4 @@
 #include "rule.h"
 
 // Cannot use keywords short and long
-void rule_5_2_b(Rule rule, RuleContext context);
+size_t rule_5_2_b(const TokenSubscription **outSubscriptions);
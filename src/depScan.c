@@ -0,0 +1,337 @@
+#include "depScan.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "array.h"
+#include "debug.h"
+#include "buffer.h"
+#include "hashMap.h"
+#include "preprocess.h"
+#include "includeSearch.h"
+
+// File name -> IncludeNode, for both resolved and missing includes
+static HashMap g_includeNodes;
+
+static size_t g_visitMark;
+
+static IncludeNode *includeNode_get(char *fileName, bool found);
+
+static void scanFile(IncludeNode *node);
+
+static void scanIncludeLine(IncludeNode *node, Buffer *buffer, size_t lineEnd);
+
+static bool updateCommentState(uint8_t *line, size_t length, bool inComment);
+
+typedef struct {
+    size_t numDeps;
+    IncludeNode **deps;
+} DependencyList;
+
+static void collectDependencies(IncludeNode *node, DependencyList *list);
+
+static void printJsonString(char *str);
+
+static void printJsonDependencies(IncludeNode *root);
+
+static void printMakeDependencies(IncludeNode *root);
+
+IncludeNode *scanDependencies(char *fileName) {
+    IncludeNode *root = includeNode_get(fileName, true);
+
+    if (!root->scanned)
+        scanFile(root);
+
+    return root;
+}
+
+void printDependencies(size_t numFiles, char **fileNames, DepFormat format) {
+    if (format == DepFormat_Json)
+        printf("[\n");
+
+    for (size_t i = 0; i < numFiles; i++) {
+        IncludeNode *root = scanDependencies(fileNames[i]);
+
+        if (format == DepFormat_Json) {
+            printJsonDependencies(root);
+            printf(i + 1 < numFiles ? ",\n" : "\n");
+        }
+        else {
+            printMakeDependencies(root);
+        }
+    }
+
+    if (format == DepFormat_Json)
+        printf("]\n");
+}
+
+static IncludeNode *includeNode_get(char *fileName, bool found) {
+    IncludeNode *node = NULL;
+    if (hashMap_find(&g_includeNodes, astr(fileName), (void**)&node))
+        return node;
+
+    node = calloc(1, sizeof(IncludeNode));
+    assert(node != NULL);
+
+    node->fileName = fileName;
+    node->found = found;
+
+    // Missing headers have nothing to scan
+    node->scanned = !found;
+
+    hashMap_insert(&g_includeNodes, astr(fileName), node);
+
+    return node;
+}
+
+static void scanFile(IncludeNode *node) {
+    node->scanned = true;
+
+    Buffer buffer = {0};
+    if (!openAndReadFileToBuffer(node->fileName, &buffer)) {
+        node->found = false;
+        return;
+    }
+
+    buffer.line = 1;
+    buffer.col = 1;
+
+    bool inComment = false;
+    size_t pos = 0;
+
+    while (pos < buffer.size) {
+        uint8_t *line = buffer.bytes + pos;
+        uint8_t *newLine = memchr(line, '\n', buffer.size - pos);
+        size_t lineEnd = newLine == NULL ? buffer.size : newLine - buffer.bytes;
+
+        // Only lines starting outside a comment with '#' can be directives.
+        // Everything else is skipped without being tokenized.
+        if (!inComment) {
+            buffer.pos = pos;
+
+            if (consumeDirective(&buffer) == Directive_Include &&
+                buffer.pos <= lineEnd)
+            {
+                scanIncludeLine(node, &buffer, lineEnd);
+            }
+        }
+
+        inComment = updateCommentState(line, lineEnd - pos, inComment);
+
+        pos = lineEnd + 1;
+        buffer.line++;
+    }
+
+    free(buffer.bytes);
+}
+
+static void scanIncludeLine(IncludeNode *node, Buffer *buffer, size_t lineEnd) {
+    while (buffer->pos < lineEnd &&
+        (peek(buffer) == ' ' || peek(buffer) == '\t'))
+    {
+        consume(buffer);
+    }
+
+    char end = 0;
+    if (peek(buffer) == '<') {
+        end = '>';
+    }
+    else if (peek(buffer) == '"') {
+        end = '"';
+    }
+    else {
+        // Computed includes need macro expansion, which we don't do here
+        printDebug("DepScan: Skipping computed include: %s:%lu\n",
+            node->fileName, buffer->line);
+        return;
+    }
+
+    consume(buffer);
+
+    String fileName = { .str = buffCurr(buffer) };
+
+    uint8_t *nameEnd = memchr(fileName.str, end, lineEnd - buffer->pos);
+    if (nameEnd == NULL)
+        return;
+
+    fileName.length = nameEnd - fileName.str;
+
+    IncludeNode *include = NULL;
+
+    char *path = includeSearch_resolve(fileName, end == '>', node->fileName);
+    if (path != NULL) {
+        include = includeNode_get(path, true);
+    }
+    else {
+        char *name = malloc(fileName.length + 1);
+        assert(name != NULL);
+
+        memcpy(name, fileName.str, fileName.length);
+        name[fileName.length] = '\0';
+
+        include = includeNode_get(name, false);
+        if (include->fileName != name)
+            free(name);
+    }
+
+    for (size_t i = 0; i < node->numIncludes; i++) {
+        if (node->includes[i] == include)
+            return;
+    }
+
+    ArrayAppend(node->includes, node->numIncludes, include);
+
+    if (!include->scanned)
+        scanFile(include);
+}
+
+static bool updateCommentState(uint8_t *line, size_t length, bool inComment) {
+    // Most lines have no comments, so check for that before walking them
+    if (!inComment && memchr(line, '/', length) == NULL)
+        return false;
+
+    for (size_t i = 0; i < length; i++) {
+        uint8_t c = line[i];
+        uint8_t next = i + 1 < length ? line[i + 1] : '\0';
+
+        if (inComment) {
+            if (c == '*' && next == '/') {
+                inComment = false;
+                i++;
+            }
+        }
+        else if (c == '"' || c == '\'') {
+            for (i++; i < length && line[i] != c; i++) {
+                if (line[i] == '\\')
+                    i++;
+            }
+        }
+        else if (c == '/' && next == '/') {
+            return false;
+        }
+        else if (c == '/' && next == '*') {
+            inComment = true;
+            i++;
+        }
+    }
+
+    return inComment;
+}
+
+static void collectDependencies(IncludeNode *node, DependencyList *list) {
+    for (size_t i = 0; i < node->numIncludes; i++) {
+        IncludeNode *include = node->includes[i];
+        if (include->visitMark == g_visitMark)
+            continue;
+
+        include->visitMark = g_visitMark;
+
+        ArrayAppend(list->deps, list->numDeps, include);
+        collectDependencies(include, list);
+    }
+}
+
+static void printJsonString(char *str) {
+    printf("\"");
+
+    for (; *str != '\0'; str++) {
+        if (*str == '"' || *str == '\\')
+            printf("\\");
+
+        printf("%c", *str);
+    }
+
+    printf("\"");
+}
+
+static void printJsonDependencies(IncludeNode *root) {
+    DependencyList list = {0};
+
+    g_visitMark++;
+    root->visitMark = g_visitMark;
+    collectDependencies(root, &list);
+
+    size_t numDeps = list.numDeps;
+    IncludeNode **deps = list.deps;
+
+    printf("  {\n    \"file\": ");
+    printJsonString(root->fileName);
+
+    printf(",\n    \"dependencies\": [");
+    bool first = true;
+    for (size_t i = 0; i < numDeps; i++) {
+        if (!deps[i]->found)
+            continue;
+
+        printf(first ? "\n      " : ",\n      ");
+        printJsonString(deps[i]->fileName);
+        first = false;
+    }
+    printf(first ? "],\n" : "\n    ],\n");
+
+    printf("    \"missing\": [");
+    first = true;
+    for (size_t i = 0; i < numDeps; i++) {
+        if (deps[i]->found)
+            continue;
+
+        printf(first ? "\n      " : ",\n      ");
+        printJsonString(deps[i]->fileName);
+        first = false;
+    }
+    printf(first ? "],\n" : "\n    ],\n");
+
+    // Direct includes of every file in the graph, root first
+    printf("    \"graph\": {");
+    for (size_t i = 0; i <= numDeps; i++) {
+        IncludeNode *node = i == 0 ? root : deps[i - 1];
+        if (!node->found)
+            continue;
+
+        printf(i == 0 ? "\n      " : ",\n      ");
+        printJsonString(node->fileName);
+        printf(": [");
+
+        for (size_t ii = 0; ii < node->numIncludes; ii++) {
+            if (ii > 0)
+                printf(", ");
+            printJsonString(node->includes[ii]->fileName);
+        }
+
+        printf("]");
+    }
+    printf("\n    }\n  }");
+
+    free(deps);
+}
+
+static void printMakeDependencies(IncludeNode *root) {
+    DependencyList list = {0};
+
+    g_visitMark++;
+    root->visitMark = g_visitMark;
+    collectDependencies(root, &list);
+
+    size_t numDeps = list.numDeps;
+    IncludeNode **deps = list.deps;
+
+    // Same target naming as gcc -MM: the base name with a .o extension
+    char *baseName = strrchr(root->fileName, '/');
+    baseName = baseName == NULL ? root->fileName : baseName + 1;
+
+    char *extension = strrchr(baseName, '.');
+    int stemLength = extension == NULL ?
+        (int)strlen(baseName) : (int)(extension - baseName);
+
+    printf("%.*s.o: %s", stemLength, baseName, root->fileName);
+
+    for (size_t i = 0; i < numDeps; i++) {
+        if (deps[i]->found)
+            printf(" \\\n  %s", deps[i]->fileName);
+    }
+
+    printf("\n");
+
+    free(deps);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Dependency scanning only looks at #include lines, so it runs close to the
+// speed of reading the files. Conditionals aren't evaluated, which means the
+// reported graph is a superset of what the compiler would actually include.
+
+typedef enum {
+    DepFormat_Json,
+    DepFormat_Make,
+} DepFormat;
+
+typedef struct IncludeNode {
+    char *fileName;
+    bool found;
+    bool scanned;
+    size_t visitMark;
+    size_t numIncludes;
+    struct IncludeNode **includes;
+} IncludeNode;
+
+// Each file is only scanned once per process, no matter how many
+// translation units include it
+IncludeNode *scanDependencies(char *fileName);
+
+void printDependencies(size_t numFiles, char **fileNames, DepFormat format);
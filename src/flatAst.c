@@ -0,0 +1,554 @@
+#include "flatAst.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "traversal.h"
+#include "hashMap.h"
+#include "array.h"
+
+static char *g_kindNames[] = {
+#define FlatNodeKindName(type) #type,
+    FlatNodeKinds(FlatNodeKindName)
+#undef FlatNodeKindName
+};
+
+char *flatNodeKind_name(FlatNodeKind kind) {
+    assert(kind < FlatNode_Count);
+    return g_kindNames[kind];
+}
+
+// Builder
+
+typedef struct {
+    FlatAst *ast;
+    Token *firstToken;
+    size_t numTokens;
+
+    // Source string -> pool offset + 1, so the same name is only pooled once
+    HashMap pooledNames;
+
+    // Nodes opened and not closed yet
+    size_t numOpen;
+    size_t openCapacity;
+    FlatIndex *open;
+
+    // Set if anything got too big for 32 bits
+    bool overflowed;
+} FlatBuilder;
+
+static uint32_t toIndex(FlatBuilder *builder, size_t value) {
+    if (value >= FlatNone) {
+        builder->overflowed = true;
+        return FlatNone;
+    }
+
+    return (uint32_t)value;
+}
+
+static uint32_t tokenIndex(FlatBuilder *builder, Token *tok) {
+    if (tok == NULL)
+        return FlatNone;
+
+    assert(tok >= builder->firstToken &&
+        tok < builder->firstToken + builder->numTokens);
+    return toIndex(builder, tok - builder->firstToken);
+}
+
+static uint32_t pushPayload(FlatBuilder *builder, uint32_t value) {
+    FlatAst *ast = builder->ast;
+
+    ast->payloads = growArray(ast->payloads, &(ast->payloadCapacity),
+        ast->numPayloads + 1, sizeof(uint32_t));
+    ast->payloads[ast->numPayloads] = value;
+
+    return toIndex(builder, ast->numPayloads++);
+}
+
+static uint32_t pushName(FlatBuilder *builder, String name) {
+    FlatAst *ast = builder->ast;
+
+    void *pooled = NULL;
+    size_t offset = 0;
+    if (hashMap_find(&(builder->pooledNames), name, &pooled)) {
+        offset = (size_t)pooled - 1;
+    }
+    else {
+        offset = ast->stringBytes;
+
+        ast->strings = growArray(ast->strings, &(ast->stringCapacity),
+            ast->stringBytes + name.length, 1);
+        memcpy(ast->strings + offset, name.str, name.length);
+        ast->stringBytes += name.length;
+
+        hashMap_insert(&(builder->pooledNames), name, (void*)(offset + 1));
+    }
+
+    uint32_t payload = pushPayload(builder, toIndex(builder, offset));
+    pushPayload(builder, toIndex(builder, name.length));
+
+    return payload;
+}
+
+typedef enum {
+    FlatData_None,
+    FlatData_Token,
+    FlatData_Payload,
+    FlatData_Name,
+} FlatDataType;
+
+static FlatDataType flatDataType(FlatNodeKind kind) {
+    switch (kind) {
+    case FlatNode_FuncDef:
+    case FlatNode_CompoundStmt:
+    case FlatNode_SelectionStatement:
+    case FlatNode_BinaryExpr:
+        return FlatData_Payload;
+    case FlatNode_IterationStatement:
+    case FlatNode_Declarator:
+    case FlatNode_CastExpr:
+    case FlatNode_UnaryExpr:
+    case FlatNode_PostfixExpr:
+        return FlatData_Token;
+    case FlatNode_JumpStatement:
+    case FlatNode_LabeledStatement:
+    case FlatNode_TypeSpecifier:
+    case FlatNode_EnumSpecifier:
+    case FlatNode_Enumerator:
+    case FlatNode_StructOrUnionSpecifier:
+    case FlatNode_DirectDeclarator:
+    case FlatNode_PostfixOp:
+    case FlatNode_PrimaryExpr:
+    case FlatNode_ConstantExpr:
+        return FlatData_Name;
+    default:
+        return FlatData_None;
+    }
+}
+
+// Fills in what's specific to each kind of node. Kinds not listed here only
+// have their position in the tree.
+static void describeNode(FlatBuilder *builder, FlatNodeKind kind, void *data,
+    FlatNode *node)
+{
+    switch (kind) {
+    case FlatNode_ExternalDecl: {
+        node->variant = ((ExternalDecl*)data)->type;
+    } break;
+    case FlatNode_FuncDef: {
+        FuncDef *def = data;
+        node->data = pushPayload(builder, tokenIndex(builder, def->startTok));
+        pushPayload(builder, tokenIndex(builder, def->endTok));
+    } break;
+    case FlatNode_CompoundStmt: {
+        CompoundStmt *stmt = data;
+        node->data = pushPayload(builder, tokenIndex(builder, stmt->openBracket));
+        pushPayload(builder, tokenIndex(builder, stmt->closeBracket));
+    } break;
+    case FlatNode_BlockItem: {
+        node->variant = ((BlockItem*)data)->type;
+    } break;
+    case FlatNode_Statement: {
+        node->variant = ((Statement*)data)->type;
+    } break;
+    case FlatNode_JumpStatement: {
+        JumpStatement *stmt = data;
+        node->variant = stmt->type;
+        if (stmt->type == JumpStatement_Goto)
+            node->data = pushName(builder, stmt->gotoIdent);
+    } break;
+    case FlatNode_IterationStatement: {
+        IterationStatement *stmt = data;
+        node->variant = stmt->type;
+        if (stmt->type == IterationStatement_While)
+            node->data = tokenIndex(builder, stmt->whileToken);
+        else if (stmt->type == IterationStatement_DoWhile)
+            node->data = tokenIndex(builder, stmt->doToken);
+        else
+            node->data = tokenIndex(builder, stmt->forToken);
+    } break;
+    case FlatNode_SelectionStatement: {
+        SelectionStatement *stmt = data;
+        node->variant = stmt->type;
+        if (stmt->type == SelectionStatement_If) {
+            node->data = pushPayload(builder, tokenIndex(builder, stmt->ifToken));
+            pushPayload(builder, stmt->ifHasElse ?
+                tokenIndex(builder, stmt->elseToken) : FlatNone);
+        }
+        else {
+            node->data = pushPayload(builder,
+                tokenIndex(builder, stmt->switchToken));
+            pushPayload(builder, FlatNone);
+        }
+    } break;
+    case FlatNode_LabeledStatement: {
+        LabeledStatement *stmt = data;
+        node->variant = stmt->type;
+        if (stmt->type == LabeledStatement_Ident)
+            node->data = pushName(builder, stmt->ident);
+    } break;
+    case FlatNode_Declaration: {
+        node->variant = ((Declaration*)data)->type;
+    } break;
+    case FlatNode_DeclarationSpecifier: {
+        node->variant = ((DeclarationSpecifier*)data)->type;
+    } break;
+    case FlatNode_FunctionSpecifier: {
+        node->variant = *(FunctionSpecifier*)data;
+    } break;
+    case FlatNode_StorageClassSpecifier: {
+        node->variant = *(StorageClassSpecifier*)data;
+    } break;
+    case FlatNode_TypeSpecifier: {
+        TypeSpecifier *spec = data;
+        node->variant = spec->type;
+        if (spec->type == TypeSpecifier_TypedefName)
+            node->data = pushName(builder, spec->typedefName);
+    } break;
+    case FlatNode_EnumSpecifier: {
+        EnumSpecifier *spec = data;
+        if (spec->hasIdent)
+            node->data = pushName(builder, spec->ident);
+    } break;
+    case FlatNode_Enumerator: {
+        node->data = pushName(builder, ((Enumerator*)data)->constantIdent);
+    } break;
+    case FlatNode_StructOrUnionSpecifier: {
+        StructOrUnionSpecifier *spec = data;
+        node->variant = spec->structOrUnion;
+        if (spec->hasIdent)
+            node->data = pushName(builder, spec->ident);
+    } break;
+    case FlatNode_SpecifierQualifier: {
+        node->variant = ((SpecifierQualifier*)data)->type;
+    } break;
+    case FlatNode_TypeQualifier: {
+        node->variant = *(TypeQualifier*)data;
+    } break;
+    case FlatNode_Declarator: {
+        node->data = tokenIndex(builder, ((Declarator*)data)->tok);
+    } break;
+    case FlatNode_DirectDeclarator: {
+        DirectDeclarator *direct = data;
+        node->variant = direct->type;
+        if (direct->type == DirectDeclarator_Ident)
+            node->data = pushName(builder, direct->ident);
+    } break;
+    case FlatNode_PostDirectDeclarator: {
+        node->variant = ((PostDirectDeclarator*)data)->type;
+    } break;
+    case FlatNode_InnerExpr: {
+        node->variant = ((InnerExpr*)data)->type;
+    } break;
+    case FlatNode_AssignPrefix: {
+        node->variant = ((AssignPrefix*)data)->op;
+    } break;
+    case FlatNode_BinaryExpr: {
+        BinaryExpr *expr = data;
+        node->variant = expr->level;
+        node->data = pushPayload(builder, tokenIndex(builder, expr->tok));
+
+        if (expr->level == BinaryExpr_Cast) {
+            pushPayload(builder, 0);
+        }
+        else {
+            pushPayload(builder, toIndex(builder, expr->operands.size - 1));
+
+            for (size_t i = 1; i < expr->operands.size; i++) {
+                BinaryOperand *operand =
+                    astList_get(expr->operands, BinaryOperand, i);
+                pushPayload(builder, tokenIndex(builder, operand->opTok));
+            }
+        }
+    } break;
+    case FlatNode_CastExpr: {
+        CastExpr *expr = data;
+        node->variant = expr->type;
+        node->data = tokenIndex(builder, expr->tok);
+    } break;
+    case FlatNode_UnaryExpr: {
+        UnaryExpr *expr = data;
+        node->variant = expr->type;
+        node->data = tokenIndex(builder, expr->tok);
+    } break;
+    case FlatNode_PostfixExpr: {
+        PostfixExpr *expr = data;
+        node->variant = expr->type;
+        node->data = tokenIndex(builder, expr->tok);
+    } break;
+    case FlatNode_PostfixOp: {
+        PostfixOp *op = data;
+        node->variant = op->type;
+        if (op->type == PostfixOp_Dot)
+            node->data = pushName(builder, op->dotIdent);
+        else if (op->type == PostfixOp_Arrow)
+            node->data = pushName(builder, op->arrowIdent);
+    } break;
+    case FlatNode_PrimaryExpr: {
+        PrimaryExpr *expr = data;
+        node->variant = expr->type;
+        if (expr->type == PrimaryExpr_Ident)
+            node->data = pushName(builder, expr->ident);
+        else if (expr->type == PrimaryExpr_Constant)
+            node->data = pushName(builder, expr->constant.data);
+        else if (expr->type == PrimaryExpr_String)
+            node->data = pushName(builder, expr->string);
+    } break;
+    case FlatNode_ConstantExpr: {
+        ConstantExpr *expr = data;
+        node->variant = expr->type;
+        node->data = pushName(builder, expr->data);
+    } break;
+    case FlatNode_Initializer: {
+        node->variant = ((Initializer*)data)->type;
+    } break;
+    case FlatNode_Designator: {
+        node->variant = ((Designator*)data)->type;
+    } break;
+    default:
+        break;
+    }
+}
+
+static FlatIndex flatBuilder_open(FlatBuilder *builder, FlatNodeKind kind,
+    void *data)
+{
+    FlatAst *ast = builder->ast;
+
+    ast->nodes = growArray(ast->nodes, &(ast->nodeCapacity),
+        ast->numNodes + 1, sizeof(FlatNode));
+
+    FlatNode node = {
+        .kind = kind,
+        .data = FlatNone,
+    };
+    describeNode(builder, kind, data, &node);
+
+    FlatIndex index = toIndex(builder, ast->numNodes++);
+    ast->nodes[index] = node;
+
+    return index;
+}
+
+static void flatBuilder_close(FlatBuilder *builder, FlatIndex index) {
+    builder->ast->nodes[index].end = toIndex(builder, builder->ast->numNodes);
+}
+
+// Every node is opened before its children are walked and closed after
+static bool flatBuild_visit(TraversalEvent event, TraversalType type,
+    void *node, void *data)
+{
+    FlatBuilder *builder = data;
+
+    if (event == TraversalEvent_Leave) {
+        flatBuilder_close(builder, builder->open[--builder->numOpen]);
+        return true;
+    }
+
+    FlatNodeKind kind = FlatNode_Count;
+    switch (type) {
+#define FlatKindCase(type) case Traversal_ ## type: kind = FlatNode_ ## type; break;
+    FlatNodeKinds(FlatKindCase)
+#undef FlatKindCase
+    default:
+        assert(false);
+    }
+
+    FlatIndex index = flatBuilder_open(builder, kind, node);
+
+    builder->open = growArray(builder->open, &(builder->openCapacity),
+        builder->numOpen + 1, sizeof(FlatIndex));
+    builder->open[builder->numOpen++] = index;
+
+    return true;
+}
+
+bool flatAst_build(TranslationUnit *unit, TokenList tokens, FlatAst *outAst) {
+    *outAst = (FlatAst){ .tokens = tokens.tokens };
+
+    FlatBuilder builder = {
+        .ast = outAst,
+        .firstToken = tokens.tokens,
+        .numTokens = tokens.numTokens,
+    };
+
+    traverseEvents(unit, false, flatBuild_visit, &builder);
+
+    hashMap_cleanup(&(builder.pooledNames));
+    free(builder.open);
+
+    if (builder.overflowed) {
+        flatAst_cleanup(outAst);
+        return false;
+    }
+
+    return true;
+}
+
+void flatAst_cleanup(FlatAst *ast) {
+    free(ast->nodes);
+    free(ast->payloads);
+    free(ast->strings);
+
+    *ast = (FlatAst){0};
+}
+
+size_t flatAst_bytes(FlatAst *ast) {
+    return ast->numNodes * sizeof(FlatNode) +
+        ast->numPayloads * sizeof(uint32_t) +
+        ast->stringBytes;
+}
+
+static bool validToken(uint32_t token, size_t numTokens) {
+    return token == FlatNone || token < numTokens;
+}
+
+static bool validatePayload(FlatAst *ast, FlatNode *node, size_t numTokens) {
+    uint32_t payload = node->data;
+
+    // Number of token indices at the start of the payload
+    size_t numPayloadTokens = 2;
+    if (node->kind == FlatNode_BinaryExpr) {
+        if (payload + 2 > ast->numPayloads)
+            return false;
+
+        numPayloadTokens = 2 + (size_t)ast->payloads[payload + 1];
+    }
+
+    if (payload + numPayloadTokens > ast->numPayloads)
+        return false;
+
+    for (size_t i = 0; i < numPayloadTokens; i++) {
+        // The operator count isn't a token
+        if (node->kind == FlatNode_BinaryExpr && i == 1)
+            continue;
+
+        if (!validToken(ast->payloads[payload + i], numTokens))
+            return false;
+    }
+
+    return true;
+}
+
+static bool validateData(FlatAst *ast, FlatNode *node, size_t numTokens) {
+    if (node->data == FlatNone)
+        return true;
+
+    switch (flatDataType(node->kind)) {
+    case FlatData_None:
+        return false;
+    case FlatData_Token:
+        return validToken(node->data, numTokens);
+    case FlatData_Payload:
+        return validatePayload(ast, node, numTokens);
+    case FlatData_Name: {
+        if ((size_t)node->data + 2 > ast->numPayloads)
+            return false;
+
+        size_t offset = ast->payloads[node->data];
+        size_t length = ast->payloads[node->data + 1];
+        return offset + length <= ast->stringBytes;
+    }
+    }
+
+    return false;
+}
+
+bool flatAst_validate(FlatAst *ast, size_t numTokens) {
+    if (ast->numNodes == 0 || ast->nodes[0].kind != FlatNode_TranslationUnit ||
+        ast->nodes[0].end != ast->numNodes)
+    {
+        return false;
+    }
+
+    // Ends of the nodes that contain the current one
+    size_t depth = 0;
+    size_t capacity = 64;
+    FlatIndex *ends = malloc(capacity * sizeof(FlatIndex));
+    assert(ends != NULL);
+
+    bool valid = true;
+    for (size_t i = 0; i < ast->numNodes && valid; i++) {
+        FlatNode *node = ast->nodes + i;
+
+        while (depth > 0 && ends[depth - 1] <= i)
+            depth--;
+
+        // Every node has to end inside the one that contains it
+        valid = node->kind < FlatNode_Count && node->end > i &&
+            (depth == 0 ? i == 0 : node->end <= ends[depth - 1]) &&
+            validateData(ast, node, numTokens);
+
+        if (depth == capacity) {
+            capacity *= 2;
+            ends = realloc(ends, capacity * sizeof(FlatIndex));
+            assert(ends != NULL);
+        }
+        ends[depth++] = node->end;
+    }
+
+    free(ends);
+    return valid;
+}
+
+// Views
+
+Token *flatAst_token(FlatAst *ast, FlatIndex index) {
+    FlatNode *node = ast->nodes + index;
+
+    FlatDataType type = flatDataType(node->kind);
+    if (type == FlatData_Payload)
+        return flatAst_payloadToken(ast, index, 0);
+
+    if (type != FlatData_Token || node->data == FlatNone)
+        return NULL;
+
+    return ast->tokens + node->data;
+}
+
+Token *flatAst_payloadToken(FlatAst *ast, FlatIndex index, size_t offset) {
+    FlatNode *node = ast->nodes + index;
+
+    uint32_t payload = node->data;
+    if (flatDataType(node->kind) != FlatData_Payload || payload == FlatNone)
+        return NULL;
+
+    assert(payload + offset < ast->numPayloads);
+    uint32_t token = ast->payloads[payload + offset];
+    if (token == FlatNone)
+        return NULL;
+
+    return ast->tokens + token;
+}
+
+String flatAst_name(FlatAst *ast, FlatIndex index) {
+    FlatNode *node = ast->nodes + index;
+
+    if (flatDataType(node->kind) != FlatData_Name || node->data == FlatNone)
+        return (String){0};
+
+    uint32_t offset = ast->payloads[node->data];
+    uint32_t length = ast->payloads[node->data + 1];
+
+    return (String){ (uint8_t*)ast->strings + offset, length };
+}
+
+FlatIndex flatAst_findChild(FlatAst *ast, FlatIndex parent, FlatNodeKind kind) {
+    flatAst_foreachChild(ast, parent, child) {
+        if (ast->nodes[child].kind == kind)
+            return child;
+    }
+
+    return FlatNone;
+}
+
+FlatIndex flatAst_parent(FlatAst *ast, FlatIndex index) {
+    // The parent is the closest node before this one whose range covers it
+    for (FlatIndex i = index; i > 0; i--) {
+        if (ast->nodes[i - 1].end > index)
+            return i - 1;
+    }
+
+    return FlatNone;
+}
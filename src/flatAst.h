@@ -0,0 +1,179 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "parser.h"
+#include "astring.h"
+
+// A compact copy of a translation unit's tree for rules that only read it.
+//
+// Every node is a fixed size record in one array, in the order a traversal
+// visits them, so walking the array front to back walks the source front to
+// back. A node's children are the nodes right after it, up to its end index.
+// Anything that doesn't fit in the record, like the tokens of a chain of
+// operators or an identifier's name, goes in a separate payload array. Names
+// are copied into a string pool so the tree doesn't point into file buffers.
+//
+// Nodes store 32 bit indices into the arrays instead of pointers, so the
+// arrays can be written out and read back as they are.
+
+// Every node kind a traversal visits. The LogicalOrExpr through
+// MultiplicativeExpr levels are left out since BinaryExpr covers them.
+#define FlatNodeKinds(X)\
+    X(TranslationUnit)\
+    X(ExternalDecl)\
+    X(FuncDef)\
+    X(CompoundStmt)\
+    X(BlockItemList)\
+    X(BlockItem)\
+    X(Statement)\
+    X(AsmStatement)\
+    X(JumpStatement)\
+    X(IterationStatement)\
+    X(ExpressionStatement)\
+    X(SelectionStatement)\
+    X(LabeledStatement)\
+    X(Declaration)\
+    X(InitDeclaratorList)\
+    X(InitDeclarator)\
+    X(DeclarationSpecifierList)\
+    X(DeclarationSpecifier)\
+    X(AlignmentSpecifier)\
+    X(FunctionSpecifier)\
+    X(StorageClassSpecifier)\
+    X(TypeSpecifier)\
+    X(EnumSpecifier)\
+    X(EnumeratorList)\
+    X(Enumerator)\
+    X(StructOrUnionSpecifier)\
+    X(StructDeclaration)\
+    X(StaticAssertDeclaration)\
+    X(StructDeclaratorList)\
+    X(StructDeclarator)\
+    X(TypeName)\
+    X(SpecifierQualifierList)\
+    X(SpecifierQualifier)\
+    X(TypeQualifier)\
+    X(Declarator)\
+    X(DirectDeclarator)\
+    X(PostDirectDeclarator)\
+    X(IdentifierList)\
+    X(AbstractDeclarator)\
+    X(Pointer)\
+    X(DirectAbstractDeclarator)\
+    X(PostDirectAbstractDeclarator)\
+    X(ParameterTypeList)\
+    X(ParameterDeclaration)\
+    X(Expr)\
+    X(InnerExpr)\
+    X(AssignExpr)\
+    X(AssignPrefix)\
+    X(ConditionalExpr)\
+    X(BinaryExpr)\
+    X(CastExpr)\
+    X(UnaryExpr)\
+    X(PostfixExpr)\
+    X(PostfixOp)\
+    X(ArgExprList)\
+    X(PrimaryExpr)\
+    X(ConstantExpr)\
+    X(GenericSelection)\
+    X(GenericAssociation)\
+    X(InitializerList)\
+    X(DesignationAndInitializer)\
+    X(Initializer)\
+    X(Designation)\
+    X(Designator)
+
+typedef enum {
+#define FlatNodeKindEnum(type) FlatNode_ ## type,
+    FlatNodeKinds(FlatNodeKindEnum)
+#undef FlatNodeKindEnum
+    FlatNode_Count,
+} FlatNodeKind;
+
+char *flatNodeKind_name(FlatNodeKind kind);
+
+typedef uint32_t FlatIndex;
+
+#define FlatNone UINT32_MAX
+
+typedef struct {
+    uint16_t kind;
+    // The type field of nodes that have one, like a Statement's
+    // StatementType or a BinaryExpr's level
+    uint16_t variant;
+    // One past the node's last descendant
+    FlatIndex end;
+    // The start of the node's payload for kinds that have one. Otherwise the
+    // index of the node's token, if it has one. FlatNone if neither.
+    uint32_t data;
+} FlatNode;
+
+// Payloads by node kind, with token indices for the tokens:
+//   FuncDef              first token, closing }
+//   CompoundStmt         opening {, closing }
+//   SelectionStatement   if or switch, else or FlatNone
+//   BinaryExpr           first token, operator count, each operator
+//   Named nodes          string pool offset, length
+// The named nodes are identifier DirectDeclarators, PrimaryExprs with an
+// identifier, constant or string, . and -> PostfixOps, ConstantExprs, typedef
+// name TypeSpecifiers, struct, union and enum tags, enumerators, labels and
+// gotos. Named nodes without a name have no payload.
+//
+// IterationStatements, Declarators, CastExprs, UnaryExprs and PostfixExprs
+// just have a token.
+
+typedef struct {
+    size_t numNodes;
+    size_t nodeCapacity;
+    FlatNode *nodes;
+
+    size_t numPayloads;
+    size_t payloadCapacity;
+    uint32_t *payloads;
+
+    size_t stringBytes;
+    size_t stringCapacity;
+    char *strings;
+
+    // Token indices are into this array, which the flat tree doesn't own
+    Token *tokens;
+} FlatAst;
+
+// Walks the whole unit, so deferred function bodies get parsed. Fails if the
+// unit is too big for 32 bit indices.
+bool flatAst_build(TranslationUnit *unit, TokenList tokens, FlatAst *outAst);
+void flatAst_cleanup(FlatAst *ast);
+
+// Bytes used by the arrays, not counting the tokens
+size_t flatAst_bytes(FlatAst *ast);
+
+// Checks that every index in the arrays is in bounds, for trees that weren't
+// just built, like ones read back from a file
+bool flatAst_validate(FlatAst *ast, size_t numTokens);
+
+// The root is the TranslationUnit node
+#define FlatRoot 0
+
+#define flatAst_node(ast, index) ((ast)->nodes + (index))
+
+#define flatAst_foreachChild(ast, parent, name)\
+    for (FlatIndex name = (parent) + 1; name < (ast)->nodes[parent].end;\
+        name = (ast)->nodes[name].end)
+
+// The node's token, or the first token in its payload. NULL if it has
+// neither.
+Token *flatAst_token(FlatAst *ast, FlatIndex index);
+// Token whose index is in the node's payload at offset, or NULL
+Token *flatAst_payloadToken(FlatAst *ast, FlatIndex index, size_t offset);
+// Empty if the node doesn't have a name
+String flatAst_name(FlatAst *ast, FlatIndex index);
+
+// First child of the given kind, or FlatNone
+FlatIndex flatAst_findChild(FlatAst *ast, FlatIndex parent, FlatNodeKind kind);
+// Parent of a node, or FlatNone for the root. Walks back from the node, so
+// it's only quick for nodes near their parent.
+FlatIndex flatAst_parent(FlatAst *ast, FlatIndex index);
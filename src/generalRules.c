@@ -1,10 +1,12 @@
 #include "generalRules.h"
 
 #include <string.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <assert.h>
 
 #include "traversal.h"
+#include "astIndex.h"
 
 // Verifies that lines not longer than 80 characters
 void rule_1_2_a(Rule rule, RuleContext context) {
@@ -23,83 +25,74 @@ void rule_1_2_a(Rule rule, RuleContext context) {
     }
 }
 
-static void rule_1_3_a_traverseSelection(TraversalFuncTable *table, SelectionStatement *stmt, void *data) {
-    Rule *rule = data;
-
-    if (stmt->type == SelectionStatement_If) {
-        if (stmt->ifTrueStmt->type != Statement_Compound) {
-            reportRuleViolation(rule->name,
-                stmt->ifToken->fileName, stmt->ifToken->line,
-                "%s", "If statement true block isn't a compound statement"
-            );
-        }
-
-        if (stmt->ifHasElse && stmt->ifFalseStmt->type != Statement_Compound) {
-            reportRuleViolation(rule->name,
-                stmt->elseToken->fileName, stmt->elseToken->line,
-                "%s", "If statement false block isn't a compound statement"
-            );
-        }
-    }
-    else if (stmt->type == SelectionStatement_Switch) {
-        if (stmt->switchStmt->type != Statement_Compound) {
-            reportRuleViolation(rule->name,
-                stmt->switchToken->fileName, stmt->switchToken->line,
-                "%s", "Switch statement block isn't a compound statement"
-            );
-        }
-    }
-    else {
-        assert(false);
-    }
-
-    // Continue traversal
-    defaultTraversal_SelectionStatement(table, stmt, data);
-}
-
-static void rule_1_3_a_traverseIteration(TraversalFuncTable *table, IterationStatement *stmt, void *data) {
-    Rule *rule = data;
-
-    if (stmt->type == IterationStatement_While) {
-        if (stmt->whileStmt->type != Statement_Compound) {
-            reportRuleViolation(rule->name,
-                stmt->whileToken->fileName, stmt->whileToken->line,
-                "%s", "While statement block isn't a compound statement"
-            );
-        }
-    }
-    else if (stmt->type == IterationStatement_DoWhile) {
-        if (stmt->doStmt->type != Statement_Compound) {
-            reportRuleViolation(rule->name,
-                stmt->doToken->fileName, stmt->doToken->line,
-                "%s", "Do While statement block isn't a compound statement"
-            );
-        }
-    }
-    else if (stmt->type == IterationStatement_For) {
-        if (stmt->forStmt->type != Statement_Compound) {
-            reportRuleViolation(rule->name,
-                stmt->forToken->fileName, stmt->forToken->line,
-                "%s", "For statement block isn't a compound statement"
-            );
-        }
-    }
-    else {
-        assert(false);
-    }
-
-    defaultTraversal_IterationStatement(table, stmt, data);
-}
+static const AstPattern rule_1_3_a_patterns[] = {
+    {
+        .type = Traversal_SelectionStatement,
+        .tests = {
+            PatternIs(SelectionStatement, type, SelectionStatement_If),
+            PatternChildIsNot(SelectionStatement, ifTrueStmt,
+                Statement, type, Statement_Compound),
+        },
+        .token = offsetof(SelectionStatement, ifToken),
+        .message = "If statement true block isn't a compound statement",
+    },
+    {
+        .type = Traversal_SelectionStatement,
+        .tests = {
+            PatternIs(SelectionStatement, type, SelectionStatement_If),
+            PatternIs(SelectionStatement, ifHasElse, true),
+            PatternChildIsNot(SelectionStatement, ifFalseStmt,
+                Statement, type, Statement_Compound),
+        },
+        .token = offsetof(SelectionStatement, elseToken),
+        .message = "If statement false block isn't a compound statement",
+    },
+    {
+        .type = Traversal_SelectionStatement,
+        .tests = {
+            PatternIs(SelectionStatement, type, SelectionStatement_Switch),
+            PatternChildIsNot(SelectionStatement, switchStmt,
+                Statement, type, Statement_Compound),
+        },
+        .token = offsetof(SelectionStatement, switchToken),
+        .message = "Switch statement block isn't a compound statement",
+    },
+    {
+        .type = Traversal_IterationStatement,
+        .tests = {
+            PatternIs(IterationStatement, type, IterationStatement_While),
+            PatternChildIsNot(IterationStatement, whileStmt,
+                Statement, type, Statement_Compound),
+        },
+        .token = offsetof(IterationStatement, whileToken),
+        .message = "While statement block isn't a compound statement",
+    },
+    {
+        .type = Traversal_IterationStatement,
+        .tests = {
+            PatternIs(IterationStatement, type, IterationStatement_DoWhile),
+            PatternChildIsNot(IterationStatement, doStmt,
+                Statement, type, Statement_Compound),
+        },
+        .token = offsetof(IterationStatement, doToken),
+        .message = "Do While statement block isn't a compound statement",
+    },
+    {
+        .type = Traversal_IterationStatement,
+        .tests = {
+            PatternIs(IterationStatement, type, IterationStatement_For),
+            PatternChildIsNot(IterationStatement, forStmt,
+                Statement, type, Statement_Compound),
+        },
+        .token = offsetof(IterationStatement, forToken),
+        .message = "For statement block isn't a compound statement",
+    },
+};
 
 // Verifies each selection and iteration statement has a compound statement
-void rule_1_3_a(Rule rule, RuleContext context) {
-    // For
-
-    TraversalFuncTable funcTable = defaultTraversal();
-    funcTable.traverse_SelectionStatement = rule_1_3_a_traverseSelection;
-    funcTable.traverse_IterationStatement = rule_1_3_a_traverseIteration;
-
-    traverse(funcTable, context.translationUnit, &rule);
+size_t rule_1_3_a(const AstPattern **outPatterns) {
+    *outPatterns = rule_1_3_a_patterns;
+    return sizeof(rule_1_3_a_patterns) / sizeof(AstPattern);
 }
 
 static bool token_isOnOwnLine(Token *token) {
@@ -115,19 +108,17 @@ static bool token_isOnOwnLine(Token *token) {
     return true;
 }
 
-static void rule_1_3_b_traverseCompound(TraversalFuncTable *table, CompoundStmt *stmt, void *data) {
-    Rule *rule = data;
-
+static void rule_1_3_b_checkCompound(Rule rule, CompoundStmt *stmt) {
     // Check if open and close brackets are alone on their line
     if (!token_isOnOwnLine(stmt->openBracket)) {
-        reportRuleViolation(rule->name,
+        reportRuleViolation(rule.name,
             stmt->openBracket->fileName, stmt->openBracket->line,
             "%s", "Open curly bracket must be alone on its line"
         );
     }
 
     if (!token_isOnOwnLine(stmt->closeBracket)) {
-        reportRuleViolation(rule->name,
+        reportRuleViolation(rule.name,
             stmt->closeBracket->fileName, stmt->closeBracket->line,
             "%s", "Closing curly bracket must be alone on its line"
         );
@@ -135,261 +126,303 @@ static void rule_1_3_b_traverseCompound(TraversalFuncTable *table, CompoundStmt
 
     // Check if open and close brackets are on the same column
     if (stmt->openBracket->col != stmt->closeBracket->col) {
-        reportRuleViolation(rule->name,
+        reportRuleViolation(rule.name,
             stmt->closeBracket->fileName, stmt->closeBracket->line,
             "%s", "Open and close curly bracket must be on same column"
         );
     }
-
-    // Continue traversal
-    defaultTraversal_CompoundStmt(table, stmt, data);
 }
 
 // Verifies braces on own line and closing brace in same column
 void rule_1_3_b(Rule rule, RuleContext context) {
-    TraversalFuncTable funcTable = defaultTraversal();
-    funcTable.traverse_CompoundStmt = rule_1_3_b_traverseCompound;
+    AstIndex *index = translationUnit_getIndex(context.translationUnit, true);
 
-    traverse(funcTable, context.translationUnit, &rule);
+    for (size_t i = 0; i < index->numCompoundStmts; i++) {
+        rule_1_3_b_checkCompound(rule, index->compoundStmts[i]);
+    }
 }
 
-static void rule_1_4_b_dirtyTraversePostfix(TraversalFuncTable *table, PostfixExpr *expr, void *data) {
+// Whether the hook's node is an operand of a root && or ||, with only levels
+// that have a single operand in between
+static bool rule_1_4_b_isRootOperand() {
+    for (size_t up = 1; ; up++) {
+        TraversalAncestor ancestor = traversal_ancestor(up);
+
+        switch (ancestor.type) {
+        case Traversal_LogicalOrExpr:
+            return ((LogicalOrExpr*)ancestor.node)->list.size > 1;
+        case Traversal_LogicalAndExpr:
+            if (((LogicalAndExpr*)ancestor.node)->list.size > 1)
+                return true;
+            break;
+        case Traversal_InclusiveOrExpr:
+            if (((InclusiveOrExpr*)ancestor.node)->list.size > 1)
+                return false;
+            break;
+        case Traversal_ExclusiveOrExpr:
+            if (((ExclusiveOrExpr*)ancestor.node)->list.size > 1)
+                return false;
+            break;
+        case Traversal_AndExpr:
+            if (((AndExpr*)ancestor.node)->list.size > 1)
+                return false;
+            break;
+        case Traversal_EqualityExpr:
+            if (((EqualityExpr*)ancestor.node)->postExprs.size > 0)
+                return false;
+            break;
+        case Traversal_RelationalExpr:
+            if (((RelationalExpr*)ancestor.node)->postExprs.size > 0)
+                return false;
+            break;
+        case Traversal_ShiftExpr:
+            if (((ShiftExpr*)ancestor.node)->postExprs.size > 0)
+                return false;
+            break;
+        case Traversal_AdditiveExpr:
+            if (((AdditiveExpr*)ancestor.node)->postExprs.size > 0)
+                return false;
+            break;
+        case Traversal_MultiplicativeExpr:
+            if (((MultiplicativeExpr*)ancestor.node)->postExprs.size > 0)
+                return false;
+            break;
+        case Traversal_CastExpr:
+            if (((CastExpr*)ancestor.node)->type != CastExpr_Unary)
+                return false;
+            break;
+        case Traversal_UnaryExpr:
+            if (((UnaryExpr*)ancestor.node)->type != UnaryExpr_Base)
+                return false;
+            break;
+        default:
+            return false;
+        }
+    }
+}
+
+// An operand of a root && or || that isn't a single postfix expression is
+// reported, and what's inside it isn't looked at any further
+void rule_1_4_b_traversePostfix(TraversalFuncTable *table, PostfixExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->type != Postfix_Primary) {
+    if (expr->type != Postfix_Primary && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Postfix expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        table->traverse_PrimaryExpr(table, &(expr->primary), data);
-    }
+
+    defaultTraversal_PostfixExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseUnary(TraversalFuncTable *table, UnaryExpr *expr, void *data) {
+void rule_1_4_b_traverseUnary(TraversalFuncTable *table, UnaryExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->type != UnaryExpr_Base) {
+    if (expr->type != UnaryExpr_Base && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Unary expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        rule_1_4_b_dirtyTraversePostfix(table, &(expr->baseExpr), data);
-    }
+
+    defaultTraversal_UnaryExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseCast(TraversalFuncTable *table, CastExpr *expr, void *data) {
+void rule_1_4_b_traverseCast(TraversalFuncTable *table, CastExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->type != CastExpr_Unary) {
+    if (expr->type != CastExpr_Unary && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Cast expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        rule_1_4_b_dirtyTraverseUnary(table, &(expr->unary), data);
-    }
+
+    defaultTraversal_CastExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseMultiplicative(TraversalFuncTable *table, MultiplicativeExpr *expr, void *data) {
+void rule_1_4_b_traverseMultiplicative(TraversalFuncTable *table, MultiplicativeExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->postExprs.size > 0) {
+    if (expr->postExprs.size > 0 && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Multiplicative expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        rule_1_4_b_dirtyTraverseCast(table, &(expr->baseExpr), data);
-    }
+
+    defaultTraversal_MultiplicativeExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseAdditive(TraversalFuncTable *table, AdditiveExpr *expr, void *data) {
+void rule_1_4_b_traverseAdditive(TraversalFuncTable *table, AdditiveExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->postExprs.size > 0) {
+    if (expr->postExprs.size > 0 && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Additive expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        rule_1_4_b_dirtyTraverseMultiplicative(table, &(expr->baseExpr), data);
-    }
+
+    defaultTraversal_AdditiveExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseShift(TraversalFuncTable *table, ShiftExpr *expr, void *data) {
+void rule_1_4_b_traverseShift(TraversalFuncTable *table, ShiftExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->postExprs.size > 0) {
+    if (expr->postExprs.size > 0 && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Shift expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        rule_1_4_b_dirtyTraverseAdditive(table, &(expr->baseExpr), data);
-    }
+
+    defaultTraversal_ShiftExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseRelational(TraversalFuncTable *table, RelationalExpr *expr, void *data) {
+void rule_1_4_b_traverseRelational(TraversalFuncTable *table, RelationalExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->postExprs.size > 0) {
+    if (expr->postExprs.size > 0 && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Relational expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        rule_1_4_b_dirtyTraverseShift(table, &(expr->baseExpr), data);
-    }
+
+    defaultTraversal_RelationalExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseEquality(TraversalFuncTable *table, EqualityExpr *expr, void *data) {
+void rule_1_4_b_traverseEquality(TraversalFuncTable *table, EqualityExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->postExprs.size > 0) {
+    if (expr->postExprs.size > 0 && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Equality expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        rule_1_4_b_dirtyTraverseRelational(table, &(expr->baseExpr), data);
-    }
+
+    defaultTraversal_EqualityExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseAnd(TraversalFuncTable *table, AndExpr *expr, void *data) {
+void rule_1_4_b_traverseAnd(TraversalFuncTable *table, AndExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->list.size > 1) {
+    if (expr->list.size > 1 && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "And expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        EqualityExpr *eq = slNode_getData(expr->list.head);
-        rule_1_4_b_dirtyTraverseEquality(table, eq, data);
-    }
+
+    defaultTraversal_AndExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseExclusiveOr(TraversalFuncTable *table, ExclusiveOrExpr *expr, void *data) {
+void rule_1_4_b_traverseExclusiveOr(TraversalFuncTable *table, ExclusiveOrExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->list.size > 1) {
+    if (expr->list.size > 1 && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Exclusive or expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        AndExpr *and = slNode_getData(expr->list.head);
-        rule_1_4_b_dirtyTraverseAnd(table, and, data);
-    }
+
+    defaultTraversal_ExclusiveOrExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseInclusiveOr(TraversalFuncTable *table, InclusiveOrExpr *expr, void *data) {
+void rule_1_4_b_traverseInclusiveOr(TraversalFuncTable *table, InclusiveOrExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->list.size > 1) {
+    if (expr->list.size > 1 && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Inclusive or expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        ExclusiveOrExpr *or = slNode_getData(expr->list.head);
-        rule_1_4_b_dirtyTraverseExclusiveOr(table, or, data);
-    }
+
+    defaultTraversal_InclusiveOrExpr(table, expr, data);
 }
 
-static void rule_1_4_b_dirtyTraverseLogicalAnd(TraversalFuncTable *table, LogicalAndExpr *expr, void *data) {
+// A && under a root || is an operand like any other. One that isn't is a
+// root itself.
+void rule_1_4_b_traverseLogicalAnd(TraversalFuncTable *table, LogicalAndExpr *expr, void *data) {
     Rule *rule = data;
 
-    if (expr->list.size > 1) {
+    if (expr->list.size > 1 && rule_1_4_b_isRootOperand()) {
         reportRuleViolation(rule->name,
             expr->tok->fileName, expr->tok->line,
             "%s", "Logical and expression was expected to be surrounded by parens because of a root && or ||"
         );
+        return;
     }
-    else {
-        InclusiveOrExpr *or = slNode_getData(expr->list.head);
-        rule_1_4_b_dirtyTraverseInclusiveOr(table, or, data);
-    }
-}
 
-static void rule_1_4_b_traverseLogicalAnd(TraversalFuncTable *table, LogicalAndExpr *expr, void *data) {
-    if (expr->list.size == 0) {
-        // I don't think this is possible
-        assert(false);
-    }
-    else if (expr->list.size == 1) {
-        defaultTraversal_LogicalAndExpr(table, expr, data);
-    }
-    else {
-        sll_foreach(expr->list, node) {
-            InclusiveOrExpr *or = slNode_getData(node);
-            rule_1_4_b_dirtyTraverseInclusiveOr(table, or, data);
-        }
-    }
-}
-
-static void rule_1_4_b_traverseLogicalOr(TraversalFuncTable *table, LogicalOrExpr *expr, void *data) {
-    if (expr->list.size == 0) {
-        // I don't think this is possible
-        assert(false);
-    }
-    else if (expr->list.size == 1) {
-        defaultTraversal_LogicalOrExpr(table, expr, data);
-    }
-    else {
-        sll_foreach(expr->list, node) {
-            LogicalAndExpr *and = slNode_getData(node);
-            rule_1_4_b_dirtyTraverseLogicalAnd(table, and, data);
-        }
-    }
+    defaultTraversal_LogicalAndExpr(table, expr, data);
 }
 
 // Verifies && and || use parens on either side for complex exprs
-void rule_1_4_b(Rule rule, RuleContext context) {
-    TraversalFuncTable funcTable = defaultTraversal();
-    funcTable.traverse_LogicalOrExpr = rule_1_4_b_traverseLogicalOr;
-    funcTable.traverse_LogicalAndExpr = rule_1_4_b_traverseLogicalAnd;
-
-    traverse(funcTable, context.translationUnit, &rule);
+void rule_1_4_b(TraversalFuncTable *table) {
+    Rule_1_4_b_Hooks(SetRuleHook)
 }
 
 // FIXME: Rules 1.7.a and 1.7.b are pretty much identical,
 //        so they should probably be refactored
+static void rule_1_7_a_checkAuto(Rule *rule, RuleContext *context, Token *tok) {
+    reportRuleViolation(rule->name,
+        context->fileName, tok->line,
+        "%s", "Use of auto keyword is prohibited"
+    );
+}
+
+static const TokenSubscription rule_1_7_a_tokens[] = {
+    { Token_auto, rule_1_7_a_checkAuto },
+};
+
 // Verifies there is no use of auto keyword
-void rule_1_7_a(Rule rule, RuleContext context) {
-    for (uint64_t i = 0; i < context.tokens.numTokens; i++) {
-        Token tok = context.tokens.tokens[i];
-        if (tok.type == Token_auto) {
-            reportRuleViolation(rule.name,
-                context.fileName, tok.line,
-                "%s", "Use of auto keyword is prohibited"
-            );
-        }
-    }
+size_t rule_1_7_a(const TokenSubscription **outSubscriptions) {
+    *outSubscriptions = rule_1_7_a_tokens;
+    return sizeof(rule_1_7_a_tokens) / sizeof(TokenSubscription);
 }
 
+static void rule_1_7_b_checkRegister(Rule *rule, RuleContext *context, Token *tok) {
+    reportRuleViolation(rule->name,
+        context->fileName, tok->line,
+        "%s", "Use of register keyword is prohibited"
+    );
+}
+
+static const TokenSubscription rule_1_7_b_tokens[] = {
+    { Token_register, rule_1_7_b_checkRegister },
+};
+
 // Verifies there is no use of register keyword
-void rule_1_7_b(Rule rule, RuleContext context) {
-    for (uint64_t i = 0; i < context.tokens.numTokens; i++) {
-        Token tok = context.tokens.tokens[i];
-        if (tok.type == Token_register) {
-            reportRuleViolation(rule.name,
-                context.fileName, tok.line,
-                "%s", "Use of register keyword is prohibited"
-            );
-        }
-    }
+size_t rule_1_7_b(const TokenSubscription **outSubscriptions) {
+    *outSubscriptions = rule_1_7_b_tokens;
+    return sizeof(rule_1_7_b_tokens) / sizeof(TokenSubscription);
+}
+
+static const TokenPattern rule_1_7_d_patterns[] = {
+    {
+        .types = { Token_continue },
+        .message = "Use of continue keyword should be avoided",
+    },
+};
+
+// Verifies there is no use of continue keyword
+size_t rule_1_7_d(const TokenPattern **outPatterns) {
+    *outPatterns = rule_1_7_d_patterns;
+    return sizeof(rule_1_7_d_patterns) / sizeof(TokenPattern);
 }
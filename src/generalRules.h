@@ -6,20 +6,37 @@
 void rule_1_2_a(Rule rule, RuleContext context);
 
 // Verifies each selection and iteration statement has a compound statement
-void rule_1_3_a(Rule rule, RuleContext context);
+size_t rule_1_3_a(const AstPattern **outPatterns);
 
 // Verifies braces on own line and closing brace in same column
 void rule_1_3_b(Rule rule, RuleContext context);
 
 // Verifies && and || use parens on either side for complex exprs
-void rule_1_4_b(Rule rule, RuleContext context);
+void rule_1_4_b(TraversalFuncTable *table);
+#define Rule_1_4_b_Hooks(X)\
+    X(LogicalAndExpr, rule_1_4_b_traverseLogicalAnd)\
+    X(InclusiveOrExpr, rule_1_4_b_traverseInclusiveOr)\
+    X(ExclusiveOrExpr, rule_1_4_b_traverseExclusiveOr)\
+    X(AndExpr, rule_1_4_b_traverseAnd)\
+    X(EqualityExpr, rule_1_4_b_traverseEquality)\
+    X(RelationalExpr, rule_1_4_b_traverseRelational)\
+    X(ShiftExpr, rule_1_4_b_traverseShift)\
+    X(AdditiveExpr, rule_1_4_b_traverseAdditive)\
+    X(MultiplicativeExpr, rule_1_4_b_traverseMultiplicative)\
+    X(CastExpr, rule_1_4_b_traverseCast)\
+    X(UnaryExpr, rule_1_4_b_traverseUnary)\
+    X(PostfixExpr, rule_1_4_b_traversePostfix)
+Rule_1_4_b_Hooks(RuleHookPrototype)
 
 // Verifies no single letter variable names
 // NOTE: Doesn't catch all abbreviations!!!
 void rule_1_5_a(Rule rule, RuleContext context);
 
 // Verifies there is no use of auto keyword
-void rule_1_7_a(Rule rule, RuleContext context);
+size_t rule_1_7_a(const TokenSubscription **outSubscriptions);
 
 // Verifies there is no use of register keyword
-void rule_1_7_b(Rule rule, RuleContext context);
+size_t rule_1_7_b(const TokenSubscription **outSubscriptions);
+
+// Verifies there is no use of continue keyword
+size_t rule_1_7_d(const TokenPattern **outPatterns);
@@ -0,0 +1,103 @@
+#include "hashMap.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#define HashMap_InitialCapacity 64
+
+static HashMapEntry *hashMap_slot(HashMapEntry *entries, size_t capacity,
+                                  String key, uint64_t hash);
+
+static void hashMap_grow(HashMap *map);
+
+// FNV-1a
+uint64_t hashBytes(uint8_t *bytes, size_t length) {
+    uint64_t hash = 14695981039346656037ULL;
+
+    for (size_t i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+bool hashMap_find(HashMap *map, String key, void **outValue) {
+    if (map->numEntries == 0)
+        return false;
+
+    uint64_t hash = hashBytes(key.str, key.length);
+    HashMapEntry *entry = hashMap_slot(map->entries, map->capacity, key, hash);
+
+    if (entry->key.str == NULL)
+        return false;
+
+    if (outValue != NULL)
+        *outValue = entry->value;
+
+    return true;
+}
+
+void hashMap_insert(HashMap *map, String key, void *value) {
+    assert(key.str != NULL);
+
+    // Keep the load factor under 3/4
+    if ((map->numEntries + 1) * 4 > map->capacity * 3)
+        hashMap_grow(map);
+
+    uint64_t hash = hashBytes(key.str, key.length);
+    HashMapEntry *entry = hashMap_slot(map->entries, map->capacity, key, hash);
+
+    if (entry->key.str == NULL) {
+        entry->key = key;
+        entry->hash = hash;
+        map->numEntries++;
+    }
+
+    entry->value = value;
+}
+
+void hashMap_cleanup(HashMap *map) {
+    free(map->entries);
+    *map = (HashMap){0};
+}
+
+static HashMapEntry *hashMap_slot(HashMapEntry *entries, size_t capacity,
+                                  String key, uint64_t hash)
+{
+    // Capacity is always a power of 2
+    size_t idx = hash & (capacity - 1);
+
+    while (true) {
+        HashMapEntry *entry = entries + idx;
+
+        if (entry->key.str == NULL)
+            return entry;
+
+        if (entry->hash == hash && astr_cmp(entry->key, key))
+            return entry;
+
+        idx = (idx + 1) & (capacity - 1);
+    }
+}
+
+static void hashMap_grow(HashMap *map) {
+    size_t newCapacity = map->capacity == 0 ?
+        HashMap_InitialCapacity : map->capacity * 2;
+
+    HashMapEntry *newEntries = calloc(newCapacity, sizeof(HashMapEntry));
+    assert(newEntries != NULL);
+
+    for (size_t i = 0; i < map->capacity; i++) {
+        HashMapEntry *entry = map->entries + i;
+        if (entry->key.str == NULL)
+            continue;
+
+        *hashMap_slot(newEntries, newCapacity, entry->key, entry->hash) = *entry;
+    }
+
+    free(map->entries);
+    map->entries = newEntries;
+    map->capacity = newCapacity;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "astring.h"
+
+// Open addressing hash map from Strings to pointers. Like String, the map
+// doesn't own the key bytes, so keys have to live at least as long as the
+// map does.
+
+typedef struct {
+    String key;
+    uint64_t hash;
+    void *value;
+} HashMapEntry;
+
+typedef struct {
+    size_t numEntries;
+    size_t capacity;
+    HashMapEntry *entries;
+} HashMap;
+
+uint64_t hashBytes(uint8_t *bytes, size_t length);
+
+bool hashMap_find(HashMap *map, String key, void **outValue);
+void hashMap_insert(HashMap *map, String key, void *value);
+void hashMap_cleanup(HashMap *map);
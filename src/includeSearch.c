@@ -0,0 +1,193 @@
+#include "includeSearch.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <dirent.h>
+#include <assert.h>
+
+#include "array.h"
+#include "debug.h"
+#include "hashMap.h"
+
+typedef struct {
+    bool exists;
+    HashMap entries;
+} DirectoryEntries;
+
+static size_t g_numUserPaths;
+static char **g_userPaths;
+
+static size_t g_numSystemPaths;
+static char **g_systemPaths;
+
+static char *g_defaultPath = "/usr/include";
+
+// Directory path -> DirectoryEntries
+static HashMap g_directoryCache;
+
+// Resolved path -> the single copy of that path we hand out
+static HashMap g_resolvedPaths;
+
+static char *copyString(uint8_t *str, size_t length);
+
+static DirectoryEntries *readDirectory(uint8_t *path, size_t length);
+
+static char *lookupFile(String directory, String fileName);
+
+static char *internPath(uint8_t *path, size_t length);
+
+void includeSearch_addPath(IncludePathType type, char *path) {
+    size_t length = strlen(path);
+
+    // Drop trailing slashes so every directory has one spelling in the cache
+    while (length > 1 && path[length - 1] == '/')
+        length--;
+
+    char *directory = copyString((uint8_t*)path, length);
+
+    if (type == IncludePath_User) {
+        ArrayAppend(g_userPaths, g_numUserPaths, directory);
+    }
+    else {
+        ArrayAppend(g_systemPaths, g_numSystemPaths, directory);
+    }
+}
+
+char *includeSearch_resolve(String fileName, bool isAngled, char *includingFile) {
+    if (fileName.length == 0)
+        return NULL;
+
+    if (fileName.str[0] == '/')
+        return lookupFile((String){0}, fileName);
+
+    char *resolved = NULL;
+
+    if (!isAngled && includingFile != NULL) {
+        String directory = astr(includingFile);
+        while (directory.length > 0 &&
+            directory.str[directory.length - 1] != '/')
+        {
+            directory.length--;
+        }
+
+        if (directory.length == 0)
+            directory = astr(".");
+
+        resolved = lookupFile(directory, fileName);
+        if (resolved != NULL)
+            return resolved;
+    }
+
+    for (size_t i = 0; i < g_numUserPaths; i++) {
+        resolved = lookupFile(astr(g_userPaths[i]), fileName);
+        if (resolved != NULL)
+            return resolved;
+    }
+
+    for (size_t i = 0; i < g_numSystemPaths; i++) {
+        resolved = lookupFile(astr(g_systemPaths[i]), fileName);
+        if (resolved != NULL)
+            return resolved;
+    }
+
+    return lookupFile(astr(g_defaultPath), fileName);
+}
+
+static char *copyString(uint8_t *str, size_t length) {
+    char *copy = malloc(length + 1);
+    assert(copy != NULL);
+
+    memcpy(copy, str, length);
+    copy[length] = '\0';
+
+    return copy;
+}
+
+static DirectoryEntries *readDirectory(uint8_t *path, size_t length) {
+    DirectoryEntries *directory = NULL;
+    if (hashMap_find(&g_directoryCache, (String){path, length},
+        (void**)&directory))
+    {
+        return directory;
+    }
+
+    char *name = copyString(path, length);
+
+    directory = calloc(1, sizeof(DirectoryEntries));
+    assert(directory != NULL);
+
+    // A directory that can't be opened stays in the cache as a negative
+    // entry, so headers we can't find only cost one failed opendir
+    DIR *handle = opendir(name);
+    if (handle != NULL) {
+        directory->exists = true;
+
+        struct dirent *entry = NULL;
+        while ((entry = readdir(handle)) != NULL) {
+            size_t entryLength = strlen(entry->d_name);
+            char *entryName = copyString((uint8_t*)entry->d_name, entryLength);
+
+            hashMap_insert(&directory->entries,
+                (String){(uint8_t*)entryName, entryLength}, NULL);
+        }
+
+        closedir(handle);
+    }
+
+    printDebug("Include: Cached directory %s\n", name);
+
+    hashMap_insert(&g_directoryCache, (String){(uint8_t*)name, length},
+        directory);
+
+    return directory;
+}
+
+static char *lookupFile(String directory, String fileName) {
+    uint8_t path[PATH_MAX];
+
+    if (directory.length + 1 + fileName.length >= PATH_MAX)
+        return NULL;
+
+    size_t length = directory.length;
+    memcpy(path, directory.str, directory.length);
+
+    if (length > 0 && path[length - 1] != '/')
+        path[length++] = '/';
+
+    memcpy(path + length, fileName.str, fileName.length);
+    length += fileName.length;
+
+    // Check the name against the listing of the directory that actually
+    // holds it, so <sys/types.h> looks in <dir>/sys
+    size_t baseStart = length;
+    while (baseStart > 0 && path[baseStart - 1] != '/')
+        baseStart--;
+
+    size_t directoryLength = baseStart > 1 ? baseStart - 1 : baseStart;
+
+    DirectoryEntries *entries = readDirectory(path, directoryLength);
+    if (!entries->exists)
+        return NULL;
+
+    String baseName = {path + baseStart, length - baseStart};
+    if (!hashMap_find(&entries->entries, baseName, NULL))
+        return NULL;
+
+    return internPath(path, length);
+}
+
+static char *internPath(uint8_t *path, size_t length) {
+    char *interned = NULL;
+    if (hashMap_find(&g_resolvedPaths, (String){path, length},
+        (void**)&interned))
+    {
+        return interned;
+    }
+
+    interned = copyString(path, length);
+    hashMap_insert(&g_resolvedPaths, (String){(uint8_t*)interned, length},
+        interned);
+
+    return interned;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+
+#include "astring.h"
+
+// Include file resolution. Search directories are tried in the order
+// cpp uses: the including file's directory (quoted includes only), then
+// -I directories, then -isystem directories, then /usr/include.
+//
+// Directory listings are read once per process and cached, so repeated
+// lookups of the same header, or of headers that don't exist in a
+// directory, don't touch the filesystem again.
+
+typedef enum {
+    IncludePath_User,
+    IncludePath_System,
+} IncludePathType;
+
+void includeSearch_addPath(IncludePathType type, char *path);
+
+// Returns an interned path that stays valid for the lifetime of the process,
+// or NULL if the file couldn't be found
+char *includeSearch_resolve(String fileName, bool isAngled, char *includingFile);
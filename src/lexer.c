@@ -9,6 +9,8 @@
 #include "debug.h"
 #include "array.h"
 #include "logger.h"
+#include "includeSearch.h"
+#include "symbol.h"
 
 typedef struct {
     Buffer buffer;
@@ -17,7 +19,8 @@ typedef struct {
 
 typedef struct {
     size_t stackSize;
-    FileContext files[16];
+    size_t capacity;
+    FileContext *files;
 } FileContextStack;
 
 typedef struct {
@@ -107,6 +110,8 @@ bool lexFile(Buffer buffer, char *fileName, TokenList *outTokens, LineInfo *outL
     if (!fileContextStack_pushFile(&fileStack, newContext))
         return false;
 
+    bool success = true;
+
     while (fileStack.stackSize > 0) {
         FileContext *context = fileContextStack_context(&fileStack);
 
@@ -121,16 +126,22 @@ bool lexFile(Buffer buffer, char *fileName, TokenList *outTokens, LineInfo *outL
 
         if (peek(buff) == '#') {
             // Run preprocessor command
-            if (!runPreprocessor(&fileStack))
-                return false;
+            if (!runPreprocessor(&fileStack)) {
+                success = false;
+                break;
+            }
         }
         else {
-            if (!tryProcessToken(context, outTokens, outLines))
-                return false;
+            if (!tryProcessToken(context, outTokens, outLines)) {
+                success = false;
+                break;
+            }
         }
     }
 
-    return true;
+    free(fileStack.files);
+
+    return success;
 }
 
 static bool runPreprocessor(FileContextStack *fileStack) {
@@ -179,19 +190,16 @@ static bool runPreprocessor(FileContextStack *fileStack) {
         // Consume the end character
         consume(buff);
 
-        printf("%.*s\n", astr_format(fileName));
+        char *name = includeSearch_resolve(fileName, c == '>',
+            context->fileName);
 
-        // Open up the file
-        const char *prefix = "/usr/include/";
-
-        char *name = calloc(strlen(prefix) + fileName.length + 1, 1);
-
-        assert(name != NULL);
-
-        memcpy(name, prefix, strlen(prefix));
-        memcpy(name + strlen(prefix), fileName.str, fileName.length);
+        if (name == NULL) {
+            logError("Lexer: Couldn't find include file: %.*s: %s:%d\n",
+                astr_format(fileName), context->fileName, buff->line);
+            return false;
+        }
 
-        printf("%s\n", name);
+        printDebug("Include: %s\n", name);
 
         // Append it to the file stack
         Buffer newBuff = {0};
@@ -200,16 +208,16 @@ static bool runPreprocessor(FileContextStack *fileStack) {
             return false;
         }
 
+        newBuff.pos = 0;
+        newBuff.line = 1;
+        newBuff.col = 1;
+
         FileContext newContext =
         {
             .buffer = newBuff,
             .fileName = name,
         };
 
-        newBuff.pos = 0;
-        newBuff.line = 1;
-        newBuff.col = 1;
-
         if (!fileContextStack_pushFile(fileStack, newContext)) {
             return false;
         }
@@ -391,7 +399,7 @@ static bool tryProcessToken(FileContext *context, TokenList *outTokens,
 
     // Identifier
     else if (peek(buff) == '_' || isalpha(peek(buff))) {
-        uint8_t *bytes = buffCurr(buff);
+        Buffer start = *buff;
 
         while (peek(buff) == '_' || isalnum(peek(buff)))
         {
@@ -399,10 +407,8 @@ static bool tryProcessToken(FileContext *context, TokenList *outTokens,
         }
 
         tok.type = Token_Ident;
-        tok.ident = (String) {
-            .str = bytes,
-            .length = buffCurr(buff) - bytes
-        };
+        tok.ident = buffer_spelling(start, buff);
+        tok.symbol = symbol_intern(tok.ident);
     }
 
     // Operators
@@ -457,7 +463,7 @@ static bool tryProcessToken(FileContext *context, TokenList *outTokens,
 
     // Constants
     else if (consumeIf(buff, '"')) {
-        uint8_t *bytes = buffCurr(buff);
+        Buffer start = *buff;
 
         while (peek(buff) != '"') {
             if (peek(buff) == '\\')
@@ -467,10 +473,7 @@ static bool tryProcessToken(FileContext *context, TokenList *outTokens,
         }
 
         tok.type = Token_ConstString;
-        tok.constString = (String) {
-            .str = bytes,
-            .length = buffCurr(buff) - bytes
-        };
+        tok.constString = buffer_spelling(start, buff);
 
         // Get the last "
         consume(buff);
@@ -479,7 +482,7 @@ static bool tryProcessToken(FileContext *context, TokenList *outTokens,
         // We currently do it in the parser
     }
     else if (isdigit(peek(buff))) {
-        uint8_t *numeric = buffCurr(buff);
+        Buffer start = *buff;
 
         bool lookForFloat = false;
         bool isHex = false;
@@ -541,13 +544,8 @@ static bool tryProcessToken(FileContext *context, TokenList *outTokens,
             }
         }
 
-        size_t length = buffCurr(buff) - numeric;
-
         tok.type = Token_ConstNumeric;
-        tok.numeric = (String) {
-            .str = numeric,
-            .length = length
-        };
+        tok.numeric = buffer_spelling(start, buff);
     }
     else if (peek(buff) == '\'') {
         uint8_t *bytes = buff->bytes;
@@ -583,10 +581,17 @@ static bool tryProcessToken(FileContext *context, TokenList *outTokens,
 }
 
 static bool fileContextStack_pushFile(FileContextStack *stack, FileContext context) {
-    if (stack == NULL || stack->stackSize == 16) {
+    if (stack == NULL) {
         return false;
     }
 
+    if (stack->stackSize == stack->capacity) {
+        stack->capacity = stack->capacity == 0 ? 16 : stack->capacity * 2;
+        stack->files = realloc(stack->files,
+            stack->capacity * sizeof(FileContext));
+        assert(stack->files != NULL);
+    }
+
     stack->files[stack->stackSize] = context;
     stack->stackSize++;
 
@@ -727,6 +732,10 @@ static void appendTok(TokenList *tokens, Token tok) {
     tokens->tokens[tokens->numTokens - 1] = tok;
 }
 
+bool token_isFrom(Token *tok, char *fileName) {
+    return tok->fileName == fileName || strcmp(tok->fileName, fileName) == 0;
+}
+
 void printTokens(TokenList tokens) {
     printDebug("Tokens: %lu\n", tokens.numTokens);
 
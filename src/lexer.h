@@ -87,6 +87,8 @@ typedef enum {
     Token_staticAssert,
     Token_threadLocal,
     Token_funcName,
+
+    Token_Count,
 } TokenType;
 
 typedef struct {
@@ -95,6 +97,8 @@ typedef struct {
     uint64_t col;
     char *fileName;
     size_t fileIndex;
+    // Interned id of an identifier's name
+    size_t symbol;
     union {
         String ident;
         String whitespace;
@@ -112,6 +116,10 @@ typedef struct {
 
 void tokenList_cleanup(TokenList tokens);
 
+// Whether the token was lexed from fileName itself rather than a header it
+// included. Only then is its fileIndex a position in that file's buffer.
+bool token_isFrom(Token *tok, char *fileName);
+
 typedef struct {
     char *fileName;
     size_t numLines;
@@ -11,6 +11,12 @@ void sll_append(SLList *list, void *data, size_t size) {
     SLNode *node = calloc(1, sizeof(SLNode) + size);
     memcpy(node + 1, data, size);
 
+    sll_appendNode(list, node);
+}
+
+void sll_appendNode(SLList *list, SLNode *node) {
+    node->next = NULL;
+
     if (list->size == 0) {
         list->head = node;
         list->tail = node;
@@ -19,6 +25,6 @@ void sll_append(SLList *list, void *data, size_t size) {
         list->tail->next = node;
         list->tail = node;
     }
-    
+
     list->size++;
 }
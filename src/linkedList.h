@@ -17,6 +17,9 @@ typedef struct {
 
 void sll_append(SLList *list, void *data, size_t size);
 
+// Links a node the caller allocated, with its data right after the node
+void sll_appendNode(SLList *list, SLNode *node);
+
 #define sll_appendLocal(list, data) sll_append(list, &data, sizeof(data))
 #define sll_foreach(list, name) for (SLNode *name = list.head;\
     name != NULL; name = name->next)
@@ -15,6 +15,10 @@
 #include "config.h"
 #include "logger.h"
 #include "preprocess.h"
+#include "includeSearch.h"
+#include "depScan.h"
+#include "astStats.h"
+#include "array.h"
 
 int main(int argc, char **argv) {
 
@@ -40,14 +44,98 @@ int main(int argc, char **argv) {
 
     findRuleIgnorePaths(config);
 
-    for (uint64_t i = 1; i < argc; i++) {
+    size_t numFiles = 0;
+    char **files = NULL;
+
+    bool scanDeps = false;
+    DepFormat depFormat = DepFormat_Json;
+    bool astStats = false;
+    char *astCacheDirectory = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-I", 2) == 0) {
+            char *includePath = argv[i] + 2;
+            if (*includePath == '\0') {
+                if (i + 1 == argc) {
+                    logError("Main: Missing directory after -I\n");
+                    return -1;
+                }
+                includePath = argv[++i];
+            }
+
+            includeSearch_addPath(IncludePath_User, includePath);
+        }
+        else if (strcmp(argv[i], "-isystem") == 0) {
+            if (i + 1 == argc) {
+                logError("Main: Missing directory after -isystem\n");
+                return -1;
+            }
+
+            includeSearch_addPath(IncludePath_System, argv[++i]);
+        }
+        else if (strcmp(argv[i], "-trigraphs") == 0) {
+            setTrigraphs(true);
+        }
+        else if (strcmp(argv[i], "--packrat") == 0) {
+            setPackratParsing(true);
+        }
+        else if (strcmp(argv[i], "--skim-ignored") == 0) {
+            setHeaderSkimming(isIgnoredPath);
+        }
+        else if (strcmp(argv[i], "--defer-bodies") == 0) {
+            setDeferredFunctionBodies(true);
+        }
+        else if (strncmp(argv[i], "--parse-threads=", 16) == 0) {
+            char *end = NULL;
+            long numThreads = strtol(argv[i] + 16, &end, 10);
+            if (*end != '\0' || numThreads < 1) {
+                logError("Main: Expected a positive number of threads in %s\n", argv[i]);
+                return -1;
+            }
+
+            setParseThreads(numThreads);
+        }
+        else if (strcmp(argv[i], "--scan-deps") == 0 ||
+            strcmp(argv[i], "--scan-deps=json") == 0)
+        {
+            scanDeps = true;
+            depFormat = DepFormat_Json;
+        }
+        else if (strcmp(argv[i], "--scan-deps=make") == 0) {
+            scanDeps = true;
+            depFormat = DepFormat_Make;
+        }
+        else if (strcmp(argv[i], "--ast-stats") == 0) {
+            astStats = true;
+        }
+        else if (strncmp(argv[i], "--ast-cache=", 12) == 0) {
+            astCacheDirectory = argv[i] + 12;
+        }
+        else {
+            ArrayAppend(files, numFiles, argv[i]);
+        }
+    }
+
+    // Dependency scanning replaces the normal analysis
+    if (scanDeps) {
+        printDependencies(numFiles, files, depFormat);
+        return 0;
+    }
+
+    // So does measuring the AST
+    if (astStats) {
+        printAstStats(numFiles, files, astCacheDirectory);
+        return 0;
+    }
+
+    for (uint64_t i = 0; i < numFiles; i++) {
         // Open file
         Buffer fileBuff = {0};
-        if (!openAndReadFileToBuffer(argv[i], &fileBuff)) {
+        if (!openAndReadFileToBuffer(files[i], &fileBuff)) {
             // There was an error reading the file
             char *fileError = strerror(errno);
             logError("Main: Couldn't read source file: %s with error: %s\n\tContinuing\n",
-                argv[i], fileError);
+                files[i], fileError);
             continue;
         }
 
@@ -56,7 +144,7 @@ int main(int argc, char **argv) {
         PreprocessTokenList preprocessTokens = {0};
 
         if (!preprocess(fileBuff, &preprocessTokens)) {
-            logError("Main: Couldn't preprocess source file: %s\n", argv[i]);
+            logError("Main: Couldn't preprocess source file: %s\n", files[i]);
             continue;
         }
 
@@ -65,7 +153,7 @@ int main(int argc, char **argv) {
         // Lex file
         // LineInfo lineInfo = {0};
         // TokenList tokens = {0};
-        // if (!lexFile(fileBuff, argv[1], &tokens, &lineInfo)) {
+        // if (!lexFile(fileBuff, files[i], &tokens, &lineInfo)) {
         //     continue;
         // }
 
@@ -83,15 +171,15 @@ int main(int argc, char **argv) {
 
         // // Run all rules
         // RuleContext context = {
-        //     .fileName = argv[i],
+        //     .fileName = files[i],
         //     .fileBuffer = fileBuff,
         //     .tokens = tokens,
         //     .lineInfo = lineInfo,
         //     .translationUnit = unit,
         // };
 
-        // for (uint64_t i = 0; i < numRules; i++) {
-        //     rules[i].validator(rules[i], context);
-        // }
+        // runRules(rules, numRules, context);
+
+        // translationUnit_cleanup(unit);
     }
 }
@@ -4,11 +4,212 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <stdio.h>
+#include <pthread.h>
+#include <stdatomic.h>
 
 #include "logger.h"
 #include "array.h"
 #include "debug.h"
-#include "linkedList.h"
+#include "arena.h"
+#include "symbol.h"
+#include "astIndex.h"
+
+// Every node of the translation unit being parsed is allocated from its arena.
+// Failed alternatives roll the arena back along with the token position, so
+// abandoned subtrees don't take up space. Threads parsing parts of the same
+// unit each fill an arena of their own.
+static _Thread_local Arena *g_arena;
+
+static AstStats *g_astStats;
+
+// Where this thread records its stats, or NULL
+static _Thread_local AstStats *g_stats;
+
+void setAstStats(AstStats *stats) {
+    g_astStats = stats;
+}
+
+static void *parserAlloc(size_t size, AstStatsType type) {
+    void *node = arena_alloc(g_arena, size);
+
+    if (g_stats != NULL)
+        astStats_recordAllocation(g_stats, type, 1, size, g_arena->allocated);
+
+    return node;
+}
+
+static void *parserCopy(void *data, size_t size, AstStatsType type) {
+    void *node = parserAlloc(size, type);
+    memcpy(node, data, size);
+    return node;
+}
+
+static AstList parserFinishList(ListBuilder *builder, AstStatsType type) {
+    size_t length = builder->size;
+    AstList list = listBuilder_finish(builder, g_arena);
+
+    if (g_stats != NULL) {
+        astStats_recordList(g_stats, type, length);
+        astStats_recordAllocation(g_stats, type, length,
+            length * builder->elemSize, g_arena->allocated);
+
+        size_t scratchBytes = listBuilder_scratchBytes();
+        if (scratchBytes > g_stats->listScratchBytes)
+            g_stats->listScratchBytes = scratchBytes;
+    }
+
+    return list;
+}
+
+#define ParserCopy(local) parserCopy(&(local), sizeof(local),\
+    AstStatsTypeOf(local))
+
+// Rewinds the tokens to try another alternative
+static void parserBacktrack(TokenList *tokens, size_t pos,
+    const char *production)
+{
+    tokens->pos = pos;
+
+    if (g_stats != NULL)
+        astStats_recordBacktrack(g_stats, production);
+}
+
+#define ParserBacktrack(tokens, pos) parserBacktrack(tokens, pos, __func__)
+
+// Kinds of the nodes parsed on this thread since the innermost Expr, Statement
+// or Declaration being parsed started. Nodes from failed alternatives count
+// too, which only means a walk doesn't skip something it could have.
+static _Thread_local NodeKindMask g_kinds;
+
+static NodeKindMask kinds_begin(void) {
+    NodeKindMask outer = g_kinds;
+    g_kinds = 0;
+    return outer;
+}
+
+// Returns the kinds parsed since kinds_begin and adds them to the outer node's
+// along with the node's own kind
+static NodeKindMask kinds_end(NodeKindMask outer, NodeKindMask own) {
+    NodeKindMask inner = g_kinds;
+    g_kinds = outer | inner | own;
+    return inner;
+}
+
+// Packrat memoization. Each memoized production has a table indexed by token
+// position holding the result, end position and a copy of the node, so a
+// production is only parsed once at each position no matter how often
+// alternatives backtrack over it.
+
+typedef enum {
+    Memo_CastExpr,
+    Memo_UnaryExpr,
+    Memo_DeclarationSpecifierList,
+    Memo_Declarator,
+    Memo_Count,
+} MemoRule;
+
+typedef struct {
+    // Entries from an older generation are stale. The generation changes
+    // whenever a typedef name is added, since that changes how the same
+    // tokens parse.
+    uint64_t generation;
+    ParseRes res;
+    size_t endPos;
+    void *node;
+    // Node kinds parsed under it, which aren't parsed again on a hit
+    NodeKindMask kinds;
+} MemoEntry;
+
+typedef struct {
+    uint64_t generation;
+    // Token position of the first entry
+    size_t start;
+    size_t numEntries;
+    MemoEntry *entries[Memo_Count];
+} ParserMemo;
+
+static bool g_packrat;
+
+// Each thread only memoizes the tokens it's parsing
+static _Thread_local ParserMemo g_memo = { .generation = 1 };
+
+// What each memoized production copies into the arena
+static AstStatsType g_memoTypes[Memo_Count] = {
+    [Memo_CastExpr] = AstStats_CastExpr,
+    [Memo_UnaryExpr] = AstStats_UnaryExpr,
+    [Memo_DeclarationSpecifierList] = AstStats_DeclarationSpecifierList,
+    [Memo_Declarator] = AstStats_Declarator,
+};
+
+void setPackratParsing(bool enabled) {
+    g_packrat = enabled;
+}
+
+static void memo_init(size_t start, size_t numTokens) {
+    if (!g_packrat)
+        return;
+
+    // Productions can start at the end of the tokens too
+    g_memo.start = start;
+    g_memo.numEntries = numTokens + 1;
+    for (size_t i = 0; i < Memo_Count; i++) {
+        g_memo.entries[i] = calloc(g_memo.numEntries, sizeof(MemoEntry));
+        assert(g_memo.entries[i] != NULL);
+    }
+
+    size_t memoBytes = Memo_Count * g_memo.numEntries * sizeof(MemoEntry);
+    if (g_stats != NULL && memoBytes > g_stats->memoBytes)
+        g_stats->memoBytes = memoBytes;
+}
+
+static void memo_cleanup(void) {
+    for (size_t i = 0; i < Memo_Count; i++) {
+        free(g_memo.entries[i]);
+        g_memo.entries[i] = NULL;
+    }
+
+    g_memo.numEntries = 0;
+    g_memo.generation++;
+}
+
+static ParseRes parseMemoized(TokenList *tokens, MemoRule rule,
+    Parser parser, void *out, size_t outSize)
+{
+    if (g_memo.numEntries == 0)
+        return parser(tokens, out);
+
+    size_t pos = tokens->pos - g_memo.start;
+    assert(tokens->pos >= g_memo.start && pos < g_memo.numEntries);
+
+    MemoEntry *entry = g_memo.entries[rule] + pos;
+    if (entry->generation == g_memo.generation) {
+        memcpy(out, entry->node, outSize);
+        tokens->pos = entry->endPos;
+        g_kinds |= entry->kinds;
+        return entry->res;
+    }
+
+    uint64_t generation = g_memo.generation;
+
+    NodeKindMask outerKinds = kinds_begin();
+    ParseRes res = parser(tokens, out);
+
+    // Recursive calls don't move the tables, so entry is still good
+    entry->generation = generation;
+    entry->res = res;
+    entry->endPos = tokens->pos;
+    entry->node = parserCopy(out, outSize, g_memoTypes[rule]);
+    entry->kinds = kinds_end(outerKinds, 0);
+
+    return res;
+}
+
+// Memoized nodes can be picked up again after their alternative failed, so
+// the arena only rolls back when memoization is off
+static void parserRollback(ArenaMark mark) {
+    if (g_memo.numEntries == 0)
+        arena_rollback(g_arena, mark);
+}
 
 // Generic Parsers
 #define Fail(msg) ((ParseRes){ .success = false, .failMessage = msg })
@@ -21,26 +222,36 @@ ParseRes parseList(TokenList *tokens, void *data)
     SimpleParser *parser = data;
     assert(parser->type == SimpleParser_List);
 
+    ListBuilder builder = listBuilder_init(parser->listElemSize);
+
+    // Elements can be any size, so they're parsed into one heap buffer
+    void *elem = malloc(parser->listElemSize);
+    assert(elem != NULL);
+
     // Parse designator list
     ParseRes res = {0};
     do {
         size_t pos = tokens->pos;
+        ArenaMark mark = arena_mark(g_arena);
 
-        void *elem = calloc(1, parser->listElemSize);
+        memset(elem, 0, parser->listElemSize);
         res = parser->listElemParser(tokens, elem);
         if (!res.success) {
-            tokens->pos = pos;
+            ParserBacktrack(tokens, pos);
+            parserRollback(mark);
             break;
         }
 
-        sll_append(parser->listOut, elem, parser->listElemSize);
-
-        free(elem);
+        listBuilder_append(&builder, elem);
     } while (res.success);
 
-    if (parser->listOut->size == 0)
+    free(elem);
+
+    if (builder.size == 0)
         return Fail(parser->listFailMessage);
 
+    *parser->listOut = parserFinishList(&builder, parser->listElemType);
+
     return Succeed;
 }
 
@@ -53,20 +264,21 @@ ParseRes parseOptional(TokenList *tokens, void *data) {
     ParseRes res = parser->optionalParser(tokens, parser->optionalData);
 
     if (!res.success) {
-        tokens->pos = pos;
+        ParserBacktrack(tokens, pos);
     }
 
     return Succeed;
 }
 
-SimpleParser ListParser(Parser listElemParser, SLList *listOut,
-    size_t listElemSize, char *listFailMessage)
+SimpleParser ListParser(Parser listElemParser, AstList *listOut,
+    size_t listElemSize, AstStatsType listElemType, char *listFailMessage)
 {
     SimpleParser res = {0};
     res.type = SimpleParser_List;
     res.listElemParser = listElemParser;
     res.listOut = listOut;
     res.listElemSize = listElemSize;
+    res.listElemType = listElemType;
     res.listFailMessage = listFailMessage;
     res.run = parseList;
     return res;
@@ -83,20 +295,121 @@ SimpleParser OptionalParser(Parser parser, void *data) {
 
 // End Generic Parsers
 
-static SLList g_typedefTable;
+// Typedef names and the ordinary identifiers that can hide them. Each parse
+// has its own table.
+static _Thread_local SymbolTable *g_symbols;
+
+// Deferred function bodies are parsed after the rest of the file, so every
+// file scope declaration is logged in order. A body is parsed with the table
+// rebuilt from the declarations that came before its function.
+
+typedef struct {
+    size_t id;
+    SymbolKind kind;
+} FileScopeName;
+
+typedef struct {
+    size_t numNames;
+    size_t capacity;
+    FileScopeName *names;
+} FileScopeLog;
+
+struct DeferredBodies {
+    TokenList tokens;
+    // The unit is passed around by value, so bodies get an arena of their own
+    // rather than growing a copy of the unit's
+    Arena arena;
+
+    FileScopeLog fileNames;
+
+    // Names as of the first numReplayed file scope declarations
+    SymbolTable symbols;
+    size_t numReplayed;
+
+    // Whether a body parsed so far had a statement expression
+    bool sawStmtExpr;
+    // Whether a body didn't parse, which leaves the unit incomplete
+    bool failed;
+};
+
+static bool g_deferBodies;
+
+// Set while parsing a file whose function bodies are being deferred
+static _Thread_local struct DeferredBodies *g_deferred;
+
+// Where file scope declarations are logged, if anywhere, and how many were
+// logged before the current token
+static _Thread_local FileScopeLog *g_fileScopeLog;
+static _Thread_local size_t g_numFileNames;
+
+// Set once this thread parses a statement expression, including ones in
+// alternatives that failed. Without any, the index doesn't have to look
+// inside expressions.
+static _Thread_local bool g_sawStmtExpr;
+
+void setDeferredFunctionBodies(bool enabled) {
+    g_deferBodies = enabled;
+}
+
+static bool isTypedefName(Token tok) {
+    return symbolTable_find(g_symbols, tok.symbol) == Symbol_Typedef;
+}
+
+// Whether a name is a typedef changes how the same tokens parse, so memoized
+// results from before the change are stale
+static void declareSymbol(size_t id, SymbolKind kind) {
+    if (symbolTable_declare(g_symbols, id, kind))
+        g_memo.generation++;
+
+    if (g_fileScopeLog != NULL && g_symbols->numScopes == 0) {
+        FileScopeLog *log = g_fileScopeLog;
+        if (log->numNames == log->capacity) {
+            log->capacity = log->capacity == 0 ? 64 : log->capacity * 2;
+            log->names = realloc(log->names,
+                log->capacity * sizeof(FileScopeName));
+            assert(log->names != NULL);
+        }
 
-bool typedefTable_find(SLList table, String name) {
-    sll_foreach(table, node) {
-        String *tableName = slNode_getData(node);
-        if (astr_cmp(*tableName, name))
-            return true;
+        log->names[log->numNames++] = (FileScopeName){ .id = id, .kind = kind };
+        g_numFileNames = log->numNames;
     }
+}
 
-    return false;
+// Brings a table to where it was after the first count logged declarations.
+// Tables are usually brought forward, so they're only rebuilt from the start
+// when going backwards.
+static void replayFileScope(FileScopeLog *log, size_t count,
+    SymbolTable *table, size_t *numReplayed)
+{
+    if (*numReplayed > count) {
+        symbolTable_cleanup(table);
+        *numReplayed = 0;
+    }
+
+    while (*numReplayed < count) {
+        FileScopeName name = log->names[(*numReplayed)++];
+        symbolTable_declare(table, name.id, name.kind);
+    }
+}
+
+static void declareName(String name, SymbolKind kind) {
+    // Declared names come from identifier tokens, so they're already interned
+    size_t id = 0;
+    if (!symbol_find(name, &id)) {
+        assert(false);
+        return;
+    }
+
+    declareSymbol(id, kind);
+}
+
+static void pushScope(void) {
+    symbolTable_pushScope(g_symbols);
 }
 
-void typedefTable_add(SLList *table, String name) {
-    sll_appendLocal(table, name);
+static void popScope(void) {
+    if (symbolTable_popScope(g_symbols))
+        g_memo.generation++;
 }
 
 // CLEANUP: A lot of this can be combined
@@ -138,6 +451,19 @@ bool consumeIfTok(TokenList *tokens, TokenType type) {
     return false;
 }
 
+// Consumes a token and, if it opens a bracket, everything up to the one that
+// closes it
+static void skipBalanced(TokenList *tokens) {
+    size_t depth = 0;
+    do {
+        TokenType type = consumeTok(tokens).type;
+        if (type == '{' || type == '(' || type == '[')
+            depth++;
+        else if (type == '}' || type == ')' || type == ']')
+            depth--;
+    } while (depth > 0 && tokens->pos < tokens->numTokens);
+}
+
 // Forward decls
 ParseRes parseAssignExpr(TokenList *tokens, AssignExpr *expr);
 ParseRes parseConditionalExpr(TokenList *tokens, ConditionalExpr *expr);
@@ -145,6 +471,7 @@ ParseRes parseInitializerList(TokenList *tokens, InitializerList *list);
 ParseRes parseTypeName(TokenList *tokens, TypeName *typeName);
 ParseRes parseExpr(TokenList *tokens, Expr *expr);
 ParseRes parseCastExpr(TokenList *tokens, CastExpr *expr);
+ParseRes parseUnaryExpr(TokenList *tokens, UnaryExpr *unaryExpr);
 ParseRes parseTypeSpecifier(TokenList *tokens, TypeSpecifier *type);
 ParseRes parseTypeQualifier(TokenList *tokens, TypeQualifier *typeQualifier);
 ParseRes parseAbstractDeclarator(TokenList *tokens, AbstractDeclarator *abstractDeclarator);
@@ -155,6 +482,8 @@ ParseRes parseDeclarator(TokenList *tokens, Declarator *declarator);
 // End forward decls
 
 ParseRes parseArgExprList(TokenList *tokens, ArgExprList *argExprList) {
+    ListBuilder builder = listBuilder_init(sizeof(AssignExpr));
+
     bool hasComma = false;
     do {
         size_t pos = tokens->pos;
@@ -162,15 +491,17 @@ ParseRes parseArgExprList(TokenList *tokens, ArgExprList *argExprList) {
         AssignExpr expr = {0};
         ParseRes res = parseAssignExpr(tokens, &expr);
         if (!res.success) {
-            tokens->pos = pos;
+            ParserBacktrack(tokens, pos);
             break;
         }
 
         hasComma = consumeIfTok(tokens, ',');
 
-        sll_appendLocal(&argExprList->list, expr);
+        listBuilder_appendLocal(&builder, expr);
     } while (hasComma);
 
+    argExprList->list = parserFinishList(&builder, AstStats_AssignExpr);
+
     return (ParseRes){ .success = true };
 }
 
@@ -205,8 +536,7 @@ ParseRes parseDesignator(TokenList *tokens, Designator *designator) {
         }
 
         designator->type = Designator_Constant;
-        designator->constantExpr = malloc(sizeof(ConditionalExpr));
-        memcpy(designator->constantExpr, &expr, sizeof(expr));
+        designator->constantExpr = ParserCopy(expr);
 
         return (ParseRes) { .success = true };
     }
@@ -231,11 +561,12 @@ ParseRes parseDesignation(TokenList *tokens, Designation *designation) {
     //         break;
     //     }
 
-    //     sll_appendLocal(&(designation->list), designator);
+    //     listBuilder_appendLocal(&builder, designator);
     // } while (res.success);
 
     SimpleParser list = ListParser((Parser)parseDesignator, &(designation->list),
-        sizeof(Designator), "Failed to find designator list in designation");
+        sizeof(Designator), AstStats_Designator,
+        "Failed to find designator list in designation");
     list.run(tokens, &list);
 
     if (!consumeIfTok(tokens, '=')) {
@@ -267,8 +598,7 @@ ParseRes parseInitializer(TokenList *tokens, Initializer *initializer) {
         }
 
         initializer->type = Initializer_InitializerList;
-        initializer->initializerList = malloc(sizeof(list));
-        memcpy(initializer->initializerList, &list, sizeof(list));
+        initializer->initializerList = ParserCopy(list);
 
         return (ParseRes){ .success = true };
     }
@@ -280,13 +610,13 @@ ParseRes parseInitializer(TokenList *tokens, Initializer *initializer) {
         return assignRes;
 
     initializer->type = Initializer_Assignment;
-    initializer->assignmentExpr = malloc(sizeof(expr));
-    memcpy(initializer->assignmentExpr, &expr, sizeof(expr));
+    initializer->assignmentExpr = ParserCopy(expr);
 
     return (ParseRes){ .success = true };
 }
 
 ParseRes parseInitializerList(TokenList *tokens, InitializerList *list) {
+    ListBuilder builder = listBuilder_init(sizeof(DesignationAndInitializer));
 
     bool hasComma = false;
     bool isAtEnd = false;
@@ -297,7 +627,7 @@ ParseRes parseInitializerList(TokenList *tokens, InitializerList *list) {
         Designation designation = {0};
         bool hasDesignation = true;
         if (!parseDesignation(tokens, &designation).success) {
-            tokens->pos = beforePos;
+            ParserBacktrack(tokens, beforePos);
             hasDesignation = false;
         }
 
@@ -316,7 +646,7 @@ ParseRes parseInitializerList(TokenList *tokens, InitializerList *list) {
             .initializer = initializer
         };
 
-        sll_appendLocal(&(list->list), wholeInitializer);
+        listBuilder_appendLocal(&builder, wholeInitializer);
 
         // Parse a ,
         hasComma = consumeIfTok(tokens, ',');
@@ -325,6 +655,9 @@ ParseRes parseInitializerList(TokenList *tokens, InitializerList *list) {
 
     } while (!isAtEnd && hasComma);
 
+    list->list = parserFinishList(&builder,
+        AstStats_DesignationAndInitializer);
+
     return (ParseRes){ .success = true };
 }
 
@@ -343,8 +676,7 @@ ParseRes parseGenericAssociation(TokenList *tokens, GenericAssociation *associat
             return assignRes;
 
         association->isDefault = true;
-        association->expr = malloc(sizeof(expr));
-        memcpy(association->expr, &expr, sizeof(expr));
+        association->expr = ParserCopy(expr);
         return (ParseRes){ .success = true };
     }
 
@@ -366,10 +698,8 @@ ParseRes parseGenericAssociation(TokenList *tokens, GenericAssociation *associat
         return assignRes;
 
     association->isDefault = false;
-    association->typeName = malloc(sizeof(typeName));
-    memcpy(association->typeName, &typeName, sizeof(typeName));
-    association->expr = malloc(sizeof(expr));
-    memcpy(association->expr, &expr, sizeof(expr));
+    association->typeName = ParserCopy(typeName);
+    association->expr = ParserCopy(expr);
     return (ParseRes){ .success = true };
 }
 
@@ -400,8 +730,9 @@ ParseRes parseGenericSelection(TokenList *tokens, GenericSelection *generic) {
         };
     }
 
-    generic->expr = malloc(sizeof(assign));
-    memcpy(generic->expr, &assign, sizeof(assign));
+    generic->expr = ParserCopy(assign);
+
+    ListBuilder builder = listBuilder_init(sizeof(GenericAssociation));
 
     bool hasComma = false;
     do {
@@ -412,12 +743,15 @@ ParseRes parseGenericSelection(TokenList *tokens, GenericSelection *generic) {
             return res;
         }
 
-        sll_appendLocal(&(generic->associations), association);
+        listBuilder_appendLocal(&builder, association);
 
         // Continue if there's a comma
         hasComma = consumeIfTok(tokens, ',');
     } while(hasComma);
 
+    generic->associations = parserFinishList(&builder,
+        AstStats_GenericAssociation);
+
     if (!consumeIfTok(tokens, ')')) {
         return (ParseRes) {
             .success = false,
@@ -456,8 +790,7 @@ ParseRes parsePrimaryExpr(TokenList *tokens, PrimaryExpr *primary) {
         }
 
         primary->type = PrimaryExpr_Expr;
-        primary->expr = malloc(sizeof(expr));
-        memcpy(primary->expr, &expr, sizeof(expr));
+        primary->expr = ParserCopy(expr);
         return (ParseRes){ .success = true };
     }
     else if (peekTok(tokens).type == Token_ConstNumeric) {
@@ -515,8 +848,7 @@ ParseRes parsePostfixOp(TokenList *tokens, PostfixOp *op) {
         }
 
         op->type = PostfixOp_Index;
-        op->indexExpr = malloc(sizeof(expr));
-        memcpy(op->indexExpr, &expr, sizeof(expr));
+        op->indexExpr = ParserCopy(expr);
         return (ParseRes){ .success = true };
     }
     if (consumeIfTok(tokens, '(')) {
@@ -589,6 +921,7 @@ ParseRes parsePostfixExpr(TokenList *tokens, PostfixExpr *postfixExpr) {
 
     // Check if initializer list
     size_t preInitializeListPos = tokens->pos;
+    ArenaMark mark = arena_mark(g_arena);
 
     // FIXME: Is this really a good use of goto chains?
 
@@ -617,14 +950,14 @@ ParseRes parsePostfixExpr(TokenList *tokens, PostfixExpr *postfixExpr) {
 
     // Succeeded, move on to postfix ops
     postfixExpr->type = Postfix_InitializerList;
-    postfixExpr->initializerListType = malloc(sizeof(typeName));
-    memcpy(postfixExpr->initializerListType, &typeName, sizeof(typeName));
+    postfixExpr->initializerListType = ParserCopy(typeName);
     postfixExpr->initializerList = list;
 
     goto PostfixExpr_AfterPrimaryExpr;
 
 PostfixExpr_AfterPostfix:
-    tokens->pos = preInitializeListPos;
+    ParserBacktrack(tokens, preInitializeListPos);
+    parserRollback(mark);
 
     // Otherwise is a primary expr
     PrimaryExpr primary = {0};
@@ -639,6 +972,8 @@ PostfixExpr_AfterPostfix:
 PostfixExpr_AfterPrimaryExpr:
     ; // Empty statement needed because label cannot precede assignment
     // Check for postfix ops
+    ListBuilder builder = listBuilder_init(sizeof(PostfixOp));
+
     ParseRes res = {0};
     do {
         size_t postfixPos = tokens->pos;
@@ -646,13 +981,15 @@ PostfixExpr_AfterPrimaryExpr:
         PostfixOp op = {0};
         res = parsePostfixOp(tokens, &op);
         if (!res.success) {
-            tokens->pos = postfixPos;
+            ParserBacktrack(tokens, postfixPos);
             break;
         }
 
-        sll_appendLocal(&(postfixExpr->postfixOps), op);
+        listBuilder_appendLocal(&builder, op);
     } while (res.success);
 
+    postfixExpr->postfixOps = parserFinishList(&builder, AstStats_PostfixOp);
+
     return (ParseRes){ .success = true };
 }
 
@@ -688,10 +1025,13 @@ ParseRes parseUnaryExprPrefix(TokenList *tokens, UnaryExprPrefixType *type) {
     };
 }
 
-ParseRes parseUnaryExpr(TokenList *tokens, UnaryExpr *unaryExpr) {
+static ParseRes parseUnaryExprUncached(TokenList *tokens,
+    UnaryExpr *unaryExpr)
+{
     unaryExpr->tok = tokens->tokens + tokens->pos;
 
     size_t pos = tokens->pos;
+    ArenaMark mark = arena_mark(g_arena);
 
     // Try to parse a unary operator
     {
@@ -706,14 +1046,14 @@ ParseRes parseUnaryExpr(TokenList *tokens, UnaryExpr *unaryExpr) {
 
         unaryExpr->type = UnaryExpr_UnaryOp;
         unaryExpr->unaryOpType = prefixType;
-        unaryExpr->unaryOpCast = malloc(sizeof(cast));
-        memcpy(unaryExpr->unaryOpCast, &cast, sizeof(cast));
+        unaryExpr->unaryOpCast = ParserCopy(cast);
         return (ParseRes){ .success = true };
     }
 
 ParseUnaryExpr_PostPrefix:
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // Try to parse an increment, decrement, or sizeof
     {
@@ -730,8 +1070,7 @@ ParseUnaryExpr_PostPrefix:
         if (!parseUnaryExpr(tokens, &innerExpr).success)
             goto ParseUnaryExpr_PostIncDecSizeofExpr;
 
-        UnaryExpr *innerAllocated = malloc(sizeof(innerExpr));
-        memcpy(innerAllocated, &innerExpr, sizeof(innerExpr));
+        UnaryExpr *innerAllocated = ParserCopy(innerExpr);
         if (tok.type == Token_IncOp) {
             unaryExpr->type = UnaryExpr_Inc;
             unaryExpr->incOpExpr = innerAllocated;
@@ -750,7 +1089,8 @@ ParseUnaryExpr_PostPrefix:
 
 ParseUnaryExpr_PostIncDecSizeofExpr:
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // Try to parse a sizeof ( typename )
     {
@@ -768,15 +1108,15 @@ ParseUnaryExpr_PostIncDecSizeofExpr:
             goto ParseUnaryExpr_PostSizeofTypename;
 
         unaryExpr->type = UnaryExpr_SizeofType;
-        unaryExpr->sizeofTypeName = malloc(sizeof(typeName));
-        memcpy(unaryExpr->sizeofExpr, &typeName, sizeof(typeName));
+        unaryExpr->sizeofTypeName = ParserCopy(typeName);
 
         return (ParseRes){ .success = true };
     }
 
 ParseUnaryExpr_PostSizeofTypename:
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // Try to parse an alignof typename
     {
@@ -794,15 +1134,15 @@ ParseUnaryExpr_PostSizeofTypename:
             goto ParseUnaryExpr_PostAlignofTypename;
 
         unaryExpr->type = UnaryExpr_AlignofType;
-        unaryExpr->alignofTypeName = malloc(sizeof(typeName));
-        memcpy(unaryExpr->alignofTypeName, &typeName, sizeof(typeName));
+        unaryExpr->alignofTypeName = ParserCopy(typeName);
 
         return (ParseRes){ .success = true };
     }
 
 ParseUnaryExpr_PostAlignofTypename:
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // If we got here then we need to parse a postfix expr
     PostfixExpr postfix = {0};
@@ -816,11 +1156,17 @@ ParseUnaryExpr_PostAlignofTypename:
     return (ParseRes){ .success = true };
 }
 
-ParseRes parseCastExpr(TokenList *tokens, CastExpr *cast) {
+ParseRes parseUnaryExpr(TokenList *tokens, UnaryExpr *unaryExpr) {
+    return parseMemoized(tokens, Memo_UnaryExpr,
+        (Parser)parseUnaryExprUncached, unaryExpr, sizeof(*unaryExpr));
+}
+
+static ParseRes parseCastExprUncached(TokenList *tokens, CastExpr *cast) {
     cast->tok = tokens->tokens + tokens->pos;
 
     // Look for an optional cast
     size_t castPos = tokens->pos;
+    ArenaMark mark = arena_mark(g_arena);
 
     if (!consumeIfTok(tokens, '('))
         goto Cast_NoCast;
@@ -839,15 +1185,14 @@ ParseRes parseCastExpr(TokenList *tokens, CastExpr *cast) {
         goto Cast_NoCast;
 
     cast->type = CastExpr_Cast;
-    cast->castType = malloc(sizeof(typeName));
-    memcpy(cast->castType, &typeName, sizeof(typeName));
-    cast->castExpr = malloc(sizeof(CastExpr));
-    memcpy(cast->castExpr, &newCast, sizeof(newCast));
+    cast->castType = ParserCopy(typeName);
+    cast->castExpr = ParserCopy(newCast);
 
     return (ParseRes){ .success = true };
 
 Cast_NoCast:
-    tokens->pos = castPos;
+    ParserBacktrack(tokens, castPos);
+    parserRollback(mark);
 
     // Look for a unary expr
     UnaryExpr unary = {0};
@@ -861,430 +1206,223 @@ Cast_NoCast:
     return (ParseRes){ .success = true };
 }
 
-ParseRes parseMultiplicativeExpr(TokenList *tokens, MultiplicativeExpr *multiplicativeExpr) {
-    multiplicativeExpr->tok = tokens->tokens + tokens->pos;
+ParseRes parseCastExpr(TokenList *tokens, CastExpr *cast) {
+    return parseMemoized(tokens, Memo_CastExpr,
+        (Parser)parseCastExprUncached, cast, sizeof(*cast));
+}
+
+// Returns the level a token works at as a binary operator, or
+// BinaryExpr_Cast if it isn't one
+static BinaryExprLevel binaryOpLevel(TokenType type) {
+    // Single character tokens use their character, so they aren't in the enum
+    switch ((int)type) {
+        case Token_LogOrOp:
+            return BinaryExpr_LogicalOr;
+        case Token_LogAndOp:
+            return BinaryExpr_LogicalAnd;
+        case '|':
+            return BinaryExpr_InclusiveOr;
+        case '^':
+            return BinaryExpr_ExclusiveOr;
+        case '&':
+            return BinaryExpr_And;
+        case Token_EqOp:
+        case Token_NEqOp:
+            return BinaryExpr_Equality;
+        case '<':
+        case '>':
+        case Token_LEqOp:
+        case Token_GEqOp:
+            return BinaryExpr_Relational;
+        case Token_ShiftLeftOp:
+        case Token_ShiftRightOp:
+            return BinaryExpr_Shift;
+        case '+':
+        case '-':
+            return BinaryExpr_Additive;
+        case '*':
+        case '/':
+        case '%':
+            return BinaryExpr_Multiplicative;
+        default:
+            return BinaryExpr_Cast;
+    }
+}
+
+// Precedence climbing. Only operators at minLevel or tighter are consumed,
+// and each run of operators at the same level becomes one chain.
+static ParseRes parseBinaryExpr(TokenList *tokens, BinaryExprLevel minLevel,
+    BinaryExpr **outExpr)
+{
+    BinaryExpr *expr = parserAlloc(sizeof(BinaryExpr), AstStats_BinaryExpr);
+    expr->tok = tokens->tokens + tokens->pos;
+    expr->level = BinaryExpr_Cast;
 
-    CastExpr castExpr = {0};
-    ParseRes res = parseCastExpr(tokens, &castExpr);
-    if (!res.success) {
-        // Error if this fails
+    ParseRes res = parseCastExpr(tokens, &(expr->cast));
+    if (!res.success)
         return res;
-    }
 
-    multiplicativeExpr->baseExpr = castExpr;
+    BinaryExprLevel level = binaryOpLevel(peekTok(tokens).type);
+    while (level != BinaryExpr_Cast && level >= minLevel) {
+        BinaryExpr *chain = parserAlloc(sizeof(BinaryExpr), AstStats_BinaryExpr);
+        chain->tok = expr->tok;
+        chain->level = level;
 
-    while (peekTok(tokens).type == '*' ||
-        peekTok(tokens).type == '/' ||
-        peekTok(tokens).type == '%')
-    {
-        Token *tok = tokens->tokens + tokens->pos;
+        ListBuilder builder = listBuilder_init(sizeof(BinaryOperand));
 
-        TokenType type = consumeTok(tokens).type;
-        MultiplicativeOp op = type == '*' ? Multiplicative_Mul :
-            type == '/' ? Multiplicative_Div :
-            Multiplicative_Mod;
+        BinaryOperand first = { .expr = expr };
+        listBuilder_appendLocal(&builder, first);
 
-        CastExpr cast = {0};
-        ParseRes res = parseCastExpr(tokens, &cast);
-        if (!res.success) {
-            // Error if this fails
-            return res;
+        while (binaryOpLevel(peekTok(tokens).type) == level) {
+            BinaryOperand operand = { .opTok = tokens->tokens + tokens->pos };
+            consumeTok(tokens);
+
+            res = parseBinaryExpr(tokens, level + 1, &(operand.expr));
+            if (!res.success)
+                return res;
+
+            listBuilder_appendLocal(&builder, operand);
         }
 
-        MultiplicativePost post = {
-            .tok = tok,
-            .op = op,
-            .expr = cast
-        };
+        chain->operands = parserFinishList(&builder, AstStats_BinaryOperand);
 
-        sll_appendLocal(&(multiplicativeExpr->postExprs), post);
+        // Anything left binds looser than this chain, so the chain becomes
+        // the first operand of the next one
+        expr = chain;
+        level = binaryOpLevel(peekTok(tokens).type);
     }
 
-    return (ParseRes){ .success = true };
+    *outExpr = expr;
+    return Succeed;
 }
 
-ParseRes parseAdditiveExpr(TokenList *tokens, AdditiveExpr *additiveExpr) {
-    additiveExpr->tok = tokens->tokens + tokens->pos;
-
-    MultiplicativeExpr multiplicativeExpr = {0};
-    ParseRes res = parseMultiplicativeExpr(tokens, &multiplicativeExpr);
-    if (!res.success) {
-        // Error if this fails
+ParseRes parseConditionalExpr(TokenList *tokens, ConditionalExpr *conditional) {
+    BinaryExpr *binary = NULL;
+    ParseRes res = parseBinaryExpr(tokens, BinaryExpr_LogicalOr, &binary);
+    if (!res.success)
         return res;
-    }
 
-    additiveExpr->baseExpr = multiplicativeExpr;
+    conditional->beforeExpr = binary;
 
-    while (peekTok(tokens).type == '+' ||
-        peekTok(tokens).type == '-')
-    {
-        Token *tok = tokens->tokens + tokens->pos;
-
-        TokenType type = consumeTok(tokens).type;
-        AdditiveOp op = type == '+' ? Additive_Add : Additive_Sub;
+    if (!consumeIfTok(tokens, '?')) {
+        conditional->hasConditionalOp = false;
+        return (ParseRes){ .success = true };
+    }
 
-        MultiplicativeExpr multiplicative = {0};
-        ParseRes res = parseMultiplicativeExpr(tokens, &multiplicative);
-        if (!res.success) {
-            // Error if this fails
-            return res;
-        }
+    Expr expr = {0};
+    ParseRes exprRes = parseExpr(tokens, &expr);
+    if (!exprRes.success)
+        return exprRes;
 
-        AdditivePost post = {
-            .tok = tok,
-            .op = op,
-            .expr = multiplicative
+    if (!consumeIfTok(tokens, ':')) {
+        return (ParseRes) {
+            .success = false,
+            .failMessage = "Expected : after ? and expr"
         };
-
-        sll_appendLocal(&(additiveExpr->postExprs), post);
     }
 
+    ConditionalExpr falseExpr = {0};
+    ParseRes falseRes = parseConditionalExpr(tokens, &falseExpr);
+    if (!falseRes.success)
+        return falseRes;
+
+    conditional->hasConditionalOp = true;
+    conditional->ifTrueExpr = ParserCopy(expr);
+    conditional->ifFalseExpr = ParserCopy(falseExpr);
+
     return (ParseRes){ .success = true };
 }
 
-ParseRes parseShiftExpr(TokenList *tokens, ShiftExpr *shiftExpr) {
-    shiftExpr->tok = tokens->tokens + tokens->pos;
-
-    AdditiveExpr additiveExpr = {0};
-    ParseRes res = parseAdditiveExpr(tokens, &additiveExpr);
-    if (!res.success) {
-        // Error if this fails
-        return res;
+ParseRes parseAssignOp(TokenList *tokens, AssignOp *op) {
+    if (consumeIfTok(tokens, '=')) {
+        *op = Assign_Eq;
     }
-
-    shiftExpr->baseExpr = additiveExpr;
-
-    while (peekTok(tokens).type == Token_ShiftLeftOp ||
-        peekTok(tokens).type == Token_ShiftRightOp)
-    {
-        Token *tok = tokens->tokens + tokens->pos;
-
-        TokenType type = consumeTok(tokens).type;
-        ShiftOp op = type == Token_ShiftLeftOp ? Shift_Left : Shift_Right;
-
-        AdditiveExpr additive = {0};
-        ParseRes res = parseAdditiveExpr(tokens, &additive);
-        if (!res.success) {
-            // Error if this fails
-            return res;
-        }
-
-        ShiftPost post = {
-            .tok = tok,
-            .op = op,
-            .expr = additive
+    else if (consumeIfTok(tokens, Token_MulAssign)) {
+        *op = Assign_MulEq;
+    }
+    else if (consumeIfTok(tokens, Token_DivAssign)) {
+        *op = Assign_DivEq;
+    }
+    else if (consumeIfTok(tokens, Token_ModAssign)) {
+        *op = Assign_ModEq;
+    }
+    else if (consumeIfTok(tokens, Token_AddAssign)) {
+        *op = Assign_AddEq;
+    }
+    else if (consumeIfTok(tokens, Token_SubAssign)) {
+        *op = Assign_SubEq;
+    }
+    else if (consumeIfTok(tokens, Token_ShiftLeftAssign)) {
+        *op = Assign_ShiftLeftEq;
+    }
+    else if (consumeIfTok(tokens, Token_ShiftRightAssign)) {
+        *op = Assign_ShiftRightEq;
+    }
+    else if (consumeIfTok(tokens, Token_AndAssign)) {
+        *op = Assign_AndEq;
+    }
+    else if (consumeIfTok(tokens, Token_XorAssign)) {
+        *op = Assign_XorEq;
+    }
+    else if (consumeIfTok(tokens, Token_OrAssign)) {
+        *op = Assign_OrEq;
+    }
+    else {
+        return (ParseRes) {
+            .success = false,
+            .failMessage = "Couldn't find an assignment op"
         };
-
-        sll_appendLocal(&(shiftExpr->postExprs), post);
     }
 
     return (ParseRes){ .success = true };
 }
 
-ParseRes parseRelationalExpr(TokenList *tokens, RelationalExpr *relExpr) {
-    relExpr->tok = tokens->tokens + tokens->pos;
-
-    ShiftExpr shiftExpr = {0};
-    ParseRes res = parseShiftExpr(tokens, &shiftExpr);
-    if (!res.success) {
-        // Error if this fails
-        return res;
-    }
-
-    relExpr->baseExpr = shiftExpr;
-
-    while (peekTok(tokens).type == '<' ||
-        peekTok(tokens).type == '>' ||
-        peekTok(tokens).type == Token_LEqOp ||
-        peekTok(tokens).type == Token_GEqOp)
-    {
-        Token *tok = tokens->tokens + tokens->pos;
+ParseRes parseAssignExpr(TokenList *tokens, AssignExpr *assignExpr) {
+    // Parse an optional list of assign exprs
+    ListBuilder builder = listBuilder_init(sizeof(AssignPrefix));
 
-        TokenType type = consumeTok(tokens).type;
-        RelationalOp op = type == '<' ? Relational_Lt :
-            type == '>' ? Relational_Gt :
-            type == Token_LEqOp ? Relational_LEq :
-            Relational_GEq;
+    ParseRes assignRes = {0};
+    do {
+        size_t preAssignPos = tokens->pos;
+        ArenaMark mark = arena_mark(g_arena);
 
-        ShiftExpr shift = {0};
-        ParseRes res = parseShiftExpr(tokens, &shift);
+        UnaryExpr unaryExpr = {0};
+        ParseRes res = parseUnaryExpr(tokens, &unaryExpr);
         if (!res.success) {
-            // Error if this fails
-            return res;
+            ParserBacktrack(tokens, preAssignPos);
+            parserRollback(mark);
+            break;
         }
 
-        RelationalPost post = {
-            .tok = tok,
-            .op = op,
-            .expr = shift
-        };
+        AssignOp op = {0};
+        assignRes = parseAssignOp(tokens, &op);
+        if (!assignRes.success) {
+            ParserBacktrack(tokens, preAssignPos);
+            parserRollback(mark);
+            break;
+        }
 
-        sll_appendLocal(&(relExpr->postExprs), post);
-    }
+        AssignPrefix leftExpr = { unaryExpr, op };
 
-    return (ParseRes){ .success = true };
-}
+        listBuilder_appendLocal(&builder, leftExpr);
+    } while (assignRes.success);
 
-ParseRes parseEqualityExpr(TokenList *tokens, EqualityExpr *eqExpr) {
-    eqExpr->tok = tokens->tokens + tokens->pos;
+    assignExpr->leftExprs = parserFinishList(&builder, AstStats_AssignPrefix);
 
-    RelationalExpr relExpr = {0};
-    ParseRes res = parseRelationalExpr(tokens, &relExpr);
-    if (!res.success) {
-        // Error if this fails
+    // Parse a conditional expr
+    ConditionalExpr conditional = {0};
+    ParseRes res = parseConditionalExpr(tokens, &conditional);
+    if (!res.success)
         return res;
-    }
-
-    eqExpr->baseExpr = relExpr;
 
-    while (peekTok(tokens).type == Token_EqOp ||
-        peekTok(tokens).type == Token_NEqOp)
-    {
-        Token *tok = tokens->tokens + tokens->pos;
+    assignExpr->rightExpr = conditional;
 
-        EqualityOp op = consumeTok(tokens).type == Token_EqOp ?
-            Equality_Eq : Equality_NEq;
-
-        RelationalExpr rel = {0};
-        ParseRes res = parseRelationalExpr(tokens, &rel);
-        if (!res.success) {
-            // Error if this fails
-            return res;
-        }
-
-        EqualityPost post = {
-            .tok = tok,
-            .op = op,
-            .expr = rel,
-        };
-
-        sll_appendLocal(&(eqExpr->postExprs), post);
-    }
-
-    return (ParseRes){ .success = true };
-}
-
-ParseRes parseAndExpr(TokenList *tokens, AndExpr *andExpr) {
-    andExpr->tok = tokens->tokens + tokens->pos;
-
-    bool foundAndOp = false;
-    do {
-        EqualityExpr eqExpr = {0};
-        ParseRes res = parseEqualityExpr(tokens, &eqExpr);
-        if (!res.success) {
-            // Error if this fails
-            return res;
-        }
-
-        foundAndOp = consumeIfTok(tokens, '&');
-
-        sll_appendLocal(&(andExpr->list), eqExpr);
-    } while (foundAndOp);
-
-    return (ParseRes){ .success = true };
-}
-
-ParseRes parseExclusiveOrExpr(TokenList *tokens, ExclusiveOrExpr *exclusiveOr) {
-    exclusiveOr->tok = tokens->tokens + tokens->pos;
-
-    bool foundOrOp = false;
-    do {
-        AndExpr andExpr = {0};
-        ParseRes res = parseAndExpr(tokens, &andExpr);
-        if (!res.success) {
-            // Error if this fails
-            return res;
-        }
-
-        foundOrOp = consumeIfTok(tokens, '^');
-
-        sll_appendLocal(&(exclusiveOr->list), andExpr);
-    } while (foundOrOp);
-
-    return (ParseRes){ .success = true };
-}
-
-ParseRes parseInclusiveOrExpr(TokenList *tokens, InclusiveOrExpr *inclusiveOr) {
-    inclusiveOr->tok = tokens->tokens + tokens->pos;
-
-    bool foundOrOp = false;
-    do {
-        ExclusiveOrExpr orExpr = {0};
-        ParseRes res = parseExclusiveOrExpr(tokens, &orExpr);
-        if (!res.success) {
-            // Error if this fails
-            return res;
-        }
-
-        foundOrOp = consumeIfTok(tokens, '|');
-
-        sll_appendLocal(&(inclusiveOr->list), orExpr);
-    } while (foundOrOp);
-
-    return (ParseRes){ .success = true };
-}
-
-ParseRes parseLogicalAndExpr(TokenList *tokens, LogicalAndExpr *logicalAnd) {
-    logicalAnd->tok = tokens->tokens + tokens->pos;
-
-    bool foundAndOp = false;
-    do {
-        InclusiveOrExpr orExpr = {0};
-        ParseRes res = parseInclusiveOrExpr(tokens, &orExpr);
-        if (!res.success) {
-            // Error if this fails
-            return res;
-        }
-
-        foundAndOp = consumeIfTok(tokens, Token_LogAndOp);
-
-        sll_appendLocal(&(logicalAnd->list), orExpr);
-    } while (foundAndOp);
-
-    return (ParseRes){ .success = true };
-}
-
-ParseRes parseLogicalOrExpr(TokenList *tokens, LogicalOrExpr *logicalOr) {
-    logicalOr->tok = tokens->tokens + tokens->pos;
-
-    bool foundOrOp = false;
-    do {
-        LogicalAndExpr andExpr = {0};
-        ParseRes res = parseLogicalAndExpr(tokens, &andExpr);
-        if (!res.success) {
-            // Error if this fails
-            return res;
-        }
-
-        foundOrOp = consumeIfTok(tokens, Token_LogOrOp);
-
-        sll_appendLocal(&(logicalOr->list), andExpr);
-    } while (foundOrOp);
-
-    return (ParseRes){ .success = true };
-}
-
-ParseRes parseConditionalExpr(TokenList *tokens, ConditionalExpr *conditional) {
-    LogicalOrExpr logicalOr = {0};
-    ParseRes res = parseLogicalOrExpr(tokens, &logicalOr);
-    if (!res.success)
-        return res;
-
-    conditional->beforeExpr = logicalOr;
-
-    if (!consumeIfTok(tokens, '?')) {
-        conditional->hasConditionalOp = false;
-        return (ParseRes){ .success = true };
-    }
-
-    Expr expr = {0};
-    ParseRes exprRes = parseExpr(tokens, &expr);
-    if (!exprRes.success)
-        return exprRes;
-
-    if (!consumeIfTok(tokens, ':')) {
-        return (ParseRes) {
-            .success = false,
-            .failMessage = "Expected : after ? and expr"
-        };
-    }
-
-    ConditionalExpr falseExpr = {0};
-    ParseRes falseRes = parseConditionalExpr(tokens, &falseExpr);
-    if (!falseRes.success)
-        return falseRes;
-
-    conditional->hasConditionalOp = true;
-    conditional->ifTrueExpr = malloc(sizeof(expr));
-    memcpy(conditional->ifTrueExpr, &expr, sizeof(expr));
-    conditional->ifFalseExpr = malloc(sizeof(falseExpr));
-    memcpy(conditional->ifFalseExpr, &falseExpr, sizeof(falseExpr));
-
-    return (ParseRes){ .success = true };
-}
-
-ParseRes parseAssignOp(TokenList *tokens, AssignOp *op) {
-    if (consumeIfTok(tokens, '=')) {
-        *op = Assign_Eq;
-    }
-    else if (consumeIfTok(tokens, Token_MulAssign)) {
-        *op = Assign_MulEq;
-    }
-    else if (consumeIfTok(tokens, Token_DivAssign)) {
-        *op = Assign_DivEq;
-    }
-    else if (consumeIfTok(tokens, Token_ModAssign)) {
-        *op = Assign_ModEq;
-    }
-    else if (consumeIfTok(tokens, Token_AddAssign)) {
-        *op = Assign_AddEq;
-    }
-    else if (consumeIfTok(tokens, Token_SubAssign)) {
-        *op = Assign_SubEq;
-    }
-    else if (consumeIfTok(tokens, Token_ShiftLeftAssign)) {
-        *op = Assign_ShiftLeftEq;
-    }
-    else if (consumeIfTok(tokens, Token_ShiftRightAssign)) {
-        *op = Assign_ShiftRightEq;
-    }
-    else if (consumeIfTok(tokens, Token_AndAssign)) {
-        *op = Assign_AndEq;
-    }
-    else if (consumeIfTok(tokens, Token_XorAssign)) {
-        *op = Assign_XorEq;
-    }
-    else if (consumeIfTok(tokens, Token_OrAssign)) {
-        *op = Assign_OrEq;
-    }
-    else {
-        return (ParseRes) {
-            .success = false,
-            .failMessage = "Couldn't find an assignment op"
-        };
-    }
-
-    return (ParseRes){ .success = true };
-}
-
-ParseRes parseAssignExpr(TokenList *tokens, AssignExpr *assignExpr) {
-    // Parse an optional list of assign exprs
-    ParseRes assignRes = {0};
-    do {
-        size_t preAssignPos = tokens->pos;
-
-        UnaryExpr unaryExpr = {0};
-        ParseRes res = parseUnaryExpr(tokens, &unaryExpr);
-        if (!res.success) {
-            tokens->pos = preAssignPos;
-            break;
-        }
-
-        AssignOp op = {0};
-        assignRes = parseAssignOp(tokens, &op);
-        if (!assignRes.success) {
-            tokens->pos = preAssignPos;
-            break;
-        }
-
-        AssignPrefix leftExpr = { unaryExpr, op };
-
-        sll_appendLocal(&(assignExpr->leftExprs), leftExpr);
-    } while (assignRes.success);
-
-    // Parse a conditional expr
-    ConditionalExpr conditional = {0};
-    ParseRes res = parseConditionalExpr(tokens, &conditional);
-    if (!res.success)
-        return res;
-
-    assignExpr->rightExpr = conditional;
-
-    return (ParseRes){ .success = true };
-}
+    return (ParseRes){ .success = true };
+}
 
 ParseRes parseInnerExpr(TokenList *tokens, InnerExpr *inner) {
     size_t pos = tokens->pos;
+    ArenaMark mark = arena_mark(g_arena);
 
     // Try to parse parens with a compound statement
     if (!consumeIfTok(tokens, '('))
@@ -1298,13 +1436,14 @@ ParseRes parseInnerExpr(TokenList *tokens, InnerExpr *inner) {
         goto ParseInnerExpr_AfterCompound;
 
     inner->type = InnerExpr_CompoundStatement;
-    inner->compoundStmt = malloc(sizeof(compound));
-    memcpy(inner->compoundStmt, &compound, sizeof(compound));
+    inner->compoundStmt = ParserCopy(compound);
+    g_sawStmtExpr = true;
 
     return (ParseRes){ .success = true };
 
 ParseInnerExpr_AfterCompound:
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // Try to parse an assign stmt
     AssignExpr expr = {0};
@@ -1325,6 +1464,10 @@ ParseInnerExpr_AfterAssign:
 }
 
 ParseRes parseExpr(TokenList *tokens, Expr *expr) {
+    NodeKindMask outerKinds = kinds_begin();
+
+    ListBuilder builder = listBuilder_init(sizeof(InnerExpr));
+
     bool hasComma = false;
 
     do {
@@ -1333,16 +1476,18 @@ ParseRes parseExpr(TokenList *tokens, Expr *expr) {
         InnerExpr inner = {0};
         ParseRes res = parseInnerExpr(tokens, &inner);
         if (!res.success) {
-            tokens->pos = pos;
+            ParserBacktrack(tokens, pos);
             break;
         }
 
-        sll_appendLocal(&(expr->list), inner);
+        listBuilder_appendLocal(&builder, inner);
 
         hasComma = consumeIfTok(tokens, ',');
 
     } while(hasComma);
 
+    expr->list = parserFinishList(&builder, AstStats_InnerExpr);
+    expr->kinds = kinds_end(outerKinds, 0);
 
     if (expr->list.size == 0) {
         return (ParseRes) {
@@ -1360,8 +1505,7 @@ ParseRes parseParameterDeclaration(TokenList *tokens, ParameterDeclaration *decl
     if (!res.success)
         return res;
 
-    decl->declarationSpecifiers = malloc(sizeof(list));
-    memcpy(decl->declarationSpecifiers, &list, sizeof(list));
+    decl->declarationSpecifiers = ParserCopy(list);
 
     size_t beforeDeclaratorPos = tokens->pos;
 
@@ -1369,12 +1513,11 @@ ParseRes parseParameterDeclaration(TokenList *tokens, ParameterDeclaration *decl
     if (parseDeclarator(tokens, &declarator).success) {
         decl->hasDeclarator = true;
         decl->hasAbstractDeclarator = false;
-        decl->declarator = malloc(sizeof(declarator));
-        memcpy(decl->declarator, &declarator, sizeof(declarator));
+        decl->declarator = ParserCopy(declarator);
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = beforeDeclaratorPos;
+    ParserBacktrack(tokens, beforeDeclaratorPos);
 
     // If no declarator, try to parse an abstract declarator
 
@@ -1384,17 +1527,18 @@ ParseRes parseParameterDeclaration(TokenList *tokens, ParameterDeclaration *decl
     if (parseAbstractDeclarator(tokens, &abstractDeclarator).success) {
         decl->hasAbstractDeclarator = true;
         decl->hasDeclarator = false;
-        decl->abstractDeclarator = malloc(sizeof(abstractDeclarator));
-        memcpy(decl->abstractDeclarator, &abstractDeclarator, sizeof(abstractDeclarator));
+        decl->abstractDeclarator = ParserCopy(abstractDeclarator);
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = beforeAbstractDeclaratorPos;
+    ParserBacktrack(tokens, beforeAbstractDeclaratorPos);
 
     return (ParseRes){ .success = true };
 }
 
 ParseRes parseParameterTypeList(TokenList *tokens, ParameterTypeList *list) {
+    ListBuilder builder = listBuilder_init(sizeof(ParameterDeclaration));
+
     bool hasComma = false;
     do {
         // Look for an ellipsis and break
@@ -1412,12 +1556,15 @@ ParseRes parseParameterTypeList(TokenList *tokens, ParameterTypeList *list) {
             };
         }
 
-        sll_appendLocal(&(list->paramDecls), decl);
+        listBuilder_appendLocal(&builder, decl);
 
         hasComma = consumeIfTok(tokens, ',');
 
     } while(hasComma);
 
+    list->paramDecls = parserFinishList(&builder,
+        AstStats_ParameterDeclaration);
+
     return (ParseRes){ .success = true };
 }
 
@@ -1455,6 +1602,8 @@ ParseRes parsePostDirectAbstractDeclarator(TokenList *tokens,
             postDeclarator->bracketHasInitialStatic = true;
 
         // parse opt type qualifier list
+        ListBuilder builder = listBuilder_init(sizeof(TypeQualifier));
+
         ParseRes res = {0};
         do {
             size_t typeQualifierPos = tokens->pos;
@@ -1462,13 +1611,16 @@ ParseRes parsePostDirectAbstractDeclarator(TokenList *tokens,
             TypeQualifier typeQualifier = {0};
             res = parseTypeQualifier(tokens, &typeQualifier);
             if (!res.success) {
-                tokens->pos = typeQualifierPos;
+                ParserBacktrack(tokens, typeQualifierPos);
                 break;
             }
 
-            sll_appendLocal(&(postDeclarator->bracketTypeQualifiers), typeQualifier);
+            listBuilder_appendLocal(&builder, typeQualifier);
         } while (res.success);
 
+        postDeclarator->bracketTypeQualifiers = parserFinishList(&builder,
+            AstStats_TypeQualifier);
+
         // Look for middle static
         if (consumeIfTok(tokens, Token_static))
             postDeclarator->bracketHasMiddleStatic = true;
@@ -1484,7 +1636,7 @@ ParseRes parsePostDirectAbstractDeclarator(TokenList *tokens,
         }
         else {
             postDeclarator->bracketHasAssignmentExpr = false;
-            tokens->pos = assignPos;
+            ParserBacktrack(tokens, assignPos);
         }
 
         // Verify it actually worked
@@ -1514,7 +1666,7 @@ ParseRes parsePostDirectAbstractDeclarator(TokenList *tokens,
 
 PostDirectAbstractDeclarator_Paren:
     memset(postDeclarator, 0, sizeof(PostDirectAbstractDeclarator));
-    tokens->pos = bracketPos;
+    ParserBacktrack(tokens, bracketPos);
 
     // Try to parse paren version
     if (!consumeIfTok(tokens, '(')) {
@@ -1570,18 +1722,19 @@ ParseRes parseDirectAbstractDeclarator(TokenList *tokens,
 
     // If we get here, then we succeeded
     directDeclarator->hasAbstractDeclarator = true;
-    directDeclarator->abstractDeclarator = malloc(sizeof(abstractDeclarator));
-    memcpy(directDeclarator->abstractDeclarator, &abstractDeclarator, sizeof(abstractDeclarator));
+    directDeclarator->abstractDeclarator = ParserCopy(abstractDeclarator);
 
     goto PostAbstractDeclaratorDone;
 
 PostAbstractDeclaratorFail:
     directDeclarator->hasAbstractDeclarator = false;
-    tokens->pos = preAbstractDeclaratorPos;
+    ParserBacktrack(tokens, preAbstractDeclaratorPos);
 
 PostAbstractDeclaratorDone:
     ; // We need this because the label needs to be before a statement
     // Parse a list of post direct abstract declarators (size can be zero)
+    ListBuilder builder = listBuilder_init(sizeof(PostDirectAbstractDeclarator));
+
     ParseRes res = {0};
     do {
         // parse opt post declarator
@@ -1590,14 +1743,16 @@ PostAbstractDeclaratorDone:
         PostDirectAbstractDeclarator postDeclarator = {0};
         res = parsePostDirectAbstractDeclarator(tokens, &postDeclarator);
         if (!res.success) {
-            tokens->pos = pos;
+            ParserBacktrack(tokens, pos);
             break;
         }
 
-        sll_appendLocal(&(directDeclarator->postDirectAbstractDeclarators),
-            postDeclarator);
+        listBuilder_appendLocal(&builder, postDeclarator);
     } while (res.success);
 
+    directDeclarator->postDirectAbstractDeclarators = parserFinishList(&builder,
+        AstStats_PostDirectAbstractDeclarator);
+
     if (!directDeclarator->hasAbstractDeclarator &&
         directDeclarator->postDirectAbstractDeclarators.size == 0)
     {
@@ -1624,6 +1779,8 @@ ParseRes parsePointer(TokenList *tokens, Pointer *pointer) {
     }
 
     // Parse opt type qualifier list
+    ListBuilder builder = listBuilder_init(sizeof(TypeQualifier));
+
     ParseRes typeQualifierRes = {0};
     do {
         size_t pos = tokens->pos;
@@ -1631,13 +1788,16 @@ ParseRes parsePointer(TokenList *tokens, Pointer *pointer) {
         TypeQualifier typeQualifier = {0};
         typeQualifierRes = parseTypeQualifier(tokens, &typeQualifier);
         if (!typeQualifierRes.success) {
-            tokens->pos = pos;
+            ParserBacktrack(tokens, pos);
             break;
         }
 
-        sll_appendLocal(&(pointer->typeQualifiers), typeQualifier);
+        listBuilder_appendLocal(&builder, typeQualifier);
     } while (typeQualifierRes.success);
 
+    pointer->typeQualifiers = parserFinishList(&builder,
+        AstStats_TypeQualifier);
+
     // If no type qualifiers, cannot have trailing pointer
     if (pointer->typeQualifiers.size == 0) {
         pointer->hasPtr = false;
@@ -1651,12 +1811,11 @@ ParseRes parsePointer(TokenList *tokens, Pointer *pointer) {
     ParseRes pointerRes = parsePointer(tokens, &trailingPointer);
     if (pointerRes.success) {
         pointer->hasPtr = true;
-        pointer->pointer = malloc(sizeof(Pointer));
-        memcpy(pointer->pointer, &trailingPointer, sizeof(Pointer));
+        pointer->pointer = ParserCopy(trailingPointer);
     }
     else {
         pointer->hasPtr = false;
-        tokens->pos = pos;
+        ParserBacktrack(tokens, pos);
     }
 
     return (ParseRes){ .success = true };
@@ -1676,7 +1835,7 @@ ParseRes parseAbstractDeclarator(TokenList *tokens,
     }
     else {
         abstractDeclarator->hasPointer = false;
-        tokens->pos = pointerPos;
+        ParserBacktrack(tokens, pointerPos);
     }
 
     // Parse opt direct abstract declarator
@@ -1690,7 +1849,7 @@ ParseRes parseAbstractDeclarator(TokenList *tokens,
     }
     else {
         abstractDeclarator->hasDirectAbstractDeclarator = false;
-        tokens->pos = directPos;
+        ParserBacktrack(tokens, directPos);
     }
 
     if (!abstractDeclarator->hasPointer &&
@@ -1708,6 +1867,8 @@ ParseRes parseAbstractDeclarator(TokenList *tokens,
 }
 
 ParseRes parseIdentifierList(TokenList *tokens, IdentifierList *list) {
+    ListBuilder builder = listBuilder_init(sizeof(String));
+
     bool hasComma = false;
     do {
         if (peekTok(tokens).type != Token_Ident) {
@@ -1715,12 +1876,14 @@ ParseRes parseIdentifierList(TokenList *tokens, IdentifierList *list) {
         }
 
         Token tok = consumeTok(tokens);
-        sll_appendLocal(&(list->list), tok.ident);
+        listBuilder_appendLocal(&builder, tok.ident);
 
         hasComma = consumeIfTok(tokens, Token_Ident);
 
     } while (hasComma);
 
+    list->list = parserFinishList(&builder, AstStats_String);
+
     return (ParseRes){ .success = true };
 }
 
@@ -1754,6 +1917,8 @@ ParseRes parsePostDirectDeclarator(TokenList *tokens, PostDirectDeclarator *post
             }
 
             // check for opt type qualifier list
+            ListBuilder builder = listBuilder_init(sizeof(TypeQualifier));
+
             ParseRes res = {0};
             do {
                 size_t typeQualifierPos = tokens->pos;
@@ -1761,14 +1926,16 @@ ParseRes parsePostDirectDeclarator(TokenList *tokens, PostDirectDeclarator *post
                 TypeQualifier typeQualifier = {0};
                 res = parseTypeQualifier(tokens, &typeQualifier);
                 if (!res.success) {
-                    tokens->pos = typeQualifierPos;
+                    ParserBacktrack(tokens, typeQualifierPos);
                     break;
                 }
 
-                sll_appendLocal(&(postDeclarator->bracketTypeQualifiers),
-                    typeQualifier);
+                listBuilder_appendLocal(&builder, typeQualifier);
             } while (res.success);
 
+            postDeclarator->bracketTypeQualifiers = parserFinishList(&builder,
+                AstStats_TypeQualifier);
+
             // Case 3a: early terminate if:
                 // no initial static
                 // typequalifier len != 0
@@ -1799,7 +1966,7 @@ ParseRes parsePostDirectDeclarator(TokenList *tokens, PostDirectDeclarator *post
                 postDeclarator->bracketAssignExpr = expr;
             }
             else {
-                tokens->pos = preAssignPos;
+                ParserBacktrack(tokens, preAssignPos);
             }
 
             if (!consumeIfTok(tokens, ']')) {
@@ -1867,7 +2034,7 @@ ParseRes parsePostDirectDeclarator(TokenList *tokens, PostDirectDeclarator *post
 
 ParsePostDirectDeclarator_PostParenParamList:
 
-        tokens->pos = pos;
+        ParserBacktrack(tokens, pos);
 
         // Parse an identifier list
         {
@@ -1927,8 +2094,7 @@ ParseRes parseDirectDeclarator(TokenList *tokens, DirectDeclarator *directDeclar
         }
 
         directDeclarator->type = DirectDeclarator_ParenDeclarator;
-        directDeclarator->declarator = malloc(sizeof(nestedDeclarator));
-        memcpy(directDeclarator->declarator, &nestedDeclarator, sizeof(nestedDeclarator));
+        directDeclarator->declarator = ParserCopy(nestedDeclarator);
     }
     else {
         return (ParseRes) {
@@ -1938,6 +2104,8 @@ ParseRes parseDirectDeclarator(TokenList *tokens, DirectDeclarator *directDeclar
     }
 
     // Parse optional list of post direct declarators
+    ListBuilder builder = listBuilder_init(sizeof(PostDirectDeclarator));
+
     ParseRes postDirectRes = {0};
     do {
         size_t pos = tokens->pos;
@@ -1945,18 +2113,22 @@ ParseRes parseDirectDeclarator(TokenList *tokens, DirectDeclarator *directDeclar
         PostDirectDeclarator postDeclarator = {0};
         postDirectRes = parsePostDirectDeclarator(tokens, &postDeclarator);
         if (!postDirectRes.success) {
-            tokens->pos = pos;
+            ParserBacktrack(tokens, pos);
             break;
         }
 
-        sll_appendLocal(&(directDeclarator->postDirectDeclarators),
-            postDeclarator);
+        listBuilder_appendLocal(&builder, postDeclarator);
     } while(postDirectRes.success);
 
+    directDeclarator->postDirectDeclarators = parserFinishList(&builder,
+        AstStats_PostDirectDeclarator);
+
     return (ParseRes) { .success = true };
 }
 
-ParseRes parseDeclarator(TokenList *tokens, Declarator *declarator) {
+static ParseRes parseDeclaratorUncached(TokenList *tokens,
+    Declarator *declarator)
+{
     declarator->tok = tokens->tokens + tokens->pos;
 
     // Try parse pointer
@@ -1968,7 +2140,7 @@ ParseRes parseDeclarator(TokenList *tokens, Declarator *declarator) {
         declarator->pointer = pointer;
     }
     else {
-        tokens->pos = prePointerPos;
+        ParserBacktrack(tokens, prePointerPos);
         declarator->hasPointer = false;
     }
 
@@ -1983,6 +2155,11 @@ ParseRes parseDeclarator(TokenList *tokens, Declarator *declarator) {
     return (ParseRes){ .success = true };
 }
 
+ParseRes parseDeclarator(TokenList *tokens, Declarator *declarator) {
+    return parseMemoized(tokens, Memo_Declarator,
+        (Parser)parseDeclaratorUncached, declarator, sizeof(*declarator));
+}
+
 ParseRes parseTypeQualifier(TokenList *tokens, TypeQualifier *outQualifier) {
     ParseRes pass = { .success = true };
     ParseRes fail = {
@@ -2020,12 +2197,11 @@ ParseRes parseSpecifierQualifier(TokenList *tokens,
     ParseRes specifierRes = parseTypeSpecifier(tokens, &specifier);
     if (specifierRes.success) {
         outSpecifierQualifier->type = SpecifierQualifier_Specifier;
-        outSpecifierQualifier->typeSpecifier = malloc(sizeof(specifier));
-        memcpy(outSpecifierQualifier->typeSpecifier, &specifier, sizeof(specifier));
+        outSpecifierQualifier->typeSpecifier = ParserCopy(specifier);
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
     // Parse qualifier
     TypeQualifier qualifier = {0};
     ParseRes qualifierRes = parseTypeQualifier(tokens, &qualifier);
@@ -2052,11 +2228,24 @@ ParseRes parseSpecifierQualifierList(TokenList *tokens,
         return res;
     }
 
+    ListBuilder builder = listBuilder_init(sizeof(SpecifierQualifier));
+
+    bool hasTypeSpecifier = false;
     do {
-        sll_appendLocal(&(outList->list), specifierQualifier);
+        listBuilder_appendLocal(&builder, specifierQualifier);
+        hasTypeSpecifier |=
+            specifierQualifier.type == SpecifierQualifier_Specifier;
+
+        // Same as declaration specifiers, an identifier after a type is the
+        // declarator
+        if (hasTypeSpecifier && peekTok(tokens).type == Token_Ident)
+            break;
+
         res = parseSpecifierQualifier(tokens, &specifierQualifier);
     } while (res.success);
 
+    outList->list = parserFinishList(&builder, AstStats_SpecifierQualifier);
+
     return (ParseRes) { .success = true };
 }
 
@@ -2082,7 +2271,7 @@ ParseRes parseTypeName(TokenList *tokens, TypeName *outType) {
     }
 
     // No abstract declarator, so reset tokens
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     outType->hasAbstractDeclarator = false;
 
@@ -2196,7 +2385,7 @@ ParseRes parseStructDeclarator(TokenList *tokens, StructDeclarator *decl) {
         decl->declarator = declarator;
     }
     else {
-        tokens->pos = posBefore;
+        ParserBacktrack(tokens, posBefore);
     }
 
     if (consumeIfTok(tokens, ':')) {
@@ -2214,6 +2403,8 @@ ParseRes parseStructDeclarator(TokenList *tokens, StructDeclarator *decl) {
 }
 
 ParseRes parseStructDeclaratorList(TokenList *tokens, StructDeclaratorList *declList) {
+    ListBuilder builder = listBuilder_init(sizeof(StructDeclarator));
+
     bool hasComma = false;
     do {
         StructDeclarator decl = {0};
@@ -2221,11 +2412,13 @@ ParseRes parseStructDeclaratorList(TokenList *tokens, StructDeclaratorList *decl
         if (!res.success)
             return res;
 
-        sll_appendLocal(&(declList->list), decl);
+        listBuilder_appendLocal(&builder, decl);
 
         hasComma = consumeIfTok(tokens, ',');
     } while(hasComma);
 
+    declList->list = parserFinishList(&builder, AstStats_StructDeclarator);
+
     return (ParseRes){ .success = true };
 }
 
@@ -2263,7 +2456,7 @@ ParseRes parseStructDeclaration(TokenList *tokens, StructDeclaration *declaratio
         declaration->normalStructDeclaratorList = declList;
     }
     else {
-        tokens->pos = preDeclaratorPos;
+        ParserBacktrack(tokens, preDeclaratorPos);
     }
 
     // Parse a ;
@@ -2298,15 +2491,20 @@ ParseRes parseStructOrUnionSpecifier(TokenList *tokens, StructOrUnionSpecifier *
     }
 
     if (consumeIfTok(tokens, '{')) {
+        ListBuilder builder = listBuilder_init(sizeof(StructDeclaration));
+
         while (peekTok(tokens).type != '}') {
             StructDeclaration decl = {0};
             ParseRes declRes = parseStructDeclaration(tokens, &decl);
             if (!declRes.success)
                 return declRes;
 
-            sll_appendLocal(&(structOrUnion->structDeclarations), decl);
+            listBuilder_appendLocal(&builder, decl);
         }
 
+        structOrUnion->structDeclarations = parserFinishList(&builder,
+            AstStats_StructDeclaration);
+
         if (!consumeIfTok(tokens, '}')) {
             return (ParseRes) {
                 .success = false,
@@ -2342,10 +2540,15 @@ ParseRes parseEnumerator(TokenList *tokens, Enumerator *enumerator) {
         enumerator->constantExpr = constant;
     }
 
+    // Enumeration constants are ordinary identifiers
+    declareSymbol(tok.symbol, Symbol_Ordinary);
+
     return (ParseRes){ .success = true };
 }
 
 ParseRes parseEnumeratorList(TokenList *tokens, EnumeratorList *list) {
+    ListBuilder builder = listBuilder_init(sizeof(Enumerator));
+
     bool foundEndBlock = false;
     bool hasComma = false;
     do {
@@ -2357,12 +2560,14 @@ ParseRes parseEnumeratorList(TokenList *tokens, EnumeratorList *list) {
 
         hasComma = consumeIfTok(tokens, ',');
 
-        sll_appendLocal(&(list->list), enumerator);
+        listBuilder_appendLocal(&builder, enumerator);
 
         foundEndBlock = peekTok(tokens).type == '}';
 
     } while(hasComma && !foundEndBlock);
 
+    list->list = parserFinishList(&builder, AstStats_Enumerator);
+
     return (ParseRes){ .success = true };
 }
 
@@ -2479,7 +2684,7 @@ ParseRes parseTypeSpecifier(TokenList *tokens, TypeSpecifier *type) {
     }
 
 PostAtomicType:
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     // Parse struct or union specifier
     StructOrUnionSpecifier structOrUnion = {0};
@@ -2490,7 +2695,7 @@ PostAtomicType:
         return pass;
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     // Parse enum specifier
     EnumSpecifier enumSpecifier = {0};
@@ -2501,19 +2706,19 @@ PostAtomicType:
         return pass;
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     // Parse typedef name
     if (peekTok(tokens).type == Token_Ident) {
         Token tok = consumeTok(tokens);
-        if (typedefTable_find(g_typedefTable, tok.ident)) {
+        if (isTypedefName(tok)) {
             type->type = TypeSpecifier_TypedefName;
             type->typedefName = tok.ident;
             return pass;
         }
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     return fail;
 }
@@ -2565,7 +2770,7 @@ ParseRes parseAlignmentSpecifier(TokenList *tokens, AlignmentSpecifier *alignmen
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     ConditionalExpr expr = {0};
     if (parseConditionalExpr(tokens, &expr).success) {
@@ -2600,7 +2805,7 @@ ParseRes parseDeclarationSpecifier(TokenList *tokens,
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     // Try parse type specifier
     TypeSpecifier type = {0};
@@ -2611,7 +2816,7 @@ ParseRes parseDeclarationSpecifier(TokenList *tokens,
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     // Try parse type qualifier
     TypeQualifier qualifier = {0};
@@ -2622,7 +2827,7 @@ ParseRes parseDeclarationSpecifier(TokenList *tokens,
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     // Try parse function specifier
     FunctionSpecifier funcSpecifier = {0};
@@ -2633,7 +2838,7 @@ ParseRes parseDeclarationSpecifier(TokenList *tokens,
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
 
     // Try parse alignment specifier
     AlignmentSpecifier alignSpec = {0};
@@ -2650,7 +2855,7 @@ ParseRes parseDeclarationSpecifier(TokenList *tokens,
     };
 }
 
-ParseRes parseDeclarationSpecifierList(TokenList *tokens,
+static ParseRes parseDeclarationSpecifierListUncached(TokenList *tokens,
     DeclarationSpecifierList *outList)
 {
     // We need at least one, so fail if this doesn't work
@@ -2660,22 +2865,38 @@ ParseRes parseDeclarationSpecifierList(TokenList *tokens,
         return res;
     }
 
+    ListBuilder builder = listBuilder_init(sizeof(DeclarationSpecifier));
+
+    bool hasTypeSpecifier = false;
     do {
-        sll_appendLocal(&(outList->list), specifier);
+        listBuilder_appendLocal(&builder, specifier);
+        hasTypeSpecifier |= specifier.type == DeclarationSpecifier_Type;
+
+        // Once there's a type, an identifier is the declarator even if it's
+        // also a typedef name from an outer scope
+        if (hasTypeSpecifier && peekTok(tokens).type == Token_Ident)
+            break;
+
         res = parseDeclarationSpecifier(tokens, &specifier);
     } while (res.success);
 
+    outList->list = parserFinishList(&builder, AstStats_DeclarationSpecifier);
+
     return (ParseRes) { .success = true };
 }
 
-ParseRes parseInitDeclarator(TokenList *tokens, InitDeclarator *initDeclarator) {
-    Declarator decl = {0};
-    ParseRes declaratorRes = parseDeclarator(tokens, &decl);
-    if (!declaratorRes.success)
-        return declaratorRes;
-
-    initDeclarator->decl = decl;
+ParseRes parseDeclarationSpecifierList(TokenList *tokens,
+    DeclarationSpecifierList *outList)
+{
+    return parseMemoized(tokens, Memo_DeclarationSpecifierList,
+        (Parser)parseDeclarationSpecifierListUncached,
+        outList, sizeof(*outList));
+}
 
+// Parses the optional initializer after an init declarator's declarator
+static ParseRes parseInitDeclaratorInitializer(TokenList *tokens,
+    InitDeclarator *initDeclarator)
+{
     if (consumeIfTok(tokens, '=')) {
         Initializer init = {0};
         ParseRes initRes = parseInitializer(tokens, &init);
@@ -2689,61 +2910,104 @@ ParseRes parseInitDeclarator(TokenList *tokens, InitDeclarator *initDeclarator)
     return (ParseRes) { .success = true };
 }
 
-ParseRes parseInitDeclaratorList(TokenList *tokens, InitDeclaratorList *initList) {
-    bool hasComma = false;
-    do {
+ParseRes parseInitDeclarator(TokenList *tokens, InitDeclarator *initDeclarator) {
+    Declarator decl = {0};
+    ParseRes declaratorRes = parseDeclarator(tokens, &decl);
+    if (!declaratorRes.success)
+        return declaratorRes;
 
-        size_t pos = tokens->pos;
+    initDeclarator->decl = decl;
 
-        // Parse an optional init declarator
-        InitDeclarator decl = {0};
-        ParseRes declRes = parseInitDeclarator(tokens, &decl);
-        if (!declRes.success) {
-            tokens->pos = pos;
-            break;
-        }
+    return parseInitDeclaratorInitializer(tokens, initDeclarator);
+}
 
-        // Parse an optional assembly rename
-        // We don't need to save the data in here because this is
-        // just for an extension in gcc to rename a symbol in the linker
-        if (consumeIfTok(tokens, Token_asm)) {
-            // Look for a (
-            if (!consumeIfTok(tokens, '(')) {
-                return (ParseRes) {
-                    .success = false,
-                    .failMessage = "Expected ( after asm in declaration rename"
-                };
-            }
+// Parse an optional assembly rename
+// We don't need to save the data in here because this is
+// just for an extension in gcc to rename a symbol in the linker
+static ParseRes parseAsmRename(TokenList *tokens) {
+    if (!consumeIfTok(tokens, Token_asm))
+        return (ParseRes){ .success = true };
 
-            // Look for String
-            if (!consumeIfTok(tokens, Token_ConstString)) {
-                return (ParseRes) {
-                    .success = false,
-                    .failMessage = "Expected String after 'asm (' in declaration rename"
-                };
-            }
+    // Look for a (
+    if (!consumeIfTok(tokens, '(')) {
+        return (ParseRes) {
+            .success = false,
+            .failMessage = "Expected ( after asm in declaration rename"
+        };
+    }
 
-            // FIXME: This probably should be handled in lexer
-            // Consume adjacent strings
-            while (peekTok(tokens).type == Token_ConstString)
-                consumeTok(tokens);
+    // Look for String
+    if (!consumeIfTok(tokens, Token_ConstString)) {
+        return (ParseRes) {
+            .success = false,
+            .failMessage = "Expected String after 'asm (' in declaration rename"
+        };
+    }
 
-            // Look for )
-            if (!consumeIfTok(tokens, ')')) {
-                return (ParseRes) {
-                    .success = false,
-                    .failMessage = "Expected ) after 'asm ( String' in declaration rename"
-                };
-            }
+    // FIXME: This probably should be handled in lexer
+    // Consume adjacent strings
+    while (peekTok(tokens).type == Token_ConstString)
+        consumeTok(tokens);
+
+    // Look for )
+    if (!consumeIfTok(tokens, ')')) {
+        return (ParseRes) {
+            .success = false,
+            .failMessage = "Expected ) after 'asm ( String' in declaration rename"
+        };
+    }
+
+    return (ParseRes){ .success = true };
+}
+
+// When first isn't NULL, the first declarator has already been parsed and the
+// list picks up right after it
+static ParseRes parseInitDeclaratorListFrom(TokenList *tokens,
+    Declarator *first, InitDeclaratorList *initList)
+{
+    ListBuilder builder = listBuilder_init(sizeof(InitDeclarator));
+
+    bool hasComma = false;
+    do {
+
+        size_t pos = tokens->pos;
+
+        // Parse an optional init declarator
+        InitDeclarator decl = {0};
+        ParseRes declRes = {0};
+        if (first != NULL) {
+            decl.decl = *first;
+            declRes = parseInitDeclaratorInitializer(tokens, &decl);
+
+            // The declarator can't be given back, so there's no list
+            // without it
+            if (!declRes.success)
+                return declRes;
+
+            first = NULL;
+        }
+        else {
+            declRes = parseInitDeclarator(tokens, &decl);
         }
 
-        sll_appendLocal(&(initList->list), decl);
+        if (!declRes.success) {
+            ParserBacktrack(tokens, pos);
+            break;
+        }
+
+        ParseRes asmRes = parseAsmRename(tokens);
+        if (!asmRes.success)
+            return asmRes;
+
+        listBuilder_appendLocal(&builder, decl);
 
         // Parse a ,
         hasComma = consumeIfTok(tokens, ',');
 
     } while (hasComma);
 
+    initList->list = parserFinishList(&builder, AstStats_InitDeclarator);
+
     // Must have at least one
     if (initList->list.size == 0) {
         return (ParseRes) {
@@ -2755,6 +3019,10 @@ ParseRes parseInitDeclaratorList(TokenList *tokens, InitDeclaratorList *initList
     return (ParseRes){ .success = true };
 }
 
+ParseRes parseInitDeclaratorList(TokenList *tokens, InitDeclaratorList *initList) {
+    return parseInitDeclaratorListFrom(tokens, NULL, initList);
+}
+
 String directDeclarator_getName(DirectDeclarator decl) {
     if (decl.type == DirectDeclarator_Ident)
         return decl.ident;
@@ -2762,7 +3030,13 @@ String directDeclarator_getName(DirectDeclarator decl) {
         return directDeclarator_getName(decl.declarator->directDeclarator);
 }
 
-ParseRes parseDeclaration(TokenList *tokens, Declaration *outDef) {
+static ParseRes parseDeclarationAfterSpecifiers(TokenList *tokens,
+    DeclarationSpecifierList specifiers, Declarator *firstDeclarator,
+    Declaration *outDef);
+
+static ParseRes parseDeclarationUntracked(TokenList *tokens,
+    Declaration *outDef)
+{
     // Try parse a static assert declaration
     if (peekTok(tokens).type == Token_staticAssert) {
         StaticAssertDeclaration staticDecl = {0};
@@ -2781,6 +3055,51 @@ ParseRes parseDeclaration(TokenList *tokens, Declaration *outDef) {
     if (!listRes.success)
         return listRes;
 
+    return parseDeclarationAfterSpecifiers(tokens, specifiers, NULL, outDef);
+}
+
+ParseRes parseDeclaration(TokenList *tokens, Declaration *outDef) {
+    NodeKindMask outerKinds = kinds_begin();
+    ParseRes res = parseDeclarationUntracked(tokens, outDef);
+    outDef->kinds = kinds_end(outerKinds, NodeKindBit(Declaration));
+
+    return res;
+}
+
+// If a declaration starts with typedef, its init declarator list has typedef
+// names. Otherwise the names are ordinary identifiers, which hide any typedef
+// with the same name from an outer scope.
+static void declareDeclarationNames(Declaration *decl) {
+    if (decl->type != Declaration_Normal || !decl->hasInitDeclaratorList)
+        return;
+
+    AstList specifiers = decl->declSpecifiers.list;
+
+    SymbolKind kind = Symbol_Ordinary;
+    if (specifiers.size > 0) {
+        DeclarationSpecifier *declSpec =
+            astList_get(specifiers, DeclarationSpecifier, 0);
+        if (declSpec->type == DeclarationSpecifier_StorageClass &&
+            declSpec->storageClass == StorageClass_Typedef)
+        {
+            kind = Symbol_Typedef;
+        }
+    }
+
+    astList_foreach(decl->initDeclaratorList.list, InitDeclarator, initDecl) {
+        String name = directDeclarator_getName(initDecl->decl.directDeclarator);
+        if (name.length > 0) {
+            declareName(name, kind);
+        }
+    }
+}
+
+// Finishes a normal declaration once its specifiers, and maybe its first
+// declarator, have been parsed
+static ParseRes parseDeclarationAfterSpecifiers(TokenList *tokens,
+    DeclarationSpecifierList specifiers, Declarator *firstDeclarator,
+    Declaration *outDef)
+{
     outDef->type = Declaration_Normal;
     outDef->declSpecifiers = specifiers;
 
@@ -2788,14 +3107,18 @@ ParseRes parseDeclaration(TokenList *tokens, Declaration *outDef) {
     size_t pos = tokens->pos;
 
     InitDeclaratorList initList = {0};
-    ParseRes initRes = parseInitDeclaratorList(tokens, &initList);
+    ParseRes initRes = parseInitDeclaratorListFrom(tokens, firstDeclarator,
+        &initList);
     if (initRes.success) {
         outDef->hasInitDeclaratorList = true;
         outDef->initDeclaratorList = initList;
     }
+    else if (firstDeclarator != NULL) {
+        return initRes;
+    }
     else {
         outDef->hasInitDeclaratorList = false;
-        tokens->pos = pos;
+        ParserBacktrack(tokens, pos);
     }
 
     // Parse semicolon
@@ -2806,28 +3129,7 @@ ParseRes parseDeclaration(TokenList *tokens, Declaration *outDef) {
         };
     }
 
-    // If starts with typedef, look through init declarator list and
-    // pull out typedef names
-    if (specifiers.list.size == 0)
-        goto Post_Typedef_Ident;
-
-    DeclarationSpecifier *declSpec = slNode_getData(specifiers.list.head);
-    if (declSpec->type != DeclarationSpecifier_StorageClass)
-        goto Post_Typedef_Ident;
-
-    if (declSpec->storageClass != StorageClass_Typedef)
-        goto Post_Typedef_Ident;
-
-    // Now that we know we have a typedef, add all the names
-    sll_foreach(initList.list, node) {
-        InitDeclarator *decl = slNode_getData(node);
-        String name = directDeclarator_getName(decl->decl.directDeclarator);
-        if (name.length > 0) {
-            typedefTable_add(&g_typedefTable, name);
-        }
-    }
-
-Post_Typedef_Ident:
+    declareDeclarationNames(outDef);
 
     return (ParseRes){ .success = true };
 }
@@ -2885,8 +3187,7 @@ ParseRes parseLabeledStatement(TokenList *tokens, LabeledStatement *stmt) {
     if (!res.success)
         return res;
 
-    stmt->stmt = malloc(sizeof(inner));
-    memcpy(stmt->stmt, &inner, sizeof(inner));
+    stmt->stmt = ParserCopy(inner);
     return (ParseRes){ .success = true };
 }
 
@@ -2921,8 +3222,7 @@ ParseRes parseSelectionStatement(TokenList *tokens, SelectionStatement *selectio
         if (!stmtRes.success)
             return stmtRes;
 
-        selection->ifTrueStmt = malloc(sizeof(stmt));
-        memcpy(selection->ifTrueStmt, &stmt, sizeof(stmt));
+        selection->ifTrueStmt = ParserCopy(stmt);
 
         if (consumeIfTok(tokens, Token_else)) {
             selection->elseToken = tokens->tokens + tokens->pos - 1;
@@ -2934,8 +3234,7 @@ ParseRes parseSelectionStatement(TokenList *tokens, SelectionStatement *selectio
                 return elseStmtRes;
 
             selection->ifHasElse = true;
-            selection->ifFalseStmt = malloc(sizeof(elseStmt));
-            memcpy(selection->ifFalseStmt, &elseStmt, sizeof(elseStmt));
+            selection->ifFalseStmt = ParserCopy(elseStmt);
         }
 
         return (ParseRes){ .success = true };
@@ -2970,8 +3269,7 @@ ParseRes parseSelectionStatement(TokenList *tokens, SelectionStatement *selectio
         if (!stmtRes.success)
             return stmtRes;
 
-        selection->switchStmt = malloc(sizeof(stmt));
-        memcpy(selection->switchStmt, &stmt, sizeof(stmt));
+        selection->switchStmt = ParserCopy(stmt);
 
         return (ParseRes){ .success = true };
     }
@@ -2986,6 +3284,7 @@ ParseRes parseSelectionStatement(TokenList *tokens, SelectionStatement *selectio
 ParseRes parseExpressionStatement(TokenList *tokens, ExpressionStatement *expression) {
     if (consumeIfTok(tokens, ';')) {
         expression->isEmpty = true;
+        g_kinds |= NodeKindBit(ExpressionStatement);
         return (ParseRes){ .success = true };
     }
 
@@ -3003,6 +3302,7 @@ ParseRes parseExpressionStatement(TokenList *tokens, ExpressionStatement *expres
 
     expression->isEmpty = false;
     expression->expr = expr;
+    g_kinds |= NodeKindBit(ExpressionStatement);
 
     return (ParseRes){ .success = true };
 }
@@ -3039,8 +3339,7 @@ ParseRes parseIterationStatement(TokenList *tokens, IterationStatement *iteratio
         if (!stmtRes.success)
             return stmtRes;
 
-        iteration->whileStmt = malloc(sizeof(stmt));
-        memcpy(iteration->whileStmt, &stmt, sizeof(stmt));
+        iteration->whileStmt = ParserCopy(stmt);
 
         return (ParseRes){ .success = true };
     }
@@ -3055,8 +3354,7 @@ ParseRes parseIterationStatement(TokenList *tokens, IterationStatement *iteratio
             return stmtRes;
 
         iteration->type = IterationStatement_DoWhile;
-        iteration->doStmt = malloc(sizeof(stmt));
-        memcpy(iteration->doStmt, &stmt, sizeof(stmt));
+        iteration->doStmt = ParserCopy(stmt);
 
         if (!consumeIfTok(tokens, Token_while)) {
             return (ParseRes) {
@@ -3119,7 +3417,7 @@ ParseRes parseIterationStatement(TokenList *tokens, IterationStatement *iteratio
             iteration->forInitialDeclaration = decl;
         }
         else {
-            tokens->pos = pos;
+            ParserBacktrack(tokens, pos);
 
             iteration->forHasInitialDeclaration = false;
 
@@ -3147,7 +3445,7 @@ ParseRes parseIterationStatement(TokenList *tokens, IterationStatement *iteratio
             iteration->forFinalExpr = expr;
         }
         else {
-            tokens->pos = preExprPos;
+            ParserBacktrack(tokens, preExprPos);
         }
 
         if (!consumeIfTok(tokens, ')')) {
@@ -3162,8 +3460,7 @@ ParseRes parseIterationStatement(TokenList *tokens, IterationStatement *iteratio
         if (!stmtRes.success)
             return stmtRes;
 
-        iteration->forStmt = malloc(sizeof(stmt));
-        memcpy(iteration->forStmt, &stmt, sizeof(stmt));
+        iteration->forStmt = ParserCopy(stmt);
 
         return (ParseRes){ .success = true };
     }
@@ -3288,8 +3585,9 @@ ParseRes parseAsmStatement(TokenList *tokens, AsmStatement *stmt) {
     return Succeed;
 }
 
-ParseRes parseStatement(TokenList *tokens, Statement *stmt) {
+static ParseRes parseStatementUntracked(TokenList *tokens, Statement *stmt) {
     size_t pos = tokens->pos;
+    ArenaMark mark = arena_mark(g_arena);
 
     LabeledStatement labeled = {0};
     if (parseLabeledStatement(tokens, &labeled).success) {
@@ -3298,18 +3596,19 @@ ParseRes parseStatement(TokenList *tokens, Statement *stmt) {
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // Parse compound statement
     CompoundStmt compound = {0};
     if (parseCompoundStmt(tokens, &compound).success) {
         stmt->type = Statement_Compound;
-        stmt->compound = malloc(sizeof(compound));
-        memcpy(stmt->compound, &compound, sizeof(compound));
+        stmt->compound = ParserCopy(compound);
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // Parse selection statement
     SelectionStatement selection = {0};
@@ -3319,7 +3618,8 @@ ParseRes parseStatement(TokenList *tokens, Statement *stmt) {
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // Parse iteration statement
     IterationStatement iteration = {0};
@@ -3329,7 +3629,8 @@ ParseRes parseStatement(TokenList *tokens, Statement *stmt) {
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // Parse jump statement
     JumpStatement jump = {0};
@@ -3339,7 +3640,8 @@ ParseRes parseStatement(TokenList *tokens, Statement *stmt) {
         return (ParseRes){ .success = true };
     }
 
-    tokens->pos = pos;
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
 
     // Parse expression statement
     ExpressionStatement expression = {0};
@@ -3358,205 +3660,958 @@ ParseRes parseStatement(TokenList *tokens, Statement *stmt) {
         return (ParseRes){ .success = true };
     }
 
-    return (ParseRes) {
-        .success = false,
-        .failMessage = "Didn't find any statements"
-    };
+    return (ParseRes) {
+        .success = false,
+        .failMessage = "Didn't find any statements"
+    };
+}
+
+// The node a statement holds. For loops always have their expression
+// statements, even the one a declaration takes the place of.
+static NodeKindMask statementKinds(Statement *stmt) {
+    switch (stmt->type) {
+    case Statement_Labeled:
+        return NodeKindBit(LabeledStatement);
+    case Statement_Compound:
+        return NodeKindBit(CompoundStmt);
+    case Statement_Expression:
+        return NodeKindBit(ExpressionStatement);
+    case Statement_Selection:
+        return NodeKindBit(SelectionStatement);
+    case Statement_Iteration:
+        return NodeKindBit(IterationStatement) |
+            NodeKindBit(ExpressionStatement);
+    case Statement_Jump:
+        return NodeKindBit(JumpStatement);
+    case Statement_Asm:
+        return NodeKindBit(AsmStatement);
+    default:
+        assert(false);
+        return 0;
+    }
+}
+
+ParseRes parseStatement(TokenList *tokens, Statement *stmt) {
+    NodeKindMask outerKinds = kinds_begin();
+    ParseRes res = parseStatementUntracked(tokens, stmt);
+    if (res.success)
+        g_kinds |= statementKinds(stmt);
+
+    stmt->kinds = kinds_end(outerKinds, NodeKindBit(Statement));
+
+    return res;
+}
+
+ParseRes parseBlockItem(TokenList *tokens, BlockItem *item) {
+    // either a declaration or statement
+    size_t pos = tokens->pos;
+    ArenaMark mark = arena_mark(g_arena);
+
+    Declaration decl = {0};
+    if (parseDeclaration(tokens, &decl).success) {
+        item->type = BlockItem_Declaration;
+        item->decl = decl;
+        return (ParseRes){ .success = true };
+    }
+
+    ParserBacktrack(tokens, pos);
+    parserRollback(mark);
+
+    Statement stmt = {0};
+    if (parseStatement(tokens, &stmt).success) {
+        item->type = BlockItem_Statement;
+        item->stmt = stmt;
+        return (ParseRes){ .success = true };
+    }
+
+    return (ParseRes){
+        .success = false,
+        .failMessage = "Expected either declaration or stmt in block item"
+    };
+}
+
+ParseRes parseBlockItemList(TokenList *tokens, BlockItemList *list) {
+    ListBuilder builder = listBuilder_init(sizeof(BlockItem));
+
+    ParseRes blockItemRes = {0};
+    do {
+
+        // Parse opt block item
+        size_t pos = tokens->pos;
+
+        BlockItem item = {0};
+        blockItemRes = parseBlockItem(tokens, &item);
+        if (!blockItemRes.success) {
+            ParserBacktrack(tokens, pos);
+            break;
+        }
+
+        listBuilder_appendLocal(&builder, item);
+    } while(blockItemRes.success);
+
+    list->list = parserFinishList(&builder, AstStats_BlockItem);
+
+    // Make sure we have at least one block item
+    if (list->list.size == 0) {
+        return (ParseRes) {
+            .success = false,
+            .failMessage = "Expected at least one block item in a block item list"
+        };
+    }
+
+    return (ParseRes){ .success = true };
+}
+
+static ParseRes parseBlockItems(TokenList *tokens, CompoundStmt *outStmt) {
+    BlockItemList list = {0};
+    ParseRes listRes = parseBlockItemList(tokens, &list);
+    if (!listRes.success)
+        return listRes;
+
+    if (!consumeIfTok(tokens, '}')) {
+        return (ParseRes) {
+            .success = false,
+            .failMessage = "Expected } after block item list in compound stmt"
+        };
+    }
+
+    // TODO: Make this into a macro?
+    outStmt->closeBracket = tokens->tokens + tokens->pos - 1;
+
+    outStmt->isEmpty = false;
+    outStmt->blockItemList = list;
+    return (ParseRes){ .success = true };
+}
+
+ParseRes parseCompoundStmt(TokenList *tokens, CompoundStmt *outStmt) {
+    if (!consumeIfTok(tokens, '{')) {
+        return (ParseRes) {
+            .success = false,
+            .failMessage = "Expected { to start compound statement"
+        };
+    }
+
+    // Set hooks back to original token
+    // TODO: Make this into a macro?
+    outStmt->openBracket = tokens->tokens + tokens->pos - 1;
+
+    if (consumeIfTok(tokens, '}')) {
+        // TODO: Make this into a macro?
+        outStmt->closeBracket = tokens->tokens + tokens->pos - 1;
+
+        outStmt->isEmpty = true;
+        g_kinds |= NodeKindBit(CompoundStmt);
+        return (ParseRes){ .success = true };
+    }
+
+    // Declarations in the block go away with it, whether or not it parses
+    pushScope();
+    ParseRes res = parseBlockItems(tokens, outStmt);
+    popScope();
+
+    if (res.success) {
+        g_kinds |= NodeKindBit(CompoundStmt) | NodeKindBit(BlockItemList) |
+            NodeKindBit(BlockItem);
+    }
+
+    return res;
+}
+
+// Parameter names hide typedef names while the function's body is parsed
+static void declareParameters(Declarator *declarator) {
+    DirectDeclarator *direct = &(declarator->directDeclarator);
+    while (direct->type == DirectDeclarator_ParenDeclarator)
+        direct = &(direct->declarator->directDeclarator);
+
+    if (direct->postDirectDeclarators.size == 0)
+        return;
+
+    PostDirectDeclarator *post =
+        astList_get(direct->postDirectDeclarators, PostDirectDeclarator, 0);
+    if (post->type != PostDirectDeclarator_Paren ||
+        post->parenType != PostDirectDeclaratorParen_ParamTypelist)
+    {
+        return;
+    }
+
+    astList_foreach(post->parenParamTypeList.paramDecls, ParameterDeclaration, param) {
+        if (!param->hasDeclarator)
+            continue;
+
+        String name = directDeclarator_getName(param->declarator->directDeclarator);
+        if (name.length > 0)
+            declareName(name, Symbol_Ordinary);
+    }
+}
+
+static ParseRes parseFuncDefBody(TokenList *tokens, FuncDef *outDef);
+
+// Finishes a function definition once its specifiers and declarator have been
+// parsed
+static ParseRes parseFuncDefAfterDeclarator(TokenList *tokens,
+    DeclarationSpecifierList specifiers, Declarator declarator,
+    FuncDef *outDef)
+{
+    outDef->specifiers = specifiers;
+    outDef->declarator = declarator;
+
+    // The parameters and old style declarations are in the same scope as the
+    // body's declarations
+    pushScope();
+    declareParameters(&declarator);
+    ParseRes res = parseFuncDefBody(tokens, outDef);
+    popScope();
+
+    return res;
+}
+
+ParseRes parseFuncDef(TokenList *tokens, FuncDef *outDef) {
+    outDef->startTok = tokens->tokens + tokens->pos;
+
+    // Parse Declaration Specifiers
+    DeclarationSpecifierList specifierList = {0};
+    ParseRes specifierRes = parseDeclarationSpecifierList(
+        tokens, &specifierList);
+    if (!specifierRes.success) {
+        return specifierRes;
+    }
+
+    // Parse Declarator
+    Declarator declarator = {0};
+    ParseRes declRes = parseDeclarator(tokens, &declarator);
+    if (!declRes.success)
+        return declRes;
+
+    return parseFuncDefAfterDeclarator(tokens, specifierList, declarator,
+        outDef);
+}
+
+static ParseRes parseFuncDefBody(TokenList *tokens, FuncDef *outDef) {
+    // Parse Opt Declaration List
+    ListBuilder builder = listBuilder_init(sizeof(Declaration));
+
+    ParseRes listRes = {0};
+    do {
+
+        size_t pos = tokens->pos;
+
+        Declaration declaration = {0};
+        listRes = parseDeclaration(tokens, &declaration);
+        if (!listRes.success) {
+            ParserBacktrack(tokens, pos);
+            break;
+        }
+
+        listBuilder_appendLocal(&builder, declaration);
+    } while(listRes.success);
+
+    outDef->declarations = parserFinishList(&builder, AstStats_Declaration);
+
+    if (g_deferred != NULL && peekTok(tokens).type == '{') {
+        size_t pos = tokens->pos;
+        skipBalanced(tokens);
+
+        Token *closeBracket = tokens->tokens + tokens->pos - 1;
+        if (closeBracket->type != '}') {
+            return (ParseRes) {
+                .success = false,
+                .failMessage = "Expected } to end function body"
+            };
+        }
+
+        outDef->stmt.openBracket = tokens->tokens + pos;
+        outDef->stmt.closeBracket = closeBracket;
+        outDef->deferred = (DeferredBody){
+            .bodies = g_deferred,
+            .pos = pos,
+            .numFileNames = g_numFileNames,
+        };
+
+        outDef->endTok = closeBracket;
+
+        return (ParseRes){ .success = true };
+    }
+
+    // Parse Compound Statement
+    CompoundStmt stmt = {0};
+    ParseRes stmtRes = parseCompoundStmt(tokens, &stmt);
+    if (!stmtRes.success)
+        return stmtRes;
+
+    outDef->stmt = stmt;
+
+    outDef->endTok = tokens->tokens + tokens->pos - 1;
+
+    return (ParseRes){ .success = true };
+}
+
+CompoundStmt *funcDef_getBody(FuncDef *def) {
+    struct DeferredBodies *bodies = def->deferred.bodies;
+    if (bodies == NULL)
+        return &(def->stmt);
+
+    def->deferred.bodies = NULL;
+
+    replayFileScope(&(bodies->fileNames), def->deferred.numFileNames,
+        &(bodies->symbols), &(bodies->numReplayed));
+
+    Arena *prevArena = g_arena;
+    SymbolTable *prevSymbols = g_symbols;
+    struct DeferredBodies *prevDeferred = g_deferred;
+    FileScopeLog *prevLog = g_fileScopeLog;
+    AstStats *prevStats = g_stats;
+    bool prevSawStmtExpr = g_sawStmtExpr;
+    NodeKindMask prevKinds = g_kinds;
+
+    g_arena = &(bodies->arena);
+    g_symbols = &(bodies->symbols);
+    g_deferred = NULL;
+    g_fileScopeLog = NULL;
+    g_stats = g_astStats;
+    g_sawStmtExpr = false;
+
+    TokenList tokens = bodies->tokens;
+    tokens.pos = def->deferred.pos;
+
+    // Same scope as parseFuncDefAfterDeclarator sets up
+    pushScope();
+    declareParameters(&(def->declarator));
+    astList_foreach(def->declarations, Declaration, decl) {
+        declareDeclarationNames(decl);
+    }
+
+    CompoundStmt stmt = {0};
+    ParseRes res = parseCompoundStmt(&tokens, &stmt);
+    popScope();
+
+    bodies->sawStmtExpr = bodies->sawStmtExpr || g_sawStmtExpr;
+
+    g_arena = prevArena;
+    g_symbols = prevSymbols;
+    g_deferred = prevDeferred;
+    g_fileScopeLog = prevLog;
+    g_stats = prevStats;
+    g_sawStmtExpr = prevSawStmtExpr;
+    g_kinds = prevKinds;
+
+    if (!res.success) {
+        // Nothing else is building a list while rules run
+        listBuilder_reset();
+
+        Token tok = tokens.tokens[def->deferred.pos];
+        logError("Parser: %s:%ld: %s\n  Current token position: %ld\n",
+            tok.fileName, tok.line, res.failMessage, tokens.pos);
+
+        bodies->failed = true;
+        def->stmt.isEmpty = true;
+        return &(def->stmt);
+    }
+
+    def->stmt = stmt;
+    return &(def->stmt);
+}
+
+// Function definitions and declarations start the same way, so the specifiers
+// and first declarator are parsed once and the token after them decides which
+// one this is
+static ParseRes parseExternalDeclUntracked(TokenList *tokens,
+    ExternalDecl *outDecl)
+{
+    ParseRes fail = {
+        .success = false,
+        .failMessage = "Couldn't find a function definition or declaration"
+    };
+
+    // Static asserts can only be declarations
+    if (peekTok(tokens).type == Token_staticAssert) {
+        Declaration decl = {0};
+        if (!parseDeclaration(tokens, &decl).success)
+            return fail;
+
+        outDecl->type = ExternalDecl_Decl;
+        outDecl->decl = decl;
+        return (ParseRes){ .success = true };
+    }
+
+    Token *startTok = tokens->tokens + tokens->pos;
+
+    DeclarationSpecifierList specifiers = {0};
+    if (!parseDeclarationSpecifierList(tokens, &specifiers).success)
+        return fail;
+
+    // Without a declarator, this can only be something like a struct
+    // declaration
+    size_t pos = tokens->pos;
+    ArenaMark mark = arena_mark(g_arena);
+
+    Declarator declarator = {0};
+    if (!parseDeclarator(tokens, &declarator).success) {
+        ParserBacktrack(tokens, pos);
+        parserRollback(mark);
+
+        Declaration decl = {0};
+        if (!parseDeclarationAfterSpecifiers(tokens, specifiers, NULL, &decl).success)
+            return fail;
+
+        outDecl->type = ExternalDecl_Decl;
+        outDecl->decl = decl;
+        return (ParseRes){ .success = true };
+    }
+
+    // Only a declaration can go on after its first declarator with one of
+    // these. Anything else has to be a function body or old style parameter
+    // declarations.
+    TokenType next = peekTok(tokens).type;
+    if (next == ';' || next == ',' || next == '=' || next == Token_asm) {
+        Declaration decl = {0};
+        if (!parseDeclarationAfterSpecifiers(tokens, specifiers, &declarator, &decl).success)
+            return fail;
+
+        outDecl->type = ExternalDecl_Decl;
+        outDecl->decl = decl;
+        return (ParseRes){ .success = true };
+    }
+
+    FuncDef def = { .startTok = startTok };
+    if (!parseFuncDefAfterDeclarator(tokens, specifiers, declarator, &def).success)
+        return fail;
+
+    outDecl->type = ExternalDecl_FuncDef;
+    outDecl->func = def;
+    return (ParseRes){ .success = true };
+}
+
+ParseRes parseExternalDecl(TokenList *tokens, ExternalDecl *outDecl) {
+    NodeKindMask outerKinds = kinds_begin();
+    ParseRes res = parseExternalDeclUntracked(tokens, outDecl);
+    NodeKindMask kinds = kinds_end(outerKinds, 0);
+
+    // Declarations here are parsed in pieces, starting before
+    // parseDeclarationAfterSpecifiers, so their kinds are only known here
+    if (res.success && outDecl->type == ExternalDecl_Decl)
+        outDecl->decl.kinds = kinds;
+
+    return res;
+}
+
+// Header skimming
+
+static SkimFilter g_skimFilter;
+
+// Tokens from the same file share the name, so the filter is only asked again
+// when the file changes. Reset for every parse since the names are freed with
+// the tokens.
+static _Thread_local char *g_lastSkimFile;
+static _Thread_local bool g_lastSkimResult;
+
+void setHeaderSkimming(SkimFilter filter) {
+    g_skimFilter = filter;
+}
+
+static bool isSkimmedFile(char *fileName) {
+    if (g_skimFilter == NULL)
+        return false;
+
+    if (fileName != g_lastSkimFile) {
+        g_lastSkimFile = fileName;
+        g_lastSkimResult = g_skimFilter(fileName);
+    }
+
+    return g_lastSkimResult;
+}
+
+// Skips over one external declaration without building it. Only typedefs
+// matter to the code after a skimmed region. Those are rare enough next to
+// prototypes that they go through the real parser, which gets their names
+// right, and their nodes are thrown away. Tag names don't need tracking since
+// the struct, union and enum keywords always introduce them.
+static ParseRes skimExternalDecl(TokenList *tokens) {
+    size_t start = tokens->pos;
+
+    bool isTypedef = false;
+    bool hasInitializer = false;
+    TokenType prevType = 0;
+
+    while (tokens->pos < tokens->numTokens) {
+        TokenType type = peekTok(tokens).type;
+
+        if (type == ';') {
+            consumeTok(tokens);
+            break;
+        }
+
+        if (type == Token_typedef)
+            isTypedef = true;
+        else if (type == '=')
+            hasInitializer = true;
+
+        if (type == '{' && prevType == ')' && !hasInitializer) {
+            // A function body ends the definition
+            skipBalanced(tokens);
+            break;
+        }
+
+        if (type == '{' || type == '(' || type == '[') {
+            // Struct bodies, parameter lists and initializers
+            skipBalanced(tokens);
+            prevType = tokens->tokens[tokens->pos - 1].type;
+            continue;
+        }
+
+        consumeTok(tokens);
+        prevType = type;
+    }
+
+    if (!isTypedef)
+        return (ParseRes){ .success = true };
+
+    tokens->pos = start;
+    ArenaMark mark = arena_mark(g_arena);
+
+    Declaration decl = {0};
+    ParseRes res = parseDeclaration(tokens, &decl);
+    parserRollback(mark);
+
+    return res;
+}
+
+static void deferredBodies_free(struct DeferredBodies *bodies) {
+    if (bodies == NULL)
+        return;
+
+    arena_release(&(bodies->arena));
+    symbolTable_cleanup(&(bodies->symbols));
+    free(bodies->fileNames.names);
+    free(bodies);
+}
+
+static struct DeferredBodies *deferredBodies_new(TokenList *tokens) {
+    if (!g_deferBodies)
+        return NULL;
+
+    struct DeferredBodies *bodies = calloc(1, sizeof(struct DeferredBodies));
+    assert(bodies != NULL);
+    bodies->tokens = *tokens;
+
+    return bodies;
+}
+
+static void declareBuiltins(void) {
+    // TODO: specify these in the config file
+    declareSymbol(symbol_intern(astr("__builtin_va_list")), Symbol_Typedef);
+    declareSymbol(symbol_intern(astr("_Float128")), Symbol_Typedef);
+}
+
+static bool parseTokensSequential(TokenList *tokens, TranslationUnit *outUnit) {
+    SymbolTable symbols = {0};
+    g_symbols = &symbols;
+
+    struct DeferredBodies *deferred = deferredBodies_new(tokens);
+    g_deferred = deferred;
+    g_fileScopeLog = deferred == NULL ? NULL : &(deferred->fileNames);
+    g_numFileNames = 0;
+
+    declareBuiltins();
+
+    g_arena = &outUnit->arena;
+    memo_init(0, tokens->numTokens);
+
+    tokens->pos = 0;
+    g_lastSkimFile = NULL;
+
+    ListBuilder builder = listBuilder_init(sizeof(ExternalDecl));
+
+    while (tokens->pos < tokens->numTokens) {
+        size_t pos = tokens->pos;
+
+        if (isSkimmedFile(tokens->tokens[pos].fileName)) {
+            if (skimExternalDecl(tokens).success)
+                continue;
+
+            // Let the full parse report the error
+            ParserBacktrack(tokens, pos);
+        }
+
+        ExternalDecl decl = {0};
+        ParseRes res = parseExternalDecl(tokens, &decl);
+        if (!res.success) {
+            tokens->pos = pos;
+            Token tok = tokens->tokens[tokens->pos];
+            logError("Parser: %s:%ld: %s\n  Current token position: %ld\n", tok.fileName, tok.line, res.failMessage, tokens->pos);
+
+            memo_cleanup();
+            listBuilder_reset();
+            symbolTable_cleanup(&symbols);
+            deferredBodies_free(deferred);
+            translationUnit_cleanup(*outUnit);
+            *outUnit = (TranslationUnit){0};
+            g_arena = NULL;
+            g_symbols = NULL;
+            g_deferred = NULL;
+            g_fileScopeLog = NULL;
+            return false;
+        }
+
+        listBuilder_appendLocal(&builder, decl);
+    }
+
+    outUnit->externalDecls = parserFinishList(&builder, AstStats_ExternalDecl);
+    outUnit->deferredBodies = deferred;
+
+    memo_cleanup();
+    symbolTable_cleanup(&symbols);
+    g_arena = NULL;
+    g_symbols = NULL;
+    g_deferred = NULL;
+    g_fileScopeLog = NULL;
+    return true;
 }
 
-ParseRes parseBlockItem(TokenList *tokens, BlockItem *item) {
-    // either a declaration or statement
-    size_t pos = tokens->pos;
+// Parallel parsing
+//
+// A sequential pre-pass skims the tokens to split them into external
+// declarations, logging the file scope names as it goes. Typedefs are the only
+// thing one external declaration needs from the ones before it, so each one
+// can then be parsed on its own with the names replayed up to its start.
+// Workers take chunks of declarations in order, which keeps their replays
+// moving forward, and fill arenas that are handed to the unit at the end.
+//
+// The skimmer finds where declarations end by matching brackets, which some
+// unusual code (like old style parameter declarations) fools. A declaration
+// that doesn't parse to exactly where the pre-pass said it ends fails the
+// whole parallel parse, and the file is parsed again sequentially, which also
+// reports real errors the same way as always.
+
+#define SegmentsPerChunk 64
+
+static size_t g_parseThreads = 1;
+
+void setParseThreads(size_t numThreads) {
+    g_parseThreads = numThreads == 0 ? 1 : numThreads;
+}
+
+typedef struct {
+    size_t start;
+    size_t end;
+    // Logged file scope names declared before the segment
+    size_t numFileNames;
+    bool skimmed;
+} Segment;
+
+typedef struct {
+    Token *tokens;
+    FileScopeLog *fileNames;
+    struct DeferredBodies *deferred;
+
+    size_t numSegments;
+    Segment *segments;
+    // Indexed by segment
+    ExternalDecl *decls;
+
+    atomic_size_t nextChunk;
+    atomic_bool failed;
+} ParallelParse;
+
+typedef struct {
+    ParallelParse *parse;
+    pthread_t thread;
+    bool started;
+    Arena arena;
+    AstStats stats;
+    bool sawStmtExpr;
+} ParseWorker;
+
+static void *parseWorker_run(void *data) {
+    ParseWorker *worker = data;
+    ParallelParse *parse = worker->parse;
+
+    SymbolTable symbols = {0};
+    size_t numReplayed = 0;
+
+    // The first worker runs on the thread that started the parse
+    AstStats *prevStats = g_stats;
+    g_stats = g_astStats == NULL ? NULL : &(worker->stats);
+
+    g_arena = &(worker->arena);
+    g_symbols = &symbols;
+    g_deferred = parse->deferred;
+    // The pre-pass already logged every file scope name
+    g_fileScopeLog = NULL;
+
+    while (!atomic_load(&(parse->failed))) {
+        size_t first = atomic_fetch_add(&(parse->nextChunk), 1) * SegmentsPerChunk;
+        if (first >= parse->numSegments)
+            break;
 
-    Declaration decl = {0};
-    if (parseDeclaration(tokens, &decl).success) {
-        item->type = BlockItem_Declaration;
-        item->decl = decl;
-        return (ParseRes){ .success = true };
-    }
+        size_t last = first + SegmentsPerChunk;
+        if (last > parse->numSegments)
+            last = parse->numSegments;
 
-    tokens->pos = pos;
+        for (size_t i = first; i < last; i++) {
+            Segment *segment = parse->segments + i;
+            if (segment->skimmed)
+                continue;
 
-    Statement stmt = {0};
-    if (parseStatement(tokens, &stmt).success) {
-        item->type = BlockItem_Statement;
-        item->stmt = stmt;
-        return (ParseRes){ .success = true };
+            replayFileScope(parse->fileNames, segment->numFileNames, &symbols,
+                &numReplayed);
+            g_numFileNames = segment->numFileNames;
+
+            // Tokens past the segment look like the end of the file
+            TokenList tokens = {
+                .numTokens = segment->end,
+                .pos = segment->start,
+                .tokens = parse->tokens,
+            };
+
+            memo_init(segment->start, segment->end - segment->start);
+            ParseRes res = parseExternalDecl(&tokens, parse->decls + i);
+            memo_cleanup();
+
+            if (!res.success || tokens.pos != segment->end) {
+                atomic_store(&(parse->failed), true);
+                break;
+            }
+        }
     }
 
-    return (ParseRes){
-        .success = false,
-        .failMessage = "Expected either declaration or stmt in block item"
-    };
+    listBuilder_release();
+    symbolTable_cleanup(&symbols);
+    g_arena = NULL;
+    g_symbols = NULL;
+    g_deferred = NULL;
+    g_stats = prevStats;
+    worker->sawStmtExpr = g_sawStmtExpr;
+
+    return NULL;
 }
 
-ParseRes parseBlockItemList(TokenList *tokens, BlockItemList *list) {
-    ParseRes blockItemRes = {0};
-    do {
+// Splits the tokens into one segment per external declaration. Returns false
+// if the skimmer couldn't get through them.
+static bool splitSegments(TokenList *tokens, FileScopeLog *log,
+    size_t *outNumSegments, Segment **outSegments)
+{
+    SymbolTable symbols = {0};
+    // Typedefs are parsed to get their names, but their nodes aren't kept
+    Arena scratch = {0};
 
-        // Parse opt block item
-        size_t pos = tokens->pos;
+    // Nothing parsed here is part of the tree the stats are for
+    AstStats *prevStats = g_stats;
 
-        BlockItem item = {0};
-        blockItemRes = parseBlockItem(tokens, &item);
-        if (!blockItemRes.success) {
-            tokens->pos = pos;
+    g_symbols = &symbols;
+    g_arena = &scratch;
+    g_stats = NULL;
+    g_fileScopeLog = log;
+    g_numFileNames = 0;
+    g_lastSkimFile = NULL;
+
+    declareBuiltins();
+
+    size_t numSegments = 0;
+    size_t capacity = 0;
+    Segment *segments = NULL;
+
+    bool success = true;
+
+    tokens->pos = 0;
+    while (tokens->pos < tokens->numTokens) {
+        Segment segment = {
+            .start = tokens->pos,
+            .numFileNames = g_numFileNames,
+            .skimmed = isSkimmedFile(tokens->tokens[tokens->pos].fileName),
+        };
+
+        if (!skimExternalDecl(tokens).success) {
+            success = false;
             break;
         }
 
-        sll_appendLocal(&(list->list), item);
-    } while(blockItemRes.success);
+        segment.end = tokens->pos;
 
-    // Make sure we have at least one block item
-    if (list->list.size == 0) {
-        return (ParseRes) {
-            .success = false,
-            .failMessage = "Expected at least one block item in a block item list"
-        };
+        if (numSegments == capacity) {
+            capacity = capacity == 0 ? 1024 : capacity * 2;
+            segments = realloc(segments, capacity * sizeof(Segment));
+            assert(segments != NULL);
+        }
+
+        segments[numSegments++] = segment;
     }
 
-    return (ParseRes){ .success = true };
-}
+    arena_release(&scratch);
+    symbolTable_cleanup(&symbols);
+    g_symbols = NULL;
+    g_arena = NULL;
+    g_stats = prevStats;
+    g_fileScopeLog = NULL;
 
-ParseRes parseCompoundStmt(TokenList *tokens, CompoundStmt *outStmt) {
-    if (!consumeIfTok(tokens, '{')) {
-        return (ParseRes) {
-            .success = false,
-            .failMessage = "Expected { to start compound statement"
-        };
+    if (!success) {
+        free(segments);
+        return false;
     }
 
-    // Set hooks back to original token
-    // TODO: Make this into a macro?
-    outStmt->openBracket = tokens->tokens + tokens->pos - 1;
+    *outNumSegments = numSegments;
+    *outSegments = segments;
+    return true;
+}
 
-    if (consumeIfTok(tokens, '}')) {
-        // TODO: Make this into a macro?
-        outStmt->closeBracket = tokens->tokens + tokens->pos - 1;
+static bool parseTokensParallel(TokenList *tokens, TranslationUnit *outUnit) {
+    struct DeferredBodies *deferred = deferredBodies_new(tokens);
 
-        outStmt->isEmpty = true;
-        return (ParseRes){ .success = true };
-    }
+    // Deferred bodies need the same log to rebuild their names later
+    FileScopeLog localLog = {0};
+    FileScopeLog *log = deferred == NULL ? &localLog : &(deferred->fileNames);
 
-    BlockItemList list = {0};
-    ParseRes listRes = parseBlockItemList(tokens, &list);
-    if (!listRes.success)
-        return listRes;
+    ParallelParse parse = {
+        .tokens = tokens->tokens,
+        .fileNames = log,
+        .deferred = deferred,
+    };
 
-    if (!consumeIfTok(tokens, '}')) {
-        return (ParseRes) {
-            .success = false,
-            .failMessage = "Expected } after block item list in compound stmt"
-        };
+    if (!splitSegments(tokens, log, &parse.numSegments, &parse.segments)) {
+        free(localLog.names);
+        deferredBodies_free(deferred);
+        return false;
     }
 
-    // TODO: Make this into a macro?
-    outStmt->closeBracket = tokens->tokens + tokens->pos - 1;
+    parse.decls = calloc(parse.numSegments, sizeof(ExternalDecl));
+    assert(parse.numSegments == 0 || parse.decls != NULL);
 
-    outStmt->isEmpty = false;
-    outStmt->blockItemList = list;
-    return (ParseRes){ .success = true };
-}
+    size_t numChunks = (parse.numSegments + SegmentsPerChunk - 1) / SegmentsPerChunk;
+    size_t numWorkers = g_parseThreads < numChunks ? g_parseThreads : numChunks;
+    if (numWorkers == 0)
+        numWorkers = 1;
 
-ParseRes parseFuncDef(TokenList *tokens, FuncDef *outDef) {
-    outDef->startTok = tokens->tokens + tokens->pos;
+    ParseWorker *workers = calloc(numWorkers, sizeof(ParseWorker));
+    assert(workers != NULL);
 
-    // Parse Declaration Specifiers
-    DeclarationSpecifierList specifierList = {0};
-    ParseRes specifierRes = parseDeclarationSpecifierList(
-        tokens, &specifierList);
-    if (!specifierRes.success) {
-        return specifierRes;
+    // This thread is the first worker. If a thread can't be started, the
+    // others just end up with more chunks.
+    for (size_t i = 0; i < numWorkers; i++) {
+        workers[i].parse = &parse;
+        if (i > 0) {
+            workers[i].started = pthread_create(&(workers[i].thread), NULL,
+                parseWorker_run, workers + i) == 0;
+        }
     }
-    outDef->specifiers = specifierList;
 
-    // Parse Declarator
-    Declarator declarator = {0};
-    ParseRes declRes = parseDeclarator(tokens, &declarator);
-    if (!declRes.success)
-        return declRes;
+    parseWorker_run(workers);
 
-    outDef->declarator = declarator;
+    for (size_t i = 1; i < numWorkers; i++) {
+        if (workers[i].started)
+            pthread_join(workers[i].thread, NULL);
+    }
 
-    // Parse Opt Declaration List
-    ParseRes listRes = {0};
-    do {
+    bool success = !atomic_load(&(parse.failed));
 
-        size_t pos = tokens->pos;
+    // A failed parse is done again sequentially, which counts on its own
+    for (size_t i = 0; i < numWorkers; i++) {
+        if (success && g_stats != NULL)
+            astStats_merge(g_stats, &(workers[i].stats));
 
-        Declaration declaration = {0};
-        listRes = parseDeclaration(tokens, &declaration);
-        if (!listRes.success) {
-            tokens->pos = pos;
-            break;
+        astStats_cleanup(&(workers[i].stats));
+        g_sawStmtExpr = g_sawStmtExpr || workers[i].sawStmtExpr;
+    }
+
+    if (success) {
+        g_arena = &(outUnit->arena);
+
+        ListBuilder builder = listBuilder_init(sizeof(ExternalDecl));
+        for (size_t i = 0; i < parse.numSegments; i++) {
+            if (!parse.segments[i].skimmed)
+                listBuilder_append(&builder, parse.decls + i);
         }
 
-        sll_appendLocal(&(outDef->declarations), declaration);
-    } while(listRes.success);
+        outUnit->externalDecls = parserFinishList(&builder,
+            AstStats_ExternalDecl);
+        outUnit->deferredBodies = deferred;
 
-    // Parse Compound Statement
-    CompoundStmt stmt = {0};
-    ParseRes stmtRes = parseCompoundStmt(tokens, &stmt);
-    if (!stmtRes.success)
-        return stmtRes;
+        for (size_t i = 0; i < numWorkers; i++)
+            arena_absorb(&(outUnit->arena), &(workers[i].arena));
 
-    outDef->stmt = stmt;
+        g_arena = NULL;
+    }
+    else {
+        for (size_t i = 0; i < numWorkers; i++)
+            arena_release(&(workers[i].arena));
 
-    outDef->endTok = tokens->tokens + tokens->pos - 1;
+        deferredBodies_free(deferred);
+    }
 
-    return (ParseRes){ .success = true };
+    free(workers);
+    free(parse.decls);
+    free(parse.segments);
+    free(localLog.names);
+
+    return success;
 }
 
-ParseRes parseExternalDecl(TokenList *tokens, ExternalDecl *outDecl) {
-    // Parse opt function definition
-    size_t pos = tokens->pos;
-    FuncDef def = {0};
-    ParseRes res = parseFuncDef(tokens, &def);
-    if (res.success) {
-        outDecl->type = ExternalDecl_FuncDef;
-        outDecl->func = def;
-        return res;
-    }
-    tokens->pos = pos;
+bool parseTokens(TokenList *tokens, TranslationUnit *outUnit) {
+    g_stats = g_astStats;
+    g_sawStmtExpr = false;
 
-    // Parse declaration
-    Declaration decl = {0};
-    ParseRes declRes = parseDeclaration(tokens, &decl);
-    if (declRes.success) {
-        outDecl->type = ExternalDecl_Decl;
-        outDecl->decl = decl;
-        return (ParseRes){ .success = true };
+    bool success = (g_parseThreads > 1 &&
+        parseTokensParallel(tokens, outUnit)) ||
+        parseTokensSequential(tokens, outUnit);
+
+    if (success) {
+        outUnit->index = malloc(sizeof(AstIndex));
+        assert(outUnit->index != NULL);
+
+        // Deferred bodies only get listed once something asks for them
+        astIndex_build(outUnit->index, *outUnit,
+            outUnit->deferredBodies == NULL, g_sawStmtExpr);
     }
 
-    return (ParseRes) {
-        .success = false,
-        .failMessage = "Couldn't find a function definition or declaration"
-    };
+    g_stats = NULL;
+    return success;
 }
 
-bool parseTokens(TokenList *tokens, TranslationUnit *outUnit) {
-    // TODO: specify these in the config file
-    typedefTable_add(&g_typedefTable, astr("__builtin_va_list"));
-    typedefTable_add(&g_typedefTable, astr("_Float128"));
+AstIndex *translationUnit_getIndex(TranslationUnit unit, bool withBodies) {
+    AstIndex *index = unit.index;
+    if (!withBodies || index->hasBodies)
+        return index;
 
-    tokens->pos = 0;
+    // The bodies are parsed first to know if any has a statement expression
+    translationUnit_parseBodies(unit);
+    translationUnit_restartIndex(unit);
+    traverseEvents(&unit, false, astIndex_visit, index);
 
-    while (tokens->pos < tokens->numTokens) {
-        size_t pos = tokens->pos;
+    return index;
+}
 
-        ExternalDecl decl = {0};
-        ParseRes res = parseExternalDecl(tokens, &decl);
-        if (!res.success) {
-            tokens->pos = pos;
-            Token tok = tokens->tokens[tokens->pos];
-            logError("Parser: %s:%ld: %s\n  Current token position: %ld\n", tok.fileName, tok.line, res.failMessage, tokens->pos);
-            return false;
-        }
+AstIndex *translationUnit_restartIndex(TranslationUnit unit) {
+    AstIndex *index = unit.index;
+    if (index->hasBodies)
+        return NULL;
+
+    bool hasStmtExprs = index->hasStmtExprs ||
+        (unit.deferredBodies != NULL && unit.deferredBodies->sawStmtExpr);
+
+    astIndex_cleanup(index);
+    astIndex_start(index, hasStmtExprs);
+
+    return index;
+}
+
+bool translationUnit_parseBodies(TranslationUnit unit) {
+    if (unit.deferredBodies == NULL)
+        return true;
 
-        sll_appendLocal(&(outUnit->externalDecls), decl);
+    AstIndex *index = unit.index;
+    for (size_t i = 0; i < index->numFuncDefs; i++) {
+        funcDef_getBody(index->funcDefs[i]);
     }
 
-    return true;
+    return !unit.deferredBodies->failed;
+}
+
+void translationUnit_cleanup(TranslationUnit unit) {
+    arena_release(&unit.arena);
+    deferredBodies_free(unit.deferredBodies);
+
+    if (unit.index != NULL) {
+        astIndex_cleanup(unit.index);
+        free(unit.index);
+    }
 }
 
 #define BaseIndent 2
@@ -3594,8 +4649,7 @@ void printDesignator(Designator designator, uint64_t indent) {
 void printDesignation(Designation desig, uint64_t indent) {
     printIndent(indent);
     printDebug("Designation: %ld\n", desig.list.size);
-    sll_foreach(desig.list, node) {
-        Designator *designator = slNode_getData(node);
+    astList_foreach(desig.list, Designator, designator) {
         printDesignator(*designator, indent + BaseIndent);
     }
 }
@@ -3620,8 +4674,7 @@ void printDesignationAndInitializer(DesignationAndInitializer desig, uint64_t in
 void printInitializerList(InitializerList list, uint64_t indent) {
     printIndent(indent);
     printDebug("Initializer List: %ld\n", list.list.size);
-    sll_foreach(list.list, node) {
-        DesignationAndInitializer *desig = slNode_getData(node);
+    astList_foreach(list.list, DesignationAndInitializer, desig) {
         printDesignationAndInitializer(*desig, indent + BaseIndent);
     }
 }
@@ -3646,8 +4699,7 @@ void printGenericSelection(GenericSelection generic, uint64_t indent) {
 
     printIndent(indent);
     printDebug("Association List: %ld\n", generic.associations.size);
-    sll_foreach(generic.associations, node) {
-        GenericAssociation *assoc = slNode_getData(node);
+    astList_foreach(generic.associations, GenericAssociation, assoc) {
         printGenericAssociation(*assoc, indent + BaseIndent);
     }
 }
@@ -3702,8 +4754,7 @@ void printPrimaryExpr(PrimaryExpr expr, uint64_t indent) {
 void printArgExprList(ArgExprList args, uint64_t indent) {
     printIndent(indent);
     printDebug("Arg Expr List: %ld\n", args.list.size);
-    sll_foreach(args.list, node) {
-        AssignExpr *expr = slNode_getData(node);
+    astList_foreach(args.list, AssignExpr, expr) {
         printAssignExpr(*expr, indent + BaseIndent);
     }
 }
@@ -3765,8 +4816,7 @@ void printPostfixExpr(PostfixExpr expr, uint64_t indent) {
         assert(false);
     }
 
-    sll_foreach(expr.postfixOps, node) {
-        PostfixOp *op = slNode_getData(node);
+    astList_foreach(expr.postfixOps, PostfixOp, op) {
         printPostfixOp(*op, indent);
     }
 }
@@ -3871,184 +4921,42 @@ void printCastExpr(CastExpr cast, uint64_t indent) {
     }
 }
 
-void printMultiplicativeExpr(MultiplicativeExpr expr, uint64_t indent) {
-    printCastExpr(expr.baseExpr, indent);
-    sll_foreach(expr.postExprs, node) {
-        MultiplicativePost *post = slNode_getData(node);
-        printIndent(indent + BaseIndent);
-
-        if (post->op == Multiplicative_Mul) {
-            printDebug("*\n");
-        }
-        else if (post->op == Multiplicative_Div) {
-            printDebug("/\n");
-        }
-        else if (post->op == Multiplicative_Mod) {
-            printDebug("%%\n");
-        }
-        else {
-            assert(false);
-        }
-        printCastExpr(post->expr, indent + BaseIndent);
-    }
-}
-
-// FIXME: Fix the way we print out binary exprs.
-// Currently, we print the left side without knowing if there
-// is an operation
-void printAdditiveExpr(AdditiveExpr expr, uint64_t indent) {
-    printMultiplicativeExpr(expr.baseExpr, indent);
-    sll_foreach(expr.postExprs, node) {
-        AdditivePost *post = slNode_getData(node);
-        printIndent(indent + BaseIndent);
-
-        if (post->op == Additive_Add) {
-            printDebug("+\n");
-        }
-        else if (post->op == Additive_Sub) {
-            printDebug("-\n");
-        }
-        else {
-            assert(false);
-        }
-        printMultiplicativeExpr(post->expr, indent + BaseIndent);
-    }
-}
-
-void printShiftExpr(ShiftExpr expr, uint64_t indent) {
-    printAdditiveExpr(expr.baseExpr, indent);
-    sll_foreach(expr.postExprs, node) {
-        ShiftPost *post = slNode_getData(node);
-        if (node->next != NULL) {
-        // if (i != expr.numPostExprs - 1) {
-            printIndent(indent + BaseIndent);
-
-            if (post->op == Shift_Left) {
-                printDebug("<<\n");
-            }
-            else if (post->op == Shift_Right) {
-                printDebug(">>\n");
-            }
-            else {
-                assert(false);
-            }
-        }
-        printAdditiveExpr(post->expr, indent + BaseIndent);
-    }
-}
-
-void printRelationalExpr(RelationalExpr expr, uint64_t indent) {
-    printShiftExpr(expr.baseExpr, indent);
-    sll_foreach(expr.postExprs, node) {
-        RelationalPost *post = slNode_getData(node);
-        if (node->next != NULL) {
-        // if (i != expr.numPostExprs - 1) {
-            printIndent(indent + BaseIndent);
-
-            if (post->op == Relational_Lt) {
-                printDebug("<\n");
-            }
-            else if (post->op == Relational_Gt) {
-                printDebug(">\n");
-            }
-            else if (post->op == Relational_LEq) {
-                printDebug("<=\n");
-            }
-            else if (post->op == Relational_GEq) {
-                printDebug(">=\n");
-            }
-            else {
-                assert(false);
-            }
-        }
-        printShiftExpr(post->expr, indent + BaseIndent);
-    }
-}
-
-void printEqualityExpr(EqualityExpr expr, uint64_t indent) {
-    printRelationalExpr(expr.baseExpr, indent);
-    sll_foreach(expr.postExprs, node) {
-        EqualityPost *post = slNode_getData(node);
-        if (node->next != NULL) {
-        // if (i != expr.numPostExprs - 1) {
-            printIndent(indent + BaseIndent);
-
-            if (post->op == Equality_Eq) {
-                printDebug("==\n");
-            }
-            else if (post->op == Equality_NEq) {
-                printDebug("!=\n");
-            }
-            else {
-                assert(false);
-            }
-        }
-        printRelationalExpr(post->expr, indent + BaseIndent);
-    }
-}
-
-void printAndExpr(AndExpr expr, uint64_t indent) {
-    sll_foreach(expr.list, node) {
-        EqualityExpr *eqExpr = slNode_getData(node);
-        printEqualityExpr(*eqExpr, indent);
-        if (node->next != NULL) {
-        // if (i != expr.numExprs - 1) {
-            printIndent(indent + BaseIndent);
-            printDebug("&\n");
-        }
-    }
-}
+void printBinaryOp(TokenType type, uint64_t indent) {
+    printIndent(indent);
 
-void printExclusiveOrExpr(ExclusiveOrExpr expr, uint64_t indent) {
-    sll_foreach(expr.list, node) {
-        AndExpr *andExpr = slNode_getData(node);
-        printAndExpr(*andExpr, indent);
-        if (node->next != NULL) {
-        // if (i != expr.numExprs - 1) {
-            printIndent(indent + BaseIndent);
-            printDebug("^\n");
-        }
+    switch ((int)type) {
+        case Token_LogOrOp: printDebug("||\n"); break;
+        case Token_LogAndOp: printDebug("&&\n"); break;
+        case Token_EqOp: printDebug("==\n"); break;
+        case Token_NEqOp: printDebug("!=\n"); break;
+        case Token_LEqOp: printDebug("<=\n"); break;
+        case Token_GEqOp: printDebug(">=\n"); break;
+        case Token_ShiftLeftOp: printDebug("<<\n"); break;
+        case Token_ShiftRightOp: printDebug(">>\n"); break;
+        case '%': printDebug("%%\n"); break;
+        default: printDebug("%c\n", (char)type); break;
     }
 }
 
-void printInclusiveOrExpr(InclusiveOrExpr expr, uint64_t indent) {
-    sll_foreach(expr.list, node) {
-        ExclusiveOrExpr *orExpr = slNode_getData(node);
-        printExclusiveOrExpr(*orExpr, indent);
-        if (node->next != NULL) {
-        // if (i != expr.numExprs - 1) {
-            printIndent(indent + BaseIndent);
-            printDebug("|\n");
-        }
+void printBinaryExpr(BinaryExpr *expr, uint64_t indent) {
+    if (expr->level == BinaryExpr_Cast) {
+        printCastExpr(expr->cast, indent);
+        return;
     }
-}
 
-void printLogicalAndExpr(LogicalAndExpr expr, uint64_t indent) {
-    sll_foreach(expr.list, node) {
-        InclusiveOrExpr *orExpr = slNode_getData(node);
-        printInclusiveOrExpr(*orExpr, indent);
-        if (node->next != NULL) {
-        // if (i != expr.numExprs - 1) {
-            printIndent(indent + BaseIndent);
-            printDebug("&&\n");
+    astList_foreach(expr->operands, BinaryOperand, operand) {
+        if (operand->opTok == NULL) {
+            printBinaryExpr(operand->expr, indent);
+            continue;
         }
-    }
-}
 
-void printLogicalOrExpr(LogicalOrExpr orExpr, uint64_t indent) {
-    sll_foreach(orExpr.list, node) {
-        LogicalAndExpr *andExpr = slNode_getData(node);
-        printLogicalAndExpr(*andExpr, indent);
-        if (node->next != NULL) {
-        // if (i != orExpr.numExprs - 1) {
-            printIndent(indent + BaseIndent);
-            printDebug("||\n");
-        }
+        printBinaryOp(operand->opTok->type, indent + BaseIndent);
+        printBinaryExpr(operand->expr, indent + BaseIndent);
     }
 }
 
 void printConditionalExpr(ConditionalExpr expr, uint64_t indent) {
-    printLogicalOrExpr(expr.beforeExpr, indent);
+    printBinaryExpr(expr.beforeExpr, indent);
 
     if (expr.hasConditionalOp) {
         printIndent(indent);
@@ -4115,8 +5023,7 @@ void printAssignOp(AssignOp op, uint64_t indent) {
 }
 
 void printAssignExpr(AssignExpr expr, uint64_t indent) {
-    sll_foreach(expr.leftExprs, node) {
-        AssignPrefix *prefix = slNode_getData(node);
+    astList_foreach(expr.leftExprs, AssignPrefix, prefix) {
         printUnaryExpr(prefix->leftExpr, indent);
         printAssignOp(prefix->op, indent + BaseIndent);
     }
@@ -4138,8 +5045,7 @@ void printInnerExpr(InnerExpr expr, uint64_t indent) {
 void printExpr(Expr expr, uint64_t indent) {
     printIndent(indent);
     printDebug("Expr: %ld\n", expr.list.size);
-    sll_foreach(expr.list, node) {
-        InnerExpr *inner = slNode_getData(node);
+    astList_foreach(expr.list, InnerExpr, inner) {
         printInnerExpr(*inner, indent + BaseIndent);
     }
 }
@@ -4162,8 +5068,7 @@ void printParameterDeclaration(ParameterDeclaration decl, uint64_t indent) {
 void printParameterTypeList(ParameterTypeList list, uint64_t indent) {
     printIndent(indent);
     printDebug("Parameter Type List: %ld\n", list.paramDecls.size);
-    sll_foreach(list.paramDecls, node) {
-        ParameterDeclaration *decl = slNode_getData(node);
+    astList_foreach(list.paramDecls, ParameterDeclaration, decl) {
         printParameterDeclaration(*decl, indent + BaseIndent);
     }
     if (list.hasEndingEllipsis) {
@@ -4201,8 +5106,7 @@ void printPostDirectAbstractDeclarator(PostDirectAbstractDeclarator post, uint64
 
             printIndent(indent + BaseIndent);
             printDebug("Type qualifier list: %ld\n", post.bracketTypeQualifiers.size);
-            sll_foreach(post.bracketTypeQualifiers, node) {
-                TypeQualifier *qualifier = slNode_getData(node);
+            astList_foreach(post.bracketTypeQualifiers, TypeQualifier, qualifier) {
                 printTypeQualifier(*qualifier, indent + BaseIndent + BaseIndent);
             }
 
@@ -4236,8 +5140,7 @@ void printDirectAbstractDeclarator(DirectAbstractDeclarator direct, uint64_t ind
         printDebug(")\n");
     }
 
-    sll_foreach(direct.postDirectAbstractDeclarators, node) {
-        PostDirectAbstractDeclarator *post = slNode_getData(node);
+    astList_foreach(direct.postDirectAbstractDeclarators, PostDirectAbstractDeclarator, post) {
         printPostDirectAbstractDeclarator(*post, indent + BaseIndent);
     }
 }
@@ -4250,8 +5153,7 @@ void printPointer(Pointer pointer, uint64_t indent) {
 
     printDebug("\n");
 
-    sll_foreach(pointer.typeQualifiers, node) {
-        TypeQualifier *qualifier = slNode_getData(node);
+    astList_foreach(pointer.typeQualifiers, TypeQualifier, qualifier) {
         printTypeQualifier(*qualifier, indent + BaseIndent);
     }
 
@@ -4273,9 +5175,8 @@ void printAbstractDeclarator(AbstractDeclarator decl, uint64_t indent) {
 void printIdentifierList(IdentifierList list, uint64_t indent) {
     printIndent(indent);
     printDebug("Identifier list: %ld\n", list.list.size);
-    sll_foreach(list.list, node) {
+    astList_foreach(list.list, String, str) {
         printIndent(indent + BaseIndent);
-        String *str = slNode_getData(node);
         printDebug("%.*s\n", astr_format(*str));
         str = str; // This is just there to get rid of the warning
     }
@@ -4327,8 +5228,7 @@ void printPostDirectDeclarator(PostDirectDeclarator post, uint64_t indent) {
 
             printIndent(indent + BaseIndent);
             printDebug("Type qualifier list: %ld\n", post.bracketTypeQualifiers.size);
-            sll_foreach(post.bracketTypeQualifiers, node) {
-                TypeQualifier *qualifier = slNode_getData(node);
+            astList_foreach(post.bracketTypeQualifiers, TypeQualifier, qualifier) {
                 printTypeQualifier(*qualifier, indent + BaseIndent + BaseIndent);
             }
 
@@ -4367,8 +5267,7 @@ void printDirectDeclarator(DirectDeclarator direct, uint64_t indent) {
 
     printIndent(indent);
     printDebug("Post Direct Declarator: %ld\n", direct.postDirectDeclarators.size);
-    sll_foreach(direct.postDirectDeclarators, node) {
-        PostDirectDeclarator *post = slNode_getData(node);
+    astList_foreach(direct.postDirectDeclarators, PostDirectDeclarator, post) {
         printPostDirectDeclarator(*post, indent + BaseIndent);
     }
 }
@@ -4423,8 +5322,7 @@ void printSpecifierQualifier(SpecifierQualifier specQual, uint64_t indent) {
 void printSpecifierQualifierList(SpecifierQualifierList list, uint64_t indent) {
     printIndent(indent);
     printDebug("Specifier Qualifier List: %ld\n", list.list.size);
-    sll_foreach(list.list, node) {
-        SpecifierQualifier *spec = slNode_getData(node);
+    astList_foreach(list.list, SpecifierQualifier, spec) {
         printSpecifierQualifier(*spec, indent + BaseIndent);
     }
 }
@@ -4449,8 +5347,7 @@ void printStructDeclarator(StructDeclarator decl, uint64_t indent) {
 void printStructDeclaratorList(StructDeclaratorList list, uint64_t indent) {
     printIndent(indent);
     printDebug("Struct Declarator List: %lu\n", list.list.size);
-    sll_foreach(list.list, node) {
-        StructDeclarator *decl = slNode_getData(node);
+    astList_foreach(list.list, StructDeclarator, decl) {
         printStructDeclarator(*decl, indent + BaseIndent);
     }
 }
@@ -4508,8 +5405,7 @@ void printStructOrUnionSpecifier(StructOrUnionSpecifier structOrUnion, uint64_t
     else {
         printDebug("{\n");
 
-        sll_foreach(structOrUnion.structDeclarations, node) {
-            StructDeclaration *decl = slNode_getData(node);
+        astList_foreach(structOrUnion.structDeclarations, StructDeclaration, decl) {
             printStructDeclaration(*decl, indent + BaseIndent);
         }
 
@@ -4533,8 +5429,7 @@ void printEnumerator(Enumerator enumer, uint64_t indent) {
 void printEnumeratorList(EnumeratorList enumList, uint64_t indent) {
     printIndent(indent);
     printDebug("EnumeratorList: %lu\n", enumList.list.size);
-    sll_foreach(enumList.list, node) {
-        Enumerator *enumerator = slNode_getData(node);
+    astList_foreach(enumList.list, Enumerator, enumerator) {
         printEnumerator(*enumerator, indent + BaseIndent);
     }
 }
@@ -4733,8 +5628,7 @@ void printDeclarationSpecifier(DeclarationSpecifier decl, uint64_t indent) {
 void printDeclarationSpecifierList(DeclarationSpecifierList list, uint64_t indent) {
     printIndent(indent);
     printDebug("Declaration Specifier List: %ld\n", list.list.size);
-    sll_foreach(list.list, node) {
-        DeclarationSpecifier *decl = slNode_getData(node);
+    astList_foreach(list.list, DeclarationSpecifier, decl) {
         printDeclarationSpecifier(*decl, indent + BaseIndent);
     }
 }
@@ -4750,8 +5644,7 @@ void printInitDeclarator(InitDeclarator init, uint64_t indent) {
 void printInitDeclaratorList(InitDeclaratorList list, uint64_t indent) {
     printIndent(indent);
     printDebug("Init declarator list: %lu\n", list.list.size);
-    sll_foreach(list.list, node) {
-        InitDeclarator *init = slNode_getData(node);
+    astList_foreach(list.list, InitDeclarator, init) {
         printInitDeclarator(*init, indent + BaseIndent);
     }
 }
@@ -4962,8 +5855,7 @@ void printBlockItemList(BlockItemList list, uint64_t indent) {
     printIndent(indent);
     printDebug("Block Item List: %lu\n", list.list.size);
 
-    sll_foreach(list.list, node) {
-        BlockItem *item = slNode_getData(node);
+    astList_foreach(list.list, BlockItem, item) {
         printBlockItem(*item, indent + BaseIndent);
     }
 }
@@ -4995,11 +5887,16 @@ void printFuncDef(FuncDef def, uint64_t indent) {
     printIndent(newIndent);
     printDebug("Declarations: %ld\n", def.declarations.size);
 
-    sll_foreach(def.declarations, node) {
-        Declaration *decl = slNode_getData(node);
+    astList_foreach(def.declarations, Declaration, decl) {
         printDeclaration(*decl, newIndent + BaseIndent);
     }
 
+    if (def.deferred.bodies != NULL) {
+        printIndent(newIndent);
+        printDebug("CompoundStmt: Deferred\n");
+        return;
+    }
+
     printCompoundStmt(def.stmt, newIndent);
 }
 
@@ -5016,8 +5913,7 @@ void printExternalDecl(ExternalDecl decl, uint64_t indent) {
 void printTranslationUnit(TranslationUnit translationUnit) {
     printDebug("Translation Unit:\n");
 
-    sll_foreach(translationUnit.externalDecls, node) {
-        ExternalDecl *decl = slNode_getData(node);
+    astList_foreach(translationUnit.externalDecls, ExternalDecl, decl) {
         printExternalDecl(*decl, BaseIndent);
     }
 }
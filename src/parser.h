@@ -1,10 +1,13 @@
 #pragma once
 
+#include <stdint.h>
 #include <stdbool.h>
 
 #include "lexer.h"
 #include "astring.h"
-#include "linkedList.h"
+#include "astList.h"
+#include "arena.h"
+#include "astStats.h"
 
 typedef struct {
     bool success;
@@ -23,8 +26,9 @@ typedef struct SimpleParser {
     union {
         struct {
             Parser listElemParser;
-            SLList *listOut;
+            AstList *listOut;
             size_t listElemSize;
+            AstStatsType listElemType;
             char *listFailMessage;
         };
         struct {
@@ -35,8 +39,8 @@ typedef struct SimpleParser {
     Parser run;
 } SimpleParser;
 
-SimpleParser ListParser(Parser listElemParser, SLList *listOut,
-    size_t listElemSize, char *listFailMessage);
+SimpleParser ListParser(Parser listElemParser, AstList *listOut,
+    size_t listElemSize, AstStatsType listElemType, char *listFailMessage);
 SimpleParser OptionalParser(Parser parser, void *data);
 
 struct ConditionalExpr;
@@ -52,6 +56,33 @@ struct Declarator;
 struct Statement;
 struct CompoundStmt;
 
+// Node kinds the parser keeps track of under every Expr, Statement and
+// Declaration it builds, so walks can skip the ones with nothing under them
+// that a table hooks. Only statements and what holds them are tracked, since
+// everything else is under almost every node.
+#define NodeKindTypes(X)\
+    X(CompoundStmt)\
+    X(BlockItemList)\
+    X(BlockItem)\
+    X(Statement)\
+    X(LabeledStatement)\
+    X(SelectionStatement)\
+    X(IterationStatement)\
+    X(JumpStatement)\
+    X(ExpressionStatement)\
+    X(AsmStatement)\
+    X(Declaration)
+
+typedef enum {
+#define NodeKindEnum(type) NodeKind_ ## type,
+    NodeKindTypes(NodeKindEnum)
+#undef NodeKindEnum
+    NodeKind_Count,
+} NodeKind;
+
+typedef uint64_t NodeKindMask;
+#define NodeKindBit(type) ((NodeKindMask)1 << NodeKind_ ## type)
+
 typedef enum {
     Designator_Constant,
     Designator_Ident,
@@ -66,7 +97,7 @@ typedef struct {
 } Designator;
 
 typedef struct {
-    SLList list; // Designator
+    AstList list; // Designator
 } Designation;
 
 typedef enum {
@@ -89,7 +120,7 @@ typedef struct {
 } DesignationAndInitializer;
 
 typedef struct InitializerList {
-    SLList list; // DesignationAndInitializer
+    AstList list; // DesignationAndInitializer
 } InitializerList;
 
 typedef struct {
@@ -100,7 +131,7 @@ typedef struct {
 
 typedef struct {
     struct AssignExpr *expr;
-    SLList associations; // GenericAssociation
+    AstList associations; // GenericAssociation
 } GenericSelection;
 
 typedef enum {
@@ -136,7 +167,7 @@ typedef struct {
 } PrimaryExpr;
 
 typedef struct {
-    SLList list; // AssignExpr
+    AstList list; // AssignExpr
 } ArgExprList;
 
 typedef enum {
@@ -177,7 +208,7 @@ typedef struct {
         };
     };
 
-    SLList postfixOps; // PostfixOp
+    AstList postfixOps; // PostfixOp
 } PostfixExpr;
 
 typedef enum {
@@ -248,7 +279,7 @@ typedef struct {
 typedef struct {
     Token *tok;
     CastExpr baseExpr;
-    SLList postExprs; // MultiplicativePost
+    AstList postExprs; // MultiplicativePost
 } MultiplicativeExpr;
 
 typedef enum {
@@ -265,7 +296,7 @@ typedef struct {
 typedef struct {
     Token *tok;
     MultiplicativeExpr baseExpr;
-    SLList postExprs; // AdditivePost
+    AstList postExprs; // AdditivePost
 } AdditiveExpr;
 
 typedef enum {
@@ -282,7 +313,7 @@ typedef struct {
 typedef struct {
     Token *tok;
     AdditiveExpr baseExpr;
-    SLList postExprs;
+    AstList postExprs;
 } ShiftExpr;
 
 typedef enum {
@@ -301,7 +332,7 @@ typedef struct {
 typedef struct {
     Token *tok;
     ShiftExpr baseExpr;
-    SLList postExprs;
+    AstList postExprs;
 } RelationalExpr;
 
 typedef enum {
@@ -318,36 +349,72 @@ typedef struct {
 typedef struct {
     Token *tok;
     RelationalExpr baseExpr;
-    SLList postExprs;
+    AstList postExprs;
 } EqualityExpr;
 
 typedef struct {
     Token *tok;
-    SLList list;
+    AstList list;
 } AndExpr;
 
 typedef struct {
     Token *tok;
-    SLList list;
+    AstList list;
 } ExclusiveOrExpr;
 
 typedef struct {
     Token *tok;
-    SLList list;
+    AstList list;
 } InclusiveOrExpr;
 
 typedef struct {
     Token *tok;
-    SLList list;
+    AstList list;
 } LogicalAndExpr;
 
 typedef struct {
     Token *tok;
-    SLList list;
+    AstList list;
 } LogicalOrExpr;
 
+// The parser doesn't build the LogicalOrExpr through MultiplicativeExpr
+// levels above. Binary expressions are parsed into chains of operands joined
+// by operators of the same level, and levels with a single operand are
+// skipped, so a bare identifier is just a Cast leaf. The traversal builds the
+// old levels from this for tables that hook them.
+typedef enum {
+    BinaryExpr_LogicalOr,
+    BinaryExpr_LogicalAnd,
+    BinaryExpr_InclusiveOr,
+    BinaryExpr_ExclusiveOr,
+    BinaryExpr_And,
+    BinaryExpr_Equality,
+    BinaryExpr_Relational,
+    BinaryExpr_Shift,
+    BinaryExpr_Additive,
+    BinaryExpr_Multiplicative,
+    BinaryExpr_Cast,
+} BinaryExprLevel;
+
+struct BinaryExpr;
+
+typedef struct {
+    // NULL for the first operand
+    Token *opTok;
+    struct BinaryExpr *expr;
+} BinaryOperand;
+
+typedef struct BinaryExpr {
+    Token *tok;
+    BinaryExprLevel level;
+    union {
+        CastExpr cast;
+        AstList operands; // BinaryOperand, at least two
+    };
+} BinaryExpr;
+
 typedef struct ConditionalExpr {
-    LogicalOrExpr beforeExpr;
+    BinaryExpr *beforeExpr;
 
     bool hasConditionalOp;
     struct Expr *ifTrueExpr;
@@ -374,7 +441,7 @@ typedef struct {
 } AssignPrefix;
 
 typedef struct AssignExpr {
-    SLList leftExprs;
+    AstList leftExprs;
 
     ConditionalExpr rightExpr;
 } AssignExpr;
@@ -395,7 +462,9 @@ typedef struct {
 } InnerExpr;
 
 typedef struct Expr {
-    SLList list;
+    AstList list;
+    // Kinds of the nodes under this one
+    NodeKindMask kinds;
 } Expr;
 
 typedef struct {
@@ -407,7 +476,7 @@ typedef struct {
 } ParameterDeclaration;
 
 typedef struct {
-    SLList paramDecls;
+    AstList paramDecls;
     bool hasEndingEllipsis;
 } ParameterTypeList;
 
@@ -424,7 +493,7 @@ typedef struct {
             bool bracketIsStar;
             bool bracketHasInitialStatic;
 
-            SLList bracketTypeQualifiers;
+            AstList bracketTypeQualifiers;
 
             bool bracketHasMiddleStatic;
 
@@ -441,12 +510,12 @@ typedef struct {
 typedef struct {
     bool hasAbstractDeclarator;
     struct AbstractDeclarator *abstractDeclarator;
-    SLList postDirectAbstractDeclarators;
+    AstList postDirectAbstractDeclarators;
 } DirectAbstractDeclarator;
 
 typedef struct Pointer {
     size_t numPtrs;
-    SLList typeQualifiers;
+    AstList typeQualifiers;
     bool hasPtr;
     struct Pointer *pointer;
 } Pointer;
@@ -459,7 +528,7 @@ typedef struct AbstractDeclarator {
 } AbstractDeclarator;
 
 typedef struct {
-    SLList list; // List of strings
+    AstList list; // List of strings
 } IdentifierList;
 
 typedef enum {
@@ -481,7 +550,7 @@ typedef struct {
             bool bracketIsStar;
 
             bool bracketHasInitialStatic;
-            SLList bracketTypeQualifiers;
+            AstList bracketTypeQualifiers;
 
             bool bracketHasStarAfterTypeQualifiers;
 
@@ -512,7 +581,7 @@ typedef struct {
         struct Declarator *declarator;
     };
 
-    SLList postDirectDeclarators;
+    AstList postDirectDeclarators;
 } DirectDeclarator;
 
 // TODO: Move this to a dedicated ast file
@@ -546,7 +615,7 @@ typedef struct {
 } SpecifierQualifier;
 
 typedef struct {
-    SLList list;
+    AstList list;
 } SpecifierQualifierList;
 
 typedef struct TypeName {
@@ -563,7 +632,7 @@ typedef struct {
 } StructDeclarator;
 
 typedef struct {
-    SLList list;
+    AstList list;
 } StructDeclaratorList;
 
 typedef struct {
@@ -598,7 +667,7 @@ typedef struct {
     bool hasIdent;
     String ident;
     bool hasStructDeclarationList;
-    SLList structDeclarations;
+    AstList structDeclarations;
 } StructOrUnionSpecifier;
 
 typedef struct {
@@ -608,7 +677,7 @@ typedef struct {
 } Enumerator;
 
 typedef struct {
-    SLList list;
+    AstList list;
 } EnumeratorList;
 
 typedef struct {
@@ -694,7 +763,7 @@ typedef struct {
 } DeclarationSpecifier;
 
 typedef struct DeclarationSpecifierList {
-    SLList list;
+    AstList list;
 } DeclarationSpecifierList;
 
 typedef struct {
@@ -704,7 +773,7 @@ typedef struct {
 } InitDeclarator;
 
 typedef struct {
-    SLList list;
+    AstList list;
  } InitDeclaratorList;
 
 typedef enum {
@@ -722,6 +791,8 @@ typedef struct {
             InitDeclaratorList initDeclaratorList;
         };
     };
+    // Kinds of the nodes under this one
+    NodeKindMask kinds;
 } Declaration;
 
 typedef enum {
@@ -848,6 +919,8 @@ typedef struct Statement {
         ExpressionStatement expression;
         AsmStatement assembly;
     };
+    // Kinds of the nodes under this one
+    NodeKindMask kinds;
 } Statement;
 
 typedef enum {
@@ -864,7 +937,7 @@ typedef struct {
 } BlockItem;
 
 typedef struct {
-    SLList list;
+    AstList list;
 } BlockItemList;
 
 typedef struct CompoundStmt {
@@ -875,14 +948,28 @@ typedef struct CompoundStmt {
     BlockItemList blockItemList;
 } CompoundStmt;
 
+struct DeferredBodies;
+
+typedef struct {
+    // Set while the body hasn't been parsed yet
+    struct DeferredBodies *bodies;
+    // Token index of the body's {
+    size_t pos;
+    // How many file scope names were declared before the function
+    size_t numFileNames;
+} DeferredBody;
+
 typedef struct {
     Token *startTok;
     Token *endTok;
 
     DeclarationSpecifierList specifiers;
     Declarator declarator;
-    SLList declarations;
+    AstList declarations;
+    // Only the brackets are set until the body is parsed. Use funcDef_getBody
+    // to read it.
     CompoundStmt stmt;
+    DeferredBody deferred;
 } FuncDef;
 
 typedef enum {
@@ -899,9 +986,62 @@ typedef struct {
 } ExternalDecl;
 
 typedef struct {
-    SLList externalDecls;
+    AstList externalDecls;
+    // Owns every node in the tree
+    Arena arena;
+    // Tokens and names needed to parse deferred function bodies, or NULL
+    struct DeferredBodies *deferredBodies;
+    // See translationUnit_getIndex
+    struct AstIndex *index;
 } TranslationUnit;
 
+// Packrat parsing memoizes the productions the parser backtracks over the
+// most. It's off by default since it uses more memory, but it keeps deeply
+// nested expressions linear instead of exponential.
+void setPackratParsing(bool enabled);
+
+// Declarations from files the filter accepts are skimmed instead of parsed.
+// Only the typedef names they declare are kept, so user code after them still
+// parses, but none of them end up in the translation unit. Pass NULL to parse
+// everything.
+typedef bool (*SkimFilter)(char *fileName);
+void setHeaderSkimming(SkimFilter filter);
+
+// Deferred function bodies are skipped over by matching brackets and only
+// parsed the first time funcDef_getBody asks for them, so analysis that never
+// looks inside a function never pays for parsing it. A body that turns out not
+// to parse is logged and left empty, and the unit counts as failed from then
+// on. Analysis that looks inside functions should parse them all up front
+// with translationUnit_parseBodies, so it doesn't run on part of the file.
+void setDeferredFunctionBodies(bool enabled);
+CompoundStmt *funcDef_getBody(FuncDef *def);
+
+// With more than one thread, the external declarations of a file are split
+// up and parsed in parallel. The unit comes out the same as a sequential
+// parse, and a file that doesn't split cleanly is just parsed sequentially.
+void setParseThreads(size_t numThreads);
+
+// Records the parser's allocations, lists and backtracking into stats for
+// every parse until it's set back to NULL
+void setAstStats(AstStats *stats);
+
+// The unit's FuncDefs, Declarations and CompoundStmts, listed by the parse.
+// FuncDefs are always listed. The others are only listed with bodies, which
+// parses any function bodies that are still deferred.
+struct AstIndex *translationUnit_getIndex(TranslationUnit unit,
+    bool withBodies);
+
+// Empties the index of a unit whose bodies were deferred, so a walk with
+// astIndex_visit lists it again along with what's in the bodies. NULL when the
+// index has the bodies already. Every body has to be parsed first.
+struct AstIndex *translationUnit_restartIndex(TranslationUnit unit);
+
+// Parses every function body that's still deferred. False if one of them, now
+// or earlier, didn't parse, in which case the unit is only partly there.
+bool translationUnit_parseBodies(TranslationUnit unit);
+
+// Frees the whole tree at once. Anything pointing into it, like the rule
+// contexts built from it, is invalid afterwards.
 void translationUnit_cleanup(TranslationUnit unit);
 
 bool parseTokens(TokenList *tokens,
@@ -1,4 +1,5 @@
 #include "preprocess.h"
+#include "preprocess_internal.h"
 
 #include <string.h>
 #include <ctype.h>
@@ -7,24 +8,32 @@
 #include "array.h"
 #include "debug.h"
 #include "logger.h"
+#include "hashMap.h"
 
 // TODO: Buffer stack
 
 typedef struct {
     size_t bufferPos;
+    size_t line;
+    size_t col;
     size_t numTokens;
 } OptState;
 
 typedef struct {
-    String name;
-    // TODO: Function like macros
-    PreprocessTokenList replacementList;
-} Macro;
+    // Set once one of the groups of the conditional has been included
+    bool taken;
+    bool seenElse;
+} Conditional;
 
 typedef struct {
-    size_t numMacros;
-    Macro *macros;
-} MacroList;
+    MacroList macros;
+    size_t numConditionals;
+    Conditional *conditionals;
+} PreprocessContext;
+
+// Macro name -> id + 1
+static HashMap g_macroIds;
+static size_t g_numMacroIds;
 
 static OptState optSetMark(Buffer *buffer, PreprocessTokenList *list);
 
@@ -33,20 +42,28 @@ static void optRestore(OptState prevState, Buffer *buffer,
 
 static void checkMacroReplacement(PreprocessTokenList *list, MacroList *macros);
 
+static bool findMacroId(String name, size_t *outId);
+
 static bool parseGroupPart(Buffer *buffer, PreprocessTokenList *list,
-                           MacroList *macros);
+                           PreprocessContext *context);
+
+static bool parseConditionalSection(Buffer *buffer, PreprocessContext *context,
+                                    DirectiveType directive);
 
-static bool parseIfDefSection(Buffer *buffer, PreprocessTokenList *list);
+static bool parseCondition(Buffer *buffer, MacroList *macros,
+                           DirectiveType directive, bool *outResult);
 
-// static bool parseElifSection(Buffer *buffer, PreprocessTokenList *list);
+static bool skipGroup(Buffer *buffer, PreprocessContext *context);
+
+static void skipLine(Buffer *buffer);
 
 static bool parseDefineSection(Buffer *buffer, MacroList *macros);
 
+static bool parseUndefSection(Buffer *buffer, MacroList *macros);
+
 static bool parseTextLine(Buffer *buffer, PreprocessTokenList *list,
                           MacroList *macros);
 
-static bool parsePPToken(Buffer *buffer, PreprocessTokenList *list);
-
 static bool parseIdentifier(Buffer *buffer, String *outIdent);
 
 static bool parseNumber(Buffer *buffer, PreprocessToken *tok);
@@ -61,15 +78,13 @@ static bool consumeDecFloatExponent(Buffer *buffer);
 
 static bool parseNewLine(Buffer *buffer);
 
-static void consumeWhitespaceAndComments(Buffer *buffer);
-
 static bool peekNonNewLineSpace(Buffer *buffer);
 
 bool preprocess(Buffer file, PreprocessTokenList *outList) {
     if (file.bytes == NULL || file.size == 0 || outList == NULL)
         return false;
 
-    MacroList macros = {0};
+    PreprocessContext context = {0};
 
     PreprocessTokenList list = {0};
 
@@ -80,7 +95,7 @@ bool preprocess(Buffer file, PreprocessTokenList *outList) {
     file.pos = 0;
 
     while (file.pos < file.size) {
-        if (!parseGroupPart(&file, &list, &macros)) {
+        if (!parseGroupPart(&file, &list, &context)) {
             printf("Parsing group part failed: %lu-%d-%c\n", file.pos, *buffCurr(&file),
                 *buffCurr(&file));
             result = false;
@@ -88,7 +103,18 @@ bool preprocess(Buffer file, PreprocessTokenList *outList) {
         }
     }
 
-    printf("Macros: %lu\n", macros.numMacros);
+    if (result && context.numConditionals > 0) {
+        logError("Preprocess: Unterminated conditional at end of file\n");
+        result = false;
+    }
+
+    size_t numDefined = 0;
+    for (size_t i = 0; i < context.macros.numMacros; i++) {
+        if (context.macros.macros[i].version != 0)
+            numDefined++;
+    }
+
+    printf("Macros: %lu\n", numDefined);
 
     if (result) {
         *outList = list;
@@ -201,6 +227,9 @@ void printPreprocessTokens(PreprocessTokenList tokens) {
         else if (tok.type == PreprocessToken_ConstString) {
             printDebug("String: %.*s\n", astr_format(tok.constString));
         }
+        else if (tok.type == PreprocessToken_ConstChar) {
+            printDebug("Char: %.*s\n", astr_format(tok.constChar));
+        }
         else {
             logFatal("Lexer: Invalid token type when printing: %ld\n", tok.type);
             assert(false);
@@ -209,117 +238,348 @@ void printPreprocessTokens(PreprocessTokenList tokens) {
 }
 
 static OptState optSetMark(Buffer *buffer, PreprocessTokenList *list) {
-    return (OptState){ .bufferPos = buffer->pos, .numTokens = list->numTokens };
+    return (OptState){
+        .bufferPos = buffer->pos,
+        .line = buffer->line,
+        .col = buffer->col,
+        .numTokens = list->numTokens
+    };
 }
 
 static void optRestore(OptState prevState, Buffer *buffer,
                        PreprocessTokenList *list)
 {
     buffer->pos = prevState.bufferPos;
+    buffer->line = prevState.line;
+    buffer->col = prevState.col;
     list->numTokens = prevState.numTokens;
 }
 
+size_t macro_intern(String name) {
+    size_t id = 0;
+    if (findMacroId(name, &id))
+        return id;
+
+    // Macro names point into file buffers, so keep our own copy
+    uint8_t *copy = malloc(name.length);
+    assert(copy != NULL);
+    memcpy(copy, name.str, name.length);
+
+    id = g_numMacroIds++;
+    hashMap_insert(&g_macroIds, (String){copy, name.length}, (void*)(id + 1));
+
+    return id;
+}
+
+Macro *macroList_find(MacroList *macros, size_t id) {
+    if (id >= macros->numMacros || macros->macros[id].version == 0)
+        return NULL;
+
+    return macros->macros + id;
+}
+
+void macroList_define(MacroList *macros, size_t id, Macro macro) {
+    if (id >= macros->numMacros) {
+        size_t numMacros = g_numMacroIds > id ? g_numMacroIds : id + 1;
+
+        macros->macros = realloc(macros->macros, numMacros * sizeof(Macro));
+        assert(macros->macros != NULL);
+
+        memset(macros->macros + macros->numMacros, 0,
+            (numMacros - macros->numMacros) * sizeof(Macro));
+
+        macros->numMacros = numMacros;
+    }
+
+    free(macros->macros[id].replacementList.tokens);
+    macros->macros[id] = macro;
+}
+
+void macroList_undefine(MacroList *macros, size_t id) {
+    Macro *macro = macroList_find(macros, id);
+    if (macro == NULL)
+        return;
+
+    free(macro->replacementList.tokens);
+    *macro = (Macro){0};
+}
+
+static bool findMacroId(String name, size_t *outId) {
+    void *value = NULL;
+    if (!hashMap_find(&g_macroIds, name, &value))
+        return false;
+
+    *outId = (size_t)value - 1;
+    return true;
+}
+
 static void checkMacroReplacement(PreprocessTokenList *list, MacroList *macros) {
     PreprocessToken token = list->tokens[list->numTokens - 1];
 
     // TODO: Search for Arguments
 
-    if (token.type == PreprocessToken_Ident) {
-        for (size_t i = 0; i < macros->numMacros; i++) {
-            Macro macro = macros->macros[i];
-            if (astr_cmp(token.ident, macro.name)) {
-                list->numTokens--;
-
-                PreprocessTokenList replacements = macro.replacementList;
+    size_t id = 0;
+    if (token.type == PreprocessToken_Ident && findMacroId(token.ident, &id)) {
+        Macro *macro = macroList_find(macros, id);
+        if (macro != NULL) {
+            list->numTokens--;
 
-                for (size_t ii = 0; ii < replacements.numTokens; ii++) {
-                    PreprocessToken token = replacements.tokens[ii];
-                    ArrayAppend(list->tokens, list->numTokens, token);
-                }
+            PreprocessTokenList replacements = macro->replacementList;
 
-                break;
+            for (size_t ii = 0; ii < replacements.numTokens; ii++) {
+                PreprocessToken token = replacements.tokens[ii];
+                ArrayAppend(list->tokens, list->numTokens, token);
             }
         }
     }
 }
 
 static bool parseGroupPart(Buffer *buffer, PreprocessTokenList *list,
-                           MacroList *macros)
+                           PreprocessContext *context)
 {
     bool result = true;
 
-    if (consumeMultiIf(buffer, "#ifdef")) {
-        result = parseIfDefSection(buffer, list);
+    DirectiveType directive = consumeDirective(buffer);
+
+    switch (directive) {
+        case Directive_If:
+        case Directive_IfDef:
+        case Directive_IfNDef:
+        case Directive_Elif:
+        case Directive_Else:
+        case Directive_EndIf: {
+            result = parseConditionalSection(buffer, context, directive);
+        } break;
+        case Directive_Define: {
+            result = parseDefineSection(buffer, &context->macros);
+        } break;
+        case Directive_Undef: {
+            result = parseUndefSection(buffer, &context->macros);
+        } break;
+        case Directive_None: {
+            result = parseTextLine(buffer, list, &context->macros);
+        } break;
+        default: {
+        } break;
     }
-    else if (consumeMultiIf(buffer, "#ifndef")) {
 
-    }
-    else if (consumeMultiIf(buffer, "#if")) {
+    return result;
+}
 
+typedef struct {
+    char *name;
+    DirectiveType type;
+} DirectiveName;
+
+static DirectiveName g_directiveNames[] = {
+    { "if", Directive_If },
+    { "ifdef", Directive_IfDef },
+    { "ifndef", Directive_IfNDef },
+    { "elif", Directive_Elif },
+    { "else", Directive_Else },
+    { "endif", Directive_EndIf },
+    { "include", Directive_Include },
+    { "define", Directive_Define },
+    { "undef", Directive_Undef },
+    { "line", Directive_Line },
+    { "error", Directive_Error },
+    { "pragma", Directive_Pragma },
+};
+
+DirectiveType consumeDirective(Buffer *buffer) {
+    Buffer mark = *buffer;
+
+    consumeWhitespaceAndComments(buffer);
+
+    if (!consumeIf(buffer, '#')) {
+        *buffer = mark;
+        return Directive_None;
     }
-    else if (consumeMultiIf(buffer, "#include")) {
 
+    consumeWhitespaceAndComments(buffer);
+
+    String name = {0};
+    if (!parseIdentifier(buffer, &name))
+        return Directive_Null;
+
+    size_t numNames = sizeof(g_directiveNames) / sizeof(g_directiveNames[0]);
+    for (size_t i = 0; i < numNames; i++) {
+        if (astr_ccmp(name, g_directiveNames[i].name))
+            return g_directiveNames[i].type;
     }
-    else if (consumeMultiIf(buffer, "#define")) {
-        result = parseDefineSection(buffer, macros);
+
+    return Directive_Unknown;
+}
+
+static bool parseConditionalSection(Buffer *buffer, PreprocessContext *context,
+                                    DirectiveType directive)
+{
+    if (directive == Directive_If || directive == Directive_IfDef ||
+        directive == Directive_IfNDef)
+    {
+        bool condition = false;
+        if (!parseCondition(buffer, &context->macros, directive, &condition))
+            return false;
+
+        Conditional conditional = { .taken = condition };
+        ArrayAppend(context->conditionals, context->numConditionals,
+            conditional);
+
+        if (!condition)
+            return skipGroup(buffer, context);
+
+        return true;
     }
-    else if (consumeMultiIf(buffer, "#undef")) {
 
+    if (context->numConditionals == 0) {
+        logError("Preprocess: Conditional directive without #if on line %lu\n",
+            buffer->line);
+        return false;
     }
-    else if (consumeMultiIf(buffer, "#line")) {
 
+    skipLine(buffer);
+
+    if (directive == Directive_EndIf) {
+        context->numConditionals--;
+        return true;
     }
-    else if (consumeMultiIf(buffer, "#error")) {
 
+    // We only get to an #elif or #else from a group that was included, so
+    // everything up to the #endif gets skipped
+    return skipGroup(buffer, context);
+}
+
+static bool parseCondition(Buffer *buffer, MacroList *macros,
+                           DirectiveType directive, bool *outResult)
+{
+    consumeWhitespaceAndComments(buffer);
+
+    if (directive == Directive_IfDef || directive == Directive_IfNDef) {
+        String identifier = {0};
+
+        if (!parseIdentifier(buffer, &identifier)) {
+            logError("Preprocess: Expected a macro name on line %lu\n",
+                buffer->line);
+            return false;
+        }
+
+        size_t id = 0;
+        bool defined = findMacroId(identifier, &id) &&
+            macroList_find(macros, id) != NULL;
+
+        *outResult = directive == Directive_IfDef ? defined : !defined;
+
+        skipLine(buffer);
+
+        return true;
     }
-    else if (consumeMultiIf(buffer, "#pragma")) {
 
+    uint8_t *start = buffCurr(buffer);
+    size_t line = buffer->line;
+
+    PreprocessTokenList tokens = {0};
+
+    while (true) {
+        OptState mark = optSetMark(buffer, &tokens);
+
+        consumeWhitespaceAndComments(buffer);
+
+        if (!parsePPToken(buffer, &tokens)) {
+            optRestore(mark, buffer, &tokens);
+            break;
+        }
     }
-    else if (consumeIf(buffer, '#')) {
 
+    String lineText = { .str = start, .length = buffCurr(buffer) - start };
+
+    consumeWhitespaceAndComments(buffer);
+
+    bool result = parseNewLine(buffer) || buffer->pos >= buffer->size;
+    if (!result) {
+        logError("Preprocess: Invalid token in #if on line %lu\n", line);
     }
     else {
-        result = parseTextLine(buffer, list, macros);
+        result = evaluateIfExpression(lineText, tokens, macros, outResult);
     }
 
+    free(tokens.tokens);
+
     return result;
 }
 
-static bool parseIfDefSection(Buffer *buffer, PreprocessTokenList *list) {
-    // Identifier
-    // if (!parseIdentifier(buffer, list))
-    //     return false;
+static bool skipGroup(Buffer *buffer, PreprocessContext *context) {
+    Conditional *conditional =
+        context->conditionals + context->numConditionals - 1;
+
+    // Nested conditionals inside the skipped group
+    size_t depth = 0;
+
+    while (buffer->pos < buffer->size) {
+        DirectiveType directive = consumeDirective(buffer);
+
+        switch (directive) {
+            case Directive_If:
+            case Directive_IfDef:
+            case Directive_IfNDef: {
+                depth++;
+                skipLine(buffer);
+            } break;
+            case Directive_EndIf: {
+                skipLine(buffer);
+
+                if (depth == 0) {
+                    context->numConditionals--;
+                    return true;
+                }
+
+                depth--;
+            } break;
+            case Directive_Elif: {
+                if (depth > 0 || conditional->taken || conditional->seenElse) {
+                    skipLine(buffer);
+                    break;
+                }
 
-    // New line
-    // if (!parseNewLine(buffer))
-    //     return false;
+                bool condition = false;
+                if (!parseCondition(buffer, &context->macros, directive,
+                    &condition))
+                {
+                    return false;
+                }
 
-    // Optional group
-    // OptState groupState = optSetMark(buffer, list);
+                if (condition) {
+                    conditional->taken = true;
+                    return true;
+                }
+            } break;
+            case Directive_Else: {
+                skipLine(buffer);
 
-    // if (!parseGroupPart(buffer, list))
-    //     optRestore(groupState, buffer, list);
+                if (depth > 0)
+                    break;
 
-    // Optional elif groups
-    // while (true) {
-    //     OptState elifState = optSetMark(buffer, list);
-    //     if (!parseElifGroup(buffer, list)) {
-    //         optRestore(elifState, buffer, list);
-    //         break;
-    //     }
-    // }
+                conditional->seenElse = true;
 
-    // Optional else group
-    // OptState elseState = optSetMark(buffer, list);
+                if (!conditional->taken) {
+                    conditional->taken = true;
+                    return true;
+                }
+            } break;
+            default: {
+                skipLine(buffer);
+            } break;
+        }
+    }
 
-    // if (!parseElseGroup(buffer, list))
-    //     optRestore(elseState, buffer, list);
+    logError("Preprocess: Unterminated conditional at end of file\n");
+    return false;
+}
 
-    // End if line
-    // if (!parseEndifLine(buffer, list))
-    //     return false;
+static void skipLine(Buffer *buffer) {
+    while (buffer->pos < buffer->size && peek(buffer) != '\n')
+        consume(buffer);
 
-    return true;
+    consumeIf(buffer, '\n');
 }
 
 static bool parseDefineSection(Buffer *buffer, MacroList *macros) {
@@ -336,8 +596,8 @@ static bool parseDefineSection(Buffer *buffer, MacroList *macros) {
     // Parse a replacement list
     PreprocessTokenList list = {0};
 
-    // TODO: Multi line replacement lists
-
+    // Line splices are skipped by the buffer, so replacement lists that
+    // continue over multiple lines read like a single line here
     while (true) {
         OptState mark = optSetMark(buffer, &list);
 
@@ -351,14 +611,55 @@ static bool parseDefineSection(Buffer *buffer, MacroList *macros) {
         consumeWhitespaceAndComments(buffer);
     }
 
-    Macro macro = { .name = identifier, .replacementList = list };
+    // Content hash of the definition, so identical redefinitions keep the
+    // same version
+    uint64_t version = hashBytes(identifier.str, identifier.length);
+    for (size_t i = 0; i < list.numTokens; i++) {
+        PreprocessToken tok = list.tokens[i];
 
-    ArrayAppend(macros->macros, macros->numMacros, macro);
+        version = (version ^ tok.type) * 1099511628211ULL;
+
+        if (tok.type == PreprocessToken_Ident ||
+            tok.type == PreprocessToken_ConstNumeric ||
+            tok.type == PreprocessToken_ConstString ||
+            tok.type == PreprocessToken_ConstChar)
+        {
+            version ^= hashBytes(tok.ident.str, tok.ident.length);
+        }
+    }
+
+    if (version == 0)
+        version = 1;
+
+    Macro macro = {
+        .name = identifier,
+        .version = version,
+        .replacementList = list
+    };
+
+    macroList_define(macros, macro_intern(identifier), macro);
 
     // Parse a new line
     return parseNewLine(buffer);
 }
 
+static bool parseUndefSection(Buffer *buffer, MacroList *macros) {
+    String identifier = {0};
+
+    consumeWhitespaceAndComments(buffer);
+
+    if (!parseIdentifier(buffer, &identifier))
+        return false;
+
+    size_t id = 0;
+    if (findMacroId(identifier, &id))
+        macroList_undefine(macros, id);
+
+    skipLine(buffer);
+
+    return true;
+}
+
 static bool parseTextLine(Buffer *buffer, PreprocessTokenList *list,
                           MacroList *macros) {
     while (true) {
@@ -407,7 +708,7 @@ static bool parseTextLine(Buffer *buffer, PreprocessTokenList *list,
     result = true;\
 }
 
-static bool parsePPToken(Buffer *buffer, PreprocessTokenList *list) {
+bool parsePPToken(Buffer *buffer, PreprocessTokenList *list) {
     bool result = false;
 
     PreprocessToken tok = {0};
@@ -486,7 +787,7 @@ static bool parsePPToken(Buffer *buffer, PreprocessTokenList *list) {
 
     // String Literal
     else if (consumeIf(buffer, '"')) {
-        uint8_t *bytes = buffCurr(buffer);
+        Buffer start = *buffer;
 
         while (peek(buffer) != '"') {
             if (peek(buffer) == '\\')
@@ -496,10 +797,7 @@ static bool parsePPToken(Buffer *buffer, PreprocessTokenList *list) {
         }
 
         tok.type = PreprocessToken_ConstString;
-        tok.constString = (String) {
-            .str = bytes,
-            .length = buffCurr(buffer) - bytes
-        };
+        tok.constString = buffer_spelling(start, buffer);
 
         // Get the last "
         consume(buffer);
@@ -509,6 +807,25 @@ static bool parsePPToken(Buffer *buffer, PreprocessTokenList *list) {
         result = true;
     }
 
+    // Character Constant
+    else if (consumeIf(buffer, '\'')) {
+        Buffer start = *buffer;
+
+        while (buffer->pos < buffer->size && peek(buffer) != '\'' &&
+            peek(buffer) != '\n')
+        {
+            if (peek(buffer) == '\\')
+                consume(buffer);
+
+            consume(buffer);
+        }
+
+        tok.type = PreprocessToken_ConstChar;
+        tok.constChar = buffer_spelling(start, buffer);
+
+        result = consumeIf(buffer, '\'');
+    }
+
     // Punctuator
     TripleCharacterOp("...", PreprocessToken_Ellipsis)
     TripleCharacterOp(">>=", PreprocessToken_ShiftRightAssign)
@@ -565,7 +882,7 @@ static bool parsePPToken(Buffer *buffer, PreprocessTokenList *list) {
 }
 
 static bool parseIdentifier(Buffer *buffer, String *outIdent) {
-    String string = { .str =buffCurr(buffer) };
+    Buffer start = *buffer;
 
     if (peek(buffer) != '_' && !isalpha(peek(buffer)))
         return false;
@@ -576,16 +893,14 @@ static bool parseIdentifier(Buffer *buffer, String *outIdent) {
         consume(buffer);
     }
 
-    string.length = buffCurr(buffer) - string.str;
-
-    *outIdent = string;
+    *outIdent = buffer_spelling(start, buffer);
 
     return true;
 }
 
 // TODO: Refactor this function to make it cleaner
 static bool parseNumber(Buffer *buffer, PreprocessToken *tok) {
-    uint8_t *numeric = buffCurr(buffer);
+    Buffer start = *buffer;
 
     bool lookForFloat = false;
     bool isHex = false;
@@ -648,13 +963,8 @@ static bool parseNumber(Buffer *buffer, PreprocessToken *tok) {
         }
     }
 
-    size_t length = buffCurr(buffer) - numeric;
-
     tok->type = PreprocessToken_ConstNumeric;
-    tok->constNumeric = (String) {
-        .str = numeric,
-        .length = length
-    };
+    tok->constNumeric = buffer_spelling(start, buffer);
 
     return true;
 }
@@ -740,21 +1050,24 @@ static bool parseNewLine(Buffer *buffer) {
     return consumeIf(buffer, '\n');
 }
 
-static void consumeWhitespaceAndComments(Buffer *buffer) {
+void consumeWhitespaceAndComments(Buffer *buffer) {
     bool foundConsumable = false;
 
     do {
         foundConsumable = true;
 
         if (peekMulti(buffer, "/*")) {
-            while (!peekMulti(buffer, "*/"))
+            while (buffer->pos < buffer->size && !peekMulti(buffer, "*/"))
                 consume(buffer);
 
             consumeMulti(buffer, 2);
         }
         else if (peekMulti(buffer, "//")) {
-            while (peek(buffer) != '\r' && peek(buffer) != '\n')
+            while (buffer->pos < buffer->size && peek(buffer) != '\r' &&
+                peek(buffer) != '\n')
+            {
                 consume(buffer);
+            }
         }
         else if (peekNonNewLineSpace(buffer)) {
             while (peekNonNewLineSpace(buffer))
@@ -97,6 +97,7 @@ typedef struct {
         String ident;
         String constNumeric;
         String constString;
+        String constChar;
     };
 } PreprocessToken;
 
@@ -105,6 +106,30 @@ typedef struct {
     PreprocessToken *tokens;
 } PreprocessTokenList;
 
+typedef enum {
+    Directive_None,
+    Directive_If,
+    Directive_IfDef,
+    Directive_IfNDef,
+    Directive_Elif,
+    Directive_Else,
+    Directive_EndIf,
+    Directive_Include,
+    Directive_Define,
+    Directive_Undef,
+    Directive_Line,
+    Directive_Error,
+    Directive_Pragma,
+    Directive_Null,
+    Directive_Unknown,
+} DirectiveType;
+
 bool preprocess(Buffer file, PreprocessTokenList *outList);
 
+// Consumes the '#' and directive name at the start of a line. Text lines
+// return Directive_None and leave the buffer where it was.
+DirectiveType consumeDirective(Buffer *buffer);
+
+void consumeWhitespaceAndComments(Buffer *buffer);
+
 void printPreprocessTokens(PreprocessTokenList tokens);
@@ -0,0 +1,648 @@
+#include "preprocess_internal.h"
+
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+#include <inttypes.h>
+
+#include "array.h"
+#include "logger.h"
+#include "hashMap.h"
+
+// #if arithmetic is done in intmax_t and uintmax_t. Signed values are
+// stored in value and unsigned values are stored in the same bits.
+typedef struct {
+    bool isUnsigned;
+    intmax_t value;
+} IfValue;
+
+#define IfToken_Value 1024
+
+typedef struct {
+    int type;
+    IfValue value;
+} IfToken;
+
+typedef struct {
+    size_t numTokens;
+    size_t pos;
+    IfToken *tokens;
+
+    size_t line;
+    bool failed;
+
+    // Every macro the result depends on, defined or not
+    size_t numDeps;
+    MacroDependency *deps;
+
+    // Macros being expanded, so self referencing macros stop
+    size_t numExpanding;
+    size_t *expanding;
+} IfState;
+
+typedef struct {
+    bool result;
+    size_t numDeps;
+    MacroDependency *deps;
+} IfMemoResult;
+
+typedef struct {
+    size_t numResults;
+    IfMemoResult *results;
+} IfMemo;
+
+// Expression text -> IfMemo. Shared by every file, so the same feature test
+// in a header is only evaluated once per set of relevant macro values.
+static HashMap g_ifMemo;
+
+static uint64_t macroVersion(MacroList *macros, size_t id);
+
+static void addDependency(IfState *state, size_t id, uint64_t version);
+
+static bool expandTokens(IfState *state, PreprocessTokenList tokens,
+                         MacroList *macros);
+
+static bool parseNumberValue(String numeric, IfValue *outValue);
+
+static bool parseCharValue(String constChar, IfValue *outValue);
+
+static IfValue parseIfExpr(IfState *state, int minPrecedence, bool evaluate);
+
+static IfValue parseIfUnary(IfState *state, bool evaluate);
+
+static int binaryPrecedence(int type);
+
+static IfValue applyBinary(IfState *state, int op, IfValue left, IfValue right,
+                           bool evaluate);
+
+bool evaluateIfExpression(String lineText, PreprocessTokenList tokens,
+                          MacroList *macros, bool *outResult)
+{
+    IfMemo *memo = NULL;
+    if (hashMap_find(&g_ifMemo, lineText, (void**)&memo)) {
+        for (size_t i = 0; i < memo->numResults; i++) {
+            IfMemoResult result = memo->results[i];
+
+            bool matches = true;
+            for (size_t ii = 0; ii < result.numDeps && matches; ii++) {
+                MacroDependency dep = result.deps[ii];
+                matches = macroVersion(macros, dep.id) == dep.version;
+            }
+
+            if (matches) {
+                *outResult = result.result;
+                return true;
+            }
+        }
+    }
+
+    IfState state = {
+        .line = tokens.numTokens > 0 ? tokens.tokens[0].line : 0
+    };
+
+    if (tokens.numTokens == 0) {
+        logError("Preprocess: #if with no expression\n");
+        return false;
+    }
+
+    bool success = expandTokens(&state, tokens, macros);
+
+    IfValue value = {0};
+    if (success) {
+        value = parseIfExpr(&state, 0, true);
+
+        if (!state.failed && state.pos != state.numTokens) {
+            logError("Preprocess: Unexpected token in #if on line %lu\n",
+                state.line);
+            state.failed = true;
+        }
+
+        success = !state.failed;
+    }
+
+    if (success) {
+        *outResult = value.value != 0;
+
+        if (memo == NULL) {
+            memo = calloc(1, sizeof(IfMemo));
+            assert(memo != NULL);
+
+            uint8_t *key = malloc(lineText.length);
+            assert(key != NULL);
+            memcpy(key, lineText.str, lineText.length);
+
+            hashMap_insert(&g_ifMemo, (String){key, lineText.length}, memo);
+        }
+
+        IfMemoResult result = {
+            .result = *outResult,
+            .numDeps = state.numDeps,
+            .deps = state.deps
+        };
+        ArrayAppend(memo->results, memo->numResults, result);
+    }
+    else {
+        free(state.deps);
+    }
+
+    free(state.tokens);
+    free(state.expanding);
+
+    return success;
+}
+
+static uint64_t macroVersion(MacroList *macros, size_t id) {
+    Macro *macro = macroList_find(macros, id);
+
+    return macro == NULL ? 0 : macro->version;
+}
+
+static void addDependency(IfState *state, size_t id, uint64_t version) {
+    for (size_t i = 0; i < state->numDeps; i++) {
+        if (state->deps[i].id == id)
+            return;
+    }
+
+    MacroDependency dep = { .id = id, .version = version };
+    ArrayAppend(state->deps, state->numDeps, dep);
+}
+
+static bool expandTokens(IfState *state, PreprocessTokenList tokens,
+                         MacroList *macros)
+{
+    for (size_t i = 0; i < tokens.numTokens; i++) {
+        PreprocessToken tok = tokens.tokens[i];
+        IfToken ifTok = { .type = IfToken_Value };
+
+        if (tok.type == PreprocessToken_Ident &&
+            astr_ccmp(tok.ident, "defined"))
+        {
+            // defined X or defined ( X )
+            bool hasParen = i + 1 < tokens.numTokens &&
+                tokens.tokens[i + 1].type == '(';
+            size_t nameIdx = hasParen ? i + 2 : i + 1;
+
+            if (nameIdx >= tokens.numTokens ||
+                (tokens.tokens[nameIdx].type != PreprocessToken_Ident &&
+                    tokens.tokens[nameIdx].type < PreprocessToken_void) ||
+                (hasParen && (nameIdx + 1 >= tokens.numTokens ||
+                    tokens.tokens[nameIdx + 1].type != ')')))
+            {
+                logError("Preprocess: Invalid defined() in #if on line %lu\n",
+                    state->line);
+                return false;
+            }
+
+            // Keywords can't have been defined by the file
+            PreprocessToken name = tokens.tokens[nameIdx];
+            if (name.type == PreprocessToken_Ident) {
+                size_t id = macro_intern(name.ident);
+                uint64_t version = macroVersion(macros, id);
+
+                addDependency(state, id, version);
+                ifTok.value.value = version != 0;
+            }
+
+            i = hasParen ? nameIdx + 1 : nameIdx;
+        }
+        else if (tok.type == PreprocessToken_Ident) {
+            size_t id = macro_intern(tok.ident);
+            Macro *macro = macroList_find(macros, id);
+
+            addDependency(state, id, macroVersion(macros, id));
+
+            bool isExpanding = false;
+            for (size_t ii = 0; ii < state->numExpanding; ii++) {
+                if (state->expanding[ii] == id)
+                    isExpanding = true;
+            }
+
+            if (macro != NULL && !isExpanding) {
+                ArrayAppend(state->expanding, state->numExpanding, id);
+
+                bool result = expandTokens(state, macro->replacementList,
+                    macros);
+
+                state->numExpanding--;
+
+                if (!result)
+                    return false;
+
+                continue;
+            }
+
+            // Identifiers left after expansion are 0
+        }
+        else if (tok.type > PreprocessToken_Ident) {
+            // So are keywords
+            if (tok.type < PreprocessToken_void) {
+                ifTok.type = tok.type;
+            }
+        }
+        else if (tok.type == PreprocessToken_ConstNumeric) {
+            if (!parseNumberValue(tok.constNumeric, &ifTok.value)) {
+                logError("Preprocess: Invalid integer constant %.*s in #if on "
+                    "line %lu\n", astr_format(tok.constNumeric), state->line);
+                return false;
+            }
+        }
+        else if (tok.type == PreprocessToken_ConstChar) {
+            if (!parseCharValue(tok.constChar, &ifTok.value)) {
+                logError("Preprocess: Invalid character constant in #if on "
+                    "line %lu\n", state->line);
+                return false;
+            }
+        }
+        else if (tok.type == PreprocessToken_ConstString) {
+            logError("Preprocess: String in #if on line %lu\n", state->line);
+            return false;
+        }
+        else {
+            ifTok.type = tok.type;
+        }
+
+        ArrayAppend(state->tokens, state->numTokens, ifTok);
+    }
+
+    return true;
+}
+
+static bool parseNumberValue(String numeric, IfValue *outValue) {
+    char digits[128] = {0};
+
+    if (numeric.length >= sizeof(digits))
+        return false;
+
+    size_t length = numeric.length;
+
+    bool isUnsigned = false;
+    while (length > 0 && strchr("uUlL", numeric.str[length - 1]) != NULL) {
+        if (tolower(numeric.str[length - 1]) == 'u')
+            isUnsigned = true;
+
+        length--;
+    }
+
+    memcpy(digits, numeric.str, length);
+
+    int base = 10;
+    char *start = digits;
+
+    if (length > 1 && digits[0] == '0' && tolower(digits[1]) == 'x') {
+        base = 16;
+        start += 2;
+    }
+    else if (length > 1 && digits[0] == '0' && tolower(digits[1]) == 'b') {
+        base = 2;
+        start += 2;
+    }
+    else if (length > 1 && digits[0] == '0') {
+        base = 8;
+    }
+
+    if (*start == '\0')
+        return false;
+
+    char *end = NULL;
+    uintmax_t value = strtoumax(start, &end, base);
+
+    // Floating point constants aren't allowed either
+    if (*end != '\0')
+        return false;
+
+    // Like gcc, constants too big for intmax_t are unsigned
+    outValue->isUnsigned = isUnsigned || value > INTMAX_MAX;
+    outValue->value = (intmax_t)value;
+
+    return true;
+}
+
+static bool parseCharValue(String constChar, IfValue *outValue) {
+    intmax_t value = 0;
+    size_t numChars = 0;
+
+    for (size_t i = 0; i < constChar.length; i++) {
+        uint8_t c = constChar.str[i];
+
+        if (c == '\\' && i + 1 < constChar.length) {
+            c = constChar.str[++i];
+
+            switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'a': c = '\a'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'v': c = '\v'; break;
+                case 'x': {
+                    uint8_t hex = 0;
+                    while (i + 1 < constChar.length &&
+                        isxdigit(constChar.str[i + 1]))
+                    {
+                        uint8_t digit = constChar.str[++i];
+                        hex = hex * 16 + (isdigit(digit) ?
+                            digit - '0' : tolower(digit) - 'a' + 10);
+                    }
+                    c = hex;
+                } break;
+                default: {
+                    if (c >= '0' && c <= '7') {
+                        uint8_t octal = c - '0';
+                        for (size_t ii = 0; ii < 2 && i + 1 < constChar.length &&
+                            constChar.str[i + 1] >= '0' &&
+                            constChar.str[i + 1] <= '7'; ii++)
+                        {
+                            octal = octal * 8 + (constChar.str[++i] - '0');
+                        }
+                        c = octal;
+                    }
+                } break;
+            }
+        }
+
+        value = (value << 8) | c;
+        numChars++;
+    }
+
+    if (numChars == 0)
+        return false;
+
+    // A single character has type int with the value of a signed char
+    if (numChars == 1)
+        value = (signed char)value;
+
+    outValue->isUnsigned = false;
+    outValue->value = value;
+
+    return true;
+}
+
+static IfValue parseIfExpr(IfState *state, int minPrecedence, bool evaluate) {
+    IfValue left = parseIfUnary(state, evaluate);
+
+    while (!state->failed && state->pos < state->numTokens) {
+        int op = state->tokens[state->pos].type;
+
+        // Conditional operator, lowest precedence and right associative
+        if (op == '?') {
+            if (minPrecedence > 0)
+                break;
+
+            state->pos++;
+
+            bool condition = left.value != 0;
+            IfValue ifTrue = parseIfExpr(state, 0, evaluate && condition);
+
+            if (state->failed || state->pos >= state->numTokens ||
+                state->tokens[state->pos].type != ':')
+            {
+                if (!state->failed) {
+                    logError("Preprocess: Expected : in #if on line %lu\n",
+                        state->line);
+                    state->failed = true;
+                }
+                return left;
+            }
+
+            state->pos++;
+
+            IfValue ifFalse = parseIfExpr(state, 0, evaluate && !condition);
+
+            left = condition ? ifTrue : ifFalse;
+            left.isUnsigned = ifTrue.isUnsigned || ifFalse.isUnsigned;
+            continue;
+        }
+
+        int precedence = binaryPrecedence(op);
+        if (precedence == 0 || precedence < minPrecedence)
+            break;
+
+        state->pos++;
+
+        // && and || don't evaluate their right side when the left decides
+        bool evaluateRight = evaluate;
+        if (op == PreprocessToken_LogAndOp && left.value == 0)
+            evaluateRight = false;
+        if (op == PreprocessToken_LogOrOp && left.value != 0)
+            evaluateRight = false;
+
+        IfValue right = parseIfExpr(state, precedence + 1, evaluateRight);
+
+        left = applyBinary(state, op, left, right, evaluate);
+    }
+
+    return left;
+}
+
+static IfValue parseIfUnary(IfState *state, bool evaluate) {
+    IfValue value = {0};
+
+    if (state->pos >= state->numTokens) {
+        logError("Preprocess: Expected a value in #if on line %lu\n",
+            state->line);
+        state->failed = true;
+        return value;
+    }
+
+    IfToken tok = state->tokens[state->pos++];
+
+    switch (tok.type) {
+        case IfToken_Value: {
+            value = tok.value;
+        } break;
+        case '(': {
+            value = parseIfExpr(state, 0, evaluate);
+
+            if (!state->failed && (state->pos >= state->numTokens ||
+                state->tokens[state->pos].type != ')'))
+            {
+                logError("Preprocess: Expected ) in #if on line %lu\n",
+                    state->line);
+                state->failed = true;
+            }
+
+            state->pos++;
+        } break;
+        case '+': {
+            value = parseIfUnary(state, evaluate);
+        } break;
+        case '-': {
+            value = parseIfUnary(state, evaluate);
+            value.value = (intmax_t)(0 - (uintmax_t)value.value);
+        } break;
+        case '~': {
+            value = parseIfUnary(state, evaluate);
+            value.value = ~value.value;
+        } break;
+        case '!': {
+            value = parseIfUnary(state, evaluate);
+            value.value = value.value == 0;
+            value.isUnsigned = false;
+        } break;
+        default: {
+            logError("Preprocess: Unexpected token in #if on line %lu\n",
+                state->line);
+            state->failed = true;
+        } break;
+    }
+
+    return value;
+}
+
+static int binaryPrecedence(int type) {
+    switch (type) {
+        case '*':
+        case '/':
+        case '%':
+            return 10;
+        case '+':
+        case '-':
+            return 9;
+        case PreprocessToken_ShiftLeftOp:
+        case PreprocessToken_ShiftRightOp:
+            return 8;
+        case '<':
+        case '>':
+        case PreprocessToken_LEqOp:
+        case PreprocessToken_GEqOp:
+            return 7;
+        case PreprocessToken_EqOp:
+        case PreprocessToken_NEqOp:
+            return 6;
+        case '&':
+            return 5;
+        case '^':
+            return 4;
+        case '|':
+            return 3;
+        case PreprocessToken_LogAndOp:
+            return 2;
+        case PreprocessToken_LogOrOp:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static IfValue applyBinary(IfState *state, int op, IfValue left, IfValue right,
+                           bool evaluate)
+{
+    // Usual arithmetic conversions. If either side is unsigned, both are.
+    bool isUnsigned = left.isUnsigned || right.isUnsigned;
+
+    uintmax_t uLeft = (uintmax_t)left.value;
+    uintmax_t uRight = (uintmax_t)right.value;
+
+    IfValue result = { .isUnsigned = isUnsigned };
+
+    switch (op) {
+        case '*': {
+            result.value = (intmax_t)(uLeft * uRight);
+        } break;
+        case '/':
+        case '%': {
+            if (right.value == 0) {
+                if (evaluate) {
+                    logError("Preprocess: Division by zero in #if on line "
+                        "%lu\n", state->line);
+                    state->failed = true;
+                }
+                break;
+            }
+
+            if (isUnsigned) {
+                result.value = (intmax_t)(op == '/' ?
+                    uLeft / uRight : uLeft % uRight);
+            }
+            else if (left.value == INTMAX_MIN && right.value == -1) {
+                result.value = op == '/' ? INTMAX_MIN : 0;
+            }
+            else {
+                result.value = op == '/' ?
+                    left.value / right.value : left.value % right.value;
+            }
+        } break;
+        case '+': {
+            result.value = (intmax_t)(uLeft + uRight);
+        } break;
+        case '-': {
+            result.value = (intmax_t)(uLeft - uRight);
+        } break;
+        case PreprocessToken_ShiftLeftOp:
+        case PreprocessToken_ShiftRightOp: {
+            // Shifts keep the type of the left side
+            result.isUnsigned = left.isUnsigned;
+
+            bool isLeft = op == PreprocessToken_ShiftLeftOp;
+            intmax_t amount = right.value;
+
+            // Negative shifts go the other way
+            if (!right.isUnsigned && amount < 0) {
+                isLeft = !isLeft;
+                amount = amount == INTMAX_MIN ? INTMAX_MAX : -amount;
+            }
+
+            if ((uintmax_t)amount >= sizeof(uintmax_t) * 8) {
+                result.value = !isLeft && !left.isUnsigned && left.value < 0 ?
+                    -1 : 0;
+            }
+            else if (isLeft) {
+                result.value = (intmax_t)(uLeft << amount);
+            }
+            else if (left.isUnsigned) {
+                result.value = (intmax_t)(uLeft >> amount);
+            }
+            else {
+                result.value = left.value >> amount;
+            }
+        } break;
+        case '<':
+        case '>':
+        case PreprocessToken_LEqOp:
+        case PreprocessToken_GEqOp: {
+            int cmp = 0;
+            if (isUnsigned)
+                cmp = uLeft < uRight ? -1 : uLeft > uRight;
+            else
+                cmp = left.value < right.value ? -1 : left.value > right.value;
+
+            result.isUnsigned = false;
+            result.value =
+                op == '<' ? cmp < 0 :
+                op == '>' ? cmp > 0 :
+                op == PreprocessToken_LEqOp ? cmp <= 0 :
+                cmp >= 0;
+        } break;
+        case PreprocessToken_EqOp: {
+            result.isUnsigned = false;
+            result.value = uLeft == uRight;
+        } break;
+        case PreprocessToken_NEqOp: {
+            result.isUnsigned = false;
+            result.value = uLeft != uRight;
+        } break;
+        case '&': {
+            result.value = (intmax_t)(uLeft & uRight);
+        } break;
+        case '^': {
+            result.value = (intmax_t)(uLeft ^ uRight);
+        } break;
+        case '|': {
+            result.value = (intmax_t)(uLeft | uRight);
+        } break;
+        case PreprocessToken_LogAndOp: {
+            result.isUnsigned = false;
+            result.value = left.value != 0 && right.value != 0;
+        } break;
+        case PreprocessToken_LogOrOp: {
+            result.isUnsigned = false;
+            result.value = left.value != 0 || right.value != 0;
+        } break;
+        default: {
+            assert(false);
+        } break;
+    }
+
+    return result;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "buffer.h"
+#include "hashMap.h"
+#include "preprocess.h"
+
+// Macro names are interned process wide, so the same name has the same id in
+// every translation unit. A macro's version is a hash of its replacement list,
+// so two identical definitions have the same version wherever they come from.
+// Version 0 means the macro isn't defined.
+
+typedef struct {
+    String name;
+    uint64_t version;
+    // TODO: Function like macros
+    PreprocessTokenList replacementList;
+} Macro;
+
+typedef struct {
+    // Indexed by macro id
+    size_t numMacros;
+    Macro *macros;
+} MacroList;
+
+typedef struct {
+    size_t id;
+    uint64_t version;
+} MacroDependency;
+
+size_t macro_intern(String name);
+
+// Returns NULL if the macro isn't defined
+Macro *macroList_find(MacroList *macros, size_t id);
+void macroList_define(MacroList *macros, size_t id, Macro macro);
+void macroList_undefine(MacroList *macros, size_t id);
+
+bool parsePPToken(Buffer *buffer, PreprocessTokenList *list);
+
+// Evaluates the tokens of an #if or #elif line. lineText is the source text
+// of the expression and is used to memoize results.
+bool evaluateIfExpression(String lineText, PreprocessTokenList tokens,
+                          MacroList *macros, bool *outResult);
@@ -2,11 +2,9 @@
 
 #include <ctype.h>
 
-#include "traversal.h"
-
-static void rule_6_1_a_traverseFuncDef(TraversalFuncTable *table, FuncDef *def, void *data) {
-    Rule *rule = data;
+#include "astIndex.h"
 
+static void rule_6_1_a_checkFuncDef(Rule rule, FuncDef *def) {
     static char *names[] = {
         "interrupt",
         "inline",
@@ -24,7 +22,7 @@ static void rule_6_1_a_traverseFuncDef(TraversalFuncTable *table, FuncDef *def,
         Token *tok = def->declarator.tok;
 
         if (astr_ccmp(name, names[i])) {
-            reportRuleViolation(rule->name, tok->fileName, tok->line,
+            reportRuleViolation(rule.name, tok->fileName, tok->line,
                 "Procedure cannot have name of: %s", names[i]);
         }
     }
@@ -33,15 +31,14 @@ static void rule_6_1_a_traverseFuncDef(TraversalFuncTable *table, FuncDef *def,
 // Procedures cannot have names that is a keyword in c or c++
 // TODO: Find more names that should be restricted
 void rule_6_1_a(Rule rule, RuleContext context) {
-    TraversalFuncTable table = defaultTraversal();
-    table.traverse_FuncDef = rule_6_1_a_traverseFuncDef;
+    AstIndex *index = translationUnit_getIndex(context.translationUnit, false);
 
-    traverse(table, context.translationUnit, &rule);
+    for (size_t i = 0; i < index->numFuncDefs; i++) {
+        rule_6_1_a_checkFuncDef(rule, index->funcDefs[i]);
+    }
 }
 
-static void rule_6_1_b_traverseFuncDef(TraversalFuncTable *table, FuncDef *def, void *data) {
-    Rule *rule = data;
-
+static void rule_6_1_b_checkFuncDef(Rule rule, FuncDef *def) {
     static char *names[] = {
         "strlen",
         "atoi",
@@ -53,7 +50,7 @@ static void rule_6_1_b_traverseFuncDef(TraversalFuncTable *table, FuncDef *def,
         Token *tok = def->declarator.tok;
 
         if (astr_ccmp(name, names[i])) {
-            reportRuleViolation(rule->name, tok->fileName, tok->line,
+            reportRuleViolation(rule.name, tok->fileName, tok->line,
                 "Procedure cannot have name of: %s", names[i]);
         }
     }
@@ -62,20 +59,19 @@ static void rule_6_1_b_traverseFuncDef(TraversalFuncTable *table, FuncDef *def,
 // Procedures cannot have a name that is a function in c stdlib
 // TODO: Find more names that should be restricted
 void rule_6_1_b(Rule rule, RuleContext context) {
-    TraversalFuncTable table = defaultTraversal();
-    table.traverse_FuncDef = rule_6_1_b_traverseFuncDef;
+    AstIndex *index = translationUnit_getIndex(context.translationUnit, false);
 
-    traverse(table, context.translationUnit, &rule);
+    for (size_t i = 0; i < index->numFuncDefs; i++) {
+        rule_6_1_b_checkFuncDef(rule, index->funcDefs[i]);
+    }
 }
 
-static void rule_6_1_c_traverseFuncDef(TraversalFuncTable *table, FuncDef *def, void *data) {
-    Rule *rule = data;
-
+static void rule_6_1_c_checkFuncDef(Rule rule, FuncDef *def) {
     String name = directDeclarator_getName(def->declarator.directDeclarator);
     Token *tok = def->declarator.tok;
 
     if (name.length > 0 && name.str[0] == '_') {
-        reportRuleViolation(rule->name, tok->fileName, tok->line,
+        reportRuleViolation(rule.name, tok->fileName, tok->line,
             "%s", "Procedure cannot have name that starts with _");
 
     }
@@ -83,41 +79,39 @@ static void rule_6_1_c_traverseFuncDef(TraversalFuncTable *table, FuncDef *def,
 
 // Procedures cannot have a name that starts with an _
 void rule_6_1_c(Rule rule, RuleContext context) {
-    TraversalFuncTable table = defaultTraversal();
-    table.traverse_FuncDef = rule_6_1_c_traverseFuncDef;
+    AstIndex *index = translationUnit_getIndex(context.translationUnit, false);
 
-    traverse(table, context.translationUnit, &rule);
+    for (size_t i = 0; i < index->numFuncDefs; i++) {
+        rule_6_1_c_checkFuncDef(rule, index->funcDefs[i]);
+    }
 }
 
-static void rule_6_1_d_traverseFuncDef(TraversalFuncTable *table, FuncDef *def, void *data) {
-    Rule *rule = data;
-
+static void rule_6_1_d_checkFuncDef(Rule rule, FuncDef *def) {
     String name = directDeclarator_getName(def->declarator.directDeclarator);
     Token *tok = def->declarator.tok;
 
     if (name.length > 31) {
-        reportRuleViolation(rule->name, tok->fileName, tok->line,
+        reportRuleViolation(rule.name, tok->fileName, tok->line,
             "%s", "Procedure cannot have name thats longer than 31 characters");
     }
 }
 
 // Procedures cannot have a name thats longer than 31 characters
 void rule_6_1_d(Rule rule, RuleContext context) {
-    TraversalFuncTable table = defaultTraversal();
-    table.traverse_FuncDef = rule_6_1_d_traverseFuncDef;
+    AstIndex *index = translationUnit_getIndex(context.translationUnit, false);
 
-    traverse(table, context.translationUnit, &rule);
+    for (size_t i = 0; i < index->numFuncDefs; i++) {
+        rule_6_1_d_checkFuncDef(rule, index->funcDefs[i]);
+    }
 }
 
-static void rule_6_1_e_traverseFuncDef(TraversalFuncTable *table, FuncDef *def, void *data) {
-    Rule *rule = data;
-
+static void rule_6_1_e_checkFuncDef(Rule rule, FuncDef *def) {
     String name = directDeclarator_getName(def->declarator.directDeclarator);
     Token *tok = def->declarator.tok;
 
     for (size_t i = 0; i < name.length; i++) {
         if (isupper(name.str[i])) {
-            reportRuleViolation(rule->name, tok->fileName, tok->line,
+            reportRuleViolation(rule.name, tok->fileName, tok->line,
                 "%s", "Procedure cannot have a name with uppercase letters");
             break;
         }
@@ -126,25 +120,25 @@ static void rule_6_1_e_traverseFuncDef(TraversalFuncTable *table, FuncDef *def,
 
 // Procedures cannot have a name with uppercase letters
 void rule_6_1_e(Rule rule, RuleContext context) {
-    TraversalFuncTable table = defaultTraversal();
-    table.traverse_FuncDef = rule_6_1_e_traverseFuncDef;
+    AstIndex *index = translationUnit_getIndex(context.translationUnit, false);
 
-    traverse(table, context.translationUnit, &rule);
+    for (size_t i = 0; i < index->numFuncDefs; i++) {
+        rule_6_1_e_checkFuncDef(rule, index->funcDefs[i]);
+    }
 }
 
-static void rule_6_2_a_traverseFuncDef(TraversalFuncTable *table, FuncDef *def, void *data) {
-    Rule *rule = data;
-
+static void rule_6_2_a_checkFuncDef(Rule rule, FuncDef *def) {
     if (def->endTok->line - def->startTok->line > 100) {
-        reportRuleViolation(rule->name, def->startTok->fileName, def->startTok->line,
+        reportRuleViolation(rule.name, def->startTok->fileName, def->startTok->line,
             "%s", "Procedure should not be longer than 100 lines");
     }
 }
 
 // Procedures should not be longer than 100 lines
 void rule_6_2_a(Rule rule, RuleContext context) {
-    TraversalFuncTable table = defaultTraversal();
-    table.traverse_FuncDef = rule_6_2_a_traverseFuncDef;
+    AstIndex *index = translationUnit_getIndex(context.translationUnit, false);
 
-    traverse(table, context.translationUnit, &rule);
+    for (size_t i = 0; i < index->numFuncDefs; i++) {
+        rule_6_2_a_checkFuncDef(rule, index->funcDefs[i]);
+    }
 }
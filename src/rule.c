@@ -1,12 +1,15 @@
 #include "rule.h"
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <stddef.h>
 #include <string.h>
 #include <stdarg.h>
+#include <assert.h>
 
 #include "trie.h"
 #include "logger.h"
+#include "astIndex.h"
 #include "generalRules.h"
 #include "whitespaceRules.h"
 #include "dataTypeRules.h"
@@ -47,10 +50,14 @@ void findRuleIgnorePaths(Config config) {
     }
 }
 
+bool isIgnoredPath(char *fileName) {
+    return trie_matchEarlyTerm(&validFileNames, fileName);
+}
+
 void reportRuleViolation(char *ruleName, char *fileName, uint64_t line,
     char *descriptionFormat, ...)
 {
-    if (trie_matchEarlyTerm(&validFileNames, fileName)) {
+    if (isIgnoredPath(fileName)) {
         return;
     }
 
@@ -69,27 +76,306 @@ void reportRuleViolation(char *ruleName, char *fileName, uint64_t line,
     va_end(list);
 }
 
+// The AST rules, whose hooks are called by a walker generated for all of them
+#define WalkedRules(X)\
+    X(rule_1_4_b, Rule_1_4_b_Hooks)\
+    X(rule_3_1_c, Rule_3_1_c_Hooks)
+
+#define WalkerName walkRules
+#define WalkerRules WalkedRules
+#include "traversalWalker.h"
+
+// In the order of WalkedRules, which is the order of the walker's rules
+static const RuleHooks walkedRules[] = {
+#define WalkedRuleHooks(rule, hooks) rule,
+    WalkedRules(WalkedRuleHooks)
+#undef WalkedRuleHooks
+};
+
+#define NumWalkedRules (sizeof(walkedRules) / sizeof(walkedRules[0]))
+
+static size_t walkedRuleIndex(RuleHooks hooks) {
+    for (size_t i = 0; i < NumWalkedRules; i++) {
+        if (walkedRules[i] == hooks)
+            return i;
+    }
+
+    // Every AST rule has to be in WalkedRules
+    assert(false);
+    return 0;
+}
+
+void traverseRule(Rule rule, RuleContext context) {
+    RuleAndContext ruleAndContext = { .rule = rule, .context = context };
+    size_t index = walkedRuleIndex(rule.hooks);
+
+    void *data[NumWalkedRules] = {0};
+    data[index] = &ruleAndContext;
+
+    WalkerRun run = {
+        .rules = (uint64_t)1 << index,
+        .data = data,
+    };
+    walkRules(&(context.translationUnit), &run);
+}
+
+static void reportPatternMatch(const AstPattern *pattern, void *node,
+    void *data)
+{
+    Rule *rule = data;
+
+    Token *tok = NULL;
+    memcpy(&tok, (uint8_t*)node + pattern->token, sizeof(Token*));
+
+    reportRuleViolation(rule->name, tok->fileName, tok->line,
+        "%s", pattern->message);
+}
+
+void matchRule(Rule rule, RuleContext context) {
+    const AstPattern *rulePatterns = NULL;
+    size_t numPatterns = rule.patterns(&rulePatterns);
+
+    AstPatterns patterns = {0};
+    astPatterns_add(&patterns, rulePatterns, numPatterns, &rule);
+    astPatterns_compile(&patterns);
+    astPatterns_match(&patterns, &(context.translationUnit),
+        reportPatternMatch);
+    astPatterns_cleanup(&patterns);
+}
+
+typedef struct {
+    Rule *rule;
+    TokenCheck check;
+} TokenRuleCheck;
+
+// Runs every rule's token checks in one pass. Each token type gets the checks
+// subscribed to it, so a token nobody subscribed to costs a single lookup.
+static void scanTokens(Rule **rules, size_t numRules, RuleContext *context) {
+    // The checks for a type are checks[first[type]] up to checks[first[type + 1]]
+    size_t first[Token_Count + 1] = {0};
+    size_t numChecks = 0;
+
+    for (size_t i = 0; i < numRules; i++) {
+        if (rules[i]->tokens == NULL)
+            continue;
+
+        const TokenSubscription *subscriptions = NULL;
+        size_t numSubscriptions = rules[i]->tokens(&subscriptions);
+
+        for (size_t ii = 0; ii < numSubscriptions; ii++) {
+            first[subscriptions[ii].type + 1]++;
+        }
+        numChecks += numSubscriptions;
+    }
+
+    if (numChecks == 0)
+        return;
+
+    for (size_t type = 0; type < Token_Count; type++) {
+        first[type + 1] += first[type];
+    }
+
+    // Filled in rule order, so checks of the same token run in that order
+    TokenRuleCheck *checks = malloc(numChecks * sizeof(TokenRuleCheck));
+    size_t filled[Token_Count] = {0};
+    assert(checks != NULL);
+
+    for (size_t i = 0; i < numRules; i++) {
+        if (rules[i]->tokens == NULL)
+            continue;
+
+        const TokenSubscription *subscriptions = NULL;
+        size_t numSubscriptions = rules[i]->tokens(&subscriptions);
+
+        for (size_t ii = 0; ii < numSubscriptions; ii++) {
+            TokenType type = subscriptions[ii].type;
+            checks[first[type] + filled[type]++] = (TokenRuleCheck){
+                .rule = rules[i],
+                .check = subscriptions[ii].check,
+            };
+        }
+    }
+
+    Token *tokens = context->tokens.tokens;
+    for (size_t i = 0; i < context->tokens.numTokens; i++) {
+        TokenType type = tokens[i].type;
+
+        for (size_t ii = first[type]; ii < first[type + 1]; ii++) {
+            checks[ii].check(checks[ii].rule, context, tokens + i);
+        }
+    }
+
+    free(checks);
+}
+
+static void reportTokenPatternMatch(const TokenPattern *pattern,
+    Token *tokens, void *data)
+{
+    Rule *rule = data;
+    Token *tok = tokens + pattern->report;
+
+    reportRuleViolation(rule->name, tok->fileName, tok->line,
+        "%s", pattern->message);
+}
+
+// Runs every rule's token patterns in one pass, through a single automaton
+static void scanTokenPatterns(Rule **rules, size_t numRules,
+    RuleContext *context)
+{
+    TokenPatterns patterns = {0};
+
+    for (size_t i = 0; i < numRules; i++) {
+        if (rules[i]->tokenPatterns == NULL)
+            continue;
+
+        const TokenPattern *rulePatterns = NULL;
+        size_t numPatterns = rules[i]->tokenPatterns(&rulePatterns);
+        tokenPatterns_add(&patterns, rulePatterns, numPatterns, rules[i]);
+    }
+
+    if (patterns.numEntries == 0)
+        return;
+
+    tokenPatterns_compile(&patterns);
+    tokenPatterns_match(&patterns, context->tokens, context->fileName,
+        context->fileBuffer, reportTokenPatternMatch);
+    tokenPatterns_cleanup(&patterns);
+}
+
+void scanRule(Rule rule, RuleContext context) {
+    Rule *rules[] = { &rule };
+    scanTokens(rules, 1, &context);
+    scanTokenPatterns(rules, 1, &context);
+}
+
+void runRules(Rule *rules, size_t numRules, RuleContext context) {
+    // With a deferred body that doesn't parse, the rules that look inside
+    // functions would only see part of the file
+    bool needsBodies = rulesNeedFunctionBodies(rules, numRules);
+    bool bodiesParsed = !needsBodies ||
+        translationUnit_parseBodies(context.translationUnit);
+    if (!bodiesParsed) {
+        logError("Rules: %s has a function body that doesn't parse, so the "
+            "rules that look inside functions are skipped\n", context.fileName);
+    }
+
+    RuleAndContext ruleData[NumWalkedRules];
+    void *data[NumWalkedRules] = {0};
+    WalkerRun run = { .data = data };
+
+    Rule **tokenRules = malloc(numRules * sizeof(Rule*));
+    Rule **validated = malloc(numRules * sizeof(Rule*));
+    assert(tokenRules != NULL && validated != NULL);
+
+    AstPatterns patterns = {0};
+
+    size_t numTokenRules = 0;
+    size_t numValidated = 0;
+    for (size_t i = 0; i < numRules; i++) {
+        if (rules[i].tokens != NULL || rules[i].tokenPatterns != NULL) {
+            tokenRules[numTokenRules++] = rules + i;
+            continue;
+        }
+
+        if (!bodiesParsed && rules[i].needsFunctionBodies)
+            continue;
+
+        if (rules[i].patterns != NULL) {
+            const AstPattern *rulePatterns = NULL;
+            size_t numPatterns = rules[i].patterns(&rulePatterns);
+            astPatterns_add(&patterns, rulePatterns, numPatterns, rules + i);
+            continue;
+        }
+
+        if (rules[i].hooks == NULL) {
+            validated[numValidated++] = rules + i;
+            continue;
+        }
+
+        size_t index = walkedRuleIndex(rules[i].hooks);
+        ruleData[index] = (RuleAndContext){
+            .rule = rules[i],
+            .context = context,
+        };
+        data[index] = ruleData + index;
+        run.rules |= (uint64_t)1 << index;
+    }
+
+    scanTokens(tokenRules, numTokenRules, &context);
+    scanTokenPatterns(tokenRules, numTokenRules, &context);
+
+    TraversalVisitor visitors[2];
+    void *visitorData[2];
+    run.visitors = visitors;
+    run.visitorData = visitorData;
+
+    astPatterns_compile(&patterns);
+    AstPatternWalk patternWalk = astPatterns_startMatch(&patterns,
+        reportPatternMatch);
+
+    // The walk doesn't visit BinaryExprs when a rule needs the legacy levels,
+    // so patterns on them are matched on their own
+    if (patterns.numStates > 0 &&
+        patterns.roots[Traversal_BinaryExpr] != AstPattern_NoState)
+    {
+        astPatterns_match(&patterns, &(context.translationUnit),
+            reportPatternMatch);
+    }
+    else if (patterns.numStates > 0) {
+        visitors[run.numVisitors] = astPatterns_visit;
+        visitorData[run.numVisitors] = &patternWalk;
+        run.numVisitors++;
+        run.legacyLevels = patterns.legacyLevels;
+    }
+
+    // The index of a unit whose bodies were deferred only has the FuncDefs
+    AstIndex *index = bodiesParsed && needsBodies ?
+        translationUnit_restartIndex(context.translationUnit) : NULL;
+    if (index != NULL) {
+        visitors[run.numVisitors] = astIndex_visit;
+        visitorData[run.numVisitors] = index;
+        run.numVisitors++;
+    }
+
+    walkRules(&(context.translationUnit), &run);
+
+    astPatterns_endMatch(&patternWalk);
+    astPatterns_cleanup(&patterns);
+
+    for (size_t i = 0; i < numValidated; i++) {
+        validated[i]->validator(*validated[i], context);
+    }
+
+    free(tokenRules);
+    free(validated);
+}
+
 size_t generateRules(Config config, Rule **outRules) {
     Rule baseRules[] = {
-        { "1.2.a", rule_1_2_a },
-        { "1.3.a", rule_1_3_a },
-        { "1.3.b", rule_1_3_b },
-        { "1.4.b", rule_1_4_b },
-        { "1.7.a", rule_1_7_a },
-        { "1.7.b", rule_1_7_b },
-        { "3.1.a", rule_3_1_a },
-        { "3.1.b", rule_3_1_b },
-        { "3.1.c", rule_3_1_c },
-        { "5.2.b", rule_5_2_b },
-        { "6.1.a", rule_6_1_a },
-        { "6.1.b", rule_6_1_b },
-        { "6.1.c", rule_6_1_c },
-        { "6.1.d", rule_6_1_d },
-        { "6.1.e", rule_6_1_e },
-        { "6.2.a", rule_6_2_a },
-        { "7.1.a", rule_7_1_a },
-        { "7.1.b", rule_7_1_b },
-        { "7.1.c", rule_7_1_c },
+        { "1.2.a", rule_1_2_a, false },
+        { "1.3.a", matchRule, true, .patterns = rule_1_3_a },
+        { "1.3.b", rule_1_3_b, true },
+        { "1.4.b", traverseRule, true, rule_1_4_b },
+        { "1.7.a", scanRule, false, .tokens = rule_1_7_a },
+        { "1.7.b", scanRule, false, .tokens = rule_1_7_b },
+        { "1.7.d", scanRule, false, .tokenPatterns = rule_1_7_d },
+        { "3.1.a", scanRule, false, .tokens = rule_3_1_a },
+        { "3.1.b", scanRule, false, .tokens = rule_3_1_b },
+        { "3.1.c", traverseRule, true, rule_3_1_c },
+        { "3.1.f", scanRule, false, .tokenPatterns = rule_3_1_f },
+        { "3.1.g", scanRule, false, .tokenPatterns = rule_3_1_g },
+        { "3.1.h", scanRule, false, .tokenPatterns = rule_3_1_h },
+        { "5.2.b", scanRule, false, .tokens = rule_5_2_b },
+        { "6.1.a", rule_6_1_a, false },
+        { "6.1.b", rule_6_1_b, false },
+        { "6.1.c", rule_6_1_c, false },
+        { "6.1.d", rule_6_1_d, false },
+        { "6.1.e", rule_6_1_e, false },
+        { "6.2.a", rule_6_2_a, false },
+        // Local variables are declared inside function bodies
+        { "7.1.a", rule_7_1_a, true },
+        { "7.1.b", rule_7_1_b, true },
+        { "7.1.c", rule_7_1_c, true },
     };
     size_t baseRuleCount = sizeof(baseRules) / sizeof(Rule);
 
@@ -148,4 +434,11 @@ size_t generateRules(Config config, Rule **outRules) {
     return newRuleSize;
 }
 
+bool rulesNeedFunctionBodies(Rule *rules, size_t numRules) {
+    for (size_t i = 0; i < numRules; i++) {
+        if (rules[i].needsFunctionBodies)
+            return true;
+    }
 
+    return false;
+}
@@ -4,6 +4,9 @@
 #include "parser.h"
 #include "config.h"
 #include "buffer.h"
+#include "traversal.h"
+#include "astPattern.h"
+#include "tokenPattern.h"
 
 typedef struct {
     char *fileName;
@@ -16,15 +19,79 @@ typedef struct {
 typedef struct Rule Rule;
 
 typedef void (*RuleValidator)(Rule rule, RuleContext context);
+// Sets the rule's hooks in a default traversal table
+typedef void (*RuleHooks)(TraversalFuncTable *table);
+// Gives the rule's AST patterns
+typedef size_t (*RulePatterns)(const AstPattern **outPatterns);
+
+// Checks a token of a type the rule subscribed to
+typedef void (*TokenCheck)(Rule *rule, RuleContext *context, Token *token);
+
+typedef struct {
+    TokenType type;
+    TokenCheck check;
+} TokenSubscription;
+
+// Gives the token types the rule checks, each with its check
+typedef size_t (*RuleTokens)(const TokenSubscription **outSubscriptions);
+// Gives the rule's token patterns
+typedef size_t (*RuleTokenPatterns)(const TokenPattern **outPatterns);
+
+// A rule's hooks are listed as X(type, hook) entries in its header, so the
+// walker rule.c generates for the AST rules can call them directly. These
+// declare the hooks and set them in a RuleHooks function.
+#define RuleHookPrototype(type, hook)\
+    void hook(TraversalFuncTable *table, type *node, void *data);
+#define SetRuleHook(type, hook) table->traverse_ ## type = hook;
 
 struct Rule {
     char *name;
     RuleValidator validator;
+    // Whether the rule looks at anything inside a function body through the
+    // AST. Token based rules and ones that only look at signatures don't.
+    bool needsFunctionBodies;
+    // Set for rules that check the AST, which are listed in WalkedRules in
+    // rule.c too. Their validator is traverseRule.
+    RuleHooks hooks;
+    // Set for rules made of AST patterns, which report where each pattern
+    // matches. Their validator is matchRule.
+    RulePatterns patterns;
+    // Set for rules that check single tokens. Their validator is scanRule.
+    RuleTokens tokens;
+    // Set for rules made of token patterns, which report where each pattern
+    // matches. Their validator is scanRule too.
+    RuleTokenPatterns tokenPatterns;
 };
 
+// The data every AST rule's hooks get
+typedef struct {
+    Rule rule;
+    RuleContext context;
+} RuleAndContext;
+
 size_t generateRules(Config config, Rule **outRules);
 
+// Runs a single AST rule over the translation unit
+void traverseRule(Rule rule, RuleContext context);
+// Runs a single pattern rule over the translation unit
+void matchRule(Rule rule, RuleContext context);
+// Runs a single token or token pattern rule over the file's tokens
+void scanRule(Rule rule, RuleContext context);
+
+// Runs every rule on the file. The AST rules share a single walk, so their
+// violations are reported in the order of the tree. The same walk matches the
+// patterns of every pattern rule, and lists deferred function bodies in the
+// unit's index for the rules that run after it. The token rules share a
+// single pass over the tokens, and the token patterns another.
+void runRules(Rule *rules, size_t numRules, RuleContext context);
+
+// When none of the rules need them, function bodies don't have to be parsed
+bool rulesNeedFunctionBodies(Rule *rules, size_t numRules);
+
 void reportRuleViolation(char *name, char *fileName, uint64_t line,
     char *descriptionFormat, ...);
 
 void findRuleIgnorePaths(Config config);
+
+// True if the file is under one of the config's ignorePaths
+bool isIgnoredPath(char *fileName);
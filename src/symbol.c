@@ -0,0 +1,130 @@
+#include "symbol.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "hashMap.h"
+
+// Name -> id + 1, so an id of 0 isn't stored as NULL
+static HashMap g_symbolIds;
+static size_t g_numSymbols;
+
+size_t symbol_intern(String name) {
+    size_t id = 0;
+    if (symbol_find(name, &id))
+        return id;
+
+    // Identifiers point into file buffers, so keep our own copy
+    uint8_t *copy = malloc(name.length);
+    assert(copy != NULL);
+    memcpy(copy, name.str, name.length);
+
+    id = g_numSymbols++;
+    hashMap_insert(&g_symbolIds, (String){copy, name.length}, (void*)(id + 1));
+
+    return id;
+}
+
+bool symbol_find(String name, size_t *outId) {
+    void *value = NULL;
+    if (!hashMap_find(&g_symbolIds, name, &value))
+        return false;
+
+    *outId = (size_t)value - 1;
+    return true;
+}
+
+static size_t growCapacity(size_t capacity, size_t needed) {
+    if (capacity == 0)
+        capacity = 64;
+
+    while (capacity < needed)
+        capacity *= 2;
+
+    return capacity;
+}
+
+SymbolKind symbolTable_find(SymbolTable *table, size_t id) {
+    if (id >= table->numKinds)
+        return Symbol_None;
+
+    return table->kinds[id];
+}
+
+bool symbolTable_declare(SymbolTable *table, size_t id, SymbolKind kind) {
+    if (id >= table->numKinds) {
+        size_t numKinds = growCapacity(table->numKinds, id + 1);
+
+        table->kinds = realloc(table->kinds, numKinds * sizeof(SymbolKind));
+        assert(table->kinds != NULL);
+
+        memset(table->kinds + table->numKinds, 0,
+            (numKinds - table->numKinds) * sizeof(SymbolKind));
+        table->numKinds = numKinds;
+    }
+
+    // Declarations outside of any scope are never popped, so there's nothing
+    // to log
+    if (table->numScopes > 0) {
+        if (table->numDeclarations == table->declarationCapacity) {
+            table->declarationCapacity = growCapacity(
+                table->declarationCapacity, table->numDeclarations + 1);
+            table->declarations = realloc(table->declarations,
+                table->declarationCapacity * sizeof(SymbolDeclaration));
+            assert(table->declarations != NULL);
+        }
+
+        table->declarations[table->numDeclarations++] = (SymbolDeclaration){
+            .id = id,
+            .hiddenKind = table->kinds[id]
+        };
+    }
+
+    SymbolKind hiddenKind = table->kinds[id];
+    table->kinds[id] = kind;
+
+    return (hiddenKind == Symbol_Typedef) != (kind == Symbol_Typedef);
+}
+
+void symbolTable_pushScope(SymbolTable *table) {
+    if (table->numScopes == table->scopeCapacity) {
+        table->scopeCapacity = growCapacity(table->scopeCapacity,
+            table->numScopes + 1);
+        table->scopeStarts = realloc(table->scopeStarts,
+            table->scopeCapacity * sizeof(size_t));
+        assert(table->scopeStarts != NULL);
+    }
+
+    table->scopeStarts[table->numScopes++] = table->numDeclarations;
+}
+
+bool symbolTable_popScope(SymbolTable *table) {
+    assert(table->numScopes > 0);
+
+    size_t start = table->scopeStarts[--table->numScopes];
+    bool changed = false;
+
+    // Undo in reverse so a name declared twice in the scope ends up with what
+    // it was before the first one
+    while (table->numDeclarations > start) {
+        SymbolDeclaration decl = table->declarations[--table->numDeclarations];
+
+        SymbolKind kind = table->kinds[decl.id];
+        if ((kind == Symbol_Typedef) != (decl.hiddenKind == Symbol_Typedef))
+            changed = true;
+
+        table->kinds[decl.id] = decl.hiddenKind;
+    }
+
+    return changed;
+}
+
+void symbolTable_cleanup(SymbolTable *table) {
+    free(table->kinds);
+    free(table->declarations);
+    free(table->scopeStarts);
+
+    *table = (SymbolTable){0};
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "astring.h"
+
+// Identifiers are interned process wide by the lexer, so every token for the
+// same name carries the same symbol id. Interning isn't thread safe, but
+// looking up a name that's already interned is.
+
+size_t symbol_intern(String name);
+bool symbol_find(String name, size_t *outId);
+
+// Ordinary identifiers and typedef names share a name space, so a block scope
+// variable can hide a typedef and the other way around. The table maps symbol
+// ids to what they currently name. Each declaration is logged so popping a
+// scope can restore whatever its declarations hid.
+
+typedef enum {
+    Symbol_None,
+    Symbol_Typedef,
+    Symbol_Ordinary,
+} SymbolKind;
+
+typedef struct {
+    size_t id;
+    SymbolKind hiddenKind;
+} SymbolDeclaration;
+
+typedef struct {
+    // Indexed by symbol id
+    size_t numKinds;
+    SymbolKind *kinds;
+
+    size_t numDeclarations;
+    size_t declarationCapacity;
+    SymbolDeclaration *declarations;
+
+    // Index of the first declaration in each open scope
+    size_t numScopes;
+    size_t scopeCapacity;
+    size_t *scopeStarts;
+} SymbolTable;
+
+SymbolKind symbolTable_find(SymbolTable *table, size_t id);
+
+// These return true if any name changed between being a typedef name and not
+// being one
+bool symbolTable_declare(SymbolTable *table, size_t id, SymbolKind kind);
+void symbolTable_pushScope(SymbolTable *table);
+bool symbolTable_popScope(SymbolTable *table);
+
+void symbolTable_cleanup(SymbolTable *table);
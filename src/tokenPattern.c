@@ -0,0 +1,259 @@
+#include "tokenPattern.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#include "array.h"
+
+#define TokenPattern_NoState UINT32_MAX
+
+void tokenPatterns_add(TokenPatterns *patterns, const TokenPattern *added,
+    size_t numAdded, void *data)
+{
+    patterns->entries = growArray(patterns->entries,
+        &(patterns->entryCapacity), patterns->numEntries + numAdded,
+        sizeof(TokenPatternEntry));
+
+    for (size_t i = 0; i < numAdded; i++) {
+        patterns->entries[patterns->numEntries++] = (TokenPatternEntry){
+            .pattern = added + i,
+            .data = data,
+        };
+    }
+}
+
+static size_t pattern_length(const TokenPattern *pattern) {
+    size_t length = 0;
+    while (length < MaxTokenPatternLength && pattern->types[length] != 0)
+        length++;
+
+    return length;
+}
+
+static uint32_t compile_addState(TokenPatterns *patterns) {
+    patterns->states = growArray(patterns->states,
+        &(patterns->stateCapacity), patterns->numStates + 1,
+        sizeof(TokenPatternState));
+    patterns->next = growArray(patterns->next, &(patterns->nextCapacity),
+        (patterns->numStates + 1) * patterns->numClasses, sizeof(uint32_t));
+
+    uint32_t state = patterns->numStates++;
+    patterns->states[state] = (TokenPatternState){0};
+    for (size_t i = 0; i < patterns->numClasses; i++)
+        patterns->next[state * patterns->numClasses + i] = TokenPattern_NoState;
+
+    return state;
+}
+
+void tokenPatterns_compile(TokenPatterns *patterns) {
+    patterns->numStates = 0;
+    patterns->numMatches = 0;
+
+    memset(patterns->classes, 0, sizeof(patterns->classes));
+    patterns->numClasses = 1;
+    for (size_t i = 0; i < patterns->numEntries; i++) {
+        const TokenPattern *pattern = patterns->entries[i].pattern;
+        assert(pattern_length(pattern) > 0);
+
+        for (size_t ii = 0; ii < pattern_length(pattern); ii++) {
+            TokenType type = pattern->types[ii];
+            if (patterns->classes[type] == 0)
+                patterns->classes[type] = patterns->numClasses++;
+        }
+    }
+
+    size_t numClasses = patterns->numClasses;
+
+    // A trie of the patterns, and the state each of them ends in
+    uint32_t *ends = malloc((patterns->numEntries + 1) * sizeof(uint32_t));
+    assert(ends != NULL);
+
+    compile_addState(patterns);
+    for (size_t i = 0; i < patterns->numEntries; i++) {
+        const TokenPattern *pattern = patterns->entries[i].pattern;
+
+        uint32_t state = 0;
+        for (size_t ii = 0; ii < pattern_length(pattern); ii++) {
+            size_t class = patterns->classes[pattern->types[ii]];
+            if (patterns->next[state * numClasses + class] ==
+                TokenPattern_NoState)
+            {
+                uint32_t added = compile_addState(patterns);
+                patterns->next[state * numClasses + class] = added;
+            }
+
+            state = patterns->next[state * numClasses + class];
+        }
+
+        ends[i] = state;
+    }
+
+    // Breadth first, so the state a state fails to is always done before it.
+    // Missing transitions go where the failure's would, which makes next a
+    // full table and the match loop a single lookup per token.
+    uint32_t *order = malloc(patterns->numStates * sizeof(uint32_t));
+    uint32_t *failures = malloc(patterns->numStates * sizeof(uint32_t));
+    assert(order != NULL && failures != NULL);
+
+    size_t numOrdered = 0;
+    order[numOrdered++] = 0;
+    failures[0] = 0;
+
+    for (size_t i = 0; i < numOrdered; i++) {
+        uint32_t state = order[i];
+
+        for (size_t class = 0; class < numClasses; class++) {
+            uint32_t *to = patterns->next + state * numClasses + class;
+            uint32_t fallback = state == 0 ? 0 :
+                patterns->next[failures[state] * numClasses + class];
+
+            if (*to == TokenPattern_NoState) {
+                *to = fallback;
+                continue;
+            }
+
+            failures[*to] = fallback;
+            order[numOrdered++] = *to;
+        }
+    }
+
+    // A state's matches are the patterns that end in it and the matches of
+    // its failure, which are shorter patterns ending on the same token. Both
+    // lists are in the order the patterns were added, so they're merged.
+    for (size_t i = 0; i < numOrdered; i++) {
+        uint32_t state = order[i];
+        TokenPatternState failure = patterns->states[failures[state]];
+
+        patterns->matches = growArray(patterns->matches,
+            &(patterns->matchCapacity),
+            patterns->numMatches + patterns->numEntries, sizeof(uint32_t));
+
+        uint32_t firstMatch = patterns->numMatches;
+        uint32_t inherited = failure.firstMatch;
+        uint32_t inheritedEnd = failure.firstMatch + failure.numMatches;
+
+        for (size_t entry = 0; entry < patterns->numEntries; entry++) {
+            if (ends[entry] != state)
+                continue;
+
+            while (inherited < inheritedEnd &&
+                patterns->matches[inherited] < entry)
+            {
+                patterns->matches[patterns->numMatches++] =
+                    patterns->matches[inherited++];
+            }
+            patterns->matches[patterns->numMatches++] = entry;
+        }
+
+        while (inherited < inheritedEnd) {
+            patterns->matches[patterns->numMatches++] =
+                patterns->matches[inherited++];
+        }
+
+        patterns->states[state] = (TokenPatternState){
+            .firstMatch = firstMatch,
+            .numMatches = patterns->numMatches - firstMatch,
+        };
+    }
+
+    free(ends);
+    free(order);
+    free(failures);
+}
+
+static bool isTrivia(uint8_t c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' ||
+        c == '\f';
+}
+
+static TokenTrivia trivia_before(Buffer buffer, Token *token) {
+    size_t index = token->fileIndex;
+    if (index > 0 && !isTrivia(buffer.bytes[index - 1]))
+        return TokenTrivia_None;
+
+    while (index > 0 && isTrivia(buffer.bytes[index - 1])) {
+        uint8_t c = buffer.bytes[index - 1];
+        if (c == '\n' || c == '\r')
+            return TokenTrivia_Break;
+
+        index--;
+    }
+
+    return index == 0 ? TokenTrivia_Break : TokenTrivia_Space;
+}
+
+static bool match_triviaPasses(const TokenPattern *pattern, size_t length,
+    TokenList tokens, size_t first, char *fileName, Buffer buffer)
+{
+    for (size_t i = 0; i < length; i++) {
+        if (pattern->before[i] == TokenTrivia_Any)
+            continue;
+
+        if (trivia_before(buffer, tokens.tokens + first + i) !=
+            pattern->before[i])
+        {
+            return false;
+        }
+    }
+
+    if (pattern->after == TokenTrivia_Any)
+        return true;
+
+    // Nothing after the last token counts as the end of a line, and so does
+    // a header included after it, since the #include is on a line of its own
+    TokenTrivia after = TokenTrivia_Break;
+    Token *next = tokens.tokens + first + length;
+    if (first + length < tokens.numTokens && token_isFrom(next, fileName))
+        after = trivia_before(buffer, next);
+
+    return after == pattern->after;
+}
+
+void tokenPatterns_match(TokenPatterns *patterns, TokenList tokens,
+    char *fileName, Buffer buffer, TokenPatternMatch onMatch)
+{
+    if (patterns->numEntries == 0)
+        return;
+
+    size_t numClasses = patterns->numClasses;
+    uint32_t state = 0;
+
+    for (size_t i = 0; i < tokens.numTokens; i++) {
+        // A header's tokens aren't in the buffer, so matching starts over
+        // after them
+        if (!token_isFrom(tokens.tokens + i, fileName)) {
+            state = 0;
+            continue;
+        }
+
+        size_t class = patterns->classes[tokens.tokens[i].type];
+        state = patterns->next[state * numClasses + class];
+
+        TokenPatternState matches = patterns->states[state];
+        for (uint32_t ii = 0; ii < matches.numMatches; ii++) {
+            TokenPatternEntry *entry = patterns->entries +
+                patterns->matches[matches.firstMatch + ii];
+
+            size_t length = pattern_length(entry->pattern);
+            size_t first = i + 1 - length;
+            if (!match_triviaPasses(entry->pattern, length, tokens, first,
+                fileName, buffer))
+            {
+                continue;
+            }
+
+            onMatch(entry->pattern, tokens.tokens + first, entry->data);
+        }
+    }
+}
+
+void tokenPatterns_cleanup(TokenPatterns *patterns) {
+    free(patterns->entries);
+    free(patterns->states);
+    free(patterns->next);
+    free(patterns->matches);
+
+    *patterns = (TokenPatterns){0};
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lexer.h"
+#include "buffer.h"
+
+// Checks on short runs of tokens and the whitespace between them, for example
+// "an identifier, then [ with a space before it". Patterns are added to a set,
+// which compiles them into a single Aho-Corasick automaton over token types,
+// so one pass over the tokens finds every pattern in the set.
+
+// What's between a token and the one before it. Comments aren't whitespace.
+typedef enum {
+    TokenTrivia_Any,
+    // The tokens are right next to each other
+    TokenTrivia_None,
+    // Spaces or tabs on the same line
+    TokenTrivia_Space,
+    // Whitespace with a new line in it, or the start of the file
+    TokenTrivia_Break,
+} TokenTrivia;
+
+#define MaxTokenPatternLength 4
+
+typedef struct {
+    // Types end at the first one that's 0
+    TokenType types[MaxTokenPatternLength];
+    // What has to be before each of the tokens, and after the last one
+    TokenTrivia before[MaxTokenPatternLength];
+    TokenTrivia after;
+
+    // Index of the token a match is reported at, and what's reported
+    size_t report;
+    char *message;
+} TokenPattern;
+
+// Called for every match with the first of the matched tokens and the data
+// the pattern was added with
+typedef void (*TokenPatternMatch)(const TokenPattern *pattern, Token *tokens,
+    void *data);
+
+typedef struct {
+    const TokenPattern *pattern;
+    void *data;
+} TokenPatternEntry;
+
+typedef struct {
+    uint32_t firstMatch;
+    uint32_t numMatches;
+} TokenPatternState;
+
+typedef struct {
+    size_t numEntries;
+    size_t entryCapacity;
+    TokenPatternEntry *entries;
+
+    // Filled in by tokenPatterns_compile. Only the types the patterns use get
+    // their own class, and the rest share class 0.
+    uint16_t classes[Token_Count];
+    size_t numClasses;
+    size_t numStates;
+    size_t stateCapacity;
+    TokenPatternState *states;
+    // The state after each state and class, numClasses to a state
+    size_t nextCapacity;
+    uint32_t *next;
+    // Indices into entries for the patterns that end in each state
+    size_t numMatches;
+    size_t matchCapacity;
+    uint32_t *matches;
+} TokenPatterns;
+
+void tokenPatterns_add(TokenPatterns *patterns, const TokenPattern *added,
+    size_t numAdded, void *data);
+void tokenPatterns_compile(TokenPatterns *patterns);
+// Runs over the tokens once and calls onMatch for every match, in the order
+// the matches end. Matches that end on the same token come in the order
+// their patterns were added. buffer is the contents of fileName, so only runs
+// of tokens lexed from it can match, and not ones from the headers it
+// includes.
+void tokenPatterns_match(TokenPatterns *patterns, TokenList tokens,
+    char *fileName, Buffer buffer, TokenPatternMatch onMatch);
+void tokenPatterns_cleanup(TokenPatterns *patterns);
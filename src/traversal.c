@@ -1,984 +1,780 @@
 #include "traversal.h"
 
+#include <stdint.h>
+#include <stdlib.h>
 #include <assert.h>
+#include <pthread.h>
 
-void defaultTraversal_Designator(TraversalFuncTable *table,
-    Designator *desig, void *data)
-{
-    if (desig->type == Designator_Constant) {
-        table->traverse_ConditionalExpr(table, desig->constantExpr, data);
-    }
-}
+#include "arena.h"
+#include "array.h"
 
-void defaultTraversal_Designation(TraversalFuncTable *table,
-    Designation *desig, void *data)
-{
-    sll_foreach(desig->list, node) {
-        Designator *designator = slNode_getData(node);
-        table->traverse_Designator(table, designator, data);
-    }
-}
+// Tables that hook the LogicalOrExpr through MultiplicativeExpr levels get
+// them built from the parser's BinaryExpr chains. The built nodes live in a
+// scratch arena that's rolled back as soon as the hooks return. Every thread
+// walks with its own, since rules run on more than one at a time.
+static _Thread_local Arena g_legacyScratch;
 
-void defaultTraversal_Initializer(TraversalFuncTable *table,
-    Initializer *init, void *data)
-{
-    if (init->type == Initializer_InitializerList) {
-        table->traverse_InitializerList(table, init->initializerList, data);
-    }
-    else if (init->type == Initializer_Assignment) {
-        table->traverse_AssignExpr(table, init->assignmentExpr, data);
-    }
-    else {
-        assert(false);
-    }
+static AstList legacyList(size_t size, size_t elemSize) {
+    return (AstList){
+        .size = size,
+        .items = arena_alloc(&g_legacyScratch, size * elemSize)
+    };
 }
 
-void defaultTraversal_DesignationAndInitializer(TraversalFuncTable *table,
-    DesignationAndInitializer *desig, void *data)
-{
-    if (desig->hasDesignation) {
-        table->traverse_Designation(table, &(desig->designation), data);
-    }
-
-    table->traverse_Initializer(table, &(desig->initializer), data);
+static bool usesLegacyBinaryHooks(TraversalFuncTable *table) {
+#define IsLegacyHooked(type) table->traverse_ ## type != defaultTraversal_ ## type ||
+    return LegacyBinaryTypes(IsLegacyHooked) false;
+#undef IsLegacyHooked
 }
 
-void defaultTraversal_InitializerList(TraversalFuncTable *table,
-    InitializerList *list, void *data)
-{
-    sll_foreach(list->list, node) {
-        DesignationAndInitializer *desig = slNode_getData(node);
-        table->traverse_DesignationAndInitializer(table, desig, data);
-    }
-}
+// The first operand of a chain is the base expression and every other operand
+// becomes a post expression
+#define LegacyChain(out, expr, postType) \
+    ((out)->postExprs = legacyList((expr)->operands.size - 1, sizeof(postType)))
 
-void defaultTraversal_GenericAssociation(TraversalFuncTable *table,
-    GenericAssociation *association, void *data)
-{
-    if (!association->isDefault) {
-        table->traverse_TypeName(table, association->typeName, data);
-    }
-    table->traverse_AssignExpr(table, association->expr, data);
-}
+#define LegacyOperand(expr, index) \
+    astList_get((expr)->operands, BinaryOperand, index)
 
-void defaultTraversal_GenericSelection(TraversalFuncTable *table,
-    GenericSelection *selection, void *data)
-{
-    table->traverse_AssignExpr(table, selection->expr, data);
+static void legacyMultiplicative(BinaryExpr *expr, MultiplicativeExpr *out) {
+    out->tok = expr->tok;
 
-    sll_foreach(selection->associations, node) {
-        GenericAssociation *association = slNode_getData(node);
-        table->traverse_GenericAssociation(table, association, data);
+    if (expr->level != BinaryExpr_Multiplicative) {
+        out->baseExpr = expr->cast;
+        return;
     }
-}
 
-void defaultTraversal_ConstantExpr(TraversalFuncTable *table,
-    ConstantExpr *expr, void *data)
-{
-    // Traverse no further
-}
+    out->baseExpr = LegacyOperand(expr, 0)->expr->cast;
+    LegacyChain(out, expr, MultiplicativePost);
 
-void defaultTraversal_PrimaryExpr(TraversalFuncTable *table,
-    PrimaryExpr *expr, void *data)
-{
-    if (expr->type == PrimaryExpr_Constant) {
-        table->traverse_ConstantExpr(table, &(expr->constant), data);
-    }
-    else if (expr->type == PrimaryExpr_Expr) {
-        table->traverse_Expr(table, expr->expr, data);
-    }
-    else if (expr->type == PrimaryExpr_GenericSelection) {
-        table->traverse_GenericSelection(table, &(expr->genericSelection), data);
-    }
-}
+    for (size_t i = 1; i < expr->operands.size; i++) {
+        BinaryOperand *operand = LegacyOperand(expr, i);
+        MultiplicativePost *post = astList_get(out->postExprs, MultiplicativePost, i - 1);
 
-void defaultTraversal_ArgExprList(TraversalFuncTable *table,
-    ArgExprList *list, void *data)
-{
-    sll_foreach(list->list, node) {
-        AssignExpr *expr = slNode_getData(node);
-        table->traverse_AssignExpr(table, expr, data);
+        TokenType type = operand->opTok->type;
+        post->tok = operand->opTok;
+        post->op = type == '*' ? Multiplicative_Mul :
+            type == '/' ? Multiplicative_Div :
+            Multiplicative_Mod;
+        post->expr = operand->expr->cast;
     }
 }
 
-void defaultTraversal_PostfixOp(TraversalFuncTable *table,
-    PostfixOp *op, void *data)
-{
-    if (op->type == PostfixOp_Index) {
-        table->traverse_Expr(table, op->indexExpr, data);
-    }
-    else if (op->type == PostfixOp_Call) {
-        if (!op->callHasEmptyArgs) {
-            table->traverse_ArgExprList(table, &(op->callExprs), data);
-        }
-    }
-
-    // We don't need to traverse any further
-}
+static void legacyAdditive(BinaryExpr *expr, AdditiveExpr *out) {
+    out->tok = expr->tok;
 
-void defaultTraversal_PostfixExpr(TraversalFuncTable *table,
-    PostfixExpr *expr, void *data)
-{
-    if (expr->type == Postfix_Primary) {
-        table->traverse_PrimaryExpr(table, &(expr->primary), data);
-    }
-    else if (expr->type == Postfix_InitializerList) {
-        table->traverse_TypeName(table, expr->initializerListType, data);
-        table->traverse_InitializerList(table, &(expr->initializerList), data);
-    }
-    else {
-        assert(false);
+    if (expr->level != BinaryExpr_Additive) {
+        legacyMultiplicative(expr, &(out->baseExpr));
+        return;
     }
 
-    sll_foreach(expr->postfixOps, node) {
-        PostfixOp *op = slNode_getData(node);
-        table->traverse_PostfixOp(table, op, data);
-    }
-}
+    legacyMultiplicative(LegacyOperand(expr, 0)->expr, &(out->baseExpr));
+    LegacyChain(out, expr, AdditivePost);
 
-void defaultTraversal_UnaryExpr(TraversalFuncTable *table,
-    UnaryExpr *expr, void *data)
-{
-    if (expr->type == UnaryExpr_UnaryOp) {
-        table->traverse_CastExpr(table, expr->unaryOpCast, data);
-    }
-    else if (expr->type == UnaryExpr_Inc) {
-        table->traverse_UnaryExpr(table, expr->incOpExpr, data);
-    }
-    else if (expr->type == UnaryExpr_Dec) {
-        table->traverse_UnaryExpr(table, expr->decOpExpr, data);
-    }
-    else if (expr->type == UnaryExpr_SizeofExpr) {
-        table->traverse_UnaryExpr(table, expr->sizeofExpr, data);
-    }
-    else if (expr->type == UnaryExpr_SizeofType) {
-        table->traverse_TypeName(table, expr->sizeofTypeName, data);
-    }
-    else if (expr->type == UnaryExpr_AlignofType) {
-        table->traverse_TypeName(table, expr->alignofTypeName, data);
-    }
-    else if (UnaryExpr_Base) {
-        table->traverse_PostfixExpr(table, &(expr->baseExpr), data);
-    }
-    else {
-        assert(false);
-    }
-}
+    for (size_t i = 1; i < expr->operands.size; i++) {
+        BinaryOperand *operand = LegacyOperand(expr, i);
+        AdditivePost *post = astList_get(out->postExprs, AdditivePost, i - 1);
 
-void defaultTraversal_CastExpr(TraversalFuncTable *table,
-    CastExpr *expr, void *data)
-{
-    if (expr->type == CastExpr_Unary) {
-        table->traverse_UnaryExpr(table, &(expr->unary), data);
-    }
-    else if (expr->type == CastExpr_Cast) {
-        table->traverse_TypeName(table, expr->castType, data);
-        table->traverse_CastExpr(table, expr->castExpr, data);
+        post->tok = operand->opTok;
+        post->op = operand->opTok->type == '+' ? Additive_Add : Additive_Sub;
+        legacyMultiplicative(operand->expr, &(post->expr));
     }
 }
 
-void defaultTraversal_MultiplicativePost(TraversalFuncTable *table,
-    MultiplicativePost *expr, void *data)
-{
-    table->traverse_CastExpr(table, &(expr->expr), data);
-}
-
-void defaultTraversal_MultiplicativeExpr(TraversalFuncTable *table,
-    MultiplicativeExpr *expr, void *data)
-{
-    table->traverse_CastExpr(table, &(expr->baseExpr), data);
+static void legacyShift(BinaryExpr *expr, ShiftExpr *out) {
+    out->tok = expr->tok;
 
-    sll_foreach(expr->postExprs, node) {
-        MultiplicativePost *post = slNode_getData(node);
-        table->traverse_MultiplicativePost(table, post, data);
+    if (expr->level != BinaryExpr_Shift) {
+        legacyAdditive(expr, &(out->baseExpr));
+        return;
     }
-}
 
-void defaultTraversal_AdditivePost(TraversalFuncTable *table,
-    AdditivePost *expr, void *data)
-{
-    table->traverse_MultiplicativeExpr(table, &(expr->expr), data);
-}
+    legacyAdditive(LegacyOperand(expr, 0)->expr, &(out->baseExpr));
+    LegacyChain(out, expr, ShiftPost);
 
-void defaultTraversal_AdditiveExpr(TraversalFuncTable *table,
-    AdditiveExpr *expr, void *data)
-{
-    table->traverse_MultiplicativeExpr(table, &(expr->baseExpr), data);
+    for (size_t i = 1; i < expr->operands.size; i++) {
+        BinaryOperand *operand = LegacyOperand(expr, i);
+        ShiftPost *post = astList_get(out->postExprs, ShiftPost, i - 1);
 
-    sll_foreach(expr->postExprs, node) {
-        AdditivePost *post = slNode_getData(node);
-        table->traverse_AdditivePost(table, post, data);
+        post->tok = operand->opTok;
+        post->op = operand->opTok->type == Token_ShiftLeftOp ?
+            Shift_Left : Shift_Right;
+        legacyAdditive(operand->expr, &(post->expr));
     }
 }
 
-void defaultTraversal_ShiftPost(TraversalFuncTable *table,
-    ShiftPost *expr, void *data)
-{
-    table->traverse_AdditiveExpr(table, &(expr->expr), data);
-}
-
-void defaultTraversal_ShiftExpr(TraversalFuncTable *table,
-    ShiftExpr *expr, void *data)
-{
-    table->traverse_AdditiveExpr(table, &(expr->baseExpr), data);
+static void legacyRelational(BinaryExpr *expr, RelationalExpr *out) {
+    out->tok = expr->tok;
 
-    sll_foreach(expr->postExprs, node) {
-        ShiftPost *post = slNode_getData(node);
-        table->traverse_ShiftPost(table, post, data);
+    if (expr->level != BinaryExpr_Relational) {
+        legacyShift(expr, &(out->baseExpr));
+        return;
     }
-}
 
-void defaultTraversal_RelationalPost(TraversalFuncTable *table,
-    RelationalPost *expr, void *data)
-{
-    table->traverse_ShiftExpr(table, &(expr->expr), data);
-}
+    legacyShift(LegacyOperand(expr, 0)->expr, &(out->baseExpr));
+    LegacyChain(out, expr, RelationalPost);
 
-void defaultTraversal_RelationalExpr(TraversalFuncTable *table,
-    RelationalExpr *expr, void *data)
-{
-    table->traverse_ShiftExpr(table, &(expr->baseExpr), data);
+    for (size_t i = 1; i < expr->operands.size; i++) {
+        BinaryOperand *operand = LegacyOperand(expr, i);
+        RelationalPost *post = astList_get(out->postExprs, RelationalPost, i - 1);
 
-    sll_foreach(expr->postExprs, node) {
-        RelationalPost *post = slNode_getData(node);
-        table->traverse_RelationalPost(table, post, data);
+        TokenType type = operand->opTok->type;
+        post->tok = operand->opTok;
+        post->op = type == '<' ? Relational_Lt :
+            type == '>' ? Relational_Gt :
+            type == Token_LEqOp ? Relational_LEq :
+            Relational_GEq;
+        legacyShift(operand->expr, &(post->expr));
     }
 }
 
-void defaultTraversal_EqualityPost(TraversalFuncTable *table,
-    EqualityPost *expr, void *data)
-{
-    table->traverse_RelationalExpr(table, &(expr->expr), data);
-}
-
-void defaultTraversal_EqualityExpr(TraversalFuncTable *table,
-    EqualityExpr *expr, void *data)
-{
-    table->traverse_RelationalExpr(table, &(expr->baseExpr), data);
+static void legacyEquality(BinaryExpr *expr, EqualityExpr *out) {
+    out->tok = expr->tok;
 
-    sll_foreach(expr->postExprs, node) {
-        EqualityPost *post = slNode_getData(node);
-        table->traverse_EqualityPost(table, post, data);
+    if (expr->level != BinaryExpr_Equality) {
+        legacyRelational(expr, &(out->baseExpr));
+        return;
     }
-}
 
-void defaultTraversal_AndExpr(TraversalFuncTable *table,
-    AndExpr *expr, void *data)
-{
-    sll_foreach(expr->list, node) {
-        EqualityExpr *equality = slNode_getData(node);
-        table->traverse_EqualityExpr(table, equality, data);
-    }
-}
+    legacyRelational(LegacyOperand(expr, 0)->expr, &(out->baseExpr));
+    LegacyChain(out, expr, EqualityPost);
 
-void defaultTraversal_ExclusiveOrExpr(TraversalFuncTable *table,
-    ExclusiveOrExpr *expr, void *data)
-{
-    sll_foreach(expr->list, node) {
-        AndExpr *and = slNode_getData(node);
-        table->traverse_AndExpr(table, and, data);
-    }
-}
+    for (size_t i = 1; i < expr->operands.size; i++) {
+        BinaryOperand *operand = LegacyOperand(expr, i);
+        EqualityPost *post = astList_get(out->postExprs, EqualityPost, i - 1);
 
-void defaultTraversal_InclusiveOrExpr(TraversalFuncTable *table,
-    InclusiveOrExpr *expr, void *data)
-{
-    sll_foreach(expr->list, node) {
-        ExclusiveOrExpr *or = slNode_getData(node);
-        table->traverse_ExclusiveOrExpr(table, or, data);
+        post->tok = operand->opTok;
+        post->op = operand->opTok->type == Token_EqOp ? Equality_Eq : Equality_NEq;
+        legacyRelational(operand->expr, &(post->expr));
     }
 }
 
-void defaultTraversal_LogicalAndExpr(TraversalFuncTable *table,
-    LogicalAndExpr *expr, void *data)
-{
-    sll_foreach(expr->list, node) {
-        InclusiveOrExpr *or = slNode_getData(node);
-        table->traverse_InclusiveOrExpr(table, or, data);
-    }
+// The levels from And up only keep a list of their operands, so they're all
+// built the same way
+#define LegacyListLevel(type, binaryLevel, operandType, buildOperand) \
+static void legacy ## type(BinaryExpr *expr, type ## Expr *out) { \
+    out->tok = expr->tok; \
+    if (expr->level != binaryLevel) { \
+        out->list = legacyList(1, sizeof(operandType)); \
+        buildOperand(expr, astList_get(out->list, operandType, 0)); \
+        return; \
+    } \
+    out->list = legacyList(expr->operands.size, sizeof(operandType)); \
+    for (size_t i = 0; i < expr->operands.size; i++) { \
+        buildOperand(LegacyOperand(expr, i)->expr, \
+            astList_get(out->list, operandType, i)); \
+    } \
 }
 
-void defaultTraversal_LogicalOrExpr(TraversalFuncTable *table,
-    LogicalOrExpr *expr, void *data)
-{
-    sll_foreach(expr->list, node) {
-        LogicalAndExpr *and = slNode_getData(node);
-        table->traverse_LogicalAndExpr(table, and, data);
-    }
-}
+LegacyListLevel(And, BinaryExpr_And, EqualityExpr, legacyEquality)
+LegacyListLevel(ExclusiveOr, BinaryExpr_ExclusiveOr, AndExpr, legacyAnd)
+LegacyListLevel(InclusiveOr, BinaryExpr_InclusiveOr, ExclusiveOrExpr, legacyExclusiveOr)
+LegacyListLevel(LogicalAnd, BinaryExpr_LogicalAnd, InclusiveOrExpr, legacyInclusiveOr)
+LegacyListLevel(LogicalOr, BinaryExpr_LogicalOr, LogicalAndExpr, legacyLogicalAnd)
 
-void defaultTraversal_ConditionalExpr(TraversalFuncTable *table,
-    ConditionalExpr *expr, void *data)
-{
-    table->traverse_LogicalOrExpr(table, &(expr->beforeExpr), data);
+_Thread_local TraversalAncestors g_traversalAncestors;
 
-    if (expr->hasConditionalOp) {
-        table->traverse_Expr(table, expr->ifTrueExpr, data);
-        table->traverse_ConditionalExpr(table, expr->ifFalseExpr, data);
-    }
-}
+void traversal_growAncestors() {
+    TraversalAncestors *stack = &g_traversalAncestors;
+    stack->ancestorCapacity = stack->ancestorCapacity == 0 ? 64 :
+        stack->ancestorCapacity * 2;
 
-void defaultTraversal_AssignPrefix(TraversalFuncTable *table,
-    AssignPrefix *prefix, void *data)
-{
-    table->traverse_UnaryExpr(table, &(prefix->leftExpr), data);
+    stack->ancestors = realloc(stack->ancestors,
+        stack->ancestorCapacity * sizeof(TraversalAncestor));
+    assert(stack->ancestors != NULL);
 }
 
-void defaultTraversal_AssignExpr(TraversalFuncTable *table,
-    AssignExpr *expr, void *data)
-{
-    sll_foreach(expr->leftExprs, node) {
-        AssignPrefix *prefix = slNode_getData(node);
-        table->traverse_AssignPrefix(table, prefix, data);
-    }
+TraversalAncestor traversal_ancestor(size_t up) {
+    TraversalAncestors *stack = &g_traversalAncestors;
+    if (up >= stack->numAncestors)
+        return (TraversalAncestor){ .type = Traversal_Count };
 
-    table->traverse_ConditionalExpr(table, &(expr->rightExpr), data);
+    return stack->ancestors[stack->numAncestors - 1 - up];
 }
 
-void defaultTraversal_InnerExpr(TraversalFuncTable *table,
-    InnerExpr *expr, void *data)
-{
-    if (expr->type == InnerExpr_Assign)
-        table->traverse_AssignExpr(table, &(expr->assign), data);
-    else if (expr->type == InnerExpr_CompoundStatement)
-        table->traverse_CompoundStmt(table, expr->compoundStmt, data);
+TraversalAncestor traversal_parent() {
+    return traversal_ancestor(1);
 }
 
-void defaultTraversal_Expr(TraversalFuncTable *table,
-    Expr *expr, void *data)
-{
-    sll_foreach(expr->list, node) {
-        InnerExpr *inner = slNode_getData(node);
-        table->traverse_InnerExpr(table, inner, data);
-    }
-}
+// A walk past the recursion limit goes on with a stack of this size
+#define DeeperStackSize ((size_t)MaxTraversalRecursion * 16 * 1024)
 
-void defaultTraversal_ParameterDeclaration(TraversalFuncTable *table,
-    ParameterDeclaration *decl, void *data)
-{
-    table->traverse_DeclarationSpecifierList(table, decl->declarationSpecifiers, data);
+typedef struct {
+    void (*func)(void *data);
+    void *data;
+    // Handed to the thread and back, so the walk carries on with them
+    TraversalAncestors ancestors;
+    Arena legacyScratch;
+} DeeperCall;
 
-    if (decl->hasDeclarator)
-        table->traverse_Declarator(table, decl->declarator, data);
+static void *deeperCall_run(void *data) {
+    DeeperCall *call = data;
+    g_traversalAncestors = call->ancestors;
+    g_legacyScratch = call->legacyScratch;
 
-    if (decl->hasAbstractDeclarator)
-        table->traverse_AbstractDeclarator(table, decl->abstractDeclarator, data);
-}
+    call->func(call->data);
 
-void defaultTraversal_ParameterTypeList(TraversalFuncTable *table,
-    ParameterTypeList *list, void *data)
-{
-    sll_foreach(list->paramDecls, node) {
-        ParameterDeclaration *decl = slNode_getData(node);
-        table->traverse_ParameterDeclaration(table, decl, data);
-    }
+    call->ancestors = g_traversalAncestors;
+    call->legacyScratch = g_legacyScratch;
+    return NULL;
 }
 
-void defaultTraversal_PostDirectAbstractDeclarator(TraversalFuncTable *table,
-    PostDirectAbstractDeclarator *decl, void *data)
-{
-    if (decl->type == PostDirectAbstractDeclarator_Bracket) {
-        sll_foreach(decl->bracketTypeQualifiers, node) {
-            TypeQualifier *qual = slNode_getData(node);
-            table->traverse_TypeQualifier(table, qual, data);
-        }
+void traversal_callDeeper(void (*func)(void *data), void *data) {
+    DeeperCall call = {
+        .func = func,
+        .data = data,
+        .ancestors = g_traversalAncestors,
+        .legacyScratch = g_legacyScratch,
+    };
 
-        table->traverse_AssignExpr(table, &(decl->bracketAssignExpr), data);
-    }
-    else if (decl->type == PostDirectAbstractDeclarator_Paren) {
-        table->traverse_ParameterTypeList(table, &(decl->parenParamList), data);
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, DeeperStackSize);
+
+    // Without a thread the walk just goes deeper on this one
+    pthread_t thread;
+    if (pthread_create(&thread, &attr, deeperCall_run, &call) == 0) {
+        pthread_join(thread, NULL);
+        g_traversalAncestors = call.ancestors;
+        g_legacyScratch = call.legacyScratch;
     }
     else {
-        assert(false);
+        func(data);
     }
-}
-
-void defaultTraversal_DirectAbstractDeclarator(TraversalFuncTable *table,
-    DirectAbstractDeclarator *decl, void *data)
-{
-    if (decl->hasAbstractDeclarator)
-        table->traverse_AbstractDeclarator(table, decl->abstractDeclarator, data);
 
-    sll_foreach(decl->postDirectAbstractDeclarators, node) {
-        PostDirectAbstractDeclarator *post = slNode_getData(node);
-        table->traverse_PostDirectAbstractDeclarator(table, post, data);
-    }
+    pthread_attr_destroy(&attr);
 }
 
-void defaultTraversal_Pointer(TraversalFuncTable *table,
-    Pointer *pointer, void *data)
-{
-    if (pointer == NULL)
-        return;
+ArenaMark traversal_buildLegacyLevels(BinaryExpr *expr, LogicalOrExpr *out) {
+    ArenaMark mark = arena_mark(&g_legacyScratch);
+    legacyLogicalOr(expr, out);
 
-    sll_foreach(pointer->typeQualifiers, node) {
-        TypeQualifier *qual = slNode_getData(node);
-        table->traverse_TypeQualifier(table, qual, data);
-    }
+    return mark;
+}
 
-    table->traverse_Pointer(table, pointer->pointer, data);
+void traversal_releaseLegacyLevels(ArenaMark mark) {
+    arena_rollback(&g_legacyScratch, mark);
 }
 
-void defaultTraversal_AbstractDeclarator(TraversalFuncTable *table,
-    AbstractDeclarator *decl, void *data)
-{
-    if (decl->hasPointer)
-        table->traverse_Pointer(table, &(decl->pointer), data);
+#define TraversalBody(type, name) void defaultTraversal_ ## type(\
+    TraversalFuncTable *table, type *name, void *data)
+#define TraverseChild(type, node) do {\
+    type *child = (node);\
+    traversal_pushAncestor(Traversal_ ## type, child);\
+    table->traverse_ ## type(table, child, data);\
+    traversal_popAncestor();\
+} while (0)
+#define TraversalLegacyLevels usesLegacyBinaryHooks(table)
+#define TraversalPrune(node)
+#include "traversalBodies.h"
 
-    if (decl->hasDirectAbstractDeclarator)
-        table->traverse_DirectAbstractDeclarator(table, &(decl->directAbstractDeclarator), data);
-}
+#define SetDefaultTraversalFunc(type) table.traverse_ ## type = defaultTraversal_ ## type;
 
-void defaultTraversal_IdentifierList(TraversalFuncTable *table,
-    IdentifierList *list, void *data)
-{
-    // Traverse no further
+TraversalFuncTable defaultTraversal() {
+    TraversalFuncTable table = {0};
+    TraversalTypes(SetDefaultTraversalFunc)
+
+    return table;
 }
 
-void defaultTraversal_PostDirectDeclarator(TraversalFuncTable *table,
-    PostDirectDeclarator *decl, void *data)
-{
-    if (decl->type == PostDirectDeclarator_Bracket) {
-        sll_foreach(decl->bracketTypeQualifiers, node) {
-            TypeQualifier *qual = slNode_getData(node);
-            table->traverse_TypeQualifier(table, qual, data);
+typedef struct {
+    void *node;
+    TraversalType type;
+    bool entered;
+    // Set when the node's legacy levels are rolled back on leaving it
+    bool builtLegacy;
+} WalkFrame;
+
+typedef struct {
+    // First so the walk is its own collecting table. A node's children are
+    // found by running its default traversal with it.
+    TraversalFuncTable collector;
+    bool legacyLevels;
+
+    size_t numFrames;
+    size_t frameCapacity;
+    WalkFrame *frames;
+
+    // One for every entered ConditionalExpr that built its legacy levels
+    size_t numLegacyMarks;
+    size_t legacyMarkCapacity;
+    ArenaMark *legacyMarks;
+} TraversalWalk;
+
+static void walk_push(TraversalWalk *walk, TraversalType type, void *node) {
+    walk->frames = growArray(walk->frames, &(walk->frameCapacity),
+        walk->numFrames + 1, sizeof(WalkFrame));
+    walk->frames[walk->numFrames++] = (WalkFrame){
+        .node = node,
+        .type = type,
+    };
+}
+
+#define CollectTraversalFunc(type)\
+static void collectTraversal_ ## type(TraversalFuncTable *table, type *node,\
+    void *data)\
+{\
+    walk_push((TraversalWalk*)table, Traversal_ ## type, node);\
+}
+TraversalTypes(CollectTraversalFunc)
+#undef CollectTraversalFunc
+
+// Pushes the children of the last frame so the first one is on top
+static void walk_expand(TraversalWalk *walk) {
+    size_t frameIndex = walk->numFrames - 1;
+    WalkFrame frame = walk->frames[frameIndex];
+    TraversalFuncTable *collector = &(walk->collector);
+
+    // The legacy levels have to outlive the subtree, so they're built here
+    // instead of on the stack of the default traversal
+    if (frame.type == Traversal_ConditionalExpr) {
+        ConditionalExpr *expr = frame.node;
+
+        if (walk->legacyLevels) {
+            walk->legacyMarks = growArray(walk->legacyMarks,
+                &(walk->legacyMarkCapacity), walk->numLegacyMarks + 1,
+                sizeof(ArenaMark));
+            walk->legacyMarks[walk->numLegacyMarks++] =
+                arena_mark(&g_legacyScratch);
+            walk->frames[frameIndex].builtLegacy = true;
+
+            LogicalOrExpr *logicalOr = arena_alloc(&g_legacyScratch,
+                sizeof(LogicalOrExpr));
+            *logicalOr = (LogicalOrExpr){0};
+            legacyLogicalOr(expr->beforeExpr, logicalOr);
+
+            collector->traverse_LogicalOrExpr(collector, logicalOr, NULL);
+        }
+        else {
+            collector->traverse_BinaryExpr(collector, expr->beforeExpr, NULL);
         }
 
-        if (decl->bracketHasAssignExpr)
-            table->traverse_AssignExpr(table, &(decl->bracketAssignExpr), data);
-    }
-    else if (decl->type == PostDirectDeclarator_Paren) {
-        if (decl->parenType == PostDirectDeclaratorParen_IdentList)
-            table->traverse_IdentifierList(table, &(decl->parenIdentList), data);
-        else if (decl->parenType == PostDirectDeclaratorParen_ParamTypelist)
-            table->traverse_ParameterTypeList(table, &(decl->parenParamTypeList), data);
-    }
-}
-
-void defaultTraversal_DirectDeclarator(TraversalFuncTable *table,
-    DirectDeclarator *decl, void *data)
-{
-    if (decl->type == DirectDeclarator_Ident) {
-        // Do Nothing
+        if (expr->hasConditionalOp) {
+            collector->traverse_Expr(collector, expr->ifTrueExpr, NULL);
+            collector->traverse_ConditionalExpr(collector, expr->ifFalseExpr,
+                NULL);
+        }
     }
-    else if (decl->type == DirectDeclarator_ParenDeclarator) {
-        table->traverse_Declarator(table, decl->declarator, data);
+    else {
+        switch (frame.type) {
+#define ExpandTraversalCase(type)\
+        case Traversal_ ## type:\
+            defaultTraversal_ ## type(collector, frame.node, NULL);\
+            break;
+        TraversalTypes(ExpandTraversalCase)
+#undef ExpandTraversalCase
+        default:
+            assert(false);
+        }
     }
 
-    sll_foreach(decl->postDirectDeclarators, node) {
-        PostDirectDeclarator *post = slNode_getData(node);
-        table->traverse_PostDirectDeclarator(table, post, data);
+    // They were pushed in visiting order
+    WalkFrame *first = walk->frames + frameIndex + 1;
+    WalkFrame *last = walk->frames + walk->numFrames - 1;
+    while (first < last) {
+        WalkFrame temp = *first;
+        *first++ = *last;
+        *last-- = temp;
     }
 }
 
-void defaultTraversal_Declarator(TraversalFuncTable *table,
-    Declarator *decl, void *data)
+static void walkIteratively(TraversalType type, void *node, bool legacyLevels,
+    TraversalVisitor visitor, void *data)
 {
-    if (decl->hasPointer)
-        table->traverse_Pointer(table, &(decl->pointer), data);
+    TraversalWalk walk = { .legacyLevels = legacyLevels };
 
-    table->traverse_DirectDeclarator(table, &(decl->directDeclarator), data);
-}
+#define SetCollectTraversalFunc(type)\
+    walk.collector.traverse_ ## type = collectTraversal_ ## type;
+    TraversalTypes(SetCollectTraversalFunc)
+#undef SetCollectTraversalFunc
 
-void defaultTraversal_TypeQualifier(TraversalFuncTable *table,
-    TypeQualifier *qual, void *data)
-{
-    // No need to go further
-}
-
-void defaultTraversal_SpecifierQualifier(TraversalFuncTable *table,
-    SpecifierQualifier *spec, void *data)
-{
-    if (spec->type == SpecifierQualifier_Specifier)
-        table->traverse_TypeSpecifier(table, spec->typeSpecifier, data);
-    else if (spec->type == SpecifierQualifier_Qualifier)
-        table->traverse_TypeQualifier(table, &(spec->typeQualifier), data);
-    else
-        assert(false);
-}
-
-void defaultTraversal_SpecifierQualifierList(TraversalFuncTable *table,
-    SpecifierQualifierList *list, void *data)
-{
-    sll_foreach(list->list, node) {
-        SpecifierQualifier *spec = slNode_getData(node);
-        table->traverse_SpecifierQualifier(table, spec, data);
-    }
-}
+    walk_push(&walk, type, node);
 
-void defaultTraversal_TypeName(TraversalFuncTable *table,
-    TypeName *type, void *data)
-{
-    table->traverse_SpecifierQualifierList(table, &(type->specifierQualifiers), data);
+    while (walk.numFrames > 0) {
+        WalkFrame *frame = walk.frames + walk.numFrames - 1;
 
-    if (type->hasAbstractDeclarator)
-        table->traverse_AbstractDeclarator(table, &(type->abstractDeclarator), data);
-}
+        // The root is already on the ancestor stack of whoever started the
+        // walk
+        bool isRoot = frame == walk.frames;
 
-void defaultTraversal_StructDeclarator(TraversalFuncTable *table,
-    StructDeclarator *decl, void *data)
-{
-    if (decl->hasDeclarator)
-        table->traverse_Declarator(table, &(decl->declarator), data);
+        if (!frame->entered) {
+            frame->entered = true;
+            if (!isRoot)
+                traversal_pushAncestor(frame->type, frame->node);
 
-    if (decl->hasConstExpr)
-        table->traverse_ConditionalExpr(table, &(decl->constExpr), data);
-}
+            if (visitor(TraversalEvent_Enter, frame->type, frame->node, data))
+                walk_expand(&walk);
 
-void defaultTraversal_StructDeclaratorList(TraversalFuncTable *table,
-    StructDeclaratorList *list, void *data)
-{
-    sll_foreach(list->list, node) {
-        StructDeclarator *decl = slNode_getData(node);
-        table->traverse_StructDeclarator(table, decl, data);
-    }
-}
+            continue;
+        }
 
-void defaultTraversal_StaticAssertDeclaration(TraversalFuncTable *table,
-    StaticAssertDeclaration *decl, void *data)
-{
-    table->traverse_ConditionalExpr(table, &(decl->constantExpr), data);
-}
+        visitor(TraversalEvent_Leave, frame->type, frame->node, data);
+        if (!isRoot)
+            traversal_popAncestor();
 
-void defaultTraversal_StructDeclaration(TraversalFuncTable *table,
-    StructDeclaration *decl, void *data)
-{
-    if (decl->type == StructDeclaration_StaticAssert) {
-        table->traverse_StaticAssertDeclaration(table, &(decl->staticAssert), data);
-    }
-    else if (decl->type == StructDeclaration_Normal) {
-        table->traverse_SpecifierQualifierList(table, &(decl->normalSpecifierQualifiers), data);
-        if (decl->normalHasStructDeclaratorList) {
-            table->traverse_StructDeclaratorList(table, &(decl->normalStructDeclaratorList), data);
+        if (frame->builtLegacy) {
+            walk.numLegacyMarks--;
+            arena_rollback(&g_legacyScratch,
+                walk.legacyMarks[walk.numLegacyMarks]);
         }
-    }
-    else {
-        assert(false);
-    }
-}
 
-void defaultTraversal_StructOrUnionSpecifier(TraversalFuncTable *table,
-    StructOrUnionSpecifier *enumerator, void *data)
-{
-    if (enumerator->hasStructDeclarationList) {
-        sll_foreach(enumerator->structDeclarations, node) {
-            ConditionalExpr *expr = slNode_getData(node);
-            table->traverse_ConditionalExpr(table, expr, data);
-        }
+        walk.numFrames--;
+    }
+
+    free(walk.frames);
+    free(walk.legacyMarks);
+}
+
+typedef struct {
+    // First so hooks can be given the whole walk as their table
+    TraversalFuncTable table;
+    bool legacyLevels;
+    TraversalVisitor visitor;
+    void *data;
+    size_t depth;
+} EventTraversal;
+
+#define EventTraversalFunc(type)\
+static void eventTraversal_ ## type(TraversalFuncTable *table, type *node,\
+    void *data)\
+{\
+    EventTraversal *events = (EventTraversal*)table;\
+\
+    if (events->depth == MaxTraversalRecursion) {\
+        walkIteratively(Traversal_ ## type, node, events->legacyLevels,\
+            events->visitor, events->data);\
+        return;\
+    }\
+\
+    if (events->visitor(TraversalEvent_Enter, Traversal_ ## type, node,\
+        events->data))\
+    {\
+        events->depth++;\
+        defaultTraversal_ ## type(table, node, data);\
+        events->depth--;\
+    }\
+\
+    events->visitor(TraversalEvent_Leave, Traversal_ ## type, node,\
+        events->data);\
+}
+TraversalTypes(EventTraversalFunc)
+#undef EventTraversalFunc
+
+void traverseEvents(TranslationUnit *unit, bool legacyLevels,
+    TraversalVisitor visitor, void *data)
+{
+    EventTraversal events = {
+        .legacyLevels = legacyLevels,
+        .visitor = visitor,
+        .data = data,
+    };
+
+#define SetEventTraversalFunc(type)\
+    events.table.traverse_ ## type = eventTraversal_ ## type;
+    TraversalTypes(SetEventTraversalFunc)
+#undef SetEventTraversalFunc
+
+    // Without the legacy levels, ConditionalExprs go straight to their
+    // BinaryExprs
+    if (!legacyLevels) {
+#define SetLegacyDefault(type)\
+        events.table.traverse_ ## type = defaultTraversal_ ## type;
+        LegacyBinaryTypes(SetLegacyDefault)
+#undef SetLegacyDefault
+    }
+
+    traversal_pushAncestor(Traversal_TranslationUnit, unit);
+    events.table.traverse_TranslationUnit(&(events.table), unit, NULL);
+    traversal_popAncestor();
+}
+
+// traverse() and traverseAll() recurse through the tables' own hooks, so
+// a hook that continues with the default traversal has the node's children
+// visited before the call returns. A walk keeps track of which tables visit
+// each node. Tables whose hook for the node's type is the default stay with
+// the walk through the whole subtree. The rest get their hook called with a
+// table of the walk's that visits the children the hook asks for with that
+// table alone, so a hook that doesn't continue prunes the subtree for its
+// table only. Tables also leave the walk at Exprs, Statements and
+// Declarations the parser found none of their hooked kinds under.
+
+typedef uint64_t TableMask;
+#define MaxWalkTables 64
+
+typedef struct TableWalk TableWalk;
+
+// The walk's tables. Each one visits the nodes it's given with the tables in
+// its mask, or with the tables that continued past the parent when the mask
+// is 0.
+typedef struct {
+    // First so it can be passed wherever a table is expected
+    TraversalFuncTable table;
+    TableWalk *walk;
+    TableMask mask;
+} WalkTable;
+
+struct TableWalk {
+    size_t numTables;
+    TraversalFuncTable *tables;
+    void **data;
+
+    // The one the walk continues through, and one for the hooks of each table
+    WalkTable shared;
+    WalkTable *hookTables;
+
+    // Tables with a hook other than the default for each type
+    TableMask hooked[Traversal_Count];
+    // Tables that only hook kinds the parser keeps track of, and those kinds
+    TableMask prunable;
+    NodeKindMask wanted[MaxWalkTables];
+
+    // Tables that continue into the children of the node being visited
+    TableMask inherited;
+    size_t depth;
+};
+
+NodeKindMask traversal_nodeKinds(TraversalType type, void *node) {
+    switch (type) {
+    case Traversal_Expr:
+        return ((Expr*)node)->kinds;
+    case Traversal_Statement:
+        return ((Statement*)node)->kinds;
+    case Traversal_Declaration:
+        return ((Declaration*)node)->kinds;
+    default:
+        return AllNodeKinds;
+    }
+}
+
+// Drops the tables that don't hook any kind under the node
+static TableMask walk_prune(TableWalk *walk, TableMask continued,
+    TraversalType type, void *node)
+{
+    NodeKindMask kinds = traversal_nodeKinds(type, node);
+    if (kinds == AllNodeKinds)
+        return continued;
+
+    TableMask prunable = continued & walk->prunable;
+    for (size_t i = 0; prunable != 0; i++) {
+        TableMask bit = (TableMask)1 << i;
+        if ((prunable & bit) == 0)
+            continue;
+
+        prunable &= ~bit;
+        if ((walk->wanted[i] & kinds) == 0)
+            continued &= ~bit;
+    }
+
+    return continued;
+}
+
+static void walk_callHook(TableWalk *walk, size_t index, TraversalType type,
+    void *node)
+{
+    TraversalFuncTable *hooks = walk->tables + index;
+    TraversalFuncTable *table = &(walk->hookTables[index].table);
+    void *data = walk->data[index];
+
+    switch (type) {
+#define WalkHookCase(type)\
+    case Traversal_ ## type:\
+        hooks->traverse_ ## type(table, node, data);\
+        break;
+    TraversalTypes(WalkHookCase)
+#undef WalkHookCase
+    default:
+        assert(false);
     }
 }
 
-void defaultTraversal_Enumerator(TraversalFuncTable *table,
-    Enumerator *enumerator, void *data)
+// Calls the hooks of the tables that reach the node and returns the ones that
+// continue into its children
+static TableMask walk_enter(TableWalk *walk, TableMask reached,
+    TraversalType type, void *node)
 {
-    if (enumerator->hasConstExpr) {
-        table->traverse_ConditionalExpr(table, &(enumerator->constantExpr), data);
-    }
-}
+    TableMask hooked = reached & walk->hooked[type];
+    for (size_t i = 0; hooked != 0; i++) {
+        TableMask bit = (TableMask)1 << i;
+        if ((hooked & bit) == 0)
+            continue;
 
-void defaultTraversal_EnumeratorList(TraversalFuncTable *table,
-    EnumeratorList *list, void *data)
-{
-    sll_foreach(list->list, node) {
-        Enumerator *enumerator = slNode_getData(node);
-        table->traverse_Enumerator(table, enumerator, data);
+        hooked &= ~bit;
+        walk_callHook(walk, i, type, node);
     }
-}
 
-void defaultTraversal_EnumSpecifier(TraversalFuncTable *table,
-    EnumSpecifier *spec, void *data)
-{
-    if (spec->hasEnumeratorList) {
-        table->traverse_EnumeratorList(table, &(spec->enumeratorList), data);
-    }
+    return walk_prune(walk, reached & ~walk->hooked[type], type, node);
 }
 
-void defaultTraversal_TypeSpecifier(TraversalFuncTable *table,
-    TypeSpecifier *spec, void *data)
-{
-    if (spec->type == TypeSpecifier_AtomicType) {
-        table->traverse_TypeName(table, &(spec->atomicName), data);
-    }
-    else if (spec->type == TypeSpecifier_StructOrUnion) {
-        table->traverse_StructOrUnionSpecifier(table, &(spec->structOrUnion), data);
-    }
-    else if (spec->type == TypeSpecifier_Enum) {
-        table->traverse_EnumSpecifier(table, &(spec->enumSpecifier), data);
-    }
-}
+typedef struct {
+    WalkTable *table;
+    TraversalType type;
+    void *node;
+} DeeperVisit;
 
-void defaultTraversal_StorageClassSpecifier(TraversalFuncTable *table,
-    StorageClassSpecifier *spec, void *data)
-{
-    // Can't go deeper
-}
+static void walk_visitDeeper(void *data) {
+    DeeperVisit *visit = data;
+    TraversalFuncTable *table = &(visit->table->table);
+    TableWalk *walk = visit->table->walk;
 
-void defaultTraversal_FunctionSpecifier(TraversalFuncTable *table,
-    FunctionSpecifier *spec, void *data)
-{
-    // Can't go deeper
-}
+    size_t depth = walk->depth;
+    walk->depth = 0;
 
-void defaultTraversal_AlignmentSpecifier(TraversalFuncTable *table,
-    AlignmentSpecifier *spec, void *data)
-{
-    if (spec->type == AlignmentSpecifier_TypeName) {
-        table->traverse_TypeName(table, &(spec->typeName), data);
-    }
-    else if (spec->type == AlignmentSpecifier_Constant) {
-        table->traverse_ConditionalExpr(table, &(spec->constant), data);
-    }
-    else {
+    switch (visit->type) {
+#define DeeperVisitCase(type)\
+    case Traversal_ ## type:\
+        table->traverse_ ## type(table, visit->node, NULL);\
+        break;
+    TraversalTypes(DeeperVisitCase)
+#undef DeeperVisitCase
+    default:
         assert(false);
     }
-}
 
-void defaultTraversal_DeclarationSpecifier(TraversalFuncTable *table,
-    DeclarationSpecifier *list, void *data)
-{
-    switch(list->type) {
-        case DeclarationSpecifier_StorageClass: {
-            table->traverse_StorageClassSpecifier(table, &(list->storageClass), data);
-            break;
-        }
-        case DeclarationSpecifier_Type: {
-            table->traverse_TypeSpecifier(table, &(list->typeSpecifier), data);
-            break;
-        }
-        case DeclarationSpecifier_TypeQualifier: {
-            table->traverse_TypeQualifier(table, &(list->typeQualifier), data);
-            break;
-        }
-        case DeclarationSpecifier_Func: {
-            table->traverse_FunctionSpecifier(table, &(list->function), data);
-            break;
+    walk->depth = depth;
+}
+
+#define WalkTraversalFunc(type)\
+static void walkTraversal_ ## type(TraversalFuncTable *table, type *node,\
+    void *data)\
+{\
+    WalkTable *from = (WalkTable*)table;\
+    TableWalk *walk = from->walk;\
+\
+    if (walk->depth == MaxTraversalRecursion) {\
+        DeeperVisit visit = { from, Traversal_ ## type, node };\
+        traversal_callDeeper(walk_visitDeeper, &visit);\
+        return;\
+    }\
+\
+    TableMask reached = from->mask != 0 ? from->mask : walk->inherited;\
+    walk->depth++;\
+    TableMask continued = walk_enter(walk, reached, Traversal_ ## type, node);\
+\
+    /* Nothing below is visited by any of the tables */\
+    if (continued != 0) {\
+        TableMask inherited = walk->inherited;\
+        walk->inherited = continued;\
+        defaultTraversal_ ## type(&(walk->shared.table), node, NULL);\
+        walk->inherited = inherited;\
+    }\
+    walk->depth--;\
+}
+TraversalTypes(WalkTraversalFunc)
+#undef WalkTraversalFunc
+
+static void walk_initTable(TableWalk *walk, WalkTable *table, TableMask mask,
+    bool legacyLevels)
+{
+    *table = (WalkTable){ .walk = walk, .mask = mask };
+
+#define SetWalkTraversalFunc(type)\
+    table->table.traverse_ ## type = walkTraversal_ ## type;
+    TraversalTypes(SetWalkTraversalFunc)
+#undef SetWalkTraversalFunc
+
+    // Without the legacy levels, ConditionalExprs go straight to their
+    // BinaryExprs
+    if (!legacyLevels) {
+#define SetLegacyDefault(type)\
+        table->table.traverse_ ## type = defaultTraversal_ ## type;
+        LegacyBinaryTypes(SetLegacyDefault)
+#undef SetLegacyDefault
+    }
+}
+
+static void traverseTables(size_t numTables, TraversalFuncTable *tables,
+    void **data, TranslationUnit *unit)
+{
+    assert(numTables <= MaxWalkTables);
+
+    bool legacyLevels = false;
+    for (size_t i = 0; i < numTables; i++) {
+        legacyLevels = legacyLevels || usesLegacyBinaryHooks(tables + i);
+    }
+
+    TableWalk walk = {
+        .numTables = numTables,
+        .tables = tables,
+        .data = data,
+        .hookTables = malloc(numTables * sizeof(WalkTable)),
+    };
+    assert(numTables == 0 || walk.hookTables != NULL);
+
+    walk_initTable(&walk, &(walk.shared), 0, legacyLevels);
+
+    for (size_t i = 0; i < numTables; i++) {
+        TraversalFuncTable *table = tables + i;
+        bool prunable = true;
+#define SetHooked(type)\
+        if (table->traverse_ ## type != defaultTraversal_ ## type) {\
+            walk.hooked[Traversal_ ## type] |= (TableMask)1 << i;\
+            NodeKindMask kind = traversal_trackedKind(Traversal_ ## type);\
+            prunable = prunable && kind != AllNodeKinds;\
+            walk.wanted[i] |= kind;\
         }
-        case DeclarationSpecifier_Alignment: {
-            table->traverse_AlignmentSpecifier(table, &(list->alignment), data);
-            break;
-        }
-        default:
-            assert(false);
-            break;
-    }
-}
-
-void defaultTraversal_DeclarationSpecifierList(TraversalFuncTable *table,
-    DeclarationSpecifierList *list, void *data)
-{
-    sll_foreach(list->list, node) {
-        DeclarationSpecifier *decl = slNode_getData(node);
-        table->traverse_DeclarationSpecifier(table, decl, data);
-    }
-}
+        TraversalTypes(SetHooked)
+#undef SetHooked
 
-void defaultTraversal_InitDeclarator(TraversalFuncTable *table,
-    InitDeclarator *decl, void *data)
-{
-    table->traverse_Declarator(table, &(decl->decl), data);
-    if (decl->hasInitializer)
-        table->traverse_Initializer(table, &(decl->initializer), data);
-}
+        if (prunable)
+            walk.prunable |= (TableMask)1 << i;
 
-void defaultTraversal_InitDeclaratorList(TraversalFuncTable *table,
-    InitDeclaratorList *list, void *data)
-{
-    sll_foreach(list->list, node) {
-        InitDeclarator *decl = slNode_getData(node);
-        table->traverse_InitDeclarator(table, decl, data);
+        walk_initTable(&walk, walk.hookTables + i, (TableMask)1 << i,
+            legacyLevels);
     }
-}
 
-void defaultTraversal_Declaration(TraversalFuncTable *table,
-    Declaration *decl, void *data)
-{
-    if (decl->type == Declaration_StaticAssert) {
-        table->traverse_StaticAssertDeclaration(table, &(decl->staticAssert), data);
-    }
-    else if (decl->type == Declaration_Normal) {
-        table->traverse_DeclarationSpecifierList(table, &(decl->declSpecifiers),
-            data);
-        if (decl->hasInitDeclaratorList) {
-            table->traverse_InitDeclaratorList(table, &(decl->initDeclaratorList),
-                data);
-        }
-    }
-}
+    // Every table starts out at the root
+    walk.inherited = numTables == MaxWalkTables ? ~(TableMask)0 :
+        ((TableMask)1 << numTables) - 1;
 
-void defaultTraversal_LabeledStatement(TraversalFuncTable *table,
-    LabeledStatement *stmt, void *data)
-{
-    if (stmt->type == LabeledStatement_Case) {
-        table->traverse_ConditionalExpr(table, &(stmt->caseConstExpr), data);
-    }
+    DeeperVisit visit = { &(walk.shared), Traversal_TranslationUnit, unit };
+    traversal_pushAncestor(Traversal_TranslationUnit, unit);
+    walk_visitDeeper(&visit);
+    traversal_popAncestor();
 
-    table->traverse_Statement(table, stmt->stmt, data);
+    free(walk.hookTables);
 }
 
-void defaultTraversal_SelectionStatement(TraversalFuncTable *table,
-    SelectionStatement *stmt, void *data)
+void traverseAll(size_t numTables, TraversalFuncTable *tables, void **data,
+    TranslationUnit unit)
 {
-    if (stmt->type == SelectionStatement_If) {
-        table->traverse_Expr(table, &(stmt->ifExpr), data);
-        table->traverse_Statement(table, stmt->ifTrueStmt, data);
-        if (stmt->ifHasElse) {
-            table->traverse_Statement(table, stmt->ifFalseStmt, data);
-        }
-    }
-    else if (stmt->type == SelectionStatement_Switch) {
-        table->traverse_Expr(table, &(stmt->switchExpr), data);
-        table->traverse_Statement(table, stmt->switchStmt, data);
+    // A walk either builds the legacy levels or visits the BinaryExprs. When
+    // some tables need the legacy levels, the ones that hook BinaryExpr
+    // instead get a walk of their own.
+    bool anyLegacy = false;
+    for (size_t i = 0; i < numTables; i++) {
+        anyLegacy = anyLegacy || usesLegacyBinaryHooks(tables + i);
     }
-    else {
-        assert(false);
-    }
-}
 
-void defaultTraversal_ExpressionStatement(TraversalFuncTable *table,
-    ExpressionStatement *stmt, void *data)
-{
-    if (!stmt->isEmpty) {
-        table->traverse_Expr(table, &(stmt->expr), data);
-    }
-}
-
-void defaultTraversal_IterationStatement(TraversalFuncTable *table,
-    IterationStatement *stmt, void *data)
-{
-    if (stmt->type == IterationStatement_While) {
-        table->traverse_Expr(table, &(stmt->whileExpr), data);
-        table->traverse_Statement(table, stmt->whileStmt, data);
-    }
-    else if (stmt->type == IterationStatement_DoWhile) {
-        table->traverse_Statement(table, stmt->doStmt, data);
-        table->traverse_Expr(table, &(stmt->doExpr), data);
-    }
-    else if (stmt->type == IterationStatement_For) {
-        if (stmt->forHasInitialDeclaration) {
-            table->traverse_Declaration(table, &(stmt->forInitialDeclaration), data);
-        }
+    TraversalFuncTable *group = malloc(numTables * sizeof(TraversalFuncTable));
+    void **groupData = malloc(numTables * sizeof(void*));
+    assert(numTables == 0 || (group != NULL && groupData != NULL));
 
-        table->traverse_ExpressionStatement(table, &(stmt->forInitialExprStmt), data);
-        table->traverse_ExpressionStatement(table, &(stmt->forInnerExprStmt), data);
+    for (int pass = 0; pass < 2; pass++) {
+        size_t groupSize = 0;
+        for (size_t i = 0; i < numTables; i++) {
+            TraversalFuncTable *table = tables + i;
+            bool needsBinary = anyLegacy && !usesLegacyBinaryHooks(table) &&
+                table->traverse_BinaryExpr != defaultTraversal_BinaryExpr;
 
-        if (stmt->forHasFinalExpr) {
-            table->traverse_Expr(table, &(stmt->forFinalExpr), data);
+            if (needsBinary == (pass == 1)) {
+                group[groupSize] = *table;
+                groupData[groupSize] = data[i];
+                groupSize++;
+            }
         }
-        table->traverse_Statement(table, stmt->forStmt, data);
-    }
-    else {
-        assert(false);
-    }
-}
 
-void defaultTraversal_JumpStatement(TraversalFuncTable *table,
-    JumpStatement *stmt, void *data)
-{
-    // Return jump is the only one that needs to traverse deeper
-    if (stmt->type == JumpStatement_Return) {
-        table->traverse_Expr(table, &(stmt->returnExpr), data);
-    }
-}
-
-void defaultTraversal_AsmStatement(TraversalFuncTable *table,
-    AsmStatement *stmt, void *data)
-{
-    // TODO: Implement this if we fill in asm struct
-}
+        for (size_t start = 0; start < groupSize; start += MaxWalkTables) {
+            size_t count = groupSize - start;
+            if (count > MaxWalkTables)
+                count = MaxWalkTables;
 
-void defaultTraversal_Statement(TraversalFuncTable *table,
-    Statement *stmt, void *data)
-{
-    switch (stmt->type) {
-        case Statement_Labeled: {
-            table->traverse_LabeledStatement(table, &(stmt->labeled), data);
-            break;
-        }
-        case Statement_Compound: {
-            table->traverse_CompoundStmt(table, stmt->compound, data);
-            break;
-        }
-        case Statement_Expression: {
-            table->traverse_ExpressionStatement(table, &(stmt->expression), data);
-            break;
-        }
-        case Statement_Selection: {
-            table->traverse_SelectionStatement(table, &(stmt->selection), data);
-            break;
-        }
-        case Statement_Iteration: {
-            table->traverse_IterationStatement(table, &(stmt->iteration), data);
-            break;
+            traverseTables(count, group + start, groupData + start, &unit);
         }
-        case Statement_Jump: {
-            table->traverse_JumpStatement(table, &(stmt->jump), data);
-            break;
-        }
-        case Statement_Asm: {
-            table->traverse_AsmStatement(table, &(stmt->assembly), data);
-            break;
-        }
-        default: {
-            assert(false);
-            break;
-        }
-    }
-}
-
-void defaultTraversal_BlockItem(TraversalFuncTable *table,
-    BlockItem *item, void *data)
-{
-    if (item->type == BlockItem_Declaration) {
-        table->traverse_Declaration(table, &(item->decl), data);
-    }
-    else if (item->type == BlockItem_Statement) {
-        table->traverse_Statement(table, &(item->stmt), data);
-    }
-    else {
-        assert(false);
-    }
-}
-
-void defaultTraversal_BlockItemList(TraversalFuncTable *table,
-    BlockItemList *list, void *data)
-{
-    sll_foreach(list->list, node) {
-        BlockItem *item = slNode_getData(node);
-        table->traverse_BlockItem(table, item, data);
-    }
-}
-
-void defaultTraversal_CompoundStmt(TraversalFuncTable *table,
-    CompoundStmt *stmt, void *data)
-{
-    if (!stmt->isEmpty) {
-        table->traverse_BlockItemList(table, &(stmt->blockItemList), data);
-    }
-}
-
-void defaultTraversal_FuncDef(TraversalFuncTable *table,
-    FuncDef *def, void *data)
-{
-    table->traverse_DeclarationSpecifierList(table, &(def->specifiers), data);
-    table->traverse_Declarator(table, &(def->declarator), data);
-
-    sll_foreach(def->declarations, node) {
-        Declaration *decl = slNode_getData(node);
-        table->traverse_Declaration(table, decl, data);
     }
 
-    table->traverse_CompoundStmt(table, &(def->stmt), data);
-}
-
-void defaultTraversal_ExternalDecl(TraversalFuncTable *table,
-    ExternalDecl *decl, void *data)
-{
-    if (decl->type == ExternalDecl_FuncDef) {
-        table->traverse_FuncDef(table, &(decl->func), data);
-    }
-    else if (decl->type == ExternalDecl_Decl) {
-        table->traverse_Declaration(table, &(decl->decl), data);
-    }
-    else {
-        assert(false);
-    }
-}
-
-void defaultTraversal_TranslationUnit(TraversalFuncTable *table,
-    TranslationUnit *unit, void *data)
-{
-    sll_foreach(unit->externalDecls, node) {
-        ExternalDecl *externalDecl = slNode_getData(node);
-        table->traverse_ExternalDecl(table, externalDecl, data);
-    }
-}
-
-#define SetDefaultTraversalFunc(type) table.traverse_ ## type = defaultTraversal_ ## type
-
-TraversalFuncTable defaultTraversal() {
-    TraversalFuncTable table = {0};
-    SetDefaultTraversalFunc(TranslationUnit);
-    SetDefaultTraversalFunc(ExternalDecl);
-    SetDefaultTraversalFunc(FuncDef);
-    SetDefaultTraversalFunc(CompoundStmt);
-    SetDefaultTraversalFunc(BlockItemList);
-    SetDefaultTraversalFunc(BlockItem);
-    SetDefaultTraversalFunc(Statement);
-    SetDefaultTraversalFunc(AsmStatement);
-    SetDefaultTraversalFunc(JumpStatement);
-    SetDefaultTraversalFunc(IterationStatement);
-    SetDefaultTraversalFunc(ExpressionStatement);
-    SetDefaultTraversalFunc(SelectionStatement);
-    SetDefaultTraversalFunc(LabeledStatement);
-    SetDefaultTraversalFunc(Declaration);
-    SetDefaultTraversalFunc(InitDeclaratorList);
-    SetDefaultTraversalFunc(InitDeclarator);
-    SetDefaultTraversalFunc(DeclarationSpecifierList);
-    SetDefaultTraversalFunc(DeclarationSpecifier);
-    SetDefaultTraversalFunc(AlignmentSpecifier);
-    SetDefaultTraversalFunc(FunctionSpecifier);
-    SetDefaultTraversalFunc(StorageClassSpecifier);
-    SetDefaultTraversalFunc(TypeSpecifier);
-    SetDefaultTraversalFunc(EnumSpecifier);
-    SetDefaultTraversalFunc(EnumeratorList);
-    SetDefaultTraversalFunc(Enumerator);
-    SetDefaultTraversalFunc(StructOrUnionSpecifier);
-    SetDefaultTraversalFunc(StructDeclaration);
-    SetDefaultTraversalFunc(StaticAssertDeclaration);
-    SetDefaultTraversalFunc(StructDeclaratorList);
-    SetDefaultTraversalFunc(StructDeclarator);
-    SetDefaultTraversalFunc(TypeName);
-    SetDefaultTraversalFunc(SpecifierQualifierList);
-    SetDefaultTraversalFunc(SpecifierQualifier);
-    SetDefaultTraversalFunc(TypeQualifier);
-    SetDefaultTraversalFunc(Declarator);
-    SetDefaultTraversalFunc(DirectDeclarator);
-    SetDefaultTraversalFunc(PostDirectDeclarator);
-    SetDefaultTraversalFunc(IdentifierList);
-    SetDefaultTraversalFunc(AbstractDeclarator);
-    SetDefaultTraversalFunc(Pointer);
-    SetDefaultTraversalFunc(DirectAbstractDeclarator);
-    SetDefaultTraversalFunc(PostDirectAbstractDeclarator);
-    SetDefaultTraversalFunc(ParameterTypeList);
-    SetDefaultTraversalFunc(ParameterDeclaration);
-    SetDefaultTraversalFunc(Expr);
-    SetDefaultTraversalFunc(InnerExpr);
-    SetDefaultTraversalFunc(AssignExpr);
-    SetDefaultTraversalFunc(AssignPrefix);
-    SetDefaultTraversalFunc(ConditionalExpr);
-    SetDefaultTraversalFunc(LogicalOrExpr);
-    SetDefaultTraversalFunc(LogicalAndExpr);
-    SetDefaultTraversalFunc(InclusiveOrExpr);
-    SetDefaultTraversalFunc(ExclusiveOrExpr);
-    SetDefaultTraversalFunc(AndExpr);
-    SetDefaultTraversalFunc(EqualityExpr);
-    SetDefaultTraversalFunc(EqualityPost);
-    SetDefaultTraversalFunc(RelationalExpr);
-    SetDefaultTraversalFunc(RelationalPost);
-    SetDefaultTraversalFunc(ShiftExpr);
-    SetDefaultTraversalFunc(ShiftPost);
-    SetDefaultTraversalFunc(AdditiveExpr);
-    SetDefaultTraversalFunc(AdditivePost);
-    SetDefaultTraversalFunc(MultiplicativeExpr);
-    SetDefaultTraversalFunc(MultiplicativePost);
-    SetDefaultTraversalFunc(CastExpr);
-    SetDefaultTraversalFunc(UnaryExpr);
-    SetDefaultTraversalFunc(PostfixExpr);
-    SetDefaultTraversalFunc(PostfixOp);
-    SetDefaultTraversalFunc(ArgExprList);
-    SetDefaultTraversalFunc(PrimaryExpr);
-    SetDefaultTraversalFunc(ConstantExpr);
-    SetDefaultTraversalFunc(GenericSelection);
-    SetDefaultTraversalFunc(GenericAssociation);
-    SetDefaultTraversalFunc(InitializerList);
-    SetDefaultTraversalFunc(DesignationAndInitializer);
-    SetDefaultTraversalFunc(Initializer);
-    SetDefaultTraversalFunc(Designation);
-    SetDefaultTraversalFunc(Designator);
-
-    return table;
+    free(group);
+    free(groupData);
 }
 
 void traverse(TraversalFuncTable table, TranslationUnit unit, void *data) {
-    table.traverse_TranslationUnit(&table, &unit, data);
+    traverseAll(1, &table, &data, unit);
 }
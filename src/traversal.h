@@ -1,6 +1,7 @@
 #pragma once
 
 #include "parser.h"
+#include "arena.h"
 
 struct TraversalFuncTable;
 
@@ -36,6 +37,7 @@ void defaultTraversal_ExclusiveOrExpr(struct TraversalFuncTable *table, Exclusiv
 void defaultTraversal_InclusiveOrExpr(struct TraversalFuncTable *table, InclusiveOrExpr *expr, void *data);
 void defaultTraversal_LogicalAndExpr(struct TraversalFuncTable *table, LogicalAndExpr *expr, void *data);
 void defaultTraversal_LogicalOrExpr(struct TraversalFuncTable *table, LogicalOrExpr *expr, void *data);
+void defaultTraversal_BinaryExpr(struct TraversalFuncTable *table, BinaryExpr *expr, void *data);
 void defaultTraversal_ConditionalExpr(struct TraversalFuncTable *table, ConditionalExpr *expr, void *data);
 void defaultTraversal_AssignPrefix(struct TraversalFuncTable *table, AssignPrefix *prefix, void *data);
 void defaultTraversal_AssignExpr(struct TraversalFuncTable *table, AssignExpr *expr, void *data);
@@ -86,86 +88,249 @@ void defaultTraversal_FuncDef(struct TraversalFuncTable *table, FuncDef *def, vo
 void defaultTraversal_ExternalDecl(struct TraversalFuncTable *table, ExternalDecl *decl, void *data);
 void defaultTraversal_TranslationUnit(struct TraversalFuncTable *table, TranslationUnit *unit, void *data);
 
+// Every node type a traversal can visit, in the order of the table
+#define TraversalTypes(X)\
+    X(TranslationUnit)\
+    X(ExternalDecl)\
+    X(FuncDef)\
+    X(CompoundStmt)\
+    X(BlockItemList)\
+    X(BlockItem)\
+    X(Statement)\
+    X(AsmStatement)\
+    X(JumpStatement)\
+    X(IterationStatement)\
+    X(ExpressionStatement)\
+    X(SelectionStatement)\
+    X(LabeledStatement)\
+    X(Declaration)\
+    X(InitDeclaratorList)\
+    X(InitDeclarator)\
+    X(DeclarationSpecifierList)\
+    X(DeclarationSpecifier)\
+    X(AlignmentSpecifier)\
+    X(FunctionSpecifier)\
+    X(StorageClassSpecifier)\
+    X(TypeSpecifier)\
+    X(EnumSpecifier)\
+    X(EnumeratorList)\
+    X(Enumerator)\
+    X(StructOrUnionSpecifier)\
+    X(StructDeclaration)\
+    X(StaticAssertDeclaration)\
+    X(StructDeclaratorList)\
+    X(StructDeclarator)\
+    X(TypeName)\
+    X(SpecifierQualifierList)\
+    X(SpecifierQualifier)\
+    X(TypeQualifier)\
+    X(Declarator)\
+    X(DirectDeclarator)\
+    X(PostDirectDeclarator)\
+    X(IdentifierList)\
+    X(AbstractDeclarator)\
+    X(Pointer)\
+    X(DirectAbstractDeclarator)\
+    X(PostDirectAbstractDeclarator)\
+    X(ParameterTypeList)\
+    X(ParameterDeclaration)\
+    X(Expr)\
+    X(InnerExpr)\
+    X(AssignExpr)\
+    X(AssignPrefix)\
+    X(ConditionalExpr)\
+    X(BinaryExpr)\
+    X(LogicalOrExpr)\
+    X(LogicalAndExpr)\
+    X(InclusiveOrExpr)\
+    X(ExclusiveOrExpr)\
+    X(AndExpr)\
+    X(EqualityExpr)\
+    X(EqualityPost)\
+    X(RelationalExpr)\
+    X(RelationalPost)\
+    X(ShiftExpr)\
+    X(ShiftPost)\
+    X(AdditiveExpr)\
+    X(AdditivePost)\
+    X(MultiplicativeExpr)\
+    X(MultiplicativePost)\
+    X(CastExpr)\
+    X(UnaryExpr)\
+    X(PostfixExpr)\
+    X(PostfixOp)\
+    X(ArgExprList)\
+    X(PrimaryExpr)\
+    X(ConstantExpr)\
+    X(GenericSelection)\
+    X(GenericAssociation)\
+    X(InitializerList)\
+    X(DesignationAndInitializer)\
+    X(Initializer)\
+    X(Designation)\
+    X(Designator)
+
+typedef enum {
+#define TraversalTypeEnum(type) Traversal_ ## type,
+    TraversalTypes(TraversalTypeEnum)
+#undef TraversalTypeEnum
+    Traversal_Count,
+} TraversalType;
+
+#define TraversalFuncMember(type) TraversalFuncDef(type);
+
 typedef struct TraversalFuncTable {
-    TraversalFuncDef(TranslationUnit);
-    TraversalFuncDef(ExternalDecl);
-    TraversalFuncDef(FuncDef);
-    TraversalFuncDef(CompoundStmt);
-    TraversalFuncDef(BlockItemList);
-    TraversalFuncDef(BlockItem);
-    TraversalFuncDef(Statement);
-    TraversalFuncDef(AsmStatement);
-    TraversalFuncDef(JumpStatement);
-    TraversalFuncDef(IterationStatement);
-    TraversalFuncDef(ExpressionStatement);
-    TraversalFuncDef(SelectionStatement);
-    TraversalFuncDef(LabeledStatement);
-    TraversalFuncDef(Declaration);
-    TraversalFuncDef(InitDeclaratorList);
-    TraversalFuncDef(InitDeclarator);
-    TraversalFuncDef(DeclarationSpecifierList);
-    TraversalFuncDef(DeclarationSpecifier);
-    TraversalFuncDef(AlignmentSpecifier);
-    TraversalFuncDef(FunctionSpecifier);
-    TraversalFuncDef(StorageClassSpecifier);
-    TraversalFuncDef(TypeSpecifier);
-    TraversalFuncDef(EnumSpecifier);
-    TraversalFuncDef(EnumeratorList);
-    TraversalFuncDef(Enumerator);
-    TraversalFuncDef(StructOrUnionSpecifier);
-    TraversalFuncDef(StructDeclaration);
-    TraversalFuncDef(StaticAssertDeclaration);
-    TraversalFuncDef(StructDeclaratorList);
-    TraversalFuncDef(StructDeclarator);
-    TraversalFuncDef(TypeName);
-    TraversalFuncDef(SpecifierQualifierList);
-    TraversalFuncDef(SpecifierQualifier);
-    TraversalFuncDef(TypeQualifier);
-    TraversalFuncDef(Declarator);
-    TraversalFuncDef(DirectDeclarator);
-    TraversalFuncDef(PostDirectDeclarator);
-    TraversalFuncDef(IdentifierList);
-    TraversalFuncDef(AbstractDeclarator);
-    TraversalFuncDef(Pointer);
-    TraversalFuncDef(DirectAbstractDeclarator);
-    TraversalFuncDef(PostDirectAbstractDeclarator);
-    TraversalFuncDef(ParameterTypeList);
-    TraversalFuncDef(ParameterDeclaration);
-    TraversalFuncDef(Expr);
-    TraversalFuncDef(InnerExpr);
-    TraversalFuncDef(AssignExpr);
-    TraversalFuncDef(AssignPrefix);
-    TraversalFuncDef(ConditionalExpr);
-    TraversalFuncDef(LogicalOrExpr);
-    TraversalFuncDef(LogicalAndExpr);
-    TraversalFuncDef(InclusiveOrExpr);
-    TraversalFuncDef(ExclusiveOrExpr);
-    TraversalFuncDef(AndExpr);
-    TraversalFuncDef(EqualityExpr);
-    TraversalFuncDef(EqualityPost);
-    TraversalFuncDef(RelationalExpr);
-    TraversalFuncDef(RelationalPost);
-    TraversalFuncDef(ShiftExpr);
-    TraversalFuncDef(ShiftPost);
-    TraversalFuncDef(AdditiveExpr);
-    TraversalFuncDef(AdditivePost);
-    TraversalFuncDef(MultiplicativeExpr);
-    TraversalFuncDef(MultiplicativePost);
-    TraversalFuncDef(CastExpr);
-    TraversalFuncDef(UnaryExpr);
-    TraversalFuncDef(PostfixExpr);
-    TraversalFuncDef(PostfixOp);
-    TraversalFuncDef(ArgExprList);
-    TraversalFuncDef(PrimaryExpr);
-    TraversalFuncDef(ConstantExpr);
-    TraversalFuncDef(GenericSelection);
-    TraversalFuncDef(GenericAssociation);
-    TraversalFuncDef(InitializerList);
-    TraversalFuncDef(DesignationAndInitializer);
-    TraversalFuncDef(Initializer);
-    TraversalFuncDef(Designation);
-    TraversalFuncDef(Designator);
+    TraversalTypes(TraversalFuncMember)
 } TraversalFuncTable;
 
 TraversalFuncTable defaultTraversal();
+
+// Levels the parser no longer builds. Traversals that hook any of them get them
+// built from the BinaryExprs.
+#define LegacyBinaryTypes(X)\
+    X(LogicalOrExpr)\
+    X(LogicalAndExpr)\
+    X(InclusiveOrExpr)\
+    X(ExclusiveOrExpr)\
+    X(AndExpr)\
+    X(EqualityExpr)\
+    X(EqualityPost)\
+    X(RelationalExpr)\
+    X(RelationalPost)\
+    X(ShiftExpr)\
+    X(ShiftPost)\
+    X(AdditiveExpr)\
+    X(AdditivePost)\
+    X(MultiplicativeExpr)\
+    X(MultiplicativePost)
+
+// Builds the legacy levels of a BinaryExpr chain in scratch space, where they
+// stay until the returned mark is released
+ArenaMark traversal_buildLegacyLevels(BinaryExpr *expr, LogicalOrExpr *out);
+void traversal_releaseLegacyLevels(ArenaMark mark);
+
+#define AllNodeKinds (~(NodeKindMask)0)
+
+// The type's bit if the parser keeps track of it, nothing for types that are
+// never under a node that keeps track, and AllNodeKinds for the rest. A walk
+// can skip the children of a node that has none of the bits of the types it
+// hooks, as long as none of them are AllNodeKinds.
+static inline NodeKindMask traversal_trackedKind(TraversalType type) {
+    switch (type) {
+#define TrackedKindCase(type) case Traversal_ ## type: return NodeKindBit(type);
+    NodeKindTypes(TrackedKindCase)
+#undef TrackedKindCase
+    case Traversal_TranslationUnit:
+    case Traversal_ExternalDecl:
+    case Traversal_FuncDef:
+        return 0;
+    default:
+        return AllNodeKinds;
+    }
+}
+
+// Kinds under the node, or AllNodeKinds for nodes that don't keep track
+NodeKindMask traversal_nodeKinds(TraversalType type, void *node);
+
+typedef struct {
+    TraversalType type;
+    void *node;
+} TraversalAncestor;
+
+// Every traversal keeps the nodes it's inside of, from the root down to the
+// node being visited, so hooks and visitors can look at where a node is. Up 0
+// is the visited node itself and 1 its parent. Past the root the type is
+// Traversal_Count and the node NULL.
+TraversalAncestor traversal_ancestor(size_t up);
+TraversalAncestor traversal_parent();
+
+// The stack behind traversal_ancestor. The default traversal pushes every
+// child around visiting it, and walks push the root.
+typedef struct {
+    size_t numAncestors;
+    size_t ancestorCapacity;
+    TraversalAncestor *ancestors;
+} TraversalAncestors;
+
+extern _Thread_local TraversalAncestors g_traversalAncestors;
+
+void traversal_growAncestors();
+
+static inline void traversal_pushAncestor(TraversalType type, void *node) {
+    TraversalAncestors *stack = &g_traversalAncestors;
+    if (stack->numAncestors == stack->ancestorCapacity)
+        traversal_growAncestors();
+
+    stack->ancestors[stack->numAncestors++] = (TraversalAncestor){
+        .type = type,
+        .node = node,
+    };
+}
+
+static inline void traversal_popAncestor() {
+    g_traversalAncestors.numAncestors--;
+}
+
+// Hooks continue a traversal by calling the node's default traversal, which
+// visits the node's children before it returns, so a hook can do work both
+// before and after them. A hook that doesn't call it skips the children.
+//
+// Exprs, Statements and Declarations that have none of the node kinds a table
+// hooks under them are skipped, as long as the table only hooks kinds the
+// parser keeps track of (see NodeKindTypes).
 void traverse(TraversalFuncTable table, TranslationUnit unit, void *data);
+
+// Deeper than this, a walk doesn't go on with the native stack it started on.
+// Event walks keep the nodes they still have to visit on a stack of their
+// own. Walks through hooks recurse, since a hook's frame has to outlive the
+// node's children, so they carry on with traversal_callDeeper. Recursing is
+// faster, since every call site mostly calls the same function, so it's only
+// given up on trees deep enough to matter for the native stack.
+#define MaxTraversalRecursion 512
+
+// Calls func on a fresh stack, with enough room for another
+// MaxTraversalRecursion levels of hooks, and returns once it's done. The
+// ancestor stack and legacy levels go along with it.
+void traversal_callDeeper(void (*func)(void *data), void *data);
+
+// Runs every table over the unit in a single walk. At each node the hooks of
+// the tables that reach it are called in order, each with its own data.
+// A hook continues or stops its own traversal the same way it does with
+// traverse(), so tables written for traverse() work unchanged. The children
+// a hook continues into are visited by its table alone, and the tables that
+// don't hook the node visit them together after the hooks.
+void traverseAll(size_t numTables, TraversalFuncTable *tables, void **data,
+    TranslationUnit unit);
+
+typedef enum {
+    TraversalEvent_Enter,
+    TraversalEvent_Leave,
+} TraversalEvent;
+
+// Gets every node on entering it and again on leaving it after its children.
+// Returning false on entering skips the children. The return value on leaving
+// is ignored.
+typedef bool (*TraversalVisitor)(TraversalEvent event, TraversalType type,
+    void *node, void *data);
+
+// Walks the unit in the same order as the default traversal, with its own
+// stack instead of recursion. With legacyLevels, ConditionalExprs are walked
+// through the LogicalOrExpr to MultiplicativeExpr levels instead of their
+// BinaryExprs. Those nodes are only valid until the ConditionalExpr is left.
+void traverseEvents(TranslationUnit *unit, bool legacyLevels,
+    TraversalVisitor visitor, void *data);
+
+// What a walker generated by traversalWalker.h does with a unit
+typedef struct {
+    // A bit for every rule of the walker's set that runs, by its place in the
+    // set, and the data each rule's hooks get
+    uint64_t rules;
+    void **data;
+    // Visitors that go along with the rules. They see the nodes the way
+    // traverseEvents() shows them.
+    size_t numVisitors;
+    TraversalVisitor *visitors;
+    void **visitorData;
+    // Whether a visitor needs the legacy levels
+    bool legacyLevels;
+} WalkerRun;
@@ -0,0 +1,747 @@
+// The default traversal of every node type. traversal.c includes it for the
+// defaultTraversal_ functions and traversalWalker.h for the walkers it
+// generates, so there's no #pragma once.
+//
+// The includer defines:
+//   TraversalBody(type, name)  the signature of the type's traversal, with the
+//                              node as name and table and data in scope
+//   TraverseChild(type, node)  visits a child with it on the ancestor stack
+//   TraversalLegacyLevels      whether ConditionalExprs are walked through the
+//                              LogicalOrExpr to MultiplicativeExpr levels
+//   TraversalPrune(node)       returns from an Expr, Statement or Declaration
+//                              whose children don't have to be visited
+// They're undefined at the end.
+
+TraversalBody(Designator, desig) {
+    if (desig->type == Designator_Constant) {
+        TraverseChild(ConditionalExpr, desig->constantExpr);
+    }
+}
+
+TraversalBody(Designation, desig) {
+    astList_foreach(desig->list, Designator, designator) {
+        TraverseChild(Designator, designator);
+    }
+}
+
+TraversalBody(Initializer, init) {
+    if (init->type == Initializer_InitializerList) {
+        TraverseChild(InitializerList, init->initializerList);
+    }
+    else if (init->type == Initializer_Assignment) {
+        TraverseChild(AssignExpr, init->assignmentExpr);
+    }
+    else {
+        assert(false);
+    }
+}
+
+TraversalBody(DesignationAndInitializer, desig) {
+    if (desig->hasDesignation) {
+        TraverseChild(Designation, &(desig->designation));
+    }
+
+    TraverseChild(Initializer, &(desig->initializer));
+}
+
+TraversalBody(InitializerList, list) {
+    astList_foreach(list->list, DesignationAndInitializer, desig) {
+        TraverseChild(DesignationAndInitializer, desig);
+    }
+}
+
+TraversalBody(GenericAssociation, association) {
+    if (!association->isDefault) {
+        TraverseChild(TypeName, association->typeName);
+    }
+    TraverseChild(AssignExpr, association->expr);
+}
+
+TraversalBody(GenericSelection, selection) {
+    TraverseChild(AssignExpr, selection->expr);
+
+    astList_foreach(selection->associations, GenericAssociation, association) {
+        TraverseChild(GenericAssociation, association);
+    }
+}
+
+TraversalBody(ConstantExpr, expr) {
+    // Traverse no further
+}
+
+TraversalBody(PrimaryExpr, expr) {
+    if (expr->type == PrimaryExpr_Constant) {
+        TraverseChild(ConstantExpr, &(expr->constant));
+    }
+    else if (expr->type == PrimaryExpr_Expr) {
+        TraverseChild(Expr, expr->expr);
+    }
+    else if (expr->type == PrimaryExpr_GenericSelection) {
+        TraverseChild(GenericSelection, &(expr->genericSelection));
+    }
+}
+
+TraversalBody(ArgExprList, list) {
+    astList_foreach(list->list, AssignExpr, expr) {
+        TraverseChild(AssignExpr, expr);
+    }
+}
+
+TraversalBody(PostfixOp, op) {
+    if (op->type == PostfixOp_Index) {
+        TraverseChild(Expr, op->indexExpr);
+    }
+    else if (op->type == PostfixOp_Call) {
+        if (!op->callHasEmptyArgs) {
+            TraverseChild(ArgExprList, &(op->callExprs));
+        }
+    }
+
+    // We don't need to traverse any further
+}
+
+TraversalBody(PostfixExpr, expr) {
+    if (expr->type == Postfix_Primary) {
+        TraverseChild(PrimaryExpr, &(expr->primary));
+    }
+    else if (expr->type == Postfix_InitializerList) {
+        TraverseChild(TypeName, expr->initializerListType);
+        TraverseChild(InitializerList, &(expr->initializerList));
+    }
+    else {
+        assert(false);
+    }
+
+    astList_foreach(expr->postfixOps, PostfixOp, op) {
+        TraverseChild(PostfixOp, op);
+    }
+}
+
+TraversalBody(UnaryExpr, expr) {
+    if (expr->type == UnaryExpr_UnaryOp) {
+        TraverseChild(CastExpr, expr->unaryOpCast);
+    }
+    else if (expr->type == UnaryExpr_Inc) {
+        TraverseChild(UnaryExpr, expr->incOpExpr);
+    }
+    else if (expr->type == UnaryExpr_Dec) {
+        TraverseChild(UnaryExpr, expr->decOpExpr);
+    }
+    else if (expr->type == UnaryExpr_SizeofExpr) {
+        TraverseChild(UnaryExpr, expr->sizeofExpr);
+    }
+    else if (expr->type == UnaryExpr_SizeofType) {
+        TraverseChild(TypeName, expr->sizeofTypeName);
+    }
+    else if (expr->type == UnaryExpr_AlignofType) {
+        TraverseChild(TypeName, expr->alignofTypeName);
+    }
+    else if (UnaryExpr_Base) {
+        TraverseChild(PostfixExpr, &(expr->baseExpr));
+    }
+    else {
+        assert(false);
+    }
+}
+
+TraversalBody(CastExpr, expr) {
+    if (expr->type == CastExpr_Unary) {
+        TraverseChild(UnaryExpr, &(expr->unary));
+    }
+    else if (expr->type == CastExpr_Cast) {
+        TraverseChild(TypeName, expr->castType);
+        TraverseChild(CastExpr, expr->castExpr);
+    }
+}
+
+TraversalBody(MultiplicativePost, expr) {
+    TraverseChild(CastExpr, &(expr->expr));
+}
+
+TraversalBody(MultiplicativeExpr, expr) {
+    TraverseChild(CastExpr, &(expr->baseExpr));
+
+    astList_foreach(expr->postExprs, MultiplicativePost, post) {
+        TraverseChild(MultiplicativePost, post);
+    }
+}
+
+TraversalBody(AdditivePost, expr) {
+    TraverseChild(MultiplicativeExpr, &(expr->expr));
+}
+
+TraversalBody(AdditiveExpr, expr) {
+    TraverseChild(MultiplicativeExpr, &(expr->baseExpr));
+
+    astList_foreach(expr->postExprs, AdditivePost, post) {
+        TraverseChild(AdditivePost, post);
+    }
+}
+
+TraversalBody(ShiftPost, expr) {
+    TraverseChild(AdditiveExpr, &(expr->expr));
+}
+
+TraversalBody(ShiftExpr, expr) {
+    TraverseChild(AdditiveExpr, &(expr->baseExpr));
+
+    astList_foreach(expr->postExprs, ShiftPost, post) {
+        TraverseChild(ShiftPost, post);
+    }
+}
+
+TraversalBody(RelationalPost, expr) {
+    TraverseChild(ShiftExpr, &(expr->expr));
+}
+
+TraversalBody(RelationalExpr, expr) {
+    TraverseChild(ShiftExpr, &(expr->baseExpr));
+
+    astList_foreach(expr->postExprs, RelationalPost, post) {
+        TraverseChild(RelationalPost, post);
+    }
+}
+
+TraversalBody(EqualityPost, expr) {
+    TraverseChild(RelationalExpr, &(expr->expr));
+}
+
+TraversalBody(EqualityExpr, expr) {
+    TraverseChild(RelationalExpr, &(expr->baseExpr));
+
+    astList_foreach(expr->postExprs, EqualityPost, post) {
+        TraverseChild(EqualityPost, post);
+    }
+}
+
+TraversalBody(AndExpr, expr) {
+    astList_foreach(expr->list, EqualityExpr, equality) {
+        TraverseChild(EqualityExpr, equality);
+    }
+}
+
+TraversalBody(ExclusiveOrExpr, expr) {
+    astList_foreach(expr->list, AndExpr, and) {
+        TraverseChild(AndExpr, and);
+    }
+}
+
+TraversalBody(InclusiveOrExpr, expr) {
+    astList_foreach(expr->list, ExclusiveOrExpr, or) {
+        TraverseChild(ExclusiveOrExpr, or);
+    }
+}
+
+TraversalBody(LogicalAndExpr, expr) {
+    astList_foreach(expr->list, InclusiveOrExpr, or) {
+        TraverseChild(InclusiveOrExpr, or);
+    }
+}
+
+TraversalBody(LogicalOrExpr, expr) {
+    astList_foreach(expr->list, LogicalAndExpr, and) {
+        TraverseChild(LogicalAndExpr, and);
+    }
+}
+
+
+TraversalBody(BinaryExpr, expr) {
+    if (expr->level == BinaryExpr_Cast) {
+        TraverseChild(CastExpr, &(expr->cast));
+        return;
+    }
+
+    astList_foreach(expr->operands, BinaryOperand, operand) {
+        TraverseChild(BinaryExpr, operand->expr);
+    }
+}
+
+TraversalBody(ConditionalExpr, expr) {
+    if (TraversalLegacyLevels) {
+        LogicalOrExpr logicalOr = {0};
+        ArenaMark mark = traversal_buildLegacyLevels(expr->beforeExpr,
+            &logicalOr);
+        TraverseChild(LogicalOrExpr, &logicalOr);
+
+        traversal_releaseLegacyLevels(mark);
+    }
+    else {
+        TraverseChild(BinaryExpr, expr->beforeExpr);
+    }
+
+    if (expr->hasConditionalOp) {
+        TraverseChild(Expr, expr->ifTrueExpr);
+        TraverseChild(ConditionalExpr, expr->ifFalseExpr);
+    }
+}
+
+TraversalBody(AssignPrefix, prefix) {
+    TraverseChild(UnaryExpr, &(prefix->leftExpr));
+}
+
+TraversalBody(AssignExpr, expr) {
+    astList_foreach(expr->leftExprs, AssignPrefix, prefix) {
+        TraverseChild(AssignPrefix, prefix);
+    }
+
+    TraverseChild(ConditionalExpr, &(expr->rightExpr));
+}
+
+TraversalBody(InnerExpr, expr) {
+    if (expr->type == InnerExpr_Assign)
+        TraverseChild(AssignExpr, &(expr->assign));
+    else if (expr->type == InnerExpr_CompoundStatement)
+        TraverseChild(CompoundStmt, expr->compoundStmt);
+}
+
+TraversalBody(Expr, expr) {
+    TraversalPrune(expr);
+
+    astList_foreach(expr->list, InnerExpr, inner) {
+        TraverseChild(InnerExpr, inner);
+    }
+}
+
+TraversalBody(ParameterDeclaration, decl) {
+    TraverseChild(DeclarationSpecifierList, decl->declarationSpecifiers);
+
+    if (decl->hasDeclarator)
+        TraverseChild(Declarator, decl->declarator);
+
+    if (decl->hasAbstractDeclarator)
+        TraverseChild(AbstractDeclarator, decl->abstractDeclarator);
+}
+
+TraversalBody(ParameterTypeList, list) {
+    astList_foreach(list->paramDecls, ParameterDeclaration, decl) {
+        TraverseChild(ParameterDeclaration, decl);
+    }
+}
+
+TraversalBody(PostDirectAbstractDeclarator, decl) {
+    if (decl->type == PostDirectAbstractDeclarator_Bracket) {
+        astList_foreach(decl->bracketTypeQualifiers, TypeQualifier, qual) {
+            TraverseChild(TypeQualifier, qual);
+        }
+
+        TraverseChild(AssignExpr, &(decl->bracketAssignExpr));
+    }
+    else if (decl->type == PostDirectAbstractDeclarator_Paren) {
+        TraverseChild(ParameterTypeList, &(decl->parenParamList));
+    }
+    else {
+        assert(false);
+    }
+}
+
+TraversalBody(DirectAbstractDeclarator, decl) {
+    if (decl->hasAbstractDeclarator)
+        TraverseChild(AbstractDeclarator, decl->abstractDeclarator);
+
+    astList_foreach(decl->postDirectAbstractDeclarators, PostDirectAbstractDeclarator, post) {
+        TraverseChild(PostDirectAbstractDeclarator, post);
+    }
+}
+
+TraversalBody(Pointer, pointer) {
+    if (pointer == NULL)
+        return;
+
+    astList_foreach(pointer->typeQualifiers, TypeQualifier, qual) {
+        TraverseChild(TypeQualifier, qual);
+    }
+
+    TraverseChild(Pointer, pointer->pointer);
+}
+
+TraversalBody(AbstractDeclarator, decl) {
+    if (decl->hasPointer)
+        TraverseChild(Pointer, &(decl->pointer));
+
+    if (decl->hasDirectAbstractDeclarator)
+        TraverseChild(DirectAbstractDeclarator, &(decl->directAbstractDeclarator));
+}
+
+TraversalBody(IdentifierList, list) {
+    // Traverse no further
+}
+
+TraversalBody(PostDirectDeclarator, decl) {
+    if (decl->type == PostDirectDeclarator_Bracket) {
+        astList_foreach(decl->bracketTypeQualifiers, TypeQualifier, qual) {
+            TraverseChild(TypeQualifier, qual);
+        }
+
+        if (decl->bracketHasAssignExpr)
+            TraverseChild(AssignExpr, &(decl->bracketAssignExpr));
+    }
+    else if (decl->type == PostDirectDeclarator_Paren) {
+        if (decl->parenType == PostDirectDeclaratorParen_IdentList)
+            TraverseChild(IdentifierList, &(decl->parenIdentList));
+        else if (decl->parenType == PostDirectDeclaratorParen_ParamTypelist)
+            TraverseChild(ParameterTypeList, &(decl->parenParamTypeList));
+    }
+}
+
+TraversalBody(DirectDeclarator, decl) {
+    if (decl->type == DirectDeclarator_Ident) {
+        // Do Nothing
+    }
+    else if (decl->type == DirectDeclarator_ParenDeclarator) {
+        TraverseChild(Declarator, decl->declarator);
+    }
+
+    astList_foreach(decl->postDirectDeclarators, PostDirectDeclarator, post) {
+        TraverseChild(PostDirectDeclarator, post);
+    }
+}
+
+TraversalBody(Declarator, decl) {
+    if (decl->hasPointer)
+        TraverseChild(Pointer, &(decl->pointer));
+
+    TraverseChild(DirectDeclarator, &(decl->directDeclarator));
+}
+
+TraversalBody(TypeQualifier, qual) {
+    // No need to go further
+}
+
+TraversalBody(SpecifierQualifier, spec) {
+    if (spec->type == SpecifierQualifier_Specifier)
+        TraverseChild(TypeSpecifier, spec->typeSpecifier);
+    else if (spec->type == SpecifierQualifier_Qualifier)
+        TraverseChild(TypeQualifier, &(spec->typeQualifier));
+    else
+        assert(false);
+}
+
+TraversalBody(SpecifierQualifierList, list) {
+    astList_foreach(list->list, SpecifierQualifier, spec) {
+        TraverseChild(SpecifierQualifier, spec);
+    }
+}
+
+TraversalBody(TypeName, type) {
+    TraverseChild(SpecifierQualifierList, &(type->specifierQualifiers));
+
+    if (type->hasAbstractDeclarator)
+        TraverseChild(AbstractDeclarator, &(type->abstractDeclarator));
+}
+
+TraversalBody(StructDeclarator, decl) {
+    if (decl->hasDeclarator)
+        TraverseChild(Declarator, &(decl->declarator));
+
+    if (decl->hasConstExpr)
+        TraverseChild(ConditionalExpr, &(decl->constExpr));
+}
+
+TraversalBody(StructDeclaratorList, list) {
+    astList_foreach(list->list, StructDeclarator, decl) {
+        TraverseChild(StructDeclarator, decl);
+    }
+}
+
+TraversalBody(StaticAssertDeclaration, decl) {
+    TraverseChild(ConditionalExpr, &(decl->constantExpr));
+}
+
+TraversalBody(StructDeclaration, decl) {
+    if (decl->type == StructDeclaration_StaticAssert) {
+        TraverseChild(StaticAssertDeclaration, &(decl->staticAssert));
+    }
+    else if (decl->type == StructDeclaration_Normal) {
+        TraverseChild(SpecifierQualifierList, &(decl->normalSpecifierQualifiers));
+        if (decl->normalHasStructDeclaratorList) {
+            TraverseChild(StructDeclaratorList, &(decl->normalStructDeclaratorList));
+        }
+    }
+    else {
+        assert(false);
+    }
+}
+
+TraversalBody(StructOrUnionSpecifier, enumerator) {
+    if (enumerator->hasStructDeclarationList) {
+        astList_foreach(enumerator->structDeclarations, StructDeclaration, decl) {
+            TraverseChild(StructDeclaration, decl);
+        }
+    }
+}
+
+TraversalBody(Enumerator, enumerator) {
+    if (enumerator->hasConstExpr) {
+        TraverseChild(ConditionalExpr, &(enumerator->constantExpr));
+    }
+}
+
+TraversalBody(EnumeratorList, list) {
+    astList_foreach(list->list, Enumerator, enumerator) {
+        TraverseChild(Enumerator, enumerator);
+    }
+}
+
+TraversalBody(EnumSpecifier, spec) {
+    if (spec->hasEnumeratorList) {
+        TraverseChild(EnumeratorList, &(spec->enumeratorList));
+    }
+}
+
+TraversalBody(TypeSpecifier, spec) {
+    if (spec->type == TypeSpecifier_AtomicType) {
+        TraverseChild(TypeName, &(spec->atomicName));
+    }
+    else if (spec->type == TypeSpecifier_StructOrUnion) {
+        TraverseChild(StructOrUnionSpecifier, &(spec->structOrUnion));
+    }
+    else if (spec->type == TypeSpecifier_Enum) {
+        TraverseChild(EnumSpecifier, &(spec->enumSpecifier));
+    }
+}
+
+TraversalBody(StorageClassSpecifier, spec) {
+    // Can't go deeper
+}
+
+TraversalBody(FunctionSpecifier, spec) {
+    // Can't go deeper
+}
+
+TraversalBody(AlignmentSpecifier, spec) {
+    if (spec->type == AlignmentSpecifier_TypeName) {
+        TraverseChild(TypeName, &(spec->typeName));
+    }
+    else if (spec->type == AlignmentSpecifier_Constant) {
+        TraverseChild(ConditionalExpr, &(spec->constant));
+    }
+    else {
+        assert(false);
+    }
+}
+
+TraversalBody(DeclarationSpecifier, list) {
+    switch(list->type) {
+        case DeclarationSpecifier_StorageClass: {
+            TraverseChild(StorageClassSpecifier, &(list->storageClass));
+            break;
+        }
+        case DeclarationSpecifier_Type: {
+            TraverseChild(TypeSpecifier, &(list->typeSpecifier));
+            break;
+        }
+        case DeclarationSpecifier_TypeQualifier: {
+            TraverseChild(TypeQualifier, &(list->typeQualifier));
+            break;
+        }
+        case DeclarationSpecifier_Func: {
+            TraverseChild(FunctionSpecifier, &(list->function));
+            break;
+        }
+        case DeclarationSpecifier_Alignment: {
+            TraverseChild(AlignmentSpecifier, &(list->alignment));
+            break;
+        }
+        default:
+            assert(false);
+            break;
+    }
+}
+
+TraversalBody(DeclarationSpecifierList, list) {
+    astList_foreach(list->list, DeclarationSpecifier, decl) {
+        TraverseChild(DeclarationSpecifier, decl);
+    }
+}
+
+TraversalBody(InitDeclarator, decl) {
+    TraverseChild(Declarator, &(decl->decl));
+    if (decl->hasInitializer)
+        TraverseChild(Initializer, &(decl->initializer));
+}
+
+TraversalBody(InitDeclaratorList, list) {
+    astList_foreach(list->list, InitDeclarator, decl) {
+        TraverseChild(InitDeclarator, decl);
+    }
+}
+
+TraversalBody(Declaration, decl) {
+    TraversalPrune(decl);
+
+    if (decl->type == Declaration_StaticAssert) {
+        TraverseChild(StaticAssertDeclaration, &(decl->staticAssert));
+    }
+    else if (decl->type == Declaration_Normal) {
+        TraverseChild(DeclarationSpecifierList, &(decl->declSpecifiers));
+        if (decl->hasInitDeclaratorList) {
+            TraverseChild(InitDeclaratorList, &(decl->initDeclaratorList));
+        }
+    }
+}
+
+TraversalBody(LabeledStatement, stmt) {
+    if (stmt->type == LabeledStatement_Case) {
+        TraverseChild(ConditionalExpr, &(stmt->caseConstExpr));
+    }
+
+    TraverseChild(Statement, stmt->stmt);
+}
+
+TraversalBody(SelectionStatement, stmt) {
+    if (stmt->type == SelectionStatement_If) {
+        TraverseChild(Expr, &(stmt->ifExpr));
+        TraverseChild(Statement, stmt->ifTrueStmt);
+        if (stmt->ifHasElse) {
+            TraverseChild(Statement, stmt->ifFalseStmt);
+        }
+    }
+    else if (stmt->type == SelectionStatement_Switch) {
+        TraverseChild(Expr, &(stmt->switchExpr));
+        TraverseChild(Statement, stmt->switchStmt);
+    }
+    else {
+        assert(false);
+    }
+}
+
+TraversalBody(ExpressionStatement, stmt) {
+    if (!stmt->isEmpty) {
+        TraverseChild(Expr, &(stmt->expr));
+    }
+}
+
+TraversalBody(IterationStatement, stmt) {
+    if (stmt->type == IterationStatement_While) {
+        TraverseChild(Expr, &(stmt->whileExpr));
+        TraverseChild(Statement, stmt->whileStmt);
+    }
+    else if (stmt->type == IterationStatement_DoWhile) {
+        TraverseChild(Statement, stmt->doStmt);
+        TraverseChild(Expr, &(stmt->doExpr));
+    }
+    else if (stmt->type == IterationStatement_For) {
+        if (stmt->forHasInitialDeclaration) {
+            TraverseChild(Declaration, &(stmt->forInitialDeclaration));
+        }
+
+        TraverseChild(ExpressionStatement, &(stmt->forInitialExprStmt));
+        TraverseChild(ExpressionStatement, &(stmt->forInnerExprStmt));
+
+        if (stmt->forHasFinalExpr) {
+            TraverseChild(Expr, &(stmt->forFinalExpr));
+        }
+        TraverseChild(Statement, stmt->forStmt);
+    }
+    else {
+        assert(false);
+    }
+}
+
+TraversalBody(JumpStatement, stmt) {
+    // Return jump is the only one that needs to traverse deeper
+    if (stmt->type == JumpStatement_Return) {
+        TraverseChild(Expr, &(stmt->returnExpr));
+    }
+}
+
+TraversalBody(AsmStatement, stmt) {
+    // TODO: Implement this if we fill in asm struct
+}
+
+TraversalBody(Statement, stmt) {
+    TraversalPrune(stmt);
+
+    switch (stmt->type) {
+        case Statement_Labeled: {
+            TraverseChild(LabeledStatement, &(stmt->labeled));
+            break;
+        }
+        case Statement_Compound: {
+            TraverseChild(CompoundStmt, stmt->compound);
+            break;
+        }
+        case Statement_Expression: {
+            TraverseChild(ExpressionStatement, &(stmt->expression));
+            break;
+        }
+        case Statement_Selection: {
+            TraverseChild(SelectionStatement, &(stmt->selection));
+            break;
+        }
+        case Statement_Iteration: {
+            TraverseChild(IterationStatement, &(stmt->iteration));
+            break;
+        }
+        case Statement_Jump: {
+            TraverseChild(JumpStatement, &(stmt->jump));
+            break;
+        }
+        case Statement_Asm: {
+            TraverseChild(AsmStatement, &(stmt->assembly));
+            break;
+        }
+        default: {
+            assert(false);
+            break;
+        }
+    }
+}
+
+TraversalBody(BlockItem, item) {
+    if (item->type == BlockItem_Declaration) {
+        TraverseChild(Declaration, &(item->decl));
+    }
+    else if (item->type == BlockItem_Statement) {
+        TraverseChild(Statement, &(item->stmt));
+    }
+    else {
+        assert(false);
+    }
+}
+
+TraversalBody(BlockItemList, list) {
+    astList_foreach(list->list, BlockItem, item) {
+        TraverseChild(BlockItem, item);
+    }
+}
+
+TraversalBody(CompoundStmt, stmt) {
+    if (!stmt->isEmpty) {
+        TraverseChild(BlockItemList, &(stmt->blockItemList));
+    }
+}
+
+TraversalBody(FuncDef, def) {
+    TraverseChild(DeclarationSpecifierList, &(def->specifiers));
+    TraverseChild(Declarator, &(def->declarator));
+
+    astList_foreach(def->declarations, Declaration, decl) {
+        TraverseChild(Declaration, decl);
+    }
+
+    TraverseChild(CompoundStmt, funcDef_getBody(def));
+}
+
+TraversalBody(ExternalDecl, decl) {
+    if (decl->type == ExternalDecl_FuncDef) {
+        TraverseChild(FuncDef, &(decl->func));
+    }
+    else if (decl->type == ExternalDecl_Decl) {
+        TraverseChild(Declaration, &(decl->decl));
+    }
+    else {
+        assert(false);
+    }
+}
+
+TraversalBody(TranslationUnit, unit) {
+    astList_foreach(unit->externalDecls, ExternalDecl, externalDecl) {
+        TraverseChild(ExternalDecl, externalDecl);
+    }
+}
+
+#undef TraversalBody
+#undef TraverseChild
+#undef TraversalLegacyLevels
+#undef TraversalPrune
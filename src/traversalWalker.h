@@ -0,0 +1,308 @@
+// Generates a single walker for a set of rules. The rules share one walk of the
+// tree, and the traversal doesn't go through a table of function pointers at
+// every node. Include it after defining:
+//   WalkerName      the walker, defined as
+//                   void WalkerName(TranslationUnit *unit, WalkerRun *run)
+//   WalkerRules(X)  an X(rule, hooks) for every rule in the set, where hooks(Y)
+//                   has a Y(type, hook) for every type the rule hooks
+//
+// A rule's place in WalkerRules is its bit in the run's rules and its index
+// into the run's data. At each node, the walker calls the hooks of the rules
+// that reach it, in the order of the set. Then the rules that don't hook the
+// node go on into its children together, along with the run's visitors. That's
+// what traverseAll() does, so hooks written for traverse() work unchanged. A
+// hook gets a table that visits the children it continues into with its rule
+// alone, and those children are visited by the time the default traversal the
+// hook calls returns.
+//
+// The walker gets its own copy of the default traversal bodies, which call
+// each other directly. Which rules hook which types is known at compile time,
+// so only the calls into the hooks are left. Rules leave the walk at Exprs,
+// Statements and Declarations that have none of their hooked kinds under them,
+// the same way traverse() skips them. Past MaxTraversalRecursion levels, the
+// walk carries on through traversal_callDeeper() the way traverseAll() does.
+//
+// The legacy levels are built when an enabled rule hooks them or the run asks
+// for them. Rules that hook BinaryExpr can't run at the same time.
+//
+// No #pragma once, since a file can generate more than one walker. WalkerName
+// and WalkerRules are undefined at the end.
+
+#define WalkerConcat(a, b) WalkerConcat_(a, b)
+#define WalkerConcat_(a, b) a ## b
+#define WalkerFunc(type) WalkerConcat(WalkerName, _ ## type)
+#define WalkerBody(type) WalkerConcat(WalkerName, _body_ ## type)
+#define WalkerEntry(type) WalkerConcat(WalkerName, _entry_ ## type)
+#define WalkerIndex(rule) WalkerConcat(WalkerName, _index_ ## rule)
+#define WalkerHooks(rule) WalkerConcat(WalkerName, _hooks_ ## rule)
+#define WalkerCall(rule) WalkerConcat(WalkerName, _call_ ## rule)
+#define WalkerBit(rule) ((uint64_t)1 << WalkerIndex(rule))
+#define WalkerCount WalkerConcat(WalkerName, _count)
+#define WalkerState WalkerConcat(WalkerName, _State)
+#define WalkerTable WalkerConcat(WalkerName, _Table)
+#define WalkerDeeper WalkerConcat(WalkerName, _Deeper)
+#define WalkerDeep WalkerConcat(WalkerName, _deep)
+#define WalkerHooked WalkerConcat(WalkerName, _hooked)
+#define WalkerPrune WalkerConcat(WalkerName, _prune)
+#define WalkerLegacyRules WalkerConcat(WalkerName, _legacyRules)
+#define WalkerVisitorBit(i) ((uint64_t)1 << (WalkerCount + (i)))
+
+enum {
+#define WalkerIndexEntry(rule, hooks) WalkerIndex(rule),
+    WalkerRules(WalkerIndexEntry)
+#undef WalkerIndexEntry
+    WalkerCount
+};
+
+typedef struct WalkerState WalkerState;
+
+// The table a rule's hooks get. It visits the nodes it's given with the rule
+// alone.
+typedef struct {
+    // First so it can be passed wherever a table is expected
+    TraversalFuncTable table;
+    WalkerState *walk;
+    uint64_t mask;
+} WalkerTable;
+
+struct WalkerState {
+    WalkerRun *run;
+    bool legacyLevels;
+    size_t depth;
+    WalkerTable tables[WalkerCount];
+};
+
+// Whether the rule hooks a type, and the call into its hook. The type is
+// always a constant, so they fold into the walker's functions.
+#define WalkerHookedCase(type, hook) case Traversal_ ## type:
+#define WalkerCallCase(type, hook)\
+    case Traversal_ ## type:\
+        hook(table, node, data);\
+        break;
+#define WalkerRuleFuncs(rule, hooks)\
+static inline bool WalkerHooks(rule)(TraversalType type) {\
+    switch (type) {\
+    hooks(WalkerHookedCase)\
+        return true;\
+    default:\
+        return false;\
+    }\
+}\
+\
+static inline void WalkerCall(rule)(WalkerState *walk, TraversalType type,\
+    void *node)\
+{\
+    TraversalFuncTable *table = &(walk->tables[WalkerIndex(rule)].table);\
+    void *data = walk->run->data[WalkerIndex(rule)];\
+\
+    switch (type) {\
+    hooks(WalkerCallCase)\
+    default:\
+        break;\
+    }\
+}
+WalkerRules(WalkerRuleFuncs)
+#undef WalkerRuleFuncs
+#undef WalkerCallCase
+#undef WalkerHookedCase
+
+// The rules that hook a type
+static inline uint64_t WalkerHooked(TraversalType type) {
+#define WalkerHookedBit(rule, hooks)\
+    (WalkerHooks(rule)(type) ? WalkerBit(rule) : 0) |
+    return WalkerRules(WalkerHookedBit) 0;
+#undef WalkerHookedBit
+}
+
+#define WalkerKind(type, hook) traversal_trackedKind(Traversal_ ## type) |
+
+// Drops the rules that hook none of the kinds under a node
+static inline uint64_t WalkerPrune(uint64_t mask, NodeKindMask kinds) {
+#define WalkerPruneRule(rule, hooks) {\
+    NodeKindMask wanted = hooks(WalkerKind) 0;\
+    if (wanted != AllNodeKinds && (kinds & wanted) == 0)\
+        mask &= ~WalkerBit(rule);\
+}
+    WalkerRules(WalkerPruneRule)
+#undef WalkerPruneRule
+
+    return mask;
+}
+
+// The rules that hook one of the legacy levels
+static inline uint64_t WalkerLegacyRules() {
+#define WalkerIsLegacy(type) WalkerHooked(Traversal_ ## type) |
+    return LegacyBinaryTypes(WalkerIsLegacy) 0;
+#undef WalkerIsLegacy
+}
+
+#define WalkerPrototype(type) static void WalkerFunc(type)(WalkerState *walk,\
+    uint64_t reached, type *node);
+TraversalTypes(WalkerPrototype)
+#undef WalkerPrototype
+
+#define TraversalBody(type, name) static void WalkerBody(type)(\
+    WalkerState *walk, uint64_t mask, type *name)
+#define TraverseChild(type, node) do {\
+    type *child = (node);\
+    traversal_pushAncestor(Traversal_ ## type, child);\
+    WalkerFunc(type)(walk, mask, child);\
+    traversal_popAncestor();\
+} while (0)
+#define TraversalLegacyLevels (walk->legacyLevels)
+#define TraversalPrune(node)\
+    mask = WalkerPrune(mask, (node)->kinds);\
+    if (mask == 0) {\
+        return;\
+    }
+#include "traversalBodies.h"
+
+#define WalkerEntryFunc(type) static void WalkerEntry(type)(\
+    TraversalFuncTable *table, type *node, void *data)\
+{\
+    WalkerTable *from = (WalkerTable*)table;\
+    WalkerFunc(type)(from->walk, from->mask, node);\
+}
+TraversalTypes(WalkerEntryFunc)
+#undef WalkerEntryFunc
+
+typedef struct {
+    WalkerState *walk;
+    uint64_t reached;
+    TraversalType type;
+    void *node;
+} WalkerDeeper;
+
+static void WalkerDeep(void *data) {
+    WalkerDeeper *visit = data;
+    WalkerState *walk = visit->walk;
+
+    size_t depth = walk->depth;
+    walk->depth = 0;
+
+    switch (visit->type) {
+#define WalkerDeepCase(type)\
+    case Traversal_ ## type:\
+        WalkerFunc(type)(walk, visit->reached, visit->node);\
+        break;
+    TraversalTypes(WalkerDeepCase)
+#undef WalkerDeepCase
+    default:
+        assert(false);
+    }
+
+    walk->depth = depth;
+}
+
+#define WalkerCallRule(rule, hooks)\
+    if (WalkerHooks(rule)(nodeType) && (reached & WalkerBit(rule)) != 0)\
+        WalkerCall(rule)(walk, nodeType, node);
+
+#define WalkerNodeFunc(type) static void WalkerFunc(type)(WalkerState *walk,\
+    uint64_t reached, type *node)\
+{\
+    if (walk->depth == MaxTraversalRecursion) {\
+        WalkerDeeper visit = { walk, reached, Traversal_ ## type, node };\
+        traversal_callDeeper(WalkerDeep, &visit);\
+        return;\
+    }\
+\
+    const TraversalType nodeType = Traversal_ ## type;\
+    WalkerRun *run = walk->run;\
+    uint64_t continued = reached & ~WalkerHooked(nodeType);\
+    walk->depth++;\
+\
+    for (size_t i = 0; i < run->numVisitors; i++) {\
+        uint64_t bit = WalkerVisitorBit(i);\
+        if ((reached & bit) != 0 && !run->visitors[i](TraversalEvent_Enter,\
+            nodeType, node, run->visitorData[i]))\
+        {\
+            continued &= ~bit;\
+        }\
+    }\
+\
+    WalkerRules(WalkerCallRule)\
+\
+    if (continued != 0) {\
+        WalkerBody(type)(walk, continued, node);\
+    }\
+\
+    for (size_t i = 0; i < run->numVisitors; i++) {\
+        if ((reached & WalkerVisitorBit(i)) != 0) {\
+            run->visitors[i](TraversalEvent_Leave, nodeType, node,\
+                run->visitorData[i]);\
+        }\
+    }\
+    walk->depth--;\
+}
+TraversalTypes(WalkerNodeFunc)
+#undef WalkerNodeFunc
+#undef WalkerCallRule
+
+void WalkerName(TranslationUnit *unit, WalkerRun *run) {
+    assert(WalkerCount + run->numVisitors <= 64);
+
+    uint64_t reached = run->rules;
+    for (size_t i = 0; i < run->numVisitors; i++) {
+        reached |= WalkerVisitorBit(i);
+    }
+
+    if (reached == 0)
+        return;
+
+    // A walk either builds the legacy levels or visits the BinaryExprs
+    bool legacyLevels = run->legacyLevels ||
+        (run->rules & WalkerLegacyRules()) != 0;
+    assert(!legacyLevels ||
+        (run->rules & WalkerHooked(Traversal_BinaryExpr)) == 0);
+
+    WalkerState walk = {
+        .run = run,
+        .legacyLevels = legacyLevels,
+    };
+
+    for (size_t i = 0; i < WalkerCount; i++) {
+        WalkerTable *table = walk.tables + i;
+        *table = (WalkerTable){ .walk = &walk, .mask = (uint64_t)1 << i };
+
+#define WalkerSetEntry(type)\
+        table->table.traverse_ ## type = WalkerEntry(type);
+        TraversalTypes(WalkerSetEntry)
+#undef WalkerSetEntry
+
+        // Without the legacy levels, a hook's default traversal of a
+        // ConditionalExpr goes straight to its BinaryExprs
+        if (!legacyLevels) {
+#define WalkerSetLegacyDefault(type)\
+            table->table.traverse_ ## type = defaultTraversal_ ## type;
+            LegacyBinaryTypes(WalkerSetLegacyDefault)
+#undef WalkerSetLegacyDefault
+        }
+    }
+
+    traversal_pushAncestor(Traversal_TranslationUnit, unit);
+    WalkerFunc(TranslationUnit)(&walk, reached, unit);
+    traversal_popAncestor();
+}
+
+#undef WalkerKind
+#undef WalkerVisitorBit
+#undef WalkerLegacyRules
+#undef WalkerPrune
+#undef WalkerHooked
+#undef WalkerDeep
+#undef WalkerDeeper
+#undef WalkerTable
+#undef WalkerState
+#undef WalkerCount
+#undef WalkerBit
+#undef WalkerCall
+#undef WalkerHooks
+#undef WalkerIndex
+#undef WalkerEntry
+#undef WalkerBody
+#undef WalkerFunc
+#undef WalkerConcat_
+#undef WalkerConcat
+#undef WalkerName
+#undef WalkerRules
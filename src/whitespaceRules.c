@@ -6,121 +6,130 @@
 
 #include "traversal.h"
 
+// Tokens from included headers aren't in the file's buffer, so they're taken
+// to be spaced
 static bool checkForTrailingSpace(RuleContext context, Token tok, size_t length) {
+    if (!token_isFrom(&tok, context.fileName))
+        return true;
+
     uint8_t lastChar = context.fileBuffer.bytes[tok.fileIndex + length];
     return (lastChar == ' ') || (lastChar == '\r') || (lastChar == '\n');
 }
 
 static bool checkForLeadingSpace(RuleContext context, Token tok) {
+    if (!token_isFrom(&tok, context.fileName))
+        return true;
+
     uint8_t lastChar = context.fileBuffer.bytes[tok.fileIndex - 1];
     return (lastChar == ' ') || (lastChar == '\r') || (lastChar == '\n');
 }
 
-// Ensures 1 space after if, while, for, switch, and return
-void rule_3_1_a(Rule rule, RuleContext context) {
-    for (uint64_t i = 0; i < context.tokens.numTokens; i++) {
-        Token token = context.tokens.tokens[i];
-
-        char *keywordString = NULL;
-
-        switch (token.type)
-        {
-            case Token_if: {
-                keywordString = "if";
-                break;
-            }
-            case Token_while: {
-                keywordString = "while";
-                break;
-            }
-            case Token_for: {
-                keywordString = "for";
-                break;
-            }
-            case Token_switch: {
-                keywordString = "switch";
-                break;
-            }
-            case Token_return: {
-                keywordString = "return";
-                break;
-            }
-            default: {
-                continue;
-            }
-        }
-
-        bool hasSpaceAfterToken = checkForTrailingSpace(context, token, strlen(keywordString));
-
-        if (token.type == Token_return && !hasSpaceAfterToken) {
-            // Check if it's a semicolon after return
-            if (context.fileBuffer.bytes[token.fileIndex + strlen(keywordString)] == ';') {
-                hasSpaceAfterToken = true;
-            }
+static void rule_3_1_a_checkKeyword(Rule *rule, RuleContext *context,
+    Token *token, char *keywordString, size_t length)
+{
+    bool hasSpaceAfterToken = checkForTrailingSpace(*context, *token, length);
+
+    if (token->type == Token_return && !hasSpaceAfterToken &&
+        token_isFrom(token, context->fileName))
+    {
+        // Check if it's a semicolon after return
+        if (context->fileBuffer.bytes[token->fileIndex + length] == ';') {
+            hasSpaceAfterToken = true;
         }
+    }
 
-        if (!hasSpaceAfterToken) {
-            reportRuleViolation(rule.name, token.fileName, token.line,
-                "%s %s", keywordString, "has no trailing space character");
-        }
+    if (!hasSpaceAfterToken) {
+        reportRuleViolation(rule->name, token->fileName, token->line,
+            "%s %s", keywordString, "has no trailing space character");
     }
 }
 
-// Ensures 1 space before and after =, +=, -=, *=, /=, %=, &=, |=, ^=, and !=
-void rule_3_1_b(Rule rule, RuleContext context) {
-    for (uint64_t i = 0; i < context.tokens.numTokens; i++) {
-        Token token = context.tokens.tokens[i];
-
-        char *opString = NULL;
-
-        if (token.type == '=')
-            opString = "=";
-        else if (token.type == Token_AddAssign)
-            opString = "+=";
-        else if (token.type == Token_SubAssign)
-            opString = "-=";
-        else if (token.type == Token_MulAssign)
-            opString = "*=";
-        else if (token.type == Token_DivAssign)
-            opString = "/=";
-        else if (token.type == Token_ModAssign)
-            opString = "*=";
-        else if (token.type == Token_AndAssign)
-            opString = "&=";
-        else if (token.type == Token_OrAssign)
-            opString = "|=";
-        else if (token.type == Token_XorAssign)
-            opString = "^=";
-        else
-            continue;
+#define Rule_3_1_a_Keywords(X)\
+    X(if)\
+    X(while)\
+    X(for)\
+    X(switch)\
+    X(return)
+
+#define Rule_3_1_a_Check(keyword)\
+static void rule_3_1_a_check_ ## keyword(Rule *rule, RuleContext *context,\
+    Token *token)\
+{\
+    rule_3_1_a_checkKeyword(rule, context, token, #keyword,\
+        sizeof(#keyword) - 1);\
+}
+Rule_3_1_a_Keywords(Rule_3_1_a_Check)
+#undef Rule_3_1_a_Check
 
-        bool hasSpaceAfterToken = checkForTrailingSpace(context, token, strlen(opString));
-        bool hasSpaceBeforeToken = checkForLeadingSpace(context, token);
+static const TokenSubscription rule_3_1_a_tokens[] = {
+#define Rule_3_1_a_Subscription(keyword)\
+    { Token_ ## keyword, rule_3_1_a_check_ ## keyword },
+    Rule_3_1_a_Keywords(Rule_3_1_a_Subscription)
+#undef Rule_3_1_a_Subscription
+};
 
-        if (!hasSpaceAfterToken) {
-            reportRuleViolation(rule.name, token.fileName, token.line,
-                "%s %s", opString, "has no trailing space character");
-        }
+// Ensures 1 space after if, while, for, switch, and return
+size_t rule_3_1_a(const TokenSubscription **outSubscriptions) {
+    *outSubscriptions = rule_3_1_a_tokens;
+    return sizeof(rule_3_1_a_tokens) / sizeof(TokenSubscription);
+}
 
-        if (!hasSpaceBeforeToken) {
-            reportRuleViolation(rule.name, token.fileName, token.line,
-                "%s %s", opString, "has no leading space character");
-        }
+static void rule_3_1_b_checkOp(Rule *rule, RuleContext *context,
+    Token *token, char *opString, size_t length)
+{
+    bool hasSpaceAfterToken = checkForTrailingSpace(*context, *token, length);
+    bool hasSpaceBeforeToken = checkForLeadingSpace(*context, *token);
+
+    if (!hasSpaceAfterToken) {
+        reportRuleViolation(rule->name, token->fileName, token->line,
+            "%s %s", opString, "has no trailing space character");
+    }
+
+    if (!hasSpaceBeforeToken) {
+        reportRuleViolation(rule->name, token->fileName, token->line,
+            "%s %s", opString, "has no leading space character");
     }
 }
 
-typedef struct {
-    Rule rule;
-    RuleContext context;
-} RuleAndContext;
+#define Rule_3_1_b_Ops(X)\
+    X(Assign, '=', "=")\
+    X(AddAssign, Token_AddAssign, "+=")\
+    X(SubAssign, Token_SubAssign, "-=")\
+    X(MulAssign, Token_MulAssign, "*=")\
+    X(DivAssign, Token_DivAssign, "/=")\
+    X(ModAssign, Token_ModAssign, "%=")\
+    X(AndAssign, Token_AndAssign, "&=")\
+    X(OrAssign, Token_OrAssign, "|=")\
+    X(XorAssign, Token_XorAssign, "^=")
+
+#define Rule_3_1_b_Check(name, type, op)\
+static void rule_3_1_b_check_ ## name(Rule *rule, RuleContext *context,\
+    Token *token)\
+{\
+    rule_3_1_b_checkOp(rule, context, token, op, sizeof(op) - 1);\
+}
+Rule_3_1_b_Ops(Rule_3_1_b_Check)
+#undef Rule_3_1_b_Check
+
+static const TokenSubscription rule_3_1_b_tokens[] = {
+#define Rule_3_1_b_Subscription(name, type, op)\
+    { type, rule_3_1_b_check_ ## name },
+    Rule_3_1_b_Ops(Rule_3_1_b_Subscription)
+#undef Rule_3_1_b_Subscription
+};
+
+// Ensures 1 space before and after =, +=, -=, *=, /=, %=, &=, |=, ^=, and !=
+size_t rule_3_1_b(const TokenSubscription **outSubscriptions) {
+    *outSubscriptions = rule_3_1_b_tokens;
+    return sizeof(rule_3_1_b_tokens) / sizeof(TokenSubscription);
+}
 
-static void rule_3_1_c_traverseMultiplicative(TraversalFuncTable *table, MultiplicativeExpr *expr, void *data) {
+void rule_3_1_c_traverseMultiplicative(TraversalFuncTable *table, MultiplicativeExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
 
-    sll_foreach(expr->postExprs, node) {
-        MultiplicativePost *post = slNode_getData(node);
+    astList_foreach(expr->postExprs, MultiplicativePost, post) {
 
         char *multiplicativeStr = NULL;
 
@@ -147,13 +156,12 @@ static void rule_3_1_c_traverseMultiplicative(TraversalFuncTable *table, Multipl
     defaultTraversal_MultiplicativeExpr(table, expr, data);
 }
 
-static void rule_3_1_c_traverseAdditive(TraversalFuncTable *table, AdditiveExpr *expr, void *data) {
+void rule_3_1_c_traverseAdditive(TraversalFuncTable *table, AdditiveExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
 
-    sll_foreach(expr->postExprs, node) {
-        AdditivePost *post = slNode_getData(node);
+    astList_foreach(expr->postExprs, AdditivePost, post) {
 
         char *additiveStr = NULL;
 
@@ -178,13 +186,12 @@ static void rule_3_1_c_traverseAdditive(TraversalFuncTable *table, AdditiveExpr
     defaultTraversal_AdditiveExpr(table, expr, data);
 }
 
-static void rule_3_1_c_traverseShift(TraversalFuncTable *table, ShiftExpr *expr, void *data) {
+void rule_3_1_c_traverseShift(TraversalFuncTable *table, ShiftExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
 
-    sll_foreach(expr->postExprs, node) {
-        ShiftPost *post = slNode_getData(node);
+    astList_foreach(expr->postExprs, ShiftPost, post) {
 
         char *shiftStr = NULL;
 
@@ -209,13 +216,12 @@ static void rule_3_1_c_traverseShift(TraversalFuncTable *table, ShiftExpr *expr,
     defaultTraversal_ShiftExpr(table, expr, data);
 }
 
-static void rule_3_1_c_traverseRelational(TraversalFuncTable *table, RelationalExpr *expr, void *data) {
+void rule_3_1_c_traverseRelational(TraversalFuncTable *table, RelationalExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
 
-    sll_foreach(expr->postExprs, node) {
-        RelationalPost *post = slNode_getData(node);
+    astList_foreach(expr->postExprs, RelationalPost, post) {
 
         char *relationalStr = NULL;
 
@@ -244,13 +250,12 @@ static void rule_3_1_c_traverseRelational(TraversalFuncTable *table, RelationalE
     defaultTraversal_RelationalExpr(table, expr, data);
 }
 
-static void rule_3_1_c_traverseEquality(TraversalFuncTable *table, EqualityExpr *expr, void *data) {
+void rule_3_1_c_traverseEquality(TraversalFuncTable *table, EqualityExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
 
-    sll_foreach(expr->postExprs, node) {
-        EqualityPost *post = slNode_getData(node);
+    astList_foreach(expr->postExprs, EqualityPost, post) {
 
         char *equalityStr = NULL;
 
@@ -275,7 +280,7 @@ static void rule_3_1_c_traverseEquality(TraversalFuncTable *table, EqualityExpr
     defaultTraversal_EqualityExpr(table, expr, data);
 }
 
-static void rule_3_1_c_traverseAnd(TraversalFuncTable *table, AndExpr *expr, void *data) {
+void rule_3_1_c_traverseAnd(TraversalFuncTable *table, AndExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
@@ -285,11 +290,12 @@ static void rule_3_1_c_traverseAnd(TraversalFuncTable *table, AndExpr *expr, voi
         assert(false);
     }
     else if (expr->list.size > 1) {
-        SLList oneAfter = expr->list;
-        oneAfter.head = oneAfter.head->next;
+        AstList oneAfter = {
+            .size = expr->list.size - 1,
+            .items = astList_get(expr->list, EqualityExpr, 1)
+        };
 
-        sll_foreach(oneAfter, node) {
-            EqualityExpr *eq = slNode_getData(node);
+        astList_foreach(oneAfter, EqualityExpr, eq) {
             Token *tok = eq->tok - 1;
 
             if (!checkForLeadingSpace(context, *tok)) {
@@ -307,7 +313,7 @@ static void rule_3_1_c_traverseAnd(TraversalFuncTable *table, AndExpr *expr, voi
     defaultTraversal_AndExpr(table, expr, data);
 }
 
-static void rule_3_1_c_traverseExclusiveOr(TraversalFuncTable *table, ExclusiveOrExpr *expr, void *data) {
+void rule_3_1_c_traverseExclusiveOr(TraversalFuncTable *table, ExclusiveOrExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
@@ -317,11 +323,12 @@ static void rule_3_1_c_traverseExclusiveOr(TraversalFuncTable *table, ExclusiveO
         assert(false);
     }
     else if (expr->list.size > 1) {
-        SLList oneAfter = expr->list;
-        oneAfter.head = oneAfter.head->next;
+        AstList oneAfter = {
+            .size = expr->list.size - 1,
+            .items = astList_get(expr->list, AndExpr, 1)
+        };
 
-        sll_foreach(oneAfter, node) {
-            AndExpr *and = slNode_getData(node);
+        astList_foreach(oneAfter, AndExpr, and) {
             Token *tok = and->tok - 1;
 
             if (!checkForLeadingSpace(context, *tok)) {
@@ -339,7 +346,7 @@ static void rule_3_1_c_traverseExclusiveOr(TraversalFuncTable *table, ExclusiveO
     defaultTraversal_ExclusiveOrExpr(table, expr, data);
 }
 
-static void rule_3_1_c_traverseInclusiveOr(TraversalFuncTable *table, InclusiveOrExpr *expr, void *data) {
+void rule_3_1_c_traverseInclusiveOr(TraversalFuncTable *table, InclusiveOrExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
@@ -349,11 +356,12 @@ static void rule_3_1_c_traverseInclusiveOr(TraversalFuncTable *table, InclusiveO
         assert(false);
     }
     else if (expr->list.size > 1) {
-        SLList oneAfter = expr->list;
-        oneAfter.head = oneAfter.head->next;
+        AstList oneAfter = {
+            .size = expr->list.size - 1,
+            .items = astList_get(expr->list, ExclusiveOrExpr, 1)
+        };
 
-        sll_foreach(oneAfter, node) {
-            ExclusiveOrExpr *or = slNode_getData(node);
+        astList_foreach(oneAfter, ExclusiveOrExpr, or) {
             Token *tok = or->tok - 1;
 
             if (!checkForLeadingSpace(context, *tok)) {
@@ -371,7 +379,7 @@ static void rule_3_1_c_traverseInclusiveOr(TraversalFuncTable *table, InclusiveO
     defaultTraversal_InclusiveOrExpr(table, expr, data);
 }
 
-static void rule_3_1_c_traverseLogicalAnd(TraversalFuncTable *table, LogicalAndExpr *expr, void *data) {
+void rule_3_1_c_traverseLogicalAnd(TraversalFuncTable *table, LogicalAndExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
@@ -381,11 +389,12 @@ static void rule_3_1_c_traverseLogicalAnd(TraversalFuncTable *table, LogicalAndE
         assert(false);
     }
     else if (expr->list.size > 1) {
-        SLList oneAfter = expr->list;
-        oneAfter.head = oneAfter.head->next;
+        AstList oneAfter = {
+            .size = expr->list.size - 1,
+            .items = astList_get(expr->list, InclusiveOrExpr, 1)
+        };
 
-        sll_foreach(oneAfter, node) {
-            InclusiveOrExpr *or = slNode_getData(node);
+        astList_foreach(oneAfter, InclusiveOrExpr, or) {
             Token *tok = or->tok - 1;
 
             if (!checkForLeadingSpace(context, *tok)) {
@@ -403,7 +412,7 @@ static void rule_3_1_c_traverseLogicalAnd(TraversalFuncTable *table, LogicalAndE
     defaultTraversal_LogicalAndExpr(table, expr, data);
 }
 
-static void rule_3_1_c_traverseLogicalOr(TraversalFuncTable *table, LogicalOrExpr *expr, void *data) {
+void rule_3_1_c_traverseLogicalOr(TraversalFuncTable *table, LogicalOrExpr *expr, void *data) {
     RuleAndContext *ruleAndContext = data;
     Rule rule = ruleAndContext->rule;
     RuleContext context = ruleAndContext->context;
@@ -413,11 +422,12 @@ static void rule_3_1_c_traverseLogicalOr(TraversalFuncTable *table, LogicalOrExp
         assert(false);
     }
     else if (expr->list.size > 1) {
-        SLList oneAfter = expr->list;
-        oneAfter.head = oneAfter.head->next;
+        AstList oneAfter = {
+            .size = expr->list.size - 1,
+            .items = astList_get(expr->list, LogicalAndExpr, 1)
+        };
 
-        sll_foreach(oneAfter, node) {
-            LogicalAndExpr *and = slNode_getData(node);
+        astList_foreach(oneAfter, LogicalAndExpr, and) {
             Token *tok = and->tok - 1;
 
             if (!checkForLeadingSpace(context, *tok)) {
@@ -437,19 +447,99 @@ static void rule_3_1_c_traverseLogicalOr(TraversalFuncTable *table, LogicalOrExp
 
 // Ensures 1 space before and after +, -, *, /, %, <, <=, >, >=, ==,
 // !=, <<, >>, &, |, ^, &&, ||
-void rule_3_1_c(Rule rule, RuleContext context) {
-    TraversalFuncTable funcTable = defaultTraversal();
-    funcTable.traverse_LogicalOrExpr = rule_3_1_c_traverseLogicalOr;
-    funcTable.traverse_LogicalAndExpr = rule_3_1_c_traverseLogicalAnd;
-    funcTable.traverse_InclusiveOrExpr = rule_3_1_c_traverseInclusiveOr;
-    funcTable.traverse_ExclusiveOrExpr = rule_3_1_c_traverseExclusiveOr;
-    funcTable.traverse_AndExpr = rule_3_1_c_traverseAnd;
-    funcTable.traverse_EqualityExpr = rule_3_1_c_traverseEquality;
-    funcTable.traverse_RelationalExpr = rule_3_1_c_traverseRelational;
-    funcTable.traverse_ShiftExpr = rule_3_1_c_traverseShift;
-    funcTable.traverse_AdditiveExpr = rule_3_1_c_traverseAdditive;
-    funcTable.traverse_MultiplicativeExpr = rule_3_1_c_traverseMultiplicative;
-
-    RuleAndContext ruleAndContext = { .rule = rule, .context = context };
-    traverse(funcTable, context.translationUnit, &ruleAndContext);
+void rule_3_1_c(TraversalFuncTable *table) {
+    Rule_3_1_c_Hooks(SetRuleHook)
+}
+
+// The : of a conditional can't be told apart from a label's or a bit
+// field's by its tokens, so only the ? is checked
+static const TokenPattern rule_3_1_f_patterns[] = {
+    {
+        .types = { '?' },
+        .before = { TokenTrivia_None },
+        .message = "? has no leading space character",
+    },
+    {
+        .types = { '?' },
+        .after = TokenTrivia_None,
+        .message = "? has no trailing space character",
+    },
+};
+
+// Ensures 1 space before and after the ? of a conditional
+size_t rule_3_1_f(const TokenPattern **outPatterns) {
+    *outPatterns = rule_3_1_f_patterns;
+    return sizeof(rule_3_1_f_patterns) / sizeof(TokenPattern);
+}
+
+// A space before a . only counts after something that can be a member
+// access's operand, since designators start with one too. Breaking a long
+// chain over lines is fine.
+#define Rule_3_1_g_SpaceBeforeDot(type) {\
+    .types = { type, '.' },\
+    .before = { TokenTrivia_Any, TokenTrivia_Space },\
+    .report = 1,\
+    .message = ". has a leading space character",\
+}
+
+static const TokenPattern rule_3_1_g_patterns[] = {
+    {
+        .types = { Token_PtrOp },
+        .before = { TokenTrivia_Space },
+        .message = "-> has a leading space character",
+    },
+    {
+        .types = { Token_PtrOp },
+        .after = TokenTrivia_Space,
+        .message = "-> has a trailing space character",
+    },
+    Rule_3_1_g_SpaceBeforeDot(Token_Ident),
+    Rule_3_1_g_SpaceBeforeDot(')'),
+    Rule_3_1_g_SpaceBeforeDot(']'),
+    {
+        .types = { '.', Token_Ident },
+        .before = { TokenTrivia_Any, TokenTrivia_Space },
+        .message = ". has a trailing space character",
+    },
+};
+
+#undef Rule_3_1_g_SpaceBeforeDot
+
+// Ensures no spaces around -> and .
+size_t rule_3_1_g(const TokenPattern **outPatterns) {
+    *outPatterns = rule_3_1_g_patterns;
+    return sizeof(rule_3_1_g_patterns) / sizeof(TokenPattern);
+}
+
+// Like the . in 3.1.g, a [ only needs to be next to what it subscripts, so
+// designators and spaces other rules want after a ] are left alone
+#define Rule_3_1_h_SpaceBeforeBracket(type) {\
+    .types = { type, '[' },\
+    .before = { TokenTrivia_Any, TokenTrivia_Space },\
+    .report = 1,\
+    .message = "[ has a leading space character",\
+}
+
+static const TokenPattern rule_3_1_h_patterns[] = {
+    Rule_3_1_h_SpaceBeforeBracket(Token_Ident),
+    Rule_3_1_h_SpaceBeforeBracket(')'),
+    Rule_3_1_h_SpaceBeforeBracket(']'),
+    {
+        .types = { '[' },
+        .after = TokenTrivia_Space,
+        .message = "[ has a trailing space character",
+    },
+    {
+        .types = { ']' },
+        .before = { TokenTrivia_Space },
+        .message = "] has a leading space character",
+    },
+};
+
+#undef Rule_3_1_h_SpaceBeforeBracket
+
+// Ensures no spaces around [ and ] where no other rule wants one
+size_t rule_3_1_h(const TokenPattern **outPatterns) {
+    *outPatterns = rule_3_1_h_patterns;
+    return sizeof(rule_3_1_h_patterns) / sizeof(TokenPattern);
 }
@@ -3,11 +3,32 @@
 #include "rule.h"
 
 // Ensures 1 space after if, while, for, switch, and return
-void rule_3_1_a(Rule rule, RuleContext context);
+size_t rule_3_1_a(const TokenSubscription **outSubscriptions);
 
 // Ensures 1 space before and after =, +=, -=, *=, /=, %=, &=, |=, and ^=
-void rule_3_1_b(Rule rule, RuleContext context);
+size_t rule_3_1_b(const TokenSubscription **outSubscriptions);
 
 // Ensures 1 space before and after +, -, *, /, %, <, <=, >, >=, ==,
 // !=, <<, >>, &, |, ^, &&, ||
-void rule_3_1_c(Rule rule, RuleContext context);
+void rule_3_1_c(TraversalFuncTable *table);
+#define Rule_3_1_c_Hooks(X)\
+    X(LogicalOrExpr, rule_3_1_c_traverseLogicalOr)\
+    X(LogicalAndExpr, rule_3_1_c_traverseLogicalAnd)\
+    X(InclusiveOrExpr, rule_3_1_c_traverseInclusiveOr)\
+    X(ExclusiveOrExpr, rule_3_1_c_traverseExclusiveOr)\
+    X(AndExpr, rule_3_1_c_traverseAnd)\
+    X(EqualityExpr, rule_3_1_c_traverseEquality)\
+    X(RelationalExpr, rule_3_1_c_traverseRelational)\
+    X(ShiftExpr, rule_3_1_c_traverseShift)\
+    X(AdditiveExpr, rule_3_1_c_traverseAdditive)\
+    X(MultiplicativeExpr, rule_3_1_c_traverseMultiplicative)
+Rule_3_1_c_Hooks(RuleHookPrototype)
+
+// Ensures 1 space before and after the ? of a conditional
+size_t rule_3_1_f(const TokenPattern **outPatterns);
+
+// Ensures no spaces around -> and .
+size_t rule_3_1_g(const TokenPattern **outPatterns);
+
+// Ensures no spaces around [ and ] where no other rule wants one
+size_t rule_3_1_h(const TokenPattern **outPatterns);
@@ -0,0 +1,30 @@
+#define A 3
+#define B (A * 2)
+#if B == 6 && defined(A) && !defined C
+int ok1;
+#elif 1
+THIS IS INVALID CODE
+#else
+THIS IS INVALID CODE
+#endif
+#if -1 > 0u
+int ok2;
+#endif
+#if (2 || 1 / 0) && 'a' == 97 && 0x10 == 020 >> 0 + 2 - 2 + 2 == 1
+THIS IS INVALID CODE
+#elif (1 ? -1 : 0u) > 0
+int ok3;
+#endif
+#ifdef C
+# if 1
+THIS IS INVALID CODE
+# else
+THIS IS INVALID CODE
+# endif
+#elif defined B
+int ok4;
+#endif
+#undef A
+#ifndef A
+int ok5;
+#endif
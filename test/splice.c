@@ -0,0 +1,13 @@
+#define BUFFER_SIZE 64
+#define LONG_\
+NAME 1
+
+int main() {
+    char buffer[BUFFER_\
+SIZE];
+    int count = BUFF\
+ER_SIZE + LONG_NAME;
+    buff\
+er[0] = 0;
+    return count;
+}
@@ -0,0 +1,25 @@
+int main(int argc, char **argv)
+{
+    int total = 0;
+
+    for (int i = 0; i < argc; i++)
+    {
+        if (argv[i][0] == '-')
+        {
+            continue;
+        }
+
+        total++;
+    }
+
+    while (total > 10)
+    {
+        total--;
+        continue;
+    }
+
+    // A continue in a comment or a string isn't a keyword
+    char *word = "continue";
+
+    return total;
+}
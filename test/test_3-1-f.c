@@ -0,0 +1,29 @@
+struct flags
+{
+    unsigned int a : 1;
+    unsigned int b:1;
+};
+
+int main(int argc, char **argv)
+{
+    int x = (argc > 1) ? 1 : 0;
+    int y = (argc > 1)? 1 : 0;
+    int z = (argc > 1) ?1 : 0;
+    int w = (argc > 1)?1:0;
+
+    int v = (argc > 1)
+        ? 1
+        : 0;
+
+    switch (argc)
+    {
+        case 1:
+            x = 2;
+            break;
+        default:
+            break;
+    }
+
+done:
+    return x + y + z + w + v;
+}
@@ -0,0 +1,29 @@
+struct point
+{
+    int x;
+    int y;
+    struct point *next;
+};
+
+int main(int argc, char **argv)
+{
+    struct point a = { .x = 1, .y = 2, .next = 0 };
+    struct point b = {
+        .x = 3,
+        .y = 4,
+        .next = &a,
+    };
+    struct point *p = &b;
+    double half = 1.5;
+
+    int c = a.x + p->y;
+    int d = a .x + p ->y;
+    int e = a. x + p-> y;
+    int f = a . x + p -> y;
+    int g = p->next
+        ->next
+        ->x;
+    int h = (*p).y + (*p) .y;
+
+    return c + d + e + f + g + h + (int)half;
+}
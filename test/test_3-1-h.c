@@ -0,0 +1,15 @@
+int main(int argc, char **argv)
+{
+    int a[4] = { [0] = 1, [2] = 3 };
+    int b[2][2] = {
+        [0] = { 1, 2 },
+        [1] = { 3, 4 },
+    };
+
+    int c = a[1] + b[0][1];
+    int d = a [1] + b[0] [1];
+    int e = a[ 1] + b[0][1 ];
+    int f = a[ 1 ] + b [ 0 ][ 1 ];
+
+    return c + d + e + f + argv[0][0];
+}
@@ -0,0 +1,9 @@
+#include "test_3-1-h_include.h"
+
+int main(int argc, char **argv)
+{
+    int a[2] = { 1, 2 };
+    int b = a [1];
+
+    return b + headerLookup0(a, 0);
+}
@@ -0,0 +1,162 @@
+// Included by test_3-1-h_include.c. Its tokens come after the short file that
+// includes it, so their positions are past the end of that file's buffer.
+
+static inline int headerLookup0(int *table, int index) {
+    return table [index] + table[ index ] + 0;
+}
+
+static inline int headerLookup1(int *table, int index) {
+    return table [index] + table[ index ] + 1;
+}
+
+static inline int headerLookup2(int *table, int index) {
+    return table [index] + table[ index ] + 2;
+}
+
+static inline int headerLookup3(int *table, int index) {
+    return table [index] + table[ index ] + 3;
+}
+
+static inline int headerLookup4(int *table, int index) {
+    return table [index] + table[ index ] + 4;
+}
+
+static inline int headerLookup5(int *table, int index) {
+    return table [index] + table[ index ] + 5;
+}
+
+static inline int headerLookup6(int *table, int index) {
+    return table [index] + table[ index ] + 6;
+}
+
+static inline int headerLookup7(int *table, int index) {
+    return table [index] + table[ index ] + 7;
+}
+
+static inline int headerLookup8(int *table, int index) {
+    return table [index] + table[ index ] + 8;
+}
+
+static inline int headerLookup9(int *table, int index) {
+    return table [index] + table[ index ] + 9;
+}
+
+static inline int headerLookup10(int *table, int index) {
+    return table [index] + table[ index ] + 10;
+}
+
+static inline int headerLookup11(int *table, int index) {
+    return table [index] + table[ index ] + 11;
+}
+
+static inline int headerLookup12(int *table, int index) {
+    return table [index] + table[ index ] + 12;
+}
+
+static inline int headerLookup13(int *table, int index) {
+    return table [index] + table[ index ] + 13;
+}
+
+static inline int headerLookup14(int *table, int index) {
+    return table [index] + table[ index ] + 14;
+}
+
+static inline int headerLookup15(int *table, int index) {
+    return table [index] + table[ index ] + 15;
+}
+
+static inline int headerLookup16(int *table, int index) {
+    return table [index] + table[ index ] + 16;
+}
+
+static inline int headerLookup17(int *table, int index) {
+    return table [index] + table[ index ] + 17;
+}
+
+static inline int headerLookup18(int *table, int index) {
+    return table [index] + table[ index ] + 18;
+}
+
+static inline int headerLookup19(int *table, int index) {
+    return table [index] + table[ index ] + 19;
+}
+
+static inline int headerLookup20(int *table, int index) {
+    return table [index] + table[ index ] + 20;
+}
+
+static inline int headerLookup21(int *table, int index) {
+    return table [index] + table[ index ] + 21;
+}
+
+static inline int headerLookup22(int *table, int index) {
+    return table [index] + table[ index ] + 22;
+}
+
+static inline int headerLookup23(int *table, int index) {
+    return table [index] + table[ index ] + 23;
+}
+
+static inline int headerLookup24(int *table, int index) {
+    return table [index] + table[ index ] + 24;
+}
+
+static inline int headerLookup25(int *table, int index) {
+    return table [index] + table[ index ] + 25;
+}
+
+static inline int headerLookup26(int *table, int index) {
+    return table [index] + table[ index ] + 26;
+}
+
+static inline int headerLookup27(int *table, int index) {
+    return table [index] + table[ index ] + 27;
+}
+
+static inline int headerLookup28(int *table, int index) {
+    return table [index] + table[ index ] + 28;
+}
+
+static inline int headerLookup29(int *table, int index) {
+    return table [index] + table[ index ] + 29;
+}
+
+static inline int headerLookup30(int *table, int index) {
+    return table [index] + table[ index ] + 30;
+}
+
+static inline int headerLookup31(int *table, int index) {
+    return table [index] + table[ index ] + 31;
+}
+
+static inline int headerLookup32(int *table, int index) {
+    return table [index] + table[ index ] + 32;
+}
+
+static inline int headerLookup33(int *table, int index) {
+    return table [index] + table[ index ] + 33;
+}
+
+static inline int headerLookup34(int *table, int index) {
+    return table [index] + table[ index ] + 34;
+}
+
+static inline int headerLookup35(int *table, int index) {
+    return table [index] + table[ index ] + 35;
+}
+
+static inline int headerLookup36(int *table, int index) {
+    return table [index] + table[ index ] + 36;
+}
+
+static inline int headerLookup37(int *table, int index) {
+    return table [index] + table[ index ] + 37;
+}
+
+static inline int headerLookup38(int *table, int index) {
+    return table [index] + table[ index ] + 38;
+}
+
+static inline int headerLookup39(int *table, int index) {
+    return table [index] + table[ index ] + 39;
+}
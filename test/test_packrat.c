@@ -0,0 +1,77 @@
+// Deeply nested expressions. The binary operators are parsed once, but an
+// assignment expression starts with the unary expression that would be
+// assigned to, and parses the same tokens again as a conditional expression
+// when no assignment operator follows. Every level of parentheses holds
+// another assignment expression, so without --packrat each level doubles the
+// work done inside it. With --packrat it should parse as fast as any other
+// file. test_packrat.sh checks this with the backtrack counts --ast-stats
+// prints.
+
+typedef int number;
+
+int parens(int a)
+{
+    return
+        ((((((((((((((((
+        ((((((((((((((((
+        ((((((((((((((((
+        ((((((((((((((((
+        a
+        ))))))))))))))))
+        ))))))))))))))))
+        ))))))))))))))))
+        ))))))))))))))))
+        ;
+}
+
+int casts(int a)
+{
+    return
+        (number)(number)(number)(number)(number)(number)(number)(number)
+        (number)(number)(number)(number)(number)(number)(number)(number)
+        (number)(number)(number)(number)(number)(number)(number)(number)
+        (number)(number)(number)(number)(number)(number)(number)(number)
+        (number)(number)(number)(number)(number)(number)(number)(number)
+        (number)(number)(number)(number)(number)(number)(number)(number)
+        (number)(number)(number)(number)(number)(number)(number)(number)
+        (number)(number)(number)(number)(number)(number)(number)(number)
+        a;
+}
+
+int unary(int a)
+{
+    return
+        -(!(~(-(!(~(-(!(~(
+        -(!(~(-(!(~(-(!(~(
+        -(!(~(-(!(~(-(!(~(
+        -(!(~(-(!(~(-(!(~(
+        a
+        )))))))))
+        )))))))))
+        )))))))))
+        )))))))))
+        ;
+}
+
+int mixed(int a)
+{
+    return
+        ((number)(a + ((number)(a + ((number)(a + ((number)(a + 
+        ((number)(a + ((number)(a + ((number)(a + ((number)(a + 
+        ((number)(a + ((number)(a + ((number)(a + ((number)(a + 
+        ((number)(a + ((number)(a + ((number)(a + ((number)(a + 
+        ((number)(a + ((number)(a + ((number)(a + ((number)(a + 
+        ((number)(a + ((number)(a + ((number)(a + ((number)(a + 
+        ((number)(a + ((number)(a + ((number)(a + ((number)(a + 
+        ((number)(a + ((number)(a + ((number)(a + ((number)(a + 
+        a
+        ))))))))
+        ))))))))
+        ))))))))
+        ))))))))
+        ))))))))
+        ))))))))
+        ))))))))
+        ))))))))
+        ;
+}
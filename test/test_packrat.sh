@@ -0,0 +1,45 @@
+#!/bin/sh
+# Checks what test_packrat.c claims, with the backtrack counts --ast-stats
+# prints. Without --packrat every level of parentheses doubles the backtracks,
+# and with it they only grow by the same few per level. Run from the root of
+# the repo after building, or pass the analyzer to run.
+
+analyzer=${1:-./analyzer}
+dir=$(mktemp -d)
+trap 'rm -rf "$dir"' EXIT
+
+# A function returning an expression nested in $1 parentheses
+nested() {
+    parens=$(printf '%*s' "$1" '' | tr ' ' '(')
+    closes=$(printf '%*s' "$1" '' | tr ' ' ')')
+    printf 'int nested(int a)\n{\n    return %sa%s;\n}\n' "$parens" "$closes" \
+        > "$dir/nested$1.c"
+}
+
+backtracks() {
+    "$analyzer" --ast-stats $2 "$dir/nested$1.c" |
+        sed -n 's/^ *"backtracks": \([0-9]*\),$/\1/p'
+}
+
+nested 8
+nested 16
+
+plain8=$(backtracks 8)
+plain16=$(backtracks 16)
+packrat8=$(backtracks 8 --packrat)
+packrat16=$(backtracks 16 --packrat)
+
+echo "backtracks at 8 and 16 levels: $plain8 and $plain16 without --packrat," \
+    "$packrat8 and $packrat16 with it"
+
+# Eight more levels are 2^8 times the work without it, and less than twice
+# the work with it
+if [ -z "$plain8" ] || [ -z "$packrat8" ] ||
+    [ "$plain16" -lt $((plain8 * 128)) ] ||
+    [ "$packrat16" -ge $((packrat8 * 2)) ]
+then
+    echo "FAIL"
+    exit 1
+fi
+
+echo "OK"
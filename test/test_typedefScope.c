@@ -0,0 +1,34 @@
+// Typedef names are scoped like any other identifier, and an ordinary
+// identifier in an inner scope hides a typedef with the same name
+
+typedef int length;
+
+int area(int width, int height) {
+    typedef long wide;
+    wide result = (wide)width * height;
+
+    return result;
+}
+
+int scale(int length) {
+    // length is a parameter here, so this is a multiplication
+    return length * 2;
+}
+
+int shadow(int value) {
+    int result = 0;
+
+    {
+        int length = value;
+        result = length * 3;
+    }
+
+    // Back to the typedef
+    length total = result;
+    return total;
+}
+
+// wide went out of scope with area's body
+int wide = 4;
+
+enum { length_max = 10 };